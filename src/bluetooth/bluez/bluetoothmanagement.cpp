@@ -37,7 +37,9 @@
 **
 ****************************************************************************/
 
+#include <QtCore/qendian.h>
 #include <QtCore/qloggingcategory.h>
+#include <QtCore/qmetaobject.h>
 #include <QtCore/qsocketnotifier.h>
 #include <QtCore/qtimer.h>
 
@@ -72,6 +74,25 @@ struct MgmtEventDeviceFound {
     quint8 eirData[0];
 }  __attribute__((packed));
 
+struct MgmtEventDeviceConnected {
+    bdaddr_t bdaddr;
+    quint8 type;
+    quint32 flags;
+    quint16 eirLength;
+    quint8 eirData[0];
+}  __attribute__((packed));
+
+struct MgmtEventDeviceDisconnected {
+    bdaddr_t bdaddr;
+    quint8 type;
+    quint8 reason;
+}  __attribute__((packed));
+
+struct MgmtEventConnectFailed {
+    bdaddr_t bdaddr;
+    quint8 type;
+    quint8 status;
+}  __attribute__((packed));
 
 /*
  * This class encapsulates access to the Bluetooth Management API as introduced by
@@ -122,9 +143,20 @@ struct capData {
 
 const int msecInADay = 1000*60*60*24;
 
-inline uint qHash(const QBluetoothAddress& address)
+static inline quint64 randomAddressKey(const QBluetoothAddress &address)
+{
+    return address.toUInt64() + 1;
+}
+
+static inline int randomAddressSlot(quint64 key, int slotCount)
 {
-    return qHash(address.toUInt64());
+    // Fibonacci hashing, slotCount is a power of two
+    return int((key * Q_UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (slotCount - 1);
+}
+
+static inline QBluetoothAddress eventAddress(const bdaddr_t &address)
+{
+    return QBluetoothAddress(convertAddress(address.b));
 }
 
 static int sysCallCapGet(capHdr *header, capData *data)
@@ -185,6 +217,29 @@ BluetoothManagement::BluetoothManagement(QObject *parent) : QObject(parent)
         return;
     }
 
+    startMonitoring();
+}
+
+/*
+ * Monitors an already opened mgmt control \a socket; used by the autotests.
+ * The object takes ownership of \a socket.
+ */
+BluetoothManagement::BluetoothManagement(int socket, QObject *parent)
+    : QObject(parent), fd(socket)
+{
+    startMonitoring();
+}
+
+BluetoothManagement::~BluetoothManagement()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+void BluetoothManagement::startMonitoring()
+{
+    clock.start();
+
     notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
     connect(notifier, &QSocketNotifier::activated, this, &BluetoothManagement::_q_readNotifier);
 
@@ -213,66 +268,186 @@ void BluetoothManagement::_q_readNotifier()
         return;
     }
 
-    // do we have at least one complete mgmt header?
-    if ((uint)buffer.size() < sizeof(MgmtHdr))
-        return;
+    // Walk the buffered events in place; an incomplete trailing event stays
+    // in the buffer until the next notification.
+    const char *data = buffer.readPointer();
+    const int size = buffer.size();
+    int consumed = 0;
+    while (consumed < size) {
+        const int eventSize = processEvent(data + consumed, size - consumed);
+        if (eventSize == 0)
+            break;
+        consumed += eventSize;
+    }
 
-    QByteArray data = buffer.readAll();
+    buffer.skip(consumed);
+}
 
-    while (true) {
-        if ((uint)data.size() < sizeof(MgmtHdr))
-            break;
+/*
+ * Processes the event at the start of \a data and returns the number of bytes
+ * it occupies, or 0 if \a data does not contain a complete event yet.
+ */
+int BluetoothManagement::processEvent(const char *data, int size)
+{
+    if (size < int(sizeof(MgmtHdr)))
+        return 0;
+
+    MgmtHdr hdr;
+    memcpy(&hdr, data, sizeof(MgmtHdr));
+    const int length = qFromLittleEndian(hdr.length);
+    const int eventSize = length + int(sizeof(MgmtHdr));
+    if (size < eventSize)
+        return 0;
+
+    const quint16 controllerIndex = qFromLittleEndian(hdr.controllerIndex);
+    const char *params = data + sizeof(MgmtHdr);
+
+    switch (static_cast<EventCode>(qFromLittleEndian(hdr.cmdCode))) {
+    case EventCode::DeviceFoundEvent:
+        processDeviceFound(controllerIndex, params, length);
+        break;
+    case EventCode::DeviceConnectedEvent:
+        processDeviceConnected(controllerIndex, params, length);
+        break;
+    case EventCode::DeviceDisconnectedEvent:
+        processDeviceDisconnected(controllerIndex, params, length);
+        break;
+    case EventCode::ConnectFailedEvent:
+        processConnectFailed(controllerIndex, params, length);
+        break;
+    default:
+        qCDebug(QT_BT_BLUEZ) << "BluetoothManagement: Ignored event:"
+                             << Qt::hex << (EventCode)qFromLittleEndian(hdr.cmdCode);
+        break;
+    }
 
-        const MgmtHdr *hdr = reinterpret_cast<const MgmtHdr*>(data.constData());
-        const int nextPackageSize = qFromLittleEndian(hdr->length) + sizeof(MgmtHdr);
-        const int remainingPackageSize = data.length() - nextPackageSize;
+    return eventSize;
+}
 
-        if (data.length() < nextPackageSize)
-            break; // not a complete event header -> wait for next notifier
+void BluetoothManagement::processDeviceFound(quint16 controllerIndex, const char *data, int length)
+{
+    MgmtEventDeviceFound event;
+    if (length < int(sizeof(event)))
+        return;
+    memcpy(&event, data, sizeof(event));
 
-        switch (static_cast<EventCode>(qFromLittleEndian(hdr->cmdCode))) {
-        case EventCode::DeviceFoundEvent:
-        {
-            const MgmtEventDeviceFound *event = reinterpret_cast<const MgmtEventDeviceFound*>
-                                                   (data.constData() + sizeof(MgmtHdr));
+    const int eirLength = qFromLittleEndian(event.eirLength);
+    if (length < int(sizeof(event)) + eirLength) {
+        qCWarning(QT_BT_BLUEZ) << "BluetoothManagement: Malformed device found event";
+        return;
+    }
 
-            if (event->type == BDADDR_LE_RANDOM) {
-                const bdaddr_t address = event->bdaddr;
-                quint64 bdaddr;
+    const QBluetoothAddress qtAddress = eventAddress(event.bdaddr);
+    if (event.type == BDADDR_LE_RANDOM) {
+        qCDebug(QT_BT_BLUEZ) << "BluetoothManagement: found random device" << qtAddress;
+        processRandomAddressFlagInformation(qtAddress);
+    }
 
-                convertAddress(address.b, &bdaddr);
-                const QBluetoothAddress qtAddress(bdaddr);
-                qCDebug(QT_BT_BLUEZ) << "BluetoothManagement: found random device"
-                                     << qtAddress;
-                processRandomAddressFlagInformation(qtAddress);
-            }
+    // the EIR data is only copied if someone listens
+    static const QMetaMethod deviceFoundSignal =
+            QMetaMethod::fromSignal(&BluetoothManagement::deviceFound);
+    if (isSignalConnected(deviceFoundSignal)) {
+        emit deviceFound(controllerIndex, qtAddress, event.type, qint8(event.rssi),
+                         qFromLittleEndian(event.flags),
+                         QByteArray(data + sizeof(event), eirLength));
+    }
+}
 
-            break;
-        }
-        default:
-            qCDebug(QT_BT_BLUEZ) << "BluetoothManagement: Ignored event:"
-                                 << Qt::hex << (EventCode)qFromLittleEndian(hdr->cmdCode);
-            break;
-        }
+void BluetoothManagement::processDeviceConnected(quint16 controllerIndex, const char *data,
+                                                 int length)
+{
+    MgmtEventDeviceConnected event;
+    if (length < int(sizeof(event)))
+        return;
+    memcpy(&event, data, sizeof(event));
 
-        if (data.length() > nextPackageSize)
-            data = data.right(remainingPackageSize);
-        else
-            data.clear();
+    const int eirLength = qFromLittleEndian(event.eirLength);
+    if (length < int(sizeof(event)) + eirLength) {
+        qCWarning(QT_BT_BLUEZ) << "BluetoothManagement: Malformed device connected event";
+        return;
+    }
 
-        if (data.isEmpty())
-            break;
+    const QBluetoothAddress qtAddress = eventAddress(event.bdaddr);
+    qCDebug(QT_BT_BLUEZ) << "BluetoothManagement: device connected" << qtAddress;
+
+    static const QMetaMethod deviceConnectedSignal =
+            QMetaMethod::fromSignal(&BluetoothManagement::deviceConnected);
+    if (isSignalConnected(deviceConnectedSignal)) {
+        emit deviceConnected(controllerIndex, qtAddress, event.type,
+                             qFromLittleEndian(event.flags),
+                             QByteArray(data + sizeof(event), eirLength));
     }
+}
+
+void BluetoothManagement::processDeviceDisconnected(quint16 controllerIndex, const char *data,
+                                                    int length)
+{
+    MgmtEventDeviceDisconnected event;
+    // kernels before 3.5 omit the reason
+    if (length < int(sizeof(event) - sizeof(event.reason)))
+        return;
+    memset(&event, 0, sizeof(event));
+    memcpy(&event, data, qMin(length, int(sizeof(event))));
+
+    const QBluetoothAddress qtAddress = eventAddress(event.bdaddr);
+    qCDebug(QT_BT_BLUEZ) << "BluetoothManagement: device disconnected" << qtAddress
+                         << "reason:" << event.reason;
+    emit deviceDisconnected(controllerIndex, qtAddress, event.type, event.reason);
+}
 
-    if (!data.isEmpty())
-        buffer.ungetBlock(data.constData(), data.size());
+void BluetoothManagement::processConnectFailed(quint16 controllerIndex, const char *data,
+                                               int length)
+{
+    MgmtEventConnectFailed event;
+    if (length < int(sizeof(event)))
+        return;
+    memcpy(&event, data, sizeof(event));
+
+    const QBluetoothAddress qtAddress = eventAddress(event.bdaddr);
+    qCDebug(QT_BT_BLUEZ) << "BluetoothManagement: connect failed" << qtAddress
+                         << "status:" << event.status;
+    emit connectFailed(controllerIndex, qtAddress, event.type, event.status);
 }
 
 void BluetoothManagement::processRandomAddressFlagInformation(const QBluetoothAddress &address)
 {
+    const quint64 key = randomAddressKey(address);
+    const qint64 now = clock.elapsed();
+    const int first = randomAddressSlot(key, AddressSlotCount);
+
     // insert or update
-    QMutexLocker locker(&accessLock);
-    privateFlagAddresses[address] = QDateTime::currentDateTimeUtc();
+    int freeSlot = -1;
+    for (int i = 0; i < AddressProbeLength; ++i) {
+        const int slot = (first + i) & (AddressSlotCount - 1);
+        const quint64 slotKey = randomAddressKeys[slot].loadRelaxed();
+        if (slotKey == key) {
+            randomAddressLastSeen[slot] = now;
+            return;
+        }
+
+        if (slotKey == 0 && freeSlot < 0)
+            freeSlot = slot;
+    }
+
+    if (overflowCount.loadRelaxed() > 0) {
+        QMutexLocker locker(&overflowLock);
+        auto it = overflowAddresses.find(key);
+        if (it != overflowAddresses.end()) {
+            *it = now;
+            return;
+        }
+    }
+
+    if (freeSlot >= 0) {
+        randomAddressLastSeen[freeSlot] = now;
+        randomAddressKeys[freeSlot].storeRelease(key);
+        return;
+    }
+
+    // the probe window is full, live entries must not be evicted
+    QMutexLocker locker(&overflowLock);
+    overflowAddresses.insert(key, now);
+    overflowCount.storeRelease(int(overflowAddresses.size()));
 }
 
 /*
@@ -280,17 +455,27 @@ void BluetoothManagement::processRandomAddressFlagInformation(const QBluetoothAd
  */
 void BluetoothManagement::cleanupOldAddressFlags()
 {
-    const auto cutOffTime = QDateTime::currentDateTimeUtc().addDays(-1);
+    const qint64 cutOffTime = clock.elapsed() - msecInADay;
 
-    QMutexLocker locker(&accessLock);
+    for (int slot = 0; slot < AddressSlotCount; ++slot) {
+        if (randomAddressKeys[slot].loadRelaxed() != 0
+                && randomAddressLastSeen[slot] < cutOffTime) {
+            randomAddressKeys[slot].storeRelease(0);
+        }
+    }
 
-    auto i = privateFlagAddresses.begin();
-    while (i != privateFlagAddresses.end()) {
+    if (overflowCount.loadRelaxed() == 0)
+        return;
+
+    QMutexLocker locker(&overflowLock);
+    auto i = overflowAddresses.begin();
+    while (i != overflowAddresses.end()) {
         if (i.value() < cutOffTime)
-            i = privateFlagAddresses.erase(i);
+            i = overflowAddresses.erase(i);
         else
             i++;
     }
+    overflowCount.storeRelease(int(overflowAddresses.size()));
 }
 
 bool BluetoothManagement::isAddressRandom(const QBluetoothAddress &address) const
@@ -298,8 +483,19 @@ bool BluetoothManagement::isAddressRandom(const QBluetoothAddress &address) cons
     if (fd == -1 || address.isNull())
         return false;
 
-    QMutexLocker locker(&accessLock);
-    return privateFlagAddresses.contains(address);
+    // entries are never moved, a lookup only needs to scan the probe window
+    const quint64 key = randomAddressKey(address);
+    const int first = randomAddressSlot(key, AddressSlotCount);
+    for (int i = 0; i < AddressProbeLength; ++i) {
+        if (randomAddressKeys[(first + i) & (AddressSlotCount - 1)].loadAcquire() == key)
+            return true;
+    }
+
+    if (overflowCount.loadAcquire() == 0)
+        return false;
+
+    QMutexLocker locker(&overflowLock);
+    return overflowAddresses.contains(key);
 }
 
 bool BluetoothManagement::isMonitoringEnabled() const
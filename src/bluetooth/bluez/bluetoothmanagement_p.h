@@ -51,7 +51,9 @@
 // We mean it.
 //
 
-#include <QtCore/qdatetime.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qhash.h>
 #include <QtCore/qmutex.h>
 #include <QtCore/qobject.h>
 
@@ -66,7 +68,7 @@ QT_BEGIN_NAMESPACE
 
 class QSocketNotifier;
 
-class BluetoothManagement : public QObject
+class Q_AUTOTEST_EXPORT BluetoothManagement : public QObject
 {
     Q_OBJECT
 
@@ -123,24 +125,54 @@ public:
     Q_ENUM(EventCode)
 
     explicit BluetoothManagement(QObject *parent = nullptr);
+    explicit BluetoothManagement(int socket, QObject *parent = nullptr);
+    ~BluetoothManagement();
     static BluetoothManagement *instance();
 
     bool isAddressRandom(const QBluetoothAddress &address) const;
     bool isMonitoringEnabled() const;
 
+signals:
+    // Event feed of the mgmt socket. The address type uses the BDADDR_* values.
+    void deviceFound(quint16 controllerIndex, const QBluetoothAddress &address,
+                     quint8 addressType, qint8 rssi, quint32 flags, const QByteArray &eirData);
+    void deviceConnected(quint16 controllerIndex, const QBluetoothAddress &address,
+                         quint8 addressType, quint32 flags, const QByteArray &eirData);
+    void deviceDisconnected(quint16 controllerIndex, const QBluetoothAddress &address,
+                            quint8 addressType, quint8 reason);
+    void connectFailed(quint16 controllerIndex, const QBluetoothAddress &address,
+                       quint8 addressType, quint8 status);
+
 private slots:
     void _q_readNotifier();
     void processRandomAddressFlagInformation(const QBluetoothAddress &address);
     void cleanupOldAddressFlags();
 
 private:
-    void readyRead();
+    void startMonitoring();
+    int processEvent(const char *data, int size);
+    void processDeviceFound(quint16 controllerIndex, const char *data, int length);
+    void processDeviceConnected(quint16 controllerIndex, const char *data, int length);
+    void processDeviceDisconnected(quint16 controllerIndex, const char *data, int length);
+    void processConnectFailed(quint16 controllerIndex, const char *data, int length);
+
+    // Random address table: open addressing over a fixed number of slots. Only
+    // the thread owning this object writes; isAddressRandom() reads the keys
+    // without locking. A key is the 48 bit address + 1, 0 marks a free slot.
+    // Addresses whose probe window is full go to the locked overflow hash, so
+    // an entry only leaves the table when it expires.
+    static constexpr int AddressSlotCount = 1024;
+    static constexpr int AddressProbeLength = 8;
 
     int fd = -1;
     QSocketNotifier* notifier;
     QPrivateLinearBuffer buffer;
-    QHash<QBluetoothAddress, QDateTime> privateFlagAddresses;
-    mutable QMutex accessLock;
+    QElapsedTimer clock;
+    QAtomicInteger<quint64> randomAddressKeys[AddressSlotCount];
+    qint64 randomAddressLastSeen[AddressSlotCount] = {};
+    QHash<quint64, qint64> overflowAddresses;
+    QAtomicInt overflowCount;
+    mutable QMutex overflowLock;
 };
 
 
@@ -503,6 +503,48 @@ void QtBluezDiscoveryManager::removeAdapterFromMonitoring(const QString &dbusPat
     emit discoveryInterrupted(dbusPath);
 }
 
+QtBluezPropertiesChangedMonitor::QtBluezPropertiesChangedMonitor(const QString &interface,
+                                                                 const QString &pathNamespace,
+                                                                 QObject *parent)
+    : QObject(parent), interfaceName(interface), pathPrefix(pathNamespace + QLatin1Char('/'))
+{
+    if (!connectToBus(true))
+        qCWarning(QT_BT_BLUEZ) << "Cannot monitor property changes of" << interface;
+}
+
+QtBluezPropertiesChangedMonitor::~QtBluezPropertiesChangedMonitor()
+{
+    connectToBus(false);
+}
+
+bool QtBluezPropertiesChangedMonitor::connectToBus(bool connect)
+{
+    // arg0 is the interface name. QtDBus cannot express path_namespace in its match
+    // rules, the path is compared in handlePropertiesChanged() instead.
+    const QString service = QStringLiteral("org.bluez");
+    const QString interface = QStringLiteral("org.freedesktop.DBus.Properties");
+    const QString name = QStringLiteral("PropertiesChanged");
+    const QStringList argumentMatch{ interfaceName };
+    const char *slot = SLOT(handlePropertiesChanged(QString,QVariantMap,QStringList,QDBusMessage));
+
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (connect)
+        return bus.connect(service, QString(), interface, name, argumentMatch, QString(), this, slot);
+    return bus.disconnect(service, QString(), interface, name, argumentMatch, QString(), this, slot);
+}
+
+void QtBluezPropertiesChangedMonitor::handlePropertiesChanged(
+        const QString &interface, const QVariantMap &changedProperties,
+        const QStringList &invalidatedProperties, const QDBusMessage &msg)
+{
+    ++delivered;
+
+    if (interface != interfaceName || !msg.path().startsWith(pathPrefix))
+        return;
+
+    emit propertiesChanged(msg.path(), changedProperties, invalidatedProperties);
+}
+
 /*!
     Finds the path for the local adapter with \a wantedAddress or an empty string
     if no local adapter with the given address can be found.
@@ -107,6 +107,40 @@ private:
     QtBluezDiscoveryManagerPrivate *d;
 };
 
+/*
+    Watches PropertiesChanged of the BlueZ objects implementing \a interface below
+    \a pathNamespace. The match rule only lets the bus deliver changes of that interface,
+    so GATT notifications and battery updates of other applications' connections are
+    not unmarshalled by this process.
+*/
+class QtBluezPropertiesChangedMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    QtBluezPropertiesChangedMonitor(const QString &interface, const QString &pathNamespace,
+                                    QObject *parent = nullptr);
+    ~QtBluezPropertiesChangedMonitor();
+
+    // Number of signals the bus delivered, including those outside of the path namespace
+    int deliveredCount() const { return delivered; }
+
+signals:
+    void propertiesChanged(const QString &path, const QVariantMap &changedProperties,
+                           const QStringList &invalidatedProperties);
+
+private slots:
+    void handlePropertiesChanged(const QString &interface, const QVariantMap &changedProperties,
+                                 const QStringList &invalidatedProperties,
+                                 const QDBusMessage &msg);
+
+private:
+    bool connectToBus(bool connect);
+
+    QString interfaceName;
+    QString pathPrefix;
+    int delivered = 0;
+};
+
 QT_END_NAMESPACE
 
 #endif
@@ -357,6 +357,12 @@ struct evt_cmd_complete {
     quint16 opcode;
 } __attribute__ ((packed));
 
+struct evt_cmd_status {
+    quint8 status;
+    quint8 ncmd;
+    quint16 opcode;
+} __attribute__ ((packed));
+
 struct AclData {
     quint16 handle: 12;
     quint16 pbFlag: 2;
@@ -382,6 +388,7 @@ namespace QBluezConst {
     Q_ENUM_NS(OpCodeGroupField)
 
     enum OpCodeCommandField {
+        OcfLeReadLocalSupportedFeatures = 0x3,
         OcfLeSetAdvParams = 0x6,
         OcfLeReadTxPowerLevel = 0x7,
         OcfLeSetAdvData = 0x8,
@@ -390,6 +397,13 @@ namespace QBluezConst {
         OcfLeClearWhiteList = 0x10,
         OcfLeAddToWhiteList = 0x11,
         OcfLeConnectionUpdate = 0x13,
+        OcfLeSetDataLength = 0x22,
+        OcfLeSetPhy = 0x32,
+        OcfLeSetExtAdvParams = 0x36,
+        OcfLeSetExtAdvData = 0x37,
+        OcfLeSetExtScanResponseData = 0x38,
+        OcfLeSetExtAdvEnable = 0x39,
+        OcfLeReadMaxAdvDataLength = 0x3a,
     };
     Q_ENUM_NS(OpCodeCommandField)
 
@@ -420,6 +434,8 @@ namespace QBluezConst {
         ATT_OP_HANDLE_VAL_NOTIFICATION     = 0x1b, //informs about value change
         ATT_OP_HANDLE_VAL_INDICATION       = 0x1d, //informs about value change -> requires reply
         ATT_OP_HANDLE_VAL_CONFIRMATION     = 0x1e, //answer for ATT_OP_HANDLE_VAL_INDICATION
+        ATT_OP_READ_MULTIPLE_VARIABLE_REQUEST  = 0x20, //read several values of any length
+        ATT_OP_READ_MULTIPLE_VARIABLE_RESPONSE = 0x21,
         ATT_OP_WRITE_COMMAND               = 0x52, //write characteristic without response
         ATT_OP_SIGNED_WRITE_COMMAND        = 0xD2
     };
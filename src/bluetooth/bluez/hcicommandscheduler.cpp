@@ -0,0 +1,321 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "hcicommandscheduler_p.h"
+#include "hcimanager_p.h"
+
+#include <QtCore/qloggingcategory.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+// Spec v5.2, Vol 4, Part E, 7.3.2
+static const quint16 hciResetOpCode = 0x0c03;
+
+HciCommandScheduler::HciCommandScheduler(HciManager &hciManager, QObject *parent)
+    : QObject(parent), m_channel(HciCommandChannel::forManager(hciManager))
+{
+    m_channel->addScheduler(this);
+}
+
+HciCommandScheduler::~HciCommandScheduler()
+{
+    if (m_channel)
+        m_channel->removeScheduler(this);
+}
+
+void HciCommandScheduler::enqueue(QBluezConst::OpCodeCommandField ocf,
+                                  const QByteArray &parameters, CommandFlags flags,
+                                  quint8 stateKey)
+{
+    m_queuedCommands.append({ ocf, parameters, flags, stateKey });
+}
+
+void HciCommandScheduler::submit()
+{
+    while (!m_queuedCommands.isEmpty()) {
+        const Command &next = m_queuedCommands.constFirst();
+        if (next.flags & SkipIfApplied) {
+            // The state is compared once the earlier commands changing it completed.
+            if (isBeingApplied(next))
+                return;
+            if (isApplied(next)) {
+                Command command = m_queuedCommands.takeFirst();
+                qCDebug(QT_BT_BLUEZ) << "skipping command" << command.ocf
+                                     << "with unchanged parameters";
+                command.skipped = true;
+                command.returnParameters = m_appliedStates.value(stateId(command)).returnParameters;
+                // completions are reported in submission order
+                if (m_sentCommands.isEmpty())
+                    completeSkippedCommand(command);
+                else
+                    m_sentCommands.append(command);
+                continue;
+            }
+        }
+        if (!canSend(next))
+            return;
+
+        const Command command = m_queuedCommands.takeFirst();
+        if (!m_channel->send(this, command.ocf, command.parameters, command.stateKey)) {
+            reset();
+            emit errorOccurred();
+            return;
+        }
+        m_sentCommands.append(command);
+    }
+}
+
+void HciCommandScheduler::dropQueuedCommands()
+{
+    m_queuedCommands.clear();
+}
+
+void HciCommandScheduler::reset()
+{
+    // Commands which are still in flight complete without us,
+    // so the state of the controller is unknown afterwards.
+    if (m_channel)
+        m_channel->abandonCommands(this);
+    m_queuedCommands.clear();
+    m_sentCommands.clear();
+    m_appliedStates.clear();
+}
+
+int HciCommandScheduler::sentCommandCount() const
+{
+    return int(std::count_if(m_sentCommands.cbegin(), m_sentCommands.cend(),
+                             [](const Command &command) { return !command.skipped; }));
+}
+
+bool HciCommandScheduler::isApplied(const Command &command) const
+{
+    if (!(command.flags & SkipIfApplied))
+        return false;
+    const auto it = m_appliedStates.constFind(stateId(command));
+    return it != m_appliedStates.cend() && it->parameters == command.parameters;
+}
+
+bool HciCommandScheduler::isBeingApplied(const Command &command) const
+{
+    const quint32 id = stateId(command);
+    return std::any_of(m_sentCommands.cbegin(), m_sentCommands.cend(),
+                       [id](const Command &sent) { return !sent.skipped && stateId(sent) == id; });
+}
+
+bool HciCommandScheduler::canSend(const Command &command) const
+{
+    if (!m_channel || !m_channel->hasCredits())
+        return false;
+    const auto lastSent = std::find_if(m_sentCommands.crbegin(), m_sentCommands.crend(),
+                                       [](const Command &sent) { return !sent.skipped; });
+    if (lastSent == m_sentCommands.crend())
+        return true;
+    return !(command.flags & Barrier) && !(lastSent->flags & Barrier);
+}
+
+void HciCommandScheduler::forgetState(QBluezConst::OpCodeCommandField ocf)
+{
+    for (auto it = m_appliedStates.begin(); it != m_appliedStates.end();) {
+        if ((it.key() >> 8) == quint32(ocf))
+            it = m_appliedStates.erase(it);
+        else
+            ++it;
+    }
+}
+
+void HciCommandScheduler::forgetState(QBluezConst::OpCodeCommandField ocf, quint8 stateKey)
+{
+    m_appliedStates.remove(stateId(ocf, stateKey));
+}
+
+void HciCommandScheduler::finishCommand(QBluezConst::OpCodeCommandField ocf, quint8 status,
+                                        const QByteArray &returnParameters)
+{
+    // The controller completes the sent commands in order, so only skipped
+    // commands can precede this one.
+    const auto it = std::find_if(m_sentCommands.cbegin(), m_sentCommands.cend(),
+            [ocf](const Command &command) { return !command.skipped && command.ocf == ocf; });
+    if (it == m_sentCommands.cend())
+        return;
+    const qsizetype index = it - m_sentCommands.cbegin();
+    const QList<Command> precedingCommands = m_sentCommands.mid(0, index);
+    const Command command = m_sentCommands.at(index);
+    m_sentCommands.remove(0, index + 1);
+
+    if (status == 0 && (command.flags & SkipIfApplied))
+        m_appliedStates.insert(stateId(command), { command.parameters, returnParameters });
+    else
+        m_appliedStates.remove(stateId(command));
+
+    for (const Command &skipped : precedingCommands)
+        completeSkippedCommand(skipped);
+    emit commandCompleted(command.ocf, status, command.parameters, returnParameters);
+    while (!m_sentCommands.isEmpty() && m_sentCommands.constFirst().skipped)
+        completeSkippedCommand(m_sentCommands.takeFirst());
+}
+
+void HciCommandScheduler::completeSkippedCommand(const Command &command)
+{
+    emit commandCompleted(command.ocf, 0, command.parameters, command.returnParameters);
+}
+
+HciCommandChannel *HciCommandChannel::forManager(HciManager &hciManager)
+{
+    auto channel = hciManager.findChild<HciCommandChannel *>(QString(),
+                                                             Qt::FindDirectChildrenOnly);
+    if (!channel)
+        channel = new HciCommandChannel(hciManager);
+    return channel;
+}
+
+HciCommandChannel::HciCommandChannel(HciManager &hciManager)
+    : QObject(&hciManager), m_hciManager(hciManager)
+{
+    connect(&m_hciManager, &HciManager::commandPacketsAvailable, this,
+            &HciCommandChannel::handleCommandPacketsAvailable);
+    connect(&m_hciManager, &HciManager::commandCompleted, this,
+            &HciCommandChannel::handleCommandCompleted);
+    connect(&m_hciManager, &HciManager::commandStatusReceived, this,
+            &HciCommandChannel::handleCommandStatus);
+}
+
+void HciCommandChannel::addScheduler(HciCommandScheduler *scheduler)
+{
+    m_schedulers.append(scheduler);
+}
+
+void HciCommandChannel::removeScheduler(HciCommandScheduler *scheduler)
+{
+    abandonCommands(scheduler);
+    m_schedulers.removeOne(scheduler);
+}
+
+bool HciCommandChannel::send(HciCommandScheduler *scheduler,
+                             QBluezConst::OpCodeCommandField ocf, const QByteArray &parameters,
+                             quint8 stateKey)
+{
+    if (!m_hciManager.sendCommand(QBluezConst::OgfLinkControl, ocf, parameters))
+        return false;
+    --m_commandCredits;
+    m_sentCommands.append({ scheduler, ocf, stateKey });
+    return true;
+}
+
+void HciCommandChannel::abandonCommands(HciCommandScheduler *scheduler)
+{
+    // the commands still hold their credits until they complete
+    for (SentCommand &command : m_sentCommands) {
+        if (command.scheduler == scheduler)
+            command.scheduler = nullptr;
+    }
+}
+
+void HciCommandChannel::handleCommandPacketsAvailable(quint8 count)
+{
+    // Always followed by the completion or status event, which submits further commands.
+    m_commandCredits = count;
+}
+
+void HciCommandChannel::handleCommandCompleted(quint16 opCode, quint8 status,
+                                               const QByteArray &data)
+{
+    if (ogfFromOpCode(opCode) != QBluezConst::OgfLinkControl) {
+        if (opCode == hciResetOpCode) {
+            for (HciCommandScheduler *scheduler : qAsConst(m_schedulers))
+                scheduler->forgetAllStates();
+        }
+        submitAll();
+        return;
+    }
+    finishCommand(QBluezConst::OpCodeCommandField(ocfFromOpCode(opCode)), status, data);
+}
+
+void HciCommandChannel::handleCommandStatus(quint16 opCode, quint8 status)
+{
+    // None of the scheduled commands has a completion event other than Command Complete,
+    // a Command Status event for them reports a failure.
+    if (ogfFromOpCode(opCode) != QBluezConst::OgfLinkControl) {
+        submitAll();
+        return;
+    }
+    finishCommand(QBluezConst::OpCodeCommandField(ocfFromOpCode(opCode)), status, QByteArray());
+}
+
+void HciCommandChannel::finishCommand(QBluezConst::OpCodeCommandField ocf, quint8 status,
+                                      const QByteArray &returnParameters)
+{
+    const auto it = std::find_if(m_sentCommands.begin(), m_sentCommands.end(),
+                                 [ocf](const SentCommand &command) { return command.ocf == ocf; });
+    if (it == m_sentCommands.end()) {
+        // Another HCI user sent this command and might have changed the state.
+        for (HciCommandScheduler *scheduler : qAsConst(m_schedulers))
+            scheduler->forgetState(ocf);
+        submitAll();
+        return;
+    }
+
+    const SentCommand command = *it;
+    m_sentCommands.erase(it);
+    if (status == 0) {
+        // the state recorded by the other schedulers was overwritten
+        for (HciCommandScheduler *scheduler : qAsConst(m_schedulers)) {
+            if (scheduler != command.scheduler)
+                scheduler->forgetState(command.ocf, command.stateKey);
+        }
+    }
+    if (command.scheduler)
+        command.scheduler->finishCommand(ocf, status, returnParameters);
+    submitAll();
+}
+
+void HciCommandChannel::submitAll()
+{
+    // a scheduler might be destroyed by the completion of another one
+    const QList<HciCommandScheduler *> schedulers = m_schedulers;
+    for (HciCommandScheduler *scheduler : schedulers) {
+        if (m_schedulers.contains(scheduler))
+            scheduler->submit();
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,209 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef HCICOMMANDSCHEDULER_P_H
+#define HCICOMMANDSCHEDULER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "bluez/bluez_data_p.h"
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qpointer.h>
+
+QT_BEGIN_NAMESPACE
+
+class HciCommandChannel;
+class HciManager;
+
+/*
+    Submits LE controller commands via an HciManager.
+
+    Commands are sent as long as the controller grants credits via the
+    Num_HCI_Command_Packets field of its Command Complete and Command Status
+    events, so independent commands do not wait for each other's round trip.
+    The controller executes them in the order they were sent. Commands setting
+    controller state whose parameters did not change since they were last
+    applied successfully are not sent again; they complete locally with the
+    recorded return parameters.
+
+    All schedulers of an HciManager share its credits, and each completion is
+    handed to the scheduler which sent the command.
+
+    Queued commands are sent by submit() and whenever a command completes.
+    Completions are reported in submission order via commandCompleted().
+ */
+class Q_AUTOTEST_EXPORT HciCommandScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum CommandFlag {
+        NoCommandFlags = 0x0,
+        // The command sets controller state, skip it if that state is applied already.
+        SkipIfApplied = 0x1,
+        // Wait for all earlier commands, and let later ones wait for this one.
+        Barrier = 0x2
+    };
+    Q_DECLARE_FLAGS(CommandFlags, CommandFlag)
+
+    explicit HciCommandScheduler(HciManager &hciManager, QObject *parent = nullptr);
+    ~HciCommandScheduler() override;
+
+    // stateKey distinguishes state of the same command, e.g. per advertising set
+    void enqueue(QBluezConst::OpCodeCommandField ocf, const QByteArray &parameters,
+                 CommandFlags flags = NoCommandFlags, quint8 stateKey = 0);
+    void submit();
+
+    void dropQueuedCommands();
+    void reset();
+
+    bool isIdle() const { return m_queuedCommands.isEmpty() && m_sentCommands.isEmpty(); }
+    int sentCommandCount() const;
+
+signals:
+    void commandCompleted(QBluezConst::OpCodeCommandField ocf, quint8 status,
+                          const QByteArray &parameters, const QByteArray &returnParameters);
+    void errorOccurred();
+
+private:
+    friend class HciCommandChannel;
+
+    struct Command {
+        QBluezConst::OpCodeCommandField ocf;
+        QByteArray parameters;
+        CommandFlags flags;
+        quint8 stateKey;
+        // set for commands which complete locally after the earlier ones
+        bool skipped = false;
+        QByteArray returnParameters;
+    };
+    struct AppliedState {
+        QByteArray parameters;
+        QByteArray returnParameters;
+    };
+
+    static quint32 stateId(QBluezConst::OpCodeCommandField ocf, quint8 stateKey)
+    {
+        return (quint32(ocf) << 8) | stateKey;
+    }
+    static quint32 stateId(const Command &command)
+    {
+        return stateId(command.ocf, command.stateKey);
+    }
+    bool isApplied(const Command &command) const;
+    bool isBeingApplied(const Command &command) const;
+    bool canSend(const Command &command) const;
+    void forgetState(QBluezConst::OpCodeCommandField ocf);
+    void forgetState(QBluezConst::OpCodeCommandField ocf, quint8 stateKey);
+    void forgetAllStates() { m_appliedStates.clear(); }
+
+    void finishCommand(QBluezConst::OpCodeCommandField ocf, quint8 status,
+                       const QByteArray &returnParameters);
+    void completeSkippedCommand(const Command &command);
+
+    // owned by the HciManager
+    QPointer<HciCommandChannel> m_channel;
+    QList<Command> m_queuedCommands;
+    // sent commands and the skipped commands submitted after them
+    QList<Command> m_sentCommands;
+    QHash<quint32, AppliedState> m_appliedStates;
+};
+
+/*
+    The command flow control of an HciManager. The controller grants its
+    credits to the host, and each Command Complete or Command Status event
+    reaches every user of the HCI socket. The channel keeps the credits and the
+    commands in flight of all schedulers of the manager and hands each
+    completion to the scheduler which sent the command.
+ */
+class HciCommandChannel : public QObject
+{
+    Q_OBJECT
+public:
+    // the channel of hciManager, created on first use and owned by hciManager
+    static HciCommandChannel *forManager(HciManager &hciManager);
+
+    void addScheduler(HciCommandScheduler *scheduler);
+    void removeScheduler(HciCommandScheduler *scheduler);
+
+    bool hasCredits() const { return m_commandCredits > 0; }
+    bool send(HciCommandScheduler *scheduler, QBluezConst::OpCodeCommandField ocf,
+              const QByteArray &parameters, quint8 stateKey);
+    // completions of the scheduler's commands in flight are not reported anymore
+    void abandonCommands(HciCommandScheduler *scheduler);
+
+private:
+    explicit HciCommandChannel(HciManager &hciManager);
+
+    void handleCommandPacketsAvailable(quint8 count);
+    void handleCommandCompleted(quint16 opCode, quint8 status, const QByteArray &data);
+    void handleCommandStatus(quint16 opCode, quint8 status);
+    void finishCommand(QBluezConst::OpCodeCommandField ocf, quint8 status,
+                       const QByteArray &returnParameters);
+    void submitAll();
+
+    struct SentCommand {
+        HciCommandScheduler *scheduler;
+        QBluezConst::OpCodeCommandField ocf;
+        quint8 stateKey;
+    };
+
+    HciManager &m_hciManager;
+    QList<HciCommandScheduler *> m_schedulers;
+    QList<SentCommand> m_sentCommands;
+    // Spec v5.2, Vol 4, Part E, 4.4: one command may be sent before the first event
+    int m_commandCredits = 1;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(HciCommandScheduler::CommandFlags)
+
+QT_END_NAMESPACE
+
+#endif // HCICOMMANDSCHEDULER_P_H
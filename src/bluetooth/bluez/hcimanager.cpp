@@ -92,6 +92,19 @@ HciManager::HciManager(const QBluetoothAddress& deviceAdapter, QObject *parent)
 
 }
 
+/*
+ * Takes ownership of an already connected \a socket which transports HCI
+ * packets for the device \a deviceId. The socket does not need to be an
+ * HCI socket, e.g. tests pass a socket pair emulating the controller.
+ * Event filters are not applied to such sockets.
+ */
+HciManager::HciManager(int socket, int deviceId, QObject *parent) :
+    QObject(parent), hciSocket(socket), hciDev(deviceId), eventFilterSupported(false)
+{
+    notifier = new QSocketNotifier(hciSocket, QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(QSocketDescriptor)), this, SLOT(_q_readNotify()));
+}
+
 HciManager::~HciManager()
 {
     if (hciSocket >= 0)
@@ -157,7 +170,7 @@ bool HciManager::monitorEvent(HciManager::HciEvent event)
 
     // this event is already enabled
     // TODO runningEvents does not seem to be used
-    if (runningEvents.contains(event))
+    if (runningEvents.contains(event) || !eventFilterSupported)
         return true;
 
     hci_filter filter;
@@ -184,6 +197,9 @@ bool HciManager::monitorAclPackets()
     if (!isValid())
         return false;
 
+    if (!eventFilterSupported)
+        return true;
+
     hci_filter filter;
     socklen_t length = sizeof(hci_filter);
     if (getsockopt(hciSocket, SOL_HCI, HCI_FILTER, &filter, &length) < 0) {
@@ -237,7 +253,7 @@ bool HciManager::sendCommand(QBluezConst::OpCodeGroupField ogf, QBluezConst::OpC
  */
 void HciManager::stopEvents()
 {
-    if (!isValid())
+    if (!isValid() || !eventFilterSupported)
         return;
 
     hci_filter filter;
@@ -259,7 +275,7 @@ QBluetoothAddress HciManager::addressForConnectionHandle(quint16 handle) const
     hci_conn_info *info;
     hci_conn_list_req *infoList;
 
-    const int maxNoOfConnections = 20;
+    const int maxNoOfConnections = 64;
     infoList = (hci_conn_list_req *)
             malloc(sizeof(hci_conn_list_req) + maxNoOfConnections * sizeof(hci_conn_info));
 
@@ -292,7 +308,8 @@ QList<quint16> HciManager::activeLowEnergyConnections() const
     hci_conn_info *info;
     hci_conn_list_req *infoList;
 
-    const int maxNoOfConnections = 20;
+    // gateways maintain dozens of LE links, see LeConnectionHub
+    const int maxNoOfConnections = 64;
     infoList = (hci_conn_list_req *)
             malloc(sizeof(hci_conn_list_req) + maxNoOfConnections * sizeof(hci_conn_info));
 
@@ -372,6 +389,52 @@ bool HciManager::sendConnectionUpdateCommand(quint16 handle,
     return sendCommand(QBluezConst::OgfLinkControl, QBluezConst::OcfLeConnectionUpdate, data);
 }
 
+/*
+ * Asks for the PHYs in the bitmasks \a txPhys and \a rxPhys, bit 0 being LE 1M,
+ * bit 1 LE 2M and bit 2 LE Coded. An empty mask expresses no preference.
+ */
+bool HciManager::sendSetPhyCommand(quint16 handle, quint8 txPhys, quint8 rxPhys)
+{
+    // Spec v5.2, Vol 4, Part E, 7.8.49
+    struct CommandParams {
+        quint16 handle;
+        quint8 allPhys;
+        quint8 txPhys;
+        quint8 rxPhys;
+        quint16 phyOptions;
+    } __attribute__ ((packed)) commandParams;
+    static_assert(sizeof commandParams == 7, "unexpected struct size");
+    commandParams.handle = qToLittleEndian(handle);
+    commandParams.allPhys = (txPhys == 0 ? 0x1 : 0) | (rxPhys == 0 ? 0x2 : 0);
+    commandParams.txPhys = txPhys;
+    commandParams.rxPhys = rxPhys;
+    commandParams.phyOptions = 0; // no preferred coding on the LE Coded PHY
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<char *>(&commandParams),
+                                                    sizeof commandParams);
+    return sendCommand(QBluezConst::OgfLinkControl, QBluezConst::OcfLeSetPhy, data);
+}
+
+bool HciManager::sendSetDataLengthCommand(quint16 handle, quint16 txOctets)
+{
+    // Spec v5.2, Vol 4, Part E, 7.8.33
+    struct CommandParams {
+        quint16 handle;
+        quint16 txOctets;
+        quint16 txTime;
+    } __attribute__ ((packed)) commandParams;
+    static_assert(sizeof commandParams == 6, "unexpected struct size");
+    txOctets = qMin<quint16>(qMax<quint16>(txOctets, 27), 251);
+    // Time needed by a packet of that size on the LE 1M PHY, which includes
+    // 14 bytes of preamble, access address, header and MIC
+    const quint16 txTime = (txOctets + 14) * 8;
+    commandParams.handle = qToLittleEndian(handle);
+    commandParams.txOctets = qToLittleEndian(txOctets);
+    commandParams.txTime = qToLittleEndian(txTime);
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<char *>(&commandParams),
+                                                    sizeof commandParams);
+    return sendCommand(QBluezConst::OgfLinkControl, QBluezConst::OcfLeSetDataLength, data);
+}
+
 bool HciManager::sendConnectionParameterUpdateRequest(quint16 handle,
                                                       const QLowEnergyConnectionParameters &params)
 {
@@ -491,10 +554,22 @@ void HciManager::handleHciEventPacket(const quint8 *data, int size)
         const quint8 status = data[sizeof *event];
         const auto additionalData = QByteArray(reinterpret_cast<const char *>(data)
                                                + sizeof *event + 1, size - sizeof *event - 1);
+        // the credit is announced first, completion handlers may send the next command
+        emit commandPacketsAvailable(event->ncmd);
         emit commandCompleted(event->opcode, status, additionalData);
     } break;
+    case HciEvent::EVT_CMD_STATUS: {
+        if (size < static_cast<int>(sizeof(evt_cmd_status))) {
+            qCWarning(QT_BT_BLUEZ) << "Unexpected HCI command status event size:" << size;
+            return;
+        }
+        auto * const event = reinterpret_cast<const evt_cmd_status *>(data);
+        static_assert(sizeof *event == 4, "unexpected struct size");
+        emit commandPacketsAvailable(event->ncmd);
+        emit commandStatusReceived(event->opcode, event->status);
+    } break;
     case HciEvent::EVT_LE_META_EVENT:
-        handleLeMetaEvent(data);
+        handleLeMetaEvent(data, size);
         break;
     default:
         break;
@@ -559,13 +634,31 @@ void HciManager::handleHciAclPacket(const quint8 *data, int size)
     emit signatureResolvingKeyReceived(aclData->handle, isRemoteKey, csrk);
 }
 
-void HciManager::handleLeMetaEvent(const quint8 *data)
+void HciManager::handleLeMetaEvent(const quint8 *data, int size)
 {
     // Spec v4.2, Vol 2, part E, 7.7.65ff
     switch (*data) {
-    case 0x1: {
+    case 0x1:
+    case 0xa: {
+        // Spec v5.2, Vol 4, Part E, 7.7.65.1 and 7.7.65.10, the enhanced event
+        // only appends the resolvable private addresses
+        if (size < 12) {
+            qCWarning(QT_BT_BLUEZ) << "Unexpected LE connection complete event size:" << size;
+            return;
+        }
+        const quint8 status = data[1];
         const quint16 handle = bt_get_le16(data + 2);
-        emit connectionComplete(handle);
+        quint8 peerAddress[6];
+        memcpy(peerAddress, data + 6, sizeof peerAddress);
+        QBluetoothAddress peerResolvableAddress;
+        if (*data == 0xa && size >= 24) {
+            // the address the peer used, if Peer_Address is its resolved identity address
+            quint8 resolvableAddress[6];
+            memcpy(resolvableAddress, data + 18, sizeof resolvableAddress);
+            peerResolvableAddress = QBluetoothAddress(convertAddress(resolvableAddress));
+        }
+        emit connectionComplete(handle, status, QBluetoothAddress(convertAddress(peerAddress)),
+                                peerResolvableAddress);
         break;
     }
     case 0x3: {
@@ -589,6 +682,48 @@ void HciManager::handleLeMetaEvent(const quint8 *data)
         }
         break;
     }
+    case 0x7: {
+        // Spec v5.2, Vol 4, Part E, 7.7.65.7
+        struct DataLengthChangeData {
+            quint16 handle;
+            quint16 maxTxOctets;
+            quint16 maxTxTime;
+            quint16 maxRxOctets;
+            quint16 maxRxTime;
+        } __attribute((packed));
+        DataLengthChangeData changeData;
+        if (size < 1 + int(sizeof changeData)) {
+            qCWarning(QT_BT_BLUEZ) << "Unexpected LE data length change event size:" << size;
+            return;
+        }
+        memcpy(&changeData, data + 1, sizeof changeData);
+        emit dataLengthChange(qFromLittleEndian(changeData.handle),
+                              qFromLittleEndian(changeData.maxTxOctets),
+                              qFromLittleEndian(changeData.maxRxOctets));
+        break;
+    }
+    case 0xc: {
+        // Spec v5.2, Vol 4, Part E, 7.7.65.12
+        struct PhyUpdateCompleteData {
+            quint8 status;
+            quint16 handle;
+            quint8 txPhy;
+            quint8 rxPhy;
+        } __attribute((packed));
+        PhyUpdateCompleteData updateData;
+        if (size < 1 + int(sizeof updateData)) {
+            qCWarning(QT_BT_BLUEZ) << "Unexpected LE PHY update complete event size:" << size;
+            return;
+        }
+        memcpy(&updateData, data + 1, sizeof updateData);
+        if (updateData.status == 0) {
+            emit phyUpdate(qFromLittleEndian(updateData.handle), updateData.txPhy,
+                           updateData.rxPhy);
+        } else {
+            qCDebug(QT_BT_BLUEZ) << "PHY update failed with status" << updateData.status;
+        }
+        break;
+    }
     default:
         break;
     }
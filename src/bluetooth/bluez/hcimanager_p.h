@@ -62,7 +62,7 @@ QT_BEGIN_NAMESPACE
 
 class QLowEnergyConnectionParameters;
 
-class HciManager : public QObject
+class Q_AUTOTEST_EXPORT HciManager : public QObject
 {
     Q_OBJECT
 public:
@@ -193,6 +193,7 @@ public:
     Q_ENUM(HciError);
 
     explicit HciManager(const QBluetoothAddress &deviceAdapter, QObject *parent = nullptr);
+    HciManager(int socket, int deviceId, QObject *parent = nullptr);
     ~HciManager();
 
     bool isValid() const;
@@ -209,12 +210,20 @@ public:
     bool sendConnectionUpdateCommand(quint16 handle, const QLowEnergyConnectionParameters &params);
     bool sendConnectionParameterUpdateRequest(quint16 handle,
                                               const QLowEnergyConnectionParameters &params);
+    bool sendSetPhyCommand(quint16 handle, quint8 txPhys, quint8 rxPhys);
+    bool sendSetDataLengthCommand(quint16 handle, quint16 txOctets);
 
 signals:
     void encryptionChangedEvent(const QBluetoothAddress &address, bool wasSuccess);
     void commandCompleted(quint16 opCode, quint8 status, const QByteArray &data);
-    void connectionComplete(quint16 handle);
+    void commandStatusReceived(quint16 opCode, quint8 status);
+    void commandPacketsAvailable(quint8 count);
+    // peerResolvable is only set by the enhanced event, if the controller resolved the address
+    void connectionComplete(quint16 handle, quint8 status, const QBluetoothAddress &peer,
+                            const QBluetoothAddress &peerResolvable = QBluetoothAddress());
     void connectionUpdate(quint16 handle, const QLowEnergyConnectionParameters &parameters);
+    void phyUpdate(quint16 handle, quint8 txPhy, quint8 rxPhy);
+    void dataLengthChange(quint16 handle, quint16 maxTxOctets, quint16 maxRxOctets);
     void signatureResolvingKeyReceived(quint16 connHandle, bool remoteKey, const quint128 &csrk);
 
 private slots:
@@ -224,10 +233,11 @@ private:
     int hciForAddress(const QBluetoothAddress &deviceAdapter);
     void handleHciEventPacket(const quint8 *data, int size);
     void handleHciAclPacket(const quint8 *data, int size);
-    void handleLeMetaEvent(const quint8 *data);
+    void handleLeMetaEvent(const quint8 *data, int size);
 
     int hciSocket;
     int hciDev;
+    bool eventFilterSupported = true;
     quint8 sigPacketIdentifier = 0;
     QSocketNotifier *notifier = nullptr;
     QSet<HciManager::HciEvent> runningEvents;
@@ -0,0 +1,200 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "leatttransmitqueue_p.h"
+
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qsocketnotifier.h>
+#include <QtCore/private/qcore_unix_p.h>
+
+#include <errno.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+LeAttTransmitQueue::LeAttTransmitQueue(QObject *parent)
+    : QObject(parent)
+{
+}
+
+LeAttTransmitQueue::~LeAttTransmitQueue() = default;
+
+void LeAttTransmitQueue::setSocketDescriptor(int socket)
+{
+    clear();
+    if (m_writeNotifier) {
+        // may be called from within flush()
+        m_writeNotifier->setEnabled(false);
+        m_writeNotifier->deleteLater();
+        m_writeNotifier = nullptr;
+    }
+    m_socket = socket;
+}
+
+void LeAttTransmitQueue::send(const QByteArray &packet)
+{
+    if (m_packets.isEmpty() && write(packet) != WouldBlock)
+        return;
+
+    Packet queued;
+    queued.data = packet;
+    enqueue(queued);
+}
+
+bool LeAttTransmitQueue::sendWriteCommand(const QByteArray &packet, QObject *owner)
+{
+    Q_ASSERT(owner);
+
+    if (m_packets.isEmpty() && write(packet) != WouldBlock)
+        return true;
+
+    if (m_queuedWriteCommands >= m_writeCommandLimit)
+        return false;
+
+    Packet queued;
+    queued.data = packet;
+    queued.ownerKey = owner;
+    queued.owner = owner;
+    ++m_queuedWriteCommands;
+    ++m_pendingWriteCommands[owner];
+    enqueue(queued);
+    return true;
+}
+
+LeAttTransmitQueue::NotificationResult LeAttTransmitQueue::sendNotification(
+        const QByteArray &packet, quint16 handle, bool coalesce)
+{
+    Q_ASSERT(handle);
+
+    if (m_packets.isEmpty() && write(packet) != WouldBlock)
+        return NotificationAccepted;
+
+    if (coalesce) {
+        for (Packet &queued : m_packets) {
+            if (queued.notificationHandle == handle) {
+                // latest value wins, the queue position is kept
+                queued.data = packet;
+                return NotificationCoalesced;
+            }
+        }
+    }
+
+    if (m_queuedNotifications >= m_notificationLimit)
+        return NotificationDropped;
+
+    Packet queued;
+    queued.data = packet;
+    queued.notificationHandle = handle;
+    ++m_queuedNotifications;
+    enqueue(queued);
+    return NotificationAccepted;
+}
+
+void LeAttTransmitQueue::clear()
+{
+    m_packets.clear();
+    m_pendingWriteCommands.clear();
+    m_queuedWriteCommands = 0;
+    m_queuedNotifications = 0;
+    if (m_writeNotifier)
+        m_writeNotifier->setEnabled(false);
+}
+
+LeAttTransmitQueue::WriteResult LeAttTransmitQueue::write(const QByteArray &packet)
+{
+    // L2CAP ATT sockets are SOCK_SEQPACKET, a PDU is written completely or not at all
+    const qint64 result = qt_safe_write(m_socket, packet.constData(), packet.size());
+    if (result >= 0)
+        return Written;
+
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return WouldBlock;
+
+    const int errorCode = errno;
+    qCDebug(QT_BT_BLUEZ) << "Cannot write ATT packet:" << Qt::hex << packet.toHex()
+                         << qt_error_string(errorCode);
+    emit errorOccurred(errorCode);
+    return Failed;
+}
+
+void LeAttTransmitQueue::enqueue(const Packet &packet)
+{
+    m_packets.enqueue(packet);
+
+    if (!m_writeNotifier) {
+        m_writeNotifier = new QSocketNotifier(m_socket, QSocketNotifier::Write, this);
+        connect(m_writeNotifier, &QSocketNotifier::activated, this, &LeAttTransmitQueue::flush);
+    }
+    m_writeNotifier->setEnabled(true);
+}
+
+void LeAttTransmitQueue::flush()
+{
+    while (!m_packets.isEmpty()) {
+        const WriteResult result = write(m_packets.head().data);
+        if (result == WouldBlock)
+            return;
+        if (result == Failed) {
+            clear();
+            return;
+        }
+
+        const Packet packet = m_packets.dequeue();
+        if (packet.notificationHandle)
+            --m_queuedNotifications;
+        if (!packet.ownerKey)
+            continue;
+
+        --m_queuedWriteCommands;
+        const auto it = m_pendingWriteCommands.find(packet.ownerKey);
+        Q_ASSERT(it != m_pendingWriteCommands.end());
+        if (--it.value() > 0)
+            continue;
+
+        m_pendingWriteCommands.erase(it);
+        if (packet.owner)
+            emit writeCommandsDrained(packet.owner);
+    }
+
+    if (m_writeNotifier)
+        m_writeNotifier->setEnabled(false);
+}
+
+QT_END_NAMESPACE
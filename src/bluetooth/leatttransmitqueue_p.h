@@ -0,0 +1,143 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef LEATTTRANSMITQUEUE_P_H
+#define LEATTTRANSMITQUEUE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qqueue.h>
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+
+/*
+    Writes ATT PDUs to a non-blocking L2CAP socket without losing any of them.
+
+    A PDU is written right away if nothing is queued and the socket accepts
+    it. Otherwise it is queued and written once the socket becomes writable
+    again, in the original order.
+
+    Write commands are accounted per owner, which is the service they were
+    issued for. Their number is bounded so that a producer which ignores the
+    backpressure cannot grow the queue without limit; PDUs with responses,
+    which the ATT protocol itself limits, are always queued.
+
+    Notifications are bounded as well; once the limit is reached, further
+    notifications are dropped. A notification which may be coalesced replaces
+    the queued notification for the same attribute handle, if there is one.
+ */
+class Q_AUTOTEST_EXPORT LeAttTransmitQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum { DefaultWriteCommandLimit = 128, DefaultNotificationLimit = 64 };
+    enum NotificationResult {
+        NotificationAccepted,
+        NotificationCoalesced,
+        NotificationDropped
+    };
+
+    explicit LeAttTransmitQueue(QObject *parent = nullptr);
+    ~LeAttTransmitQueue() override;
+
+    void setSocketDescriptor(int socket);
+    int socketDescriptor() const { return m_socket; }
+
+    void setWriteCommandLimit(int limit) { m_writeCommandLimit = limit; }
+    int writeCommandLimit() const { return m_writeCommandLimit; }
+    void setNotificationLimit(int limit) { m_notificationLimit = limit; }
+    int notificationLimit() const { return m_notificationLimit; }
+
+    void send(const QByteArray &packet);
+    // returns false if the limit of queued write commands is reached
+    bool sendWriteCommand(const QByteArray &packet, QObject *owner);
+    NotificationResult sendNotification(const QByteArray &packet, quint16 handle, bool coalesce);
+
+    int pendingWriteCommands(const QObject *owner) const
+    { return m_pendingWriteCommands.value(owner); }
+    int queuedPacketCount() const { return m_packets.count(); }
+
+    void clear();
+
+signals:
+    void writeCommandsDrained(QObject *owner);
+    void errorOccurred(int errorCode);
+
+private:
+    struct Packet {
+        QByteArray data;
+        // null for packets other than write commands
+        const QObject *ownerKey = nullptr;
+        QPointer<QObject> owner;
+        // attribute handle of a notification, 0 otherwise
+        quint16 notificationHandle = 0;
+    };
+
+    enum WriteResult { Written, WouldBlock, Failed };
+    WriteResult write(const QByteArray &packet);
+    void enqueue(const Packet &packet);
+    void flush();
+
+    QQueue<Packet> m_packets;
+    QHash<const QObject *, int> m_pendingWriteCommands;
+    int m_queuedWriteCommands = 0;
+    int m_writeCommandLimit = DefaultWriteCommandLimit;
+    int m_queuedNotifications = 0;
+    int m_notificationLimit = DefaultNotificationLimit;
+    int m_socket = -1;
+    QSocketNotifier *m_writeNotifier = nullptr;
+};
+
+QT_END_NAMESPACE
+
+#endif // LEATTTRANSMITQUEUE_P_H
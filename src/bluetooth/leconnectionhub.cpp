@@ -0,0 +1,314 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "leconnectionhub_p.h"
+#include "bluez/hcimanager_p.h"
+
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qthread.h>
+
+#include <utility>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+namespace {
+struct HubRegistry
+{
+    QMutex mutex;
+    // keyed by adapter address and thread, the hub's socket notifier is bound to its thread
+    QHash<std::pair<quint64, QThread *>, QWeakPointer<LeConnectionHub>> hubs;
+};
+}
+
+Q_GLOBAL_STATIC(HubRegistry, hubRegistry)
+
+LeConnectionHub::LeConnectionHub(HciManager *hciManager, QObject *parent)
+    : QObject(parent), m_hciManager(hciManager)
+{
+    if (!m_hciManager->isValid())
+        return;
+
+    m_hciManager->monitorEvent(HciManager::HciEvent::EVT_ENCRYPT_CHANGE);
+    m_hciManager->monitorEvent(HciManager::HciEvent::EVT_LE_META_EVENT);
+    m_hciManager->monitorAclPackets();
+    connect(m_hciManager, &HciManager::connectionComplete,
+            this, &LeConnectionHub::handleConnectionComplete);
+    connect(m_hciManager, &HciManager::encryptionChangedEvent,
+            this, &LeConnectionHub::handleEncryptionChanged);
+    connect(m_hciManager, &HciManager::connectionUpdate,
+            this, &LeConnectionHub::handleConnectionUpdate);
+    connect(m_hciManager, &HciManager::phyUpdate, this, &LeConnectionHub::handlePhyUpdate);
+    connect(m_hciManager, &HciManager::dataLengthChange,
+            this, &LeConnectionHub::handleDataLengthChange);
+    connect(m_hciManager, &HciManager::signatureResolvingKeyReceived,
+            this, &LeConnectionHub::handleSignatureResolvingKey);
+}
+
+QSharedPointer<LeConnectionHub> LeConnectionHub::forAdapter(const QBluetoothAddress &localAdapter)
+{
+    const auto key = std::make_pair(localAdapter.toUInt64(), QThread::currentThread());
+    HubRegistry *registry = hubRegistry();
+    QMutexLocker locker(&registry->mutex);
+    QSharedPointer<LeConnectionHub> hub = registry->hubs.value(key).toStrongRef();
+    if (hub)
+        return hub;
+
+    auto hciManager = new HciManager(localAdapter);
+    // the last link may go away while the hub emits one of its signals
+    hub = QSharedPointer<LeConnectionHub>(new LeConnectionHub(hciManager), &QObject::deleteLater);
+    hciManager->setParent(hub.data());
+    if (hciManager->isValid())
+        registry->hubs.insert(key, hub);
+    else
+        registry->hubs.remove(key);
+    return hub;
+}
+
+void LeConnectionHub::setMaxPendingConnections(int count)
+{
+    m_maxPendingConnections = qMax(1, count);
+    grantConnectionSlots();
+}
+
+LeHciLink *LeConnectionHub::linkForConnectionHandle(quint16 handle) const
+{
+    return m_linksByHandle.value(handle);
+}
+
+QList<quint16> LeConnectionHub::externalLowEnergyConnections() const
+{
+    QList<quint16> handles = m_hciManager->activeLowEnergyConnections();
+    handles.removeIf([this](quint16 handle) { return m_linksByHandle.contains(handle); });
+    return handles;
+}
+
+void LeConnectionHub::addLink(LeHciLink *link)
+{
+    m_links.append(link);
+}
+
+void LeConnectionHub::removeLink(LeHciLink *link)
+{
+    releaseConnectionSlot(link);
+    resetConnectionHandle(link);
+    setRemoteDevice(link, QBluetoothAddress());
+    m_links.removeOne(link);
+}
+
+void LeConnectionHub::setRemoteDevice(LeHciLink *link, const QBluetoothAddress &address)
+{
+    const quint64 previousKey = link->m_remoteDevice.toUInt64();
+    if (!link->m_remoteDevice.isNull() && m_linksByPeer.value(previousKey) == link)
+        m_linksByPeer.remove(previousKey);
+
+    link->m_remoteDevice = address;
+    if (!address.isNull())
+        m_linksByPeer.insert(address.toUInt64(), link);
+    // several links accepting connections may have been told about the handle,
+    // the one which got the connection serves it
+    if (link->m_connectionHandle != 0 && !address.isNull())
+        m_linksByHandle.insert(link->m_connectionHandle, link);
+}
+
+void LeConnectionHub::resetConnectionHandle(LeHciLink *link)
+{
+    if (link->m_connectionHandle == 0)
+        return;
+    if (m_linksByHandle.value(link->m_connectionHandle) == link)
+        m_linksByHandle.remove(link->m_connectionHandle);
+    link->m_connectionHandle = 0;
+}
+
+bool LeConnectionHub::requestConnectionSlot(LeHciLink *link)
+{
+    if (m_pendingLinks.contains(link))
+        return true;
+
+    if (m_queuedLinks.isEmpty() && m_pendingLinks.count() < m_maxPendingConnections) {
+        m_pendingLinks.append(link);
+        return true;
+    }
+
+    if (!m_queuedLinks.contains(link))
+        m_queuedLinks.append(link);
+    qCDebug(QT_BT_BLUEZ) << "Connection attempt to" << link->m_remoteDevice << "waits for"
+                         << m_pendingLinks.count() << "pending attempts, queue length:"
+                         << m_queuedLinks.count();
+    return false;
+}
+
+void LeConnectionHub::releaseConnectionSlot(LeHciLink *link)
+{
+    m_queuedLinks.removeOne(link);
+    if (m_pendingLinks.removeOne(link))
+        grantConnectionSlots();
+}
+
+void LeConnectionHub::grantConnectionSlots()
+{
+    while (!m_queuedLinks.isEmpty() && m_pendingLinks.count() < m_maxPendingConnections) {
+        LeHciLink *link = m_queuedLinks.takeFirst();
+        m_pendingLinks.append(link);
+        emit link->connectionSlotGranted();
+    }
+}
+
+LeHciLink *LeConnectionHub::linkForPeer(const QBluetoothAddress &peer,
+                                        const QBluetoothAddress &peerResolvable) const
+{
+    if (LeHciLink *link = m_linksByPeer.value(peer.toUInt64()))
+        return link;
+    if (!peerResolvable.isNull())
+        return m_linksByPeer.value(peerResolvable.toUInt64());
+    return nullptr;
+}
+
+void LeConnectionHub::handleConnectionComplete(quint16 handle, quint8 status,
+                                               const QBluetoothAddress &peer,
+                                               const QBluetoothAddress &peerResolvable)
+{
+    LeHciLink *link = linkForPeer(peer, peerResolvable);
+    if (status != 0) {
+        qCDebug(QT_BT_BLUEZ) << "LE connection to" << peer << "failed, status:" << status;
+        if (link)
+            releaseConnectionSlot(link);
+        return;
+    }
+
+    qCDebug(QT_BT_BLUEZ) << "received connection complete event, handle:" << handle
+                         << "peer:" << peer << "resolvable address:" << peerResolvable;
+
+    // the handle may be reused without the previous link having seen the disconnection
+    if (LeHciLink *previous = m_linksByHandle.take(handle))
+        previous->m_connectionHandle = 0;
+
+    if (link) {
+        resetConnectionHandle(link);
+        link->m_connectionHandle = handle;
+        m_linksByHandle.insert(handle, link);
+        releaseConnectionSlot(link);
+        emit link->connectionComplete(handle);
+        return;
+    }
+
+    // an incoming connection, or one of another process
+    const QList<LeHciLink *> links = m_links;
+    for (LeHciLink *acceptingLink : links) {
+        if (!m_links.contains(acceptingLink) || !acceptingLink->m_remoteDevice.isNull())
+            continue;
+        resetConnectionHandle(acceptingLink);
+        acceptingLink->m_connectionHandle = handle;
+        m_linksByHandle.insert(handle, acceptingLink);
+        emit acceptingLink->connectionComplete(handle);
+    }
+}
+
+void LeConnectionHub::handleEncryptionChanged(const QBluetoothAddress &address, bool wasSuccess)
+{
+    if (LeHciLink *link = m_linksByPeer.value(address.toUInt64()))
+        emit link->encryptionChanged(wasSuccess);
+}
+
+void LeConnectionHub::handleConnectionUpdate(quint16 handle,
+                                             const QLowEnergyConnectionParameters &params)
+{
+    if (LeHciLink *link = m_linksByHandle.value(handle))
+        emit link->connectionUpdate(params);
+}
+
+void LeConnectionHub::handlePhyUpdate(quint16 handle, quint8 txPhy, quint8 rxPhy)
+{
+    if (LeHciLink *link = m_linksByHandle.value(handle))
+        emit link->phyUpdate(txPhy, rxPhy);
+}
+
+void LeConnectionHub::handleDataLengthChange(quint16 handle, quint16 maxTxOctets,
+                                             quint16 maxRxOctets)
+{
+    if (LeHciLink *link = m_linksByHandle.value(handle))
+        emit link->dataLengthChange(maxTxOctets, maxRxOctets);
+}
+
+void LeConnectionHub::handleSignatureResolvingKey(quint16 handle, bool remoteKey,
+                                                  const quint128 &csrk)
+{
+    if (LeHciLink *link = m_linksByHandle.value(handle))
+        emit link->signatureResolvingKeyReceived(remoteKey, csrk);
+}
+
+LeHciLink::LeHciLink(const QSharedPointer<LeConnectionHub> &hub, QObject *parent)
+    : QObject(parent), m_hub(hub)
+{
+    m_hub->addLink(this);
+}
+
+LeHciLink::~LeHciLink()
+{
+    m_hub->removeLink(this);
+}
+
+void LeHciLink::setRemoteDevice(const QBluetoothAddress &address)
+{
+    m_hub->setRemoteDevice(this, address);
+}
+
+void LeHciLink::resetConnectionHandle()
+{
+    m_hub->resetConnectionHandle(this);
+}
+
+bool LeHciLink::requestConnectionSlot()
+{
+    return m_hub->requestConnectionSlot(this);
+}
+
+void LeHciLink::releaseConnectionSlot()
+{
+    m_hub->releaseConnectionSlot(this);
+}
+
+bool LeHciLink::hasConnectionSlot() const
+{
+    return m_hub->m_pendingLinks.contains(const_cast<LeHciLink *>(this));
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,187 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef LECONNECTIONHUB_P_H
+#define LECONNECTIONHUB_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtBluetooth/qbluetoothaddress.h>
+#include <QtBluetooth/qbluetoothuuid.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qsharedpointer.h>
+
+QT_BEGIN_NAMESPACE
+
+class HciManager;
+class LeHciLink;
+class QLowEnergyConnectionParameters;
+
+/*
+    Shares one HciManager between all LE controllers of an adapter.
+
+    Every raw HCI socket receives every event of the adapter, so a process
+    with one HciManager per connection parses each event once per connection.
+    The hub owns the only HciManager of the adapter in its thread and hands
+    each event to the LeHciLink of the connection it belongs to, looked up by
+    connection handle. Links learn their handle from the LE Connection Complete
+    event, matched by peer address. If the controller resolved a private address,
+    the enhanced event reports the identity address and the link may know the
+    peer by its resolvable private address instead. Links without a peer address are waiting
+    for incoming connections; they receive connection complete events which
+    no other link claims.
+
+    The hub also limits the number of connection attempts in progress on the
+    adapter. The controller creates LE connections one at a time, further
+    attempts of the kernel wait until the previous one completed and count
+    against their own timeout meanwhile. A link requests a connection slot
+    before connecting and gets it once fewer than maxPendingConnections()
+    attempts are in progress. The slot is released when the connection
+    completes or the attempt is given up.
+ */
+class Q_AUTOTEST_EXPORT LeConnectionHub : public QObject
+{
+    Q_OBJECT
+public:
+    enum { DefaultMaxPendingConnections = 1 };
+
+    // does not take ownership of hciManager
+    explicit LeConnectionHub(HciManager *hciManager, QObject *parent = nullptr);
+
+    // the hub shared by all links of localAdapter in the current thread
+    static QSharedPointer<LeConnectionHub> forAdapter(const QBluetoothAddress &localAdapter);
+
+    HciManager *hciManager() const { return m_hciManager; }
+
+    void setMaxPendingConnections(int count);
+    int maxPendingConnections() const { return m_maxPendingConnections; }
+    int pendingConnectionCount() const { return m_pendingLinks.count(); }
+    int queuedConnectionCount() const { return m_queuedLinks.count(); }
+    int linkCount() const { return m_links.count(); }
+
+    LeHciLink *linkForConnectionHandle(quint16 handle) const;
+    // active LE connections of the adapter which are not served by a link of this hub
+    QList<quint16> externalLowEnergyConnections() const;
+
+private:
+    friend class LeHciLink;
+
+    void addLink(LeHciLink *link);
+    void removeLink(LeHciLink *link);
+    void setRemoteDevice(LeHciLink *link, const QBluetoothAddress &address);
+    void resetConnectionHandle(LeHciLink *link);
+    bool requestConnectionSlot(LeHciLink *link);
+    void releaseConnectionSlot(LeHciLink *link);
+    void grantConnectionSlots();
+
+    LeHciLink *linkForPeer(const QBluetoothAddress &peer,
+                           const QBluetoothAddress &peerResolvable) const;
+    void handleConnectionComplete(quint16 handle, quint8 status, const QBluetoothAddress &peer,
+                                  const QBluetoothAddress &peerResolvable);
+    void handleEncryptionChanged(const QBluetoothAddress &address, bool wasSuccess);
+    void handleConnectionUpdate(quint16 handle, const QLowEnergyConnectionParameters &params);
+    void handlePhyUpdate(quint16 handle, quint8 txPhy, quint8 rxPhy);
+    void handleDataLengthChange(quint16 handle, quint16 maxTxOctets, quint16 maxRxOctets);
+    void handleSignatureResolvingKey(quint16 handle, bool remoteKey, const quint128 &csrk);
+
+    HciManager *m_hciManager;
+    QList<LeHciLink *> m_links;
+    QHash<quint16, LeHciLink *> m_linksByHandle;
+    QHash<quint64, LeHciLink *> m_linksByPeer;
+    QList<LeHciLink *> m_pendingLinks;
+    QList<LeHciLink *> m_queuedLinks;
+    int m_maxPendingConnections = DefaultMaxPendingConnections;
+};
+
+/*
+    The events of one LE connection, as dispatched by a LeConnectionHub.
+    Keeps the hub alive as long as the link exists.
+ */
+class Q_AUTOTEST_EXPORT LeHciLink : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LeHciLink(const QSharedPointer<LeConnectionHub> &hub, QObject *parent = nullptr);
+    ~LeHciLink() override;
+
+    LeConnectionHub *hub() const { return m_hub.data(); }
+    HciManager *hciManager() const { return m_hub->hciManager(); }
+
+    // a null address accepts incoming connections
+    void setRemoteDevice(const QBluetoothAddress &address);
+    QBluetoothAddress remoteDevice() const { return m_remoteDevice; }
+    quint16 connectionHandle() const { return m_connectionHandle; }
+    void resetConnectionHandle();
+
+    // returns true if the slot is granted right away, otherwise
+    // connectionSlotGranted() is emitted once it is granted
+    bool requestConnectionSlot();
+    void releaseConnectionSlot();
+    bool hasConnectionSlot() const;
+
+signals:
+    void connectionSlotGranted();
+    void connectionComplete(quint16 handle);
+    void encryptionChanged(bool wasSuccess);
+    void connectionUpdate(const QLowEnergyConnectionParameters &parameters);
+    void phyUpdate(quint8 txPhy, quint8 rxPhy);
+    void dataLengthChange(quint16 maxTxOctets, quint16 maxRxOctets);
+    void signatureResolvingKeyReceived(bool remoteKey, const quint128 &csrk);
+
+private:
+    friend class LeConnectionHub;
+
+    QSharedPointer<LeConnectionHub> m_hub;
+    QBluetoothAddress m_remoteDevice;
+    quint16 m_connectionHandle = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif // LECONNECTIONHUB_P_H
@@ -0,0 +1,495 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "legattdatabasewalker_p.h"
+
+#include "bluez/bluez_data_p.h"
+
+#include <QtCore/qloggingcategory.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+#define GATT_INCLUDED_SERVICE   quint16(0x2802)
+#define GATT_CHARACTERISTIC     quint16(0x2803)
+
+#define FIND_INFO_REQUEST_HEADER_SIZE 5
+#define READ_BY_TYPE_REQ_HEADER_SIZE 7
+#define READ_REQUEST_HEADER_SIZE 3
+#define READ_BLOB_REQUEST_HEADER_SIZE 5
+
+static QBluetoothUuid uuidFromPacket(const char *data, int size)
+{
+    if (size == 2)
+        return QBluetoothUuid(bt_get_le16(data));
+    if (size != 16)
+        return QBluetoothUuid();
+
+    // Bluetooth LE data comes as little endian, QBluetoothUuid expects big endian
+    quint128 uuid;
+    for (int i = 0; i < 16; ++i)
+        uuid.data[15 - i] = data[i];
+    return QBluetoothUuid(uuid);
+}
+
+static bool isResponse(const QByteArray &response, QBluezConst::AttCommand command)
+{
+    return !response.isEmpty() && static_cast<QBluezConst::AttCommand>(response.at(0)) == command;
+}
+
+LeGattDatabaseWalker::LeGattDatabaseWalker(const QList<Service> &services, quint16 mtuSize,
+                                           QLowEnergyService::DiscoveryMode discoveryMode)
+    : serviceList(services), mtu(mtuSize), mode(discoveryMode)
+{
+    std::sort(serviceList.begin(), serviceList.end(), [](const Service &a, const Service &b) {
+        return a.startHandle < b.startHandle;
+    });
+    for (const Service &service : qAsConst(serviceList))
+        lastHandle = qMax(lastHandle, service.endHandle);
+
+    startPhase(Phase::Includes);
+}
+
+/*
+    Returns the next request PDU or an empty byte array once all services
+    have been discovered. Every returned request must be answered via
+    processResponse() before this function is called again.
+ */
+QByteArray LeGattDatabaseWalker::nextRequest()
+{
+    QByteArray request;
+
+    switch (phase) {
+    case Phase::Includes:
+    case Phase::Characteristics:
+        request.resize(READ_BY_TYPE_REQ_HEADER_SIZE);
+        request[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_BY_TYPE_REQUEST);
+        putBtData(nextHandle, request.data() + 1);
+        putBtData(lastHandle, request.data() + 3);
+        putBtData(phase == Phase::Includes ? GATT_INCLUDED_SERVICE : GATT_CHARACTERISTIC,
+                  request.data() + 5);
+        break;
+    case Phase::Descriptors:
+        request.resize(FIND_INFO_REQUEST_HEADER_SIZE);
+        request[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_FIND_INFORMATION_REQUEST);
+        putBtData(nextHandle, request.data() + 1);
+        putBtData(lastHandle, request.data() + 3);
+        break;
+    case Phase::Values:
+        if (!longValues.isEmpty()) {
+            const LongValue &value = longValues.constFirst();
+            request.resize(READ_BLOB_REQUEST_HEADER_SIZE);
+            request[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_BLOB_REQUEST);
+            putBtData(value.target.handle, request.data() + 1);
+            putBtData(value.offset, request.data() + 3);
+            break;
+        }
+
+        {
+            const qsizetype maxHandles = (singleReads > 0 || !readMultipleSupported)
+                    ? 1 : (mtu - 1) / 2;
+            valueBatch = pendingValues.mid(0, maxHandles);
+            pendingValues.remove(0, valueBatch.size());
+        }
+
+        if (valueBatch.size() == 1) {
+            if (singleReads > 0)
+                --singleReads;
+            request.resize(READ_REQUEST_HEADER_SIZE);
+            request[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_REQUEST);
+            putBtData(valueBatch.constFirst().handle, request.data() + 1);
+        } else {
+            request.resize(1 + 2 * valueBatch.size());
+            request[0] = static_cast<quint8>(
+                    QBluezConst::AttCommand::ATT_OP_READ_MULTIPLE_VARIABLE_REQUEST);
+            char *data = request.data() + 1;
+            for (const ValueTarget &target : qAsConst(valueBatch)) {
+                putBtData(target.handle, data);
+                data += 2;
+            }
+        }
+        break;
+    case Phase::Finished:
+        return request;
+    }
+
+    currentRequest = request;
+    ++sentRequests;
+    return request;
+}
+
+/*
+    Processes the \a response to the last request returned by nextRequest().
+    Error responses end the current discovery step or skip the affected value.
+ */
+void LeGattDatabaseWalker::processResponse(const QByteArray &response)
+{
+    switch (phase) {
+    case Phase::Includes:
+    case Phase::Characteristics:
+        processDiscoveryResponse(response);
+        break;
+    case Phase::Descriptors:
+        processFindInformationResponse(response);
+        break;
+    case Phase::Values:
+        processValueResponse(response);
+        break;
+    case Phase::Finished:
+        break;
+    }
+}
+
+void LeGattDatabaseWalker::startPhase(Phase next)
+{
+    phase = next;
+
+    switch (phase) {
+    case Phase::Includes:
+    case Phase::Characteristics:
+        if (serviceList.isEmpty())
+            phase = Phase::Finished;
+        else
+            nextHandle = serviceList.constFirst().startHandle;
+        break;
+    case Phase::Descriptors:
+        // Descriptors can only follow the value handle of a characteristic.
+        // Characteristics without room for descriptors are never queried.
+        for (int i = 0; i < serviceList.size(); ++i) {
+            const Service &service = serviceList.at(i);
+            QList<QLowEnergyHandle> charHandles = service.characteristics.keys();
+            std::sort(charHandles.begin(), charHandles.end());
+
+            for (int j = 0; j < charHandles.size(); ++j) {
+                const QLowEnergyHandle last = (j + 1 < charHandles.size())
+                        ? charHandles.at(j + 1) - 1 : service.endHandle;
+                const QLowEnergyHandle valueHandle =
+                        service.characteristics.value(charHandles.at(j)).valueHandle;
+                if (valueHandle < last) {
+                    descriptorRanges.append({ QLowEnergyHandle(valueHandle + 1), last,
+                                              charHandles.at(j), i });
+                }
+            }
+        }
+
+        if (descriptorRanges.isEmpty())
+            startPhase(Phase::Values);
+        else
+            nextHandle = descriptorRanges.constFirst().first;
+        break;
+    case Phase::Values:
+        if (mode != QLowEnergyService::SkipValueDiscovery) {
+            for (int i = 0; i < serviceList.size(); ++i) {
+                const Service &service = serviceList.at(i);
+                QList<QLowEnergyHandle> charHandles = service.characteristics.keys();
+                std::sort(charHandles.begin(), charHandles.end());
+
+                for (const QLowEnergyHandle charHandle : qAsConst(charHandles)) {
+                    const QLowEnergyServicePrivate::CharData &charData =
+                            service.characteristics[charHandle];
+                    // Don't try to read writeOnly characteristic
+                    if ((charData.properties & QLowEnergyCharacteristic::Read)
+                            && QLowEnergyServicePrivate::readsValueDuringDiscovery(
+                                    mode, service.readPolicies, charData.uuid)) {
+                        pendingValues.append({ charData.valueHandle, charHandle, 0, i });
+                    }
+
+                    QList<QLowEnergyHandle> descriptorHandles = charData.descriptorList.keys();
+                    std::sort(descriptorHandles.begin(), descriptorHandles.end());
+                    for (const QLowEnergyHandle descriptorHandle : qAsConst(descriptorHandles)) {
+                        if (!QLowEnergyServicePrivate::readsDescriptorDuringDiscovery(
+                                    mode, charData.descriptorList[descriptorHandle].uuid)) {
+                            continue;
+                        }
+                        pendingValues.append({ descriptorHandle, charHandle, descriptorHandle, i });
+                    }
+                }
+            }
+        }
+
+        if (pendingValues.isEmpty())
+            phase = Phase::Finished;
+        break;
+    case Phase::Finished:
+        break;
+    }
+}
+
+int LeGattDatabaseWalker::serviceForHandle(QLowEnergyHandle handle) const
+{
+    const auto it = std::upper_bound(serviceList.cbegin(), serviceList.cend(), handle,
+                                     [](QLowEnergyHandle h, const Service &service) {
+        return h < service.startHandle;
+    });
+    if (it == serviceList.cbegin())
+        return -1;
+
+    const int index = int(std::distance(serviceList.cbegin(), it)) - 1;
+    return handle <= serviceList.at(index).endHandle ? index : -1;
+}
+
+const LeGattDatabaseWalker::DescriptorRange *
+LeGattDatabaseWalker::descriptorRangeFor(QLowEnergyHandle handle) const
+{
+    const auto it = std::upper_bound(descriptorRanges.cbegin(), descriptorRanges.cend(), handle,
+                                     [](QLowEnergyHandle h, const DescriptorRange &range) {
+        return h < range.first;
+    });
+    if (it == descriptorRanges.cbegin())
+        return nullptr;
+
+    const DescriptorRange *range = &*std::prev(it);
+    return handle <= range->last ? range : nullptr;
+}
+
+QByteArray &LeGattDatabaseWalker::valueOf(const ValueTarget &target)
+{
+    QLowEnergyServicePrivate::CharData &charData =
+            serviceList[target.service].characteristics[target.charHandle];
+    if (target.descriptorHandle)
+        return charData.descriptorList[target.descriptorHandle].value;
+    return charData.value;
+}
+
+void LeGattDatabaseWalker::processDiscoveryResponse(const QByteArray &response)
+{
+    const Phase following = (phase == Phase::Includes) ? Phase::Characteristics
+                                                        : Phase::Descriptors;
+    const int minElementLength = (phase == Phase::Includes) ? 6 : 7;
+
+    // an error response (usually "attribute not found") ends the step
+    if (!isResponse(response, QBluezConst::AttCommand::ATT_OP_READ_BY_TYPE_RESPONSE)
+            || response.size() < 2 || quint8(response.at(1)) < minElementLength) {
+        startPhase(following);
+        return;
+    }
+
+    /* packet format:
+     * if GATT_CHARACTERISTIC discovery
+     *      <opcode><elementLength>
+     *          [<handle><property><charHandle><uuid>]+
+     *
+     * if GATT_INCLUDE discovery
+     *      <opcode><elementLength>
+     *          [<handle><startHandle_included><endHandle_included><uuid>]+
+     *
+     *  The uuid of an included service is only present if it is a 16 bit uuid.
+     */
+    const int elementLength = quint8(response.at(1));
+    const int numElements = (response.size() - 2) / elementLength;
+    const char *data = response.constData() + 2;
+    QLowEnergyHandle handle = 0;
+    for (int i = 0; i < numElements; ++i, data += elementLength) {
+        handle = bt_get_le16(data);
+        const int service = serviceForHandle(handle);
+        if (service < 0)
+            continue;
+
+        if (phase == Phase::Includes) {
+            const QLowEnergyHandle includedStartHandle = bt_get_le16(data + 2);
+            QBluetoothUuid uuid;
+            if (elementLength == 8) {
+                uuid = QBluetoothUuid(bt_get_le16(data + 6));
+            } else {
+                for (const Service &candidate : qAsConst(serviceList)) {
+                    if (candidate.startHandle == includedStartHandle) {
+                        uuid = candidate.uuid;
+                        break;
+                    }
+                }
+            }
+            qCDebug(QT_BT_BLUEZ) << "Found included service:" << Qt::hex << handle
+                                 << "uuid:" << uuid;
+            if (!uuid.isNull())
+                serviceList[service].includedServices.append(uuid);
+        } else {
+            QLowEnergyServicePrivate::CharData charData;
+            charData.properties = QLowEnergyCharacteristic::PropertyTypes(quint8(data[2]));
+            charData.valueHandle = bt_get_le16(data + 3);
+            charData.uuid = uuidFromPacket(data + 5, elementLength - 5);
+            serviceList[service].characteristics.insert(handle, charData);
+        }
+    }
+
+    if (numElements == 0 || handle >= lastHandle)
+        startPhase(following);
+    else
+        nextHandle = handle + 1;
+}
+
+void LeGattDatabaseWalker::processFindInformationResponse(const QByteArray &response)
+{
+    if (!isResponse(response, QBluezConst::AttCommand::ATT_OP_FIND_INFORMATION_RESPONSE)
+            || response.size() < 2) {
+        startPhase(Phase::Values);
+        return;
+    }
+
+    /* packet format:
+     *  <opcode><format>[<handle><descriptor_uuid>]+
+     *
+     *  The uuid can be 16 or 128 bit which is indicated by format.
+     */
+    int elementLength = 0;
+    switch (response.at(1)) {
+    case 0x01:
+        elementLength = 2 + 2;
+        break;
+    case 0x02:
+        elementLength = 2 + 16;
+        break;
+    default:
+        qCWarning(QT_BT_BLUEZ) << "Unknown format in FIND_INFORMATION_RESPONSE";
+        startPhase(Phase::Values);
+        return;
+    }
+
+    const int numElements = (response.size() - 2) / elementLength;
+    const char *data = response.constData() + 2;
+    QLowEnergyHandle handle = 0;
+    for (int i = 0; i < numElements; ++i, data += elementLength) {
+        handle = bt_get_le16(data);
+        const DescriptorRange *range = descriptorRangeFor(handle);
+        if (!range)
+            continue;
+
+        const QBluetoothUuid uuid = uuidFromPacket(data + 2, elementLength - 2);
+        bool ok = false;
+        const quint16 shortUuid = uuid.toUInt16(&ok);
+        if (ok && shortUuid >= QLowEnergyServicePrivate::PrimaryService
+               && shortUuid <= QLowEnergyServicePrivate::Characteristic) {
+            continue;
+        }
+
+        QLowEnergyServicePrivate::DescData descriptor;
+        descriptor.uuid = uuid;
+        serviceList[range->service].characteristics[range->charHandle].descriptorList.insert(
+                    handle, descriptor);
+    }
+
+    if (numElements == 0 || handle >= lastHandle) {
+        startPhase(Phase::Values);
+        return;
+    }
+
+    // continue with the first handle behind the response which may be a descriptor
+    const auto it = std::find_if(descriptorRanges.cbegin(), descriptorRanges.cend(),
+                                 [handle](const DescriptorRange &range) {
+        return range.last > handle;
+    });
+    if (it == descriptorRanges.cend())
+        startPhase(Phase::Values);
+    else
+        nextHandle = qMax(it->first, QLowEnergyHandle(handle + 1));
+}
+
+void LeGattDatabaseWalker::processValueResponse(const QByteArray &response)
+{
+    switch (static_cast<QBluezConst::AttCommand>(currentRequest.at(0))) {
+    case QBluezConst::AttCommand::ATT_OP_READ_MULTIPLE_VARIABLE_REQUEST: {
+        if (!isResponse(response, QBluezConst::AttCommand::ATT_OP_READ_MULTIPLE_VARIABLE_RESPONSE)) {
+            if (response.size() >= 5 && static_cast<QBluezConst::AttError>(response.at(4))
+                    == QBluezConst::AttError::ATT_ERROR_REQUEST_NOT_SUPPORTED) {
+                qCDebug(QT_BT_BLUEZ) << "Read multiple variable not supported,"
+                                     << "falling back to single reads";
+                readMultipleSupported = false;
+            } else {
+                // a single unreadable value fails the entire batch
+                singleReads = int(valueBatch.size());
+            }
+            pendingValues = valueBatch + pendingValues;
+            break;
+        }
+
+        // <opcode>[<length><value>]+
+        // The list is cut off at the MTU, possibly within a length field.
+        const char *data = response.constData() + 1;
+        qsizetype remaining = response.size() - 1;
+        qsizetype i = 0;
+        for (; i < valueBatch.size() && remaining >= 2; ++i) {
+            const int length = bt_get_le16(data);
+            const int received = int(qMin<qsizetype>(length, remaining - 2));
+            valueOf(valueBatch.at(i)) = QByteArray(data + 2, received);
+            data += 2 + received;
+            remaining -= 2 + received;
+            if (received < length)
+                longValues.append({ valueBatch.at(i), quint16(received), length });
+        }
+
+        if (i == 0)
+            singleReads = 1;
+        pendingValues = valueBatch.mid(i) + pendingValues;
+    } break;
+    case QBluezConst::AttCommand::ATT_OP_READ_REQUEST: {
+        // unreadable values are skipped like during per service discovery
+        if (!isResponse(response, QBluezConst::AttCommand::ATT_OP_READ_RESPONSE))
+            break;
+
+        const ValueTarget &target = valueBatch.constFirst();
+        valueOf(target) = response.mid(1);
+        if (response.size() == mtu)
+            longValues.append({ target, quint16(mtu - 1), -1 });
+    } break;
+    case QBluezConst::AttCommand::ATT_OP_READ_BLOB_REQUEST: {
+        if (!isResponse(response, QBluezConst::AttCommand::ATT_OP_READ_BLOB_RESPONSE)
+                || response.size() == 1) {
+            longValues.removeFirst();
+            break;
+        }
+
+        LongValue &value = longValues.first();
+        valueOf(value.target).append(response.constData() + 1, response.size() - 1);
+        value.offset += response.size() - 1;
+        const bool complete = (value.length >= 0) ? (value.offset >= value.length)
+                                                  : (response.size() < mtu);
+        if (complete)
+            longValues.removeFirst();
+    } break;
+    default:
+        Q_UNREACHABLE();
+    }
+
+    if (pendingValues.isEmpty() && longValues.isEmpty())
+        phase = Phase::Finished;
+}
+
+QT_END_NAMESPACE
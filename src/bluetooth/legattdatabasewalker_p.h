@@ -0,0 +1,150 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef LEGATTDATABASEWALKER_P_H
+#define LEGATTDATABASEWALKER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qlowenergyserviceprivate_p.h"
+
+#include <QtBluetooth/qbluetoothuuid.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qlist.h>
+
+QT_BEGIN_NAMESPACE
+
+/*
+    Discovers the details of several services in one pass over the remote
+    attribute database.
+
+    Instead of running include, characteristic and descriptor discovery per
+    service, each discovery step covers the handle range of all services at
+    once and every response is filled up to the negotiated MTU. Values are
+    batched via Read Multiple Variable Length requests, falling back to
+    individual reads if the remote device does not support them. Which values
+    are read follows the discovery mode of the services.
+
+    The walker does not talk to the socket itself. The caller sends the PDU
+    returned by nextRequest() and passes the matching response (or error
+    response) to processResponse() until nextRequest() returns an empty PDU.
+ */
+class Q_AUTOTEST_EXPORT LeGattDatabaseWalker
+{
+public:
+    struct Service {
+        QLowEnergyHandle startHandle = 0;
+        QLowEnergyHandle endHandle = 0;
+        QBluetoothUuid uuid;
+        QList<QBluetoothUuid> includedServices;
+        CharacteristicDataMap characteristics;
+        CharacteristicReadPolicyMap readPolicies;
+    };
+
+    LeGattDatabaseWalker(const QList<Service> &services, quint16 mtuSize,
+                         QLowEnergyService::DiscoveryMode discoveryMode);
+
+    QByteArray nextRequest();
+    void processResponse(const QByteArray &response);
+
+    bool isFinished() const { return phase == Phase::Finished; }
+    int requestCount() const { return sentRequests; }
+    const QList<Service> &services() const { return serviceList; }
+
+private:
+    enum class Phase { Includes, Characteristics, Descriptors, Values, Finished };
+
+    // handles which may hold descriptors of a characteristic
+    struct DescriptorRange {
+        QLowEnergyHandle first;
+        QLowEnergyHandle last;
+        QLowEnergyHandle charHandle;
+        int service;
+    };
+
+    struct ValueTarget {
+        QLowEnergyHandle handle;
+        QLowEnergyHandle charHandle;
+        QLowEnergyHandle descriptorHandle;
+        int service;
+    };
+
+    struct LongValue {
+        ValueTarget target;
+        quint16 offset;
+        int length; // -1 if unknown
+    };
+
+    void startPhase(Phase next);
+    int serviceForHandle(QLowEnergyHandle handle) const;
+    const DescriptorRange *descriptorRangeFor(QLowEnergyHandle handle) const;
+    QByteArray &valueOf(const ValueTarget &target);
+
+    void processDiscoveryResponse(const QByteArray &response);
+    void processFindInformationResponse(const QByteArray &response);
+    void processValueResponse(const QByteArray &response);
+
+    QList<Service> serviceList;
+    QList<DescriptorRange> descriptorRanges;
+    QList<ValueTarget> pendingValues;
+    QList<ValueTarget> valueBatch;
+    QList<LongValue> longValues;
+
+    Phase phase = Phase::Includes;
+    QByteArray currentRequest;
+    QLowEnergyHandle nextHandle = 0;
+    QLowEnergyHandle lastHandle = 0;
+    quint16 mtu;
+    int singleReads = 0;
+    int sentRequests = 0;
+    QLowEnergyService::DiscoveryMode mode;
+    bool readMultipleSupported = true;
+};
+
+QT_END_NAMESPACE
+
+#endif // LEGATTDATABASEWALKER_P_H
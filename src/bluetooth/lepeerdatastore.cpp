@@ -0,0 +1,256 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "lepeerdatastore_p.h"
+
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qsettings.h>
+#include <QtCore/qtimer.h>
+
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+LePeerDataStore::LePeerDataStore(const QBluetoothAddress &localAdapter, QObject *parent)
+    : QObject(parent),
+      m_localAdapter(localAdapter),
+      m_storageDirectory(QStringLiteral("/var/lib/bluetooth")),
+      m_flushTimer(new QTimer(this))
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(DefaultFlushInterval);
+    connect(m_flushTimer, &QTimer::timeout, this, &LePeerDataStore::flush);
+}
+
+LePeerDataStore::~LePeerDataStore()
+{
+    flush();
+}
+
+void LePeerDataStore::setFlushInterval(int msecs)
+{
+    m_flushTimer->setInterval(msecs);
+}
+
+void LePeerDataStore::loadSigningData(const QBluetoothAddress &peer, SigningKeyType keyType)
+{
+    const quint64 peerKey = peer.toUInt64();
+    if (m_signingData.contains(peerKey))
+        return; // We are up to date for this device.
+    const QString filePath = settingsFilePath(peerKey);
+    if (!QFileInfo(filePath).exists()) {
+        qCDebug(QT_BT_BLUEZ) << "No settings found for peer device.";
+        return;
+    }
+    QSettings settings(filePath, QSettings::IniFormat);
+    const QString group = settingsGroup(keyType);
+    settings.beginGroup(group);
+    const QByteArray keyString = settings.value(QLatin1String("Key")).toByteArray();
+    if (keyString.isEmpty()) {
+        qCDebug(QT_BT_BLUEZ) << "Group" << group << "not found in settings file";
+        return;
+    }
+    const QByteArray keyData = QByteArray::fromHex(keyString);
+    if (keyData.count() != int(sizeof(quint128))) {
+        qCWarning(QT_BT_BLUEZ) << "Signing key in settings file has invalid size"
+                               << keyString.count();
+        return;
+    }
+    qCDebug(QT_BT_BLUEZ) << "CSRK of peer device is" << keyString;
+    const quint32 counter = settings.value(QLatin1String("Counter"), 0).toUInt();
+    quint128 csrk;
+    using namespace std;
+    memcpy(csrk.data, keyData.constData(), keyData.count());
+
+    Entry entry;
+    entry.data = SigningData(csrk, counter - 1);
+    entry.keyType = keyType;
+    entry.storedCounter = counter;
+    m_signingData.insert(peerKey, entry);
+}
+
+void LePeerDataStore::setSigningKey(const QBluetoothAddress &peer, SigningKeyType keyType,
+                                    const quint128 &csrk)
+{
+    Entry entry;
+    entry.data = SigningData(csrk);
+    entry.keyType = keyType;
+    m_signingData.insert(peer.toUInt64(), entry);
+}
+
+LePeerDataStore::SigningData *LePeerDataStore::signingData(const QBluetoothAddress &peer)
+{
+    const auto it = m_signingData.find(peer.toUInt64());
+    return it == m_signingData.end() ? nullptr : &it.value().data;
+}
+
+void LePeerDataStore::commitSignCounter(const QBluetoothAddress &peer)
+{
+    const quint64 peerKey = peer.toUInt64();
+    const auto it = m_signingData.find(peerKey);
+    if (it == m_signingData.end())
+        return;
+    Entry &entry = it.value();
+    const quint32 nextCounter = entry.data.counter + 1;
+
+    if (entry.keyType == LocalSigningKey) {
+        // The counter has to be reserved before the signed packet leaves,
+        // otherwise a crash could make us reuse it.
+        if (nextCounter > entry.storedCounter)
+            storeCounter(peerKey, entry, nextCounter + m_counterReservation);
+        return;
+    }
+
+    // A lost remote counter only weakens replay protection until the peer
+    // signs again, so it is written lazily.
+    if (nextCounter == entry.storedCounter)
+        return;
+    entry.dirty = true;
+    if (!m_flushTimer->isActive())
+        m_flushTimer->start();
+}
+
+void LePeerDataStore::flush()
+{
+    m_flushTimer->stop();
+    for (auto it = m_signingData.begin(); it != m_signingData.end(); ++it) {
+        Entry &entry = it.value();
+        if (!entry.dirty)
+            continue;
+        entry.dirty = false;
+        storeCounter(it.key(), entry, entry.data.counter + 1);
+    }
+}
+
+void LePeerDataStore::setClientConfigurations(
+        const QBluetoothAddress &peer, const QList<ClientConfigurationData> &configurations)
+{
+    removeClientConfigurations(peer);
+    const quint64 peerKey = peer.toUInt64();
+    Client &client = m_clients[peerKey];
+    client.configurations = configurations;
+    client.storedAt = m_updateSequence;
+    for (const ClientConfigurationData &configuration : configurations)
+        m_subscribers[configuration.charValueHandle].insert(peerKey);
+}
+
+void LePeerDataStore::removeClientConfigurations(const QBluetoothAddress &peer)
+{
+    const quint64 peerKey = peer.toUInt64();
+    const auto clientIt = m_clients.constFind(peerKey);
+    if (clientIt == m_clients.constEnd())
+        return;
+    for (const ClientConfigurationData &configuration : clientIt.value().configurations) {
+        const auto it = m_subscribers.find(configuration.charValueHandle);
+        if (it == m_subscribers.end())
+            continue;
+        it.value().remove(peerKey);
+        if (it.value().isEmpty()) {
+            m_lastUpdate.remove(it.key());
+            m_subscribers.erase(it);
+        }
+    }
+    m_clients.erase(clientIt);
+}
+
+QList<LePeerDataStore::ClientConfigurationData>
+LePeerDataStore::clientConfigurations(const QBluetoothAddress &peer) const
+{
+    const auto clientIt = m_clients.constFind(peer.toUInt64());
+    if (clientIt == m_clients.constEnd())
+        return {};
+    QList<ClientConfigurationData> configurations = clientIt.value().configurations;
+    for (ClientConfigurationData &configuration : configurations) {
+        configuration.charValueWasUpdated
+                = m_lastUpdate.value(configuration.charValueHandle) > clientIt.value().storedAt;
+    }
+    return configurations;
+}
+
+void LePeerDataStore::characteristicValueUpdated(QLowEnergyHandle charValueHandle)
+{
+    if (m_subscribers.contains(charValueHandle))
+        m_lastUpdate.insert(charValueHandle, ++m_updateSequence);
+}
+
+int LePeerDataStore::subscriberCount(QLowEnergyHandle charValueHandle) const
+{
+    return m_subscribers.value(charValueHandle).count();
+}
+
+QString LePeerDataStore::settingsFilePath(quint64 peer) const
+{
+    return QString::fromLatin1("%1/%2/%3/info").arg(m_storageDirectory,
+                                                   m_localAdapter.toString(),
+                                                   QBluetoothAddress(peer).toString());
+}
+
+QString LePeerDataStore::settingsGroup(SigningKeyType keyType)
+{
+    return QLatin1String(keyType == LocalSigningKey ? "LocalSignatureKey" : "RemoteSignatureKey");
+}
+
+bool LePeerDataStore::storeCounter(quint64 peer, Entry &entry, quint32 counter)
+{
+    // Remembered even if the file cannot be written, so that we do not try
+    // again for every signed packet.
+    entry.storedCounter = counter;
+
+    const QString filePath = settingsFilePath(peer);
+    if (!QFileInfo(filePath).exists())
+        return false;
+    QSettings settings(filePath, QSettings::IniFormat);
+    if (!settings.isWritable())
+        return false;
+    settings.beginGroup(settingsGroup(entry.keyType));
+    const QString counterKey = QLatin1String("Counter");
+    if (!settings.allKeys().contains(counterKey))
+        return false;
+    if (counter == settings.value(counterKey).toUInt())
+        return true;
+    settings.setValue(counterKey, counter);
+    settings.sync();
+    ++m_settingsWriteCount;
+    return settings.status() == QSettings::NoError;
+}
+
+QT_END_NAMESPACE
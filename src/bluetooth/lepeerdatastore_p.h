@@ -0,0 +1,174 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef LEPEERDATASTORE_P_H
+#define LEPEERDATASTORE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtBluetooth/qbluetooth.h>
+#include <QtBluetooth/qbluetoothaddress.h>
+#include <QtBluetooth/qbluetoothuuid.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qset.h>
+#include <QtCore/qstring.h>
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+
+/*
+    Keeps the per peer data of LE connections which outlives a connection:
+    signing keys with their sign counters and, for bonded clients of the GATT
+    server, the client characteristic configurations.
+
+    Signing data is read from the BlueZ device information file once per peer
+    and kept in memory. Sign counters are written back in batches instead of
+    once per signed write:
+
+    - The counter of the local key is crash safe. The stored counter is the
+      next one to be used, and when it is reached the store reserves further
+      counters by writing it ahead. After a crash, the counters from the last
+      reservation onwards are unused and the stored counter is still valid.
+    - The counter of the remote key is written by flush(), which runs on a
+      timer after the counter changed and when the peer disconnects.
+
+    Client configurations are only kept in memory. The store indexes them by
+    characteristic value handle, so that a value update of the GATT server
+    does not have to look at every bonded client. An update only stamps the
+    handle with a sequence number. Whether a client missed an update is
+    decided when it reconnects, by comparing the stamps of its subscriptions
+    with the sequence number at which its configuration was stored.
+ */
+class Q_AUTOTEST_EXPORT LePeerDataStore : public QObject
+{
+    Q_OBJECT
+public:
+    enum SigningKeyType { LocalSigningKey, RemoteSigningKey };
+    enum { DefaultCounterReservation = 64, DefaultFlushInterval = 5000 };
+
+    struct SigningData {
+        SigningData() = default;
+        SigningData(const quint128 &csrk, quint32 signCounter = quint32(-1))
+            : key(csrk), counter(signCounter) {}
+
+        quint128 key;
+        // last counter used
+        quint32 counter = quint32(-1);
+    };
+
+    struct ClientConfigurationData {
+        ClientConfigurationData(QLowEnergyHandle chHndl = 0, QLowEnergyHandle coHndl = 0,
+                                quint16 val = 0)
+            : charValueHandle(chHndl), configHandle(coHndl), configValue(val) {}
+
+        QLowEnergyHandle charValueHandle;
+        QLowEnergyHandle configHandle;
+        quint16 configValue;
+        bool charValueWasUpdated = false;
+    };
+
+    explicit LePeerDataStore(const QBluetoothAddress &localAdapter, QObject *parent = nullptr);
+    ~LePeerDataStore() override;
+
+    void setStorageDirectory(const QString &directory) { m_storageDirectory = directory; }
+    void setCounterReservation(quint32 count) { m_counterReservation = count; }
+    void setFlushInterval(int msecs);
+
+    void loadSigningData(const QBluetoothAddress &peer, SigningKeyType keyType);
+    void setSigningKey(const QBluetoothAddress &peer, SigningKeyType keyType,
+                       const quint128 &csrk);
+    SigningData *signingData(const QBluetoothAddress &peer);
+    // to be called after the counter of the peer's signing data changed
+    void commitSignCounter(const QBluetoothAddress &peer);
+    void flush();
+
+    void setClientConfigurations(const QBluetoothAddress &peer,
+                                 const QList<ClientConfigurationData> &configurations);
+    void removeClientConfigurations(const QBluetoothAddress &peer);
+    // charValueWasUpdated is set for values updated since the configurations were stored
+    QList<ClientConfigurationData> clientConfigurations(const QBluetoothAddress &peer) const;
+    void characteristicValueUpdated(QLowEnergyHandle charValueHandle);
+    int subscriberCount(QLowEnergyHandle charValueHandle) const;
+
+    int settingsWriteCount() const { return m_settingsWriteCount; }
+
+private:
+    struct Entry {
+        SigningData data;
+        SigningKeyType keyType = LocalSigningKey;
+        // counter value in the information file, the next one to be used
+        quint32 storedCounter = 0;
+        bool dirty = false;
+    };
+
+    QString settingsFilePath(quint64 peer) const;
+    static QString settingsGroup(SigningKeyType keyType);
+    bool storeCounter(quint64 peer, Entry &entry, quint32 counter);
+
+    QBluetoothAddress m_localAdapter;
+    QString m_storageDirectory;
+    struct Client {
+        QList<ClientConfigurationData> configurations;
+        quint64 storedAt = 0;
+    };
+
+    QHash<quint64, Entry> m_signingData;
+    QHash<quint64, Client> m_clients;
+    QHash<QLowEnergyHandle, QSet<quint64>> m_subscribers;
+    QHash<QLowEnergyHandle, quint64> m_lastUpdate;
+    quint64 m_updateSequence = 0;
+    QTimer *m_flushTimer = nullptr;
+    quint32 m_counterReservation = DefaultCounterReservation;
+    int m_settingsWriteCount = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif // LEPEERDATASTORE_P_H
@@ -0,0 +1,99 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "lepreparedwrite_p.h"
+#include "bluez/bluez_data_p.h"
+
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+LePreparedWrite::LePreparedWrite(int mtu, bool reliable)
+    : m_maxPayload(mtu - PrepareWriteHeaderSize), m_reliable(reliable)
+{
+    Q_ASSERT(m_maxPayload > 0);
+}
+
+void LePreparedWrite::addValue(QLowEnergyHandle attributeHandle, QLowEnergyHandle targetHandle,
+                               const QByteArray &value)
+{
+    m_parts.append({ attributeHandle, targetHandle, value });
+
+    m_packets.reserve(m_packets.size() + (value.size() + m_maxPayload - 1) / m_maxPayload);
+    qsizetype offset = 0;
+    do {
+        // an empty value still needs one request to be written
+        const qsizetype payload = qMin<qsizetype>(value.size() - offset, m_maxPayload);
+        QByteArray packet(PrepareWriteHeaderSize + payload, Qt::Uninitialized);
+        packet[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST);
+        putBtData(targetHandle, packet.data() + 1);
+        putBtData(quint16(offset), packet.data() + 3);
+        using namespace std;
+        memcpy(packet.data() + PrepareWriteHeaderSize, value.constData() + offset, payload);
+        m_packets.append(packet);
+        offset += payload;
+    } while (offset < value.size());
+}
+
+QByteArray LePreparedWrite::nextPacket()
+{
+    Q_ASSERT(!atEnd());
+    return m_packets.at(m_next++);
+}
+
+/*
+    A Prepare Write Response carries handle, offset and value of the request.
+ */
+bool LePreparedWrite::isEcho(const QByteArray &request, const QByteArray &response)
+{
+    if (request.size() != response.size() || request.isEmpty())
+        return false;
+    using namespace std;
+    return memcmp(request.constData() + 1, response.constData() + 1, request.size() - 1) == 0;
+}
+
+QByteArray LePreparedWrite::executePacket(bool execute)
+{
+    QByteArray packet(2, Qt::Uninitialized);
+    packet[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_EXECUTE_WRITE_REQUEST);
+    packet[1] = execute ? 0x01 : 0x00; // execute or cancel the prepared writes
+    return packet;
+}
+
+QT_END_NAMESPACE
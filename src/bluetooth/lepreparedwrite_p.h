@@ -0,0 +1,108 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef LEPREPAREDWRITE_P_H
+#define LEPREPAREDWRITE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtBluetooth/qbluetooth.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qlist.h>
+
+QT_BEGIN_NAMESPACE
+
+/*
+    Values written with Prepare Write Requests and applied by a single
+    Execute Write Request. This is used for long characteristic and
+    descriptor writes, and for reliable writes of several characteristics.
+
+    The values are sliced once, for the MTU at the time the write starts, and
+    the attributes are resolved once by the caller. Each Prepare Write
+    Response must echo the request, otherwise the server's queue does not
+    hold what we sent and the write must be cancelled.
+ */
+class Q_AUTOTEST_EXPORT LePreparedWrite
+{
+public:
+    enum { PrepareWriteHeaderSize = 5 };
+
+    struct Part {
+        // identifies the written attribute for the caller
+        QLowEnergyHandle attributeHandle;
+        // handle on the server
+        QLowEnergyHandle targetHandle;
+        QByteArray value;
+    };
+
+    explicit LePreparedWrite(int mtu, bool reliable = false);
+
+    void addValue(QLowEnergyHandle attributeHandle, QLowEnergyHandle targetHandle,
+                  const QByteArray &value);
+    const QList<Part> &parts() const { return m_parts; }
+    // a reliable write reports the outcome for all parts together
+    bool isReliable() const { return m_reliable; }
+
+    int packetCount() const { return m_packets.count(); }
+    int sentPackets() const { return m_next; }
+    bool atEnd() const { return m_next >= m_packets.count(); }
+    QByteArray nextPacket();
+
+    static bool isEcho(const QByteArray &request, const QByteArray &response);
+    static QByteArray executePacket(bool execute);
+
+private:
+    QList<Part> m_parts;
+    QList<QByteArray> m_packets;
+    qsizetype m_next = 0;
+    int m_maxPayload;
+    bool m_reliable;
+};
+
+QT_END_NAMESPACE
+
+#endif // LEPREPAREDWRITE_P_H
@@ -298,6 +298,35 @@ int QBluetoothDeviceDiscoveryAgent::lowEnergyDiscoveryTimeout() const
     return d->lowEnergySearchTimeout;
 }
 
+/*!
+    Sets the filter which restricts the devices reported by the next discovery to \a filter.
+
+    On Linux the filter is handed to BlueZ, so that non-matching devices are neither
+    transferred to nor processed by the application. The new filter does not take effect
+    until the device search is restarted. The filter is ignored on other platforms.
+
+    \sa discoveryFilter()
+    \since 6.2
+ */
+void QBluetoothDeviceDiscoveryAgent::setDiscoveryFilter(const QBluetoothDeviceDiscoveryFilter &filter)
+{
+    Q_D(QBluetoothDeviceDiscoveryAgent);
+    d->discoveryFilter = filter;
+}
+
+/*!
+    Returns the filter applied to the device search. By default the filter is empty
+    and all devices are reported.
+
+    \sa setDiscoveryFilter()
+    \since 6.2
+ */
+QBluetoothDeviceDiscoveryFilter QBluetoothDeviceDiscoveryAgent::discoveryFilter() const
+{
+    Q_D(const QBluetoothDeviceDiscoveryAgent);
+    return d->discoveryFilter;
+}
+
 /*!
     \fn QBluetoothDeviceDiscoveryAgent::DiscoveryMethods QBluetoothDeviceDiscoveryAgent::supportedDiscoveryMethods()
 
@@ -46,6 +46,7 @@
 #include <QtCore/QObject>
 #include <QtBluetooth/QBluetoothDeviceInfo>
 #include <QtBluetooth/QBluetoothAddress>
+#include <QtBluetooth/qbluetoothdevicediscoveryfilter.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -93,6 +94,9 @@ public:
     void setLowEnergyDiscoveryTimeout(int msTimeout);
     int lowEnergyDiscoveryTimeout() const;
 
+    void setDiscoveryFilter(const QBluetoothDeviceDiscoveryFilter &filter);
+    QBluetoothDeviceDiscoveryFilter discoveryFilter() const;
+
     static DiscoveryMethods supportedDiscoveryMethods();
 public Q_SLOTS:
     void start();
@@ -53,6 +53,8 @@
 #include "bluez/properties_p.h"
 #include "bluez/bluetoothmanagement_p.h"
 
+#include <algorithm>
+
 QT_BEGIN_NAMESPACE
 
 Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
@@ -149,10 +151,40 @@ void QBluetoothDeviceDiscoveryAgentPrivate::start(QBluetoothDeviceDiscoveryAgent
     else
         map.insert(QStringLiteral("Transport"), QStringLiteral("bredr"));
 
+    // Let BlueZ drop non-matching devices before they are sent over D-Bus
+    filterUuids.clear();
+    QVariantMap filterMap = map;
+    if (!discoveryFilter.isEmpty()) {
+        for (const QBluetoothUuid &uuid : discoveryFilter.serviceUuids())
+            filterUuids.append(uuid.toString(QUuid::WithoutBraces));
+        if (!filterUuids.isEmpty())
+            filterMap.insert(QStringLiteral("UUIDs"), filterUuids);
+
+        // RSSI and Pathloss are mutually exclusive for BlueZ, the pathloss is checked locally then
+        if (discoveryFilter.minimumRssi() != 0)
+            filterMap.insert(QStringLiteral("RSSI"), QVariant::fromValue(discoveryFilter.minimumRssi()));
+        else if (discoveryFilter.maximumPathloss() != 0)
+            filterMap.insert(QStringLiteral("Pathloss"), QVariant::fromValue(discoveryFilter.maximumPathloss()));
+
+        if (!discoveryFilter.isDuplicateDataReported())
+            filterMap.insert(QStringLiteral("DuplicateData"), false);
+        if (!discoveryFilter.namePattern().isEmpty())
+            filterMap.insert(QStringLiteral("Pattern"), discoveryFilter.namePattern());
+    }
+
     // older BlueZ 5.x versions don't have this function
     // filterReply returns UnknownMethod which we ignore
-    QDBusPendingReply<> filterReply = adapterBluez5->SetDiscoveryFilter(map);
+    QDBusPendingReply<> filterReply = adapterBluez5->SetDiscoveryFilter(filterMap);
     filterReply.waitForFinished();
+    if (filterReply.isError() && filterMap != map
+            && filterReply.error().name() == QStringLiteral("org.bluez.Error.InvalidArguments")) {
+        // BlueZ versions before 5.54 reject the keys they do not know. Fall back to the transport,
+        // the filter is applied in acceptDeviceBluez5() in any case.
+        qCDebug(QT_BT_BLUEZ) << "Discovery filter not supported by BlueZ, filtering locally:"
+                             << filterReply.error();
+        filterReply = adapterBluez5->SetDiscoveryFilter(map);
+        filterReply.waitForFinished();
+    }
     if (filterReply.isError()) {
         if (filterReply.error().type() == QDBusError::Other
                     && filterReply.error().name() == QStringLiteral("org.bluez.Error.Failed")) {
@@ -174,18 +206,17 @@ void QBluetoothDeviceDiscoveryAgentPrivate::start(QBluetoothDeviceDiscoveryAgent
                      q, [this](const QString &path){
         this->_q_discoveryInterrupted(path);
     });
-    OrgFreedesktopDBusPropertiesInterface *prop = new OrgFreedesktopDBusPropertiesInterface(
-                QStringLiteral("org.bluez"), QStringLiteral(""), QDBusConnection::systemBus());
-    QObject::connect(prop, &OrgFreedesktopDBusPropertiesInterface::PropertiesChanged,
-                     q, [this](const QString &interface, const QVariantMap &changedProperties,
-                     const QStringList &invalidatedProperties,
-                     const QDBusMessage &signal) {
-        this->_q_PropertiesChanged(interface, signal.path(), changedProperties, invalidatedProperties);
+    // Only changes of the devices below our adapter are of interest
+    propertiesChangedUsed = 0;
+    deviceMonitor = new QtBluezPropertiesChangedMonitor(QStringLiteral("org.bluez.Device1"),
+                                                        adapterBluez5->path());
+    QObject::connect(deviceMonitor, &QtBluezPropertiesChangedMonitor::propertiesChanged,
+                     q, [this](const QString &path, const QVariantMap &changedProperties,
+                     const QStringList &invalidatedProperties) {
+        this->_q_PropertiesChanged(QStringLiteral("org.bluez.Device1"), path,
+                                   changedProperties, invalidatedProperties);
     });
 
-    // remember what we have to cleanup
-    propertyMonitors.append(prop);
-
     // collect initial set of information
     QDBusPendingReply<ManagedObjectList> reply = managerBluez5->GetManagedObjects();
     reply.waitForFinished();
@@ -238,6 +269,53 @@ void QBluetoothDeviceDiscoveryAgentPrivate::stop()
     _q_discoveryFinished();
 }
 
+/*
+    Applies discoveryFilter to the raw BlueZ properties. BlueZ already filters the devices it
+    finds during the discovery (depending on its version), but devices it knew before are
+    reported regardless. Rejecting them here avoids creating a QBluetoothDeviceInfo.
+*/
+bool QBluetoothDeviceDiscoveryAgentPrivate::acceptDeviceBluez5(const QVariantMap &properties) const
+{
+    if (discoveryFilter.isEmpty())
+        return true;
+
+    if (!filterUuids.isEmpty()) {
+        const QStringList uuids = properties.value(QStringLiteral("UUIDs")).toStringList();
+        const auto isFiltered = [this](const QString &uuid) {
+            return filterUuids.contains(uuid, Qt::CaseInsensitive);
+        };
+        if (std::none_of(uuids.cbegin(), uuids.cend(), isFiltered))
+            return false;
+    }
+
+    const qint16 minimumRssi = discoveryFilter.minimumRssi();
+    const quint16 maximumPathloss = discoveryFilter.maximumPathloss();
+    if (minimumRssi != 0 || maximumPathloss != 0) {
+        const auto rssiIt = properties.constFind(QStringLiteral("RSSI"));
+        if (rssiIt == properties.constEnd()) // not in range
+            return false;
+
+        const int rssi = rssiIt->toInt();
+        if (minimumRssi != 0 && rssi < minimumRssi)
+            return false;
+
+        if (maximumPathloss != 0) {
+            const auto txPowerIt = properties.constFind(QStringLiteral("TxPower"));
+            if (txPowerIt == properties.constEnd() || txPowerIt->toInt() - rssi > maximumPathloss)
+                return false;
+        }
+    }
+
+    const QString pattern = discoveryFilter.namePattern();
+    if (!pattern.isEmpty()
+            && !properties.value(QStringLiteral("Name")).toString().startsWith(pattern)
+            && !properties.value(QStringLiteral("Address")).toString().startsWith(pattern)) {
+        return false;
+    }
+
+    return true;
+}
+
 // Returns invalid QBluetoothDeviceInfo in case of error
 static QBluetoothDeviceInfo createDeviceInfoFromBluez5Device(const QVariantMap& properties)
 {
@@ -300,6 +378,13 @@ void QBluetoothDeviceDiscoveryAgentPrivate::deviceFoundBluez5(const QString &dev
      if (deviceAdapter.path() != adapterBluez5->path())
          return;
 
+    // Cache the properties so we do not have to access dbus every time to get a value.
+    // Filtered devices are kept as well, they may match once their RSSI changes.
+    devicesProperties[devicePath] = properties;
+
+    if (!acceptDeviceBluez5(properties))
+        return;
+
     // read information
     QBluetoothDeviceInfo deviceInfo = createDeviceInfoFromBluez5Device(properties);
     if (!deviceInfo.isValid()) // no point reporting an empty address
@@ -311,9 +396,6 @@ void QBluetoothDeviceDiscoveryAgentPrivate::deviceFoundBluez5(const QString &dev
                          << "RSSI" << deviceInfo.rssi()
                          << "Num ManufacturerData" << deviceInfo.manufacturerData().size();
 
-    // Cache the properties so we do not have to access dbus every time to get a value
-    devicesProperties[devicePath] = properties;
-
     for (int i = 0; i < discoveredDevices.size(); i++) {
         if (discoveredDevices[i].address() == deviceInfo.address()) {
             if (lowEnergySearchTimeout > 0 && discoveredDevices[i] == deviceInfo) {
@@ -356,8 +438,13 @@ void QBluetoothDeviceDiscoveryAgentPrivate::_q_discoveryFinished()
     QtBluezDiscoveryManager::instance()->disconnect(q);
     QtBluezDiscoveryManager::instance()->unregisterDiscoveryInterest(adapterBluez5->path());
 
-    qDeleteAll(propertyMonitors);
-    propertyMonitors.clear();
+    if (deviceMonitor) {
+        qCDebug(QT_BT_BLUEZ) << "Device PropertiesChanged signals delivered:"
+                             << deviceMonitor->deliveredCount()
+                             << "used:" << propertiesChangedUsed;
+        delete deviceMonitor;
+        deviceMonitor = nullptr;
+    }
 
     delete adapterBluez5;
     adapterBluez5 = nullptr;
@@ -392,6 +479,9 @@ void QBluetoothDeviceDiscoveryAgentPrivate::_q_discoveryInterrupted(const QStrin
         // no need to call unregisterDiscoveryInterest since QtBluezDiscoveryManager
         // does this automatically when emitting discoveryInterrupted(QString) signal
 
+        delete deviceMonitor;
+        deviceMonitor = nullptr;
+
         delete adapterBluez5;
         adapterBluez5 = nullptr;
 
@@ -413,6 +503,8 @@ void QBluetoothDeviceDiscoveryAgentPrivate::_q_PropertiesChanged(const QString &
     if (!devicesProperties.contains(path))
         return;
 
+    ++propertiesChangedUsed;
+
     // Update the cached properties before checking changed_properties for RSSI and ManufacturerData
     // so the cached properties are always up to date.
     QVariantMap & properties = devicesProperties[path];
@@ -424,6 +516,9 @@ void QBluetoothDeviceDiscoveryAgentPrivate::_q_PropertiesChanged(const QString &
     for (const QString & property : invalidated_properties)
         properties.remove(property);
 
+    if (!acceptDeviceBluez5(properties))
+        return;
+
     const auto info = createDeviceInfoFromBluez5Device(properties);
     if (!info.isValid())
         return;
@@ -481,6 +576,13 @@ void QBluetoothDeviceDiscoveryAgentPrivate::_q_PropertiesChanged(const QString &
                 return;
             }
         }
+
+        // The device was rejected by the RSSI or pathloss filter before and is in range now
+        if (!discoveryFilter.isEmpty()) {
+            qCDebug(QT_BT_BLUEZ) << "Filtered device now matches:" << info.address();
+            discoveredDevices.append(info);
+            emit q->deviceDiscovered(info);
+        }
     }
 }
 QT_END_NAMESPACE
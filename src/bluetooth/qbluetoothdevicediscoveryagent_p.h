@@ -164,9 +164,16 @@ private:
     OrgFreedesktopDBusObjectManagerInterface *managerBluez5 = nullptr;
     OrgBluezAdapter1Interface *adapterBluez5 = nullptr;
     QTimer *discoveryTimer = nullptr;
-    QList<OrgFreedesktopDBusPropertiesInterface *> propertyMonitors;
+    QtBluezPropertiesChangedMonitor *deviceMonitor = nullptr;
+    // PropertiesChanged signals which updated a discovered device, compared against
+    // the number delivered by the bus at the end of the discovery
+    int propertiesChangedUsed = 0;
 
     void deviceFoundBluez5(const QString &devicePath, const QVariantMap &properties);
+    bool acceptDeviceBluez5(const QVariantMap &properties) const;
+
+    // discoveryFilter's service UUIDs in the string form used by BlueZ
+    QStringList filterUuids;
 
     QMap<QString, QVariantMap> devicesProperties;
 #endif
@@ -236,6 +243,7 @@ private:
 
 #endif // Q_OS_DARWIN
 
+    QBluetoothDeviceDiscoveryFilter discoveryFilter;
     int lowEnergySearchTimeout = 40000;
     QBluetoothDeviceDiscoveryAgent::DiscoveryMethods requestedMethods;
     QBluetoothDeviceDiscoveryAgent *q_ptr;
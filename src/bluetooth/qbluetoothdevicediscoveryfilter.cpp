@@ -0,0 +1,271 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qbluetoothdevicediscoveryfilter.h"
+
+QT_BEGIN_NAMESPACE
+
+class QBluetoothDeviceDiscoveryFilterPrivate : public QSharedData
+{
+public:
+    QList<QBluetoothUuid> serviceUuids;
+    QString namePattern;
+    qint16 minimumRssi = 0;
+    quint16 maximumPathloss = 0;
+    bool duplicateData = true;
+};
+
+/*!
+    \since 6.2
+    \class QBluetoothDeviceDiscoveryFilter
+    \brief The QBluetoothDeviceDiscoveryFilter class restricts the devices reported
+           by a QBluetoothDeviceDiscoveryAgent.
+
+    A filter is applied by passing it to
+    \l QBluetoothDeviceDiscoveryAgent::setDiscoveryFilter() before the discovery is started.
+    Devices which do not match the filter are not reported via
+    \l QBluetoothDeviceDiscoveryAgent::deviceDiscovered() and do not appear in
+    \l QBluetoothDeviceDiscoveryAgent::discoveredDevices().
+
+    All criteria of the filter must be met by a device. Criteria which are not set
+    do not restrict the discovery.
+
+    On Linux the filter is handed to BlueZ, which then does not forward non-matching
+    devices to the application at all. Criteria the running BlueZ version does not
+    support are applied by Qt when the device is reported. The filter is ignored on
+    other platforms.
+
+    \inmodule QtBluetooth
+    \ingroup shared
+
+    \sa QBluetoothDeviceDiscoveryAgent::setDiscoveryFilter()
+*/
+
+/*!
+    Constructs a new filter which does not restrict the discovery.
+ */
+QBluetoothDeviceDiscoveryFilter::QBluetoothDeviceDiscoveryFilter()
+    : d(new QBluetoothDeviceDiscoveryFilterPrivate)
+{
+}
+
+/*! Constructs a new object of this class that is a copy of \a other. */
+QBluetoothDeviceDiscoveryFilter::QBluetoothDeviceDiscoveryFilter(
+        const QBluetoothDeviceDiscoveryFilter &other)
+    : d(other.d)
+{
+}
+
+/*! Destroys this object. */
+QBluetoothDeviceDiscoveryFilter::~QBluetoothDeviceDiscoveryFilter()
+{
+}
+
+/*! Makes this object a copy of \a other and returns the new value of this object. */
+QBluetoothDeviceDiscoveryFilter &QBluetoothDeviceDiscoveryFilter::operator=(
+        const QBluetoothDeviceDiscoveryFilter &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Returns \c true if this filter does not restrict the reported devices;
+    otherwise returns \c false.
+ */
+bool QBluetoothDeviceDiscoveryFilter::isEmpty() const
+{
+    return d->serviceUuids.isEmpty() && d->namePattern.isEmpty() && d->minimumRssi == 0
+            && d->maximumPathloss == 0 && d->duplicateData;
+}
+
+/*!
+    Sets the service UUIDs to filter for to \a uuids. A device matches if it
+    advertises or offers at least one of the services in \a uuids.
+
+    \sa serviceUuids()
+ */
+void QBluetoothDeviceDiscoveryFilter::setServiceUuids(const QList<QBluetoothUuid> &uuids)
+{
+    d->serviceUuids = uuids;
+}
+
+/*!
+    Returns the service UUIDs a device must provide one of. The list is empty by default.
+
+    \sa setServiceUuids()
+ */
+QList<QBluetoothUuid> QBluetoothDeviceDiscoveryFilter::serviceUuids() const
+{
+    return d->serviceUuids;
+}
+
+/*!
+    Sets the minimum received signal strength in dBm to \a rssi. Devices which are
+    received with a weaker signal are not reported until they come closer.
+    A value of \c 0 disables the filter.
+
+    \sa minimumRssi(), setMaximumPathloss()
+ */
+void QBluetoothDeviceDiscoveryFilter::setMinimumRssi(qint16 rssi)
+{
+    d->minimumRssi = rssi;
+}
+
+/*!
+    Returns the minimum received signal strength in dBm. The default is \c 0,
+    which does not restrict the discovery.
+
+    \sa setMinimumRssi()
+ */
+qint16 QBluetoothDeviceDiscoveryFilter::minimumRssi() const
+{
+    return d->minimumRssi;
+}
+
+/*!
+    Sets the maximum pathloss in dB to \a pathloss. The pathloss is the difference
+    between the advertised transmit power of a device and the received signal strength.
+    Devices which do not advertise their transmit power never match this filter.
+    A value of \c 0 disables the filter.
+
+    \note BlueZ does not accept a pathloss and an RSSI filter at the same time. If both are
+    set, only the RSSI filter is handed to BlueZ and the pathloss is checked by Qt.
+
+    \sa maximumPathloss(), setMinimumRssi()
+ */
+void QBluetoothDeviceDiscoveryFilter::setMaximumPathloss(quint16 pathloss)
+{
+    d->maximumPathloss = pathloss;
+}
+
+/*!
+    Returns the maximum pathloss in dB. The default is \c 0, which does not restrict
+    the discovery.
+
+    \sa setMaximumPathloss()
+ */
+quint16 QBluetoothDeviceDiscoveryFilter::maximumPathloss() const
+{
+    return d->maximumPathloss;
+}
+
+/*!
+    Sets whether advertisements which repeat the data of previous advertisements
+    are reported as device updates to \a reported. Turning this off considerably reduces
+    the number of updates of the signal strength and manufacturer data during a long
+    running discovery.
+
+    \sa isDuplicateDataReported()
+ */
+void QBluetoothDeviceDiscoveryFilter::setDuplicateDataReported(bool reported)
+{
+    d->duplicateData = reported;
+}
+
+/*!
+    Returns \c true if repeated advertisement data is reported. The default is \c true.
+
+    \sa setDuplicateDataReported()
+ */
+bool QBluetoothDeviceDiscoveryFilter::isDuplicateDataReported() const
+{
+    return d->duplicateData;
+}
+
+/*!
+    Sets the name pattern to \a pattern. A device matches if either its name or its
+    address starts with \a pattern. An empty pattern disables the filter.
+
+    \sa namePattern()
+ */
+void QBluetoothDeviceDiscoveryFilter::setNamePattern(const QString &pattern)
+{
+    d->namePattern = pattern;
+}
+
+/*!
+    Returns the prefix the name or address of a device must start with.
+    The pattern is empty by default.
+
+    \sa setNamePattern()
+ */
+QString QBluetoothDeviceDiscoveryFilter::namePattern() const
+{
+    return d->namePattern;
+}
+
+/*!
+   \fn void QBluetoothDeviceDiscoveryFilter::swap(QBluetoothDeviceDiscoveryFilter &other)
+   Swaps this object with \a other.
+ */
+
+/*!
+    \brief Returns \a true if \a a and \a b are equal with respect to their public state,
+    otherwise returns false.
+    \internal
+ */
+bool QBluetoothDeviceDiscoveryFilter::equals(const QBluetoothDeviceDiscoveryFilter &a,
+                                             const QBluetoothDeviceDiscoveryFilter &b)
+{
+    if (a.d == b.d)
+        return true;
+    return a.d->serviceUuids == b.d->serviceUuids && a.d->namePattern == b.d->namePattern
+            && a.d->minimumRssi == b.d->minimumRssi
+            && a.d->maximumPathloss == b.d->maximumPathloss
+            && a.d->duplicateData == b.d->duplicateData;
+}
+
+/*!
+   \fn bool QBluetoothDeviceDiscoveryFilter::operator!=(
+                                    const QBluetoothDeviceDiscoveryFilter &a,
+                                    const QBluetoothDeviceDiscoveryFilter &b)
+   \brief Returns \c true if \a a and \a b are not equal with respect to their public state,
+   otherwise returns \c false.
+ */
+
+/*!
+    \fn bool QBluetoothDeviceDiscoveryFilter::operator==(
+                                    const QBluetoothDeviceDiscoveryFilter &a,
+                                    const QBluetoothDeviceDiscoveryFilter &b)
+    \brief Returns \c true if \a a and \a b are equal with respect to their public state,
+    otherwise returns \c false.
+ */
+
+QT_END_NAMESPACE
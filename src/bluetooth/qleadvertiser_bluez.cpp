@@ -37,13 +37,17 @@
 **
 ****************************************************************************/
 
+
 #include "qleadvertiser_p.h"
 
 #include "bluez/bluez_data_p.h"
 #include "bluez/hcimanager_p.h"
 #include "qbluetoothsocketbase_p.h"
 
+#include <QtCore/qendian.h>
+#include <QtCore/qglobalstatic.h>
 #include <QtCore/qloggingcategory.h>
+#include <QtCore/qset.h>
 
 #include <cstring>
 
@@ -62,9 +66,48 @@ struct AdvParams {
     quint8 filterPolicy;
 } __attribute__ ((packed));
 
+struct ExtAdvParams {
+    quint8 handle;
+    quint16 properties;
+    quint8 primaryMinInterval[3];
+    quint8 primaryMaxInterval[3];
+    quint8 primaryChannelMap;
+    quint8 ownAddrType;
+    quint8 peerAddrType;
+    bdaddr_t peerAddr;
+    quint8 filterPolicy;
+    qint8 txPower;
+    quint8 primaryPhy;
+    quint8 secondaryMaxSkip;
+    quint8 secondaryPhy;
+    quint8 sid;
+    quint8 scanRequestNotification;
+} __attribute__ ((packed));
+
+enum ExtAdvProperty : quint16 {
+    ExtAdvConnectable = 0x0001,
+    ExtAdvScannable = 0x0002,
+    ExtAdvLegacyPdu = 0x0010
+};
+
+enum ExtAdvDataOperation : quint8 {
+    ExtAdvDataIntermediateFragment = 0x00,
+    ExtAdvDataFirstFragment = 0x01,
+    ExtAdvDataLastFragment = 0x02,
+    ExtAdvDataComplete = 0x03
+};
+
+static const int legacyAdvDataLength = 31;
+static const int maxExtAdvDataLength = 1650;
+// a connectable extended advertisement must fit into a single AUX_ADV_IND PDU
+static const int maxConnectableExtAdvDataLength = 191;
+static const int maxExtAdvDataFragmentLength = 251;
+static const int maxAdvertisingHandle = 0xef;
+
 struct AdvData {
-    quint8 length;
-    quint8 data[31];
+    quint16 length = 0;
+    quint16 capacity = legacyAdvDataLength;
+    quint8 data[maxExtAdvDataLength];
 };
 
 struct WhiteListParams {
@@ -72,66 +115,131 @@ struct WhiteListParams {
     bdaddr_t addr;
 };
 
+// advertising sets of all advertisers in this process
+Q_GLOBAL_STATIC(QSet<int>, advertisingHandlesInUse)
 
 template<typename T> QByteArray byteArrayFromStruct(const T &data, int maxSize = -1)
 {
     return QByteArray(reinterpret_cast<const char *>(&data), maxSize != -1 ? maxSize : sizeof data);
 }
 
+// Space available for the next AD structure, whose length is encoded in a single byte
+static int elementSpace(const AdvData &data)
+{
+    return qMin(data.capacity - data.length, 256);
+}
+
 QLeAdvertiserBluez::QLeAdvertiserBluez(const QLowEnergyAdvertisingParameters &params,
                                        const QLowEnergyAdvertisingData &advertisingData,
                                        const QLowEnergyAdvertisingData &scanResponseData,
                                        HciManager &hciManager, QObject *parent)
-    : QLeAdvertiser(params, advertisingData, scanResponseData, parent), m_hciManager(hciManager)
+    : QLeAdvertiser(params, advertisingData, scanResponseData, parent), m_hciManager(hciManager),
+      m_commandScheduler(new HciCommandScheduler(hciManager, this))
 {
-    connect(&m_hciManager, &HciManager::commandCompleted, this,
+    connect(m_commandScheduler, &HciCommandScheduler::commandCompleted, this,
             &QLeAdvertiserBluez::handleCommandCompleted);
+    connect(m_commandScheduler, &HciCommandScheduler::errorOccurred, this,
+            &QLeAdvertiserBluez::handleError);
 }
 
 QLeAdvertiserBluez::~QLeAdvertiserBluez()
 {
-    disconnect(&m_hciManager, &HciManager::commandCompleted, this,
+    disconnect(m_commandScheduler, &HciCommandScheduler::commandCompleted, this,
                &QLeAdvertiserBluez::handleCommandCompleted);
+    disconnect(m_commandScheduler, &HciCommandScheduler::errorOccurred, this,
+               &QLeAdvertiserBluez::handleError);
     doStopAdvertising();
+    if (m_advertisingHandle >= 0)
+        advertisingHandlesInUse()->remove(m_advertisingHandle);
 }
 
 void QLeAdvertiserBluez::doStartAdvertising()
 {
-    if (!m_hciManager.monitorEvent(HciManager::HciEvent::EVT_CMD_COMPLETE)) {
+    if (!m_hciManager.monitorEvent(HciManager::HciEvent::EVT_CMD_COMPLETE)
+            || !m_hciManager.monitorEvent(HciManager::HciEvent::EVT_CMD_STATUS)) {
         handleError();
         return;
     }
 
+    m_started = true;
     m_sendPowerLevel = advertisingData().includePowerLevel()
             || scanResponseData().includePowerLevel();
-    if (m_sendPowerLevel)
-        queueReadTxPowerLevelCommand();
-    else
-        queueAdvertisingCommands();
-    sendNextCommand();
+    if (m_mode == Mode::Unknown) {
+        // Spec v5.2, Vol 4, Part E, 7.8.3
+        queueCommand(QBluezConst::OcfLeReadLocalSupportedFeatures, QByteArray());
+    } else {
+        queueStartCommands();
+    }
+    m_commandScheduler->submit();
 }
 
 void QLeAdvertiserBluez::doStopAdvertising()
 {
-    toggleAdvertising(false);
-    sendNextCommand();
+    m_started = false;
+    m_dataUpdatePending = false;
+
+    // commands the controller is processing already complete, the others are dropped
+    m_commandScheduler->dropQueuedCommands();
+
+    if (m_mode == Mode::Extended && m_advertisingHandle >= 0)
+        toggleExtendedAdvertising(false);
+    else
+        toggleAdvertising(false);
+    m_commandScheduler->submit();
 }
 
-void QLeAdvertiserBluez::queueCommand(QBluezConst::OpCodeCommandField ocf, const QByteArray &data)
+void QLeAdvertiserBluez::doUpdateAdvertisingData()
 {
-    m_pendingCommands << Command(ocf, data);
+    // otherwise the new data is used by the next start
+    if (!m_started)
+        return;
+
+    // Rapid updates are coalesced: only the latest data is sent once
+    // the running command sequence has finished.
+    if (!m_commandScheduler->isIdle()) {
+        m_dataUpdatePending = true;
+        return;
+    }
+
+    queueDataUpdateCommands();
+    m_commandScheduler->submit();
 }
 
-void QLeAdvertiserBluez::sendNextCommand()
+void QLeAdvertiserBluez::queueCommand(QBluezConst::OpCodeCommandField ocf, const QByteArray &data,
+                                      HciCommandScheduler::CommandFlags flags)
 {
-    if (m_pendingCommands.isEmpty()) {
-        // TODO: Unmonitor event.
+    // the state of an advertising set is independent of the other sets
+    const quint8 stateKey = m_mode == Mode::Extended && m_advertisingHandle >= 0
+            ? quint8(m_advertisingHandle) : 0;
+    m_commandScheduler->enqueue(ocf, data, flags, stateKey);
+}
+
+void QLeAdvertiserBluez::queueStartCommands()
+{
+    if (m_mode == Mode::Extended) {
+        if (!acquireAdvertisingHandle()) {
+            qCWarning(QT_BT_BLUEZ) << "no free advertising set available";
+            handleError();
+            return;
+        }
+        queueExtendedAdvertisingCommands();
         return;
     }
-    const Command &c = m_pendingCommands.first();
-    if (!m_hciManager.sendCommand(QBluezConst::OgfLinkControl, c.ocf, c.data)) {
-        handleError();
-        return;
+
+    if (m_sendPowerLevel)
+        queueReadTxPowerLevelCommand();
+    else
+        queueAdvertisingCommands();
+}
+
+void QLeAdvertiserBluez::queueDataUpdateCommands()
+{
+    // The data is replaced while advertising continues.
+    if (m_mode == Mode::Extended) {
+        queueExtendedDataCommands(true);
+    } else {
+        setAdvertisingData();
+        setScanResponseData();
     }
 }
 
@@ -148,13 +256,29 @@ void QLeAdvertiserBluez::queueAdvertisingCommands()
 void QLeAdvertiserBluez::queueReadTxPowerLevelCommand()
 {
     // Spec v4.2, Vol 2, Part E, 7.8.6
-    queueCommand(QBluezConst::OcfLeReadTxPowerLevel, QByteArray());
+    // The level does not change, a restart uses the recorded result.
+    queueCommand(QBluezConst::OcfLeReadTxPowerLevel, QByteArray(),
+                 HciCommandScheduler::SkipIfApplied);
 }
 
 void QLeAdvertiserBluez::toggleAdvertising(bool enable)
 {
     // Spec v4.2, Vol 2, Part E, 7.8.9
-    queueCommand(QBluezConst::OcfLeSetAdvEnable, QByteArray(1, enable));
+    // Enabling waits for the setup commands, which might fail.
+    queueCommand(QBluezConst::OcfLeSetAdvEnable, QByteArray(1, enable),
+                 enable ? HciCommandScheduler::Barrier : HciCommandScheduler::NoCommandFlags);
+}
+
+quint8 QLeAdvertiserBluez::advertisingFilterPolicy() const
+{
+    quint8 filterPolicy = parameters().filterPolicy();
+    if (filterPolicy != QLowEnergyAdvertisingParameters::IgnoreWhiteList
+            && advertisingData().discoverability() == QLowEnergyAdvertisingData::DiscoverabilityLimited) {
+        qCWarning(QT_BT_BLUEZ) << "limited discoverability is incompatible with "
+                                  "using a white list; disabling filtering";
+        filterPolicy = QLowEnergyAdvertisingParameters::IgnoreWhiteList;
+    }
+    return filterPolicy;
 }
 
 void QLeAdvertiserBluez::setAdvertisingParams()
@@ -166,13 +290,7 @@ void QLeAdvertiserBluez::setAdvertisingParams()
     memset(&params, 0, sizeof params);
     setAdvertisingInterval(params);
     params.type = parameters().mode();
-    params.filterPolicy = parameters().filterPolicy();
-    if (params.filterPolicy != QLowEnergyAdvertisingParameters::IgnoreWhiteList
-            && advertisingData().discoverability() == QLowEnergyAdvertisingData::DiscoverabilityLimited) {
-        qCWarning(QT_BT_BLUEZ) << "limited discoverability is incompatible with "
-                                  "using a white list; disabling filtering";
-        params.filterPolicy = QLowEnergyAdvertisingParameters::IgnoreWhiteList;
-    }
+    params.filterPolicy = advertisingFilterPolicy();
     params.ownAddrType = QLowEnergyController::PublicAddress; // TODO: Make configurable.
 
     // TODO: For ADV_DIRECT_IND.
@@ -183,7 +301,7 @@ void QLeAdvertiserBluez::setAdvertisingParams()
 
     const QByteArray paramsData = byteArrayFromStruct(params);
     qCDebug(QT_BT_BLUEZ) << "advertising parameters:" << paramsData.toHex();
-    queueCommand(QBluezConst::OcfLeSetAdvParams, paramsData);
+    queueCommand(QBluezConst::OcfLeSetAdvParams, paramsData, HciCommandScheduler::SkipIfApplied);
 }
 
 static quint16 forceIntoRange(quint16 val, quint16 min, quint16 max)
@@ -250,7 +368,7 @@ static void addServicesData(AdvData &data, const QList<T> &services)
 {
     if (services.isEmpty())
         return;
-    const int spaceAvailable = sizeof data.data - data.length;
+    const int spaceAvailable = elementSpace(data);
     const int maxServices = qMin<int>((spaceAvailable - 2) / sizeof(T), services.count());
     if (maxServices <= 0) {
         qCWarning(QT_BT_BLUEZ) << "services data does not fit into advertising data packet";
@@ -304,7 +422,7 @@ void QLeAdvertiserBluez::setManufacturerData(const QLowEnergyAdvertisingData &sr
 {
     if (src.manufacturerId() == QLowEnergyAdvertisingData::invalidManufacturerId())
         return;
-    if (dest.length >= sizeof dest.data - 1 - 1 - 2 - src.manufacturerData().count()) {
+    if (1 + 1 + 2 + src.manufacturerData().count() > elementSpace(dest)) {
         qCWarning(QT_BT_BLUEZ) << "manufacturer data does not fit into advertising data packet";
         return;
     }
@@ -321,14 +439,14 @@ void QLeAdvertiserBluez::setLocalNameData(const QLowEnergyAdvertisingData &src,
 {
     if (src.localName().isEmpty())
         return;
-    if (dest.length >= sizeof dest.data - 3) {
+    if (elementSpace(dest) < 3) {
         qCWarning(QT_BT_BLUEZ) << "local name does not fit into advertising data";
         return;
     }
 
     const QByteArray localNameUtf8 = src.localName().toUtf8();
     const int fullSize = localNameUtf8.count() + 1 + 1;
-    const int size = qMin<int>(fullSize, sizeof dest.data - dest.length);
+    const int size = qMin<int>(fullSize, elementSpace(dest));
     const bool isComplete = size == fullSize;
     dest.data[dest.length++] = size - 1;
     const int dataType = isComplete ? 0x9 : 0x8;
@@ -337,18 +455,14 @@ void QLeAdvertiserBluez::setLocalNameData(const QLowEnergyAdvertisingData &src,
     dest.length += size - 2;
 }
 
-void QLeAdvertiserBluez::setData(bool isScanResponseData)
+void QLeAdvertiserBluez::buildData(bool isScanResponseData, AdvData &theData)
 {
     // Spec v4.2, Vol 3, Part C, 11 and Supplement, Part 1
-    AdvData theData;
-    static_assert(sizeof theData == 32, "unexpected struct size");
-    theData.length = 0;
-
     const QLowEnergyAdvertisingData &sourceData = isScanResponseData
             ? scanResponseData() : advertisingData();
 
     if (!sourceData.rawData().isEmpty()) {
-        theData.length = qMin<int>(sizeof theData.data, sourceData.rawData().count());
+        theData.length = qMin<int>(theData.capacity, sourceData.rawData().count());
         std::memcpy(theData.data, sourceData.rawData().constData(), theData.length);
     } else {
         if (sourceData.includePowerLevel())
@@ -362,18 +476,28 @@ void QLeAdvertiserBluez::setData(bool isScanResponseData)
         setServicesData(sourceData, theData);
         setManufacturerData(sourceData, theData);
     }
+}
+
+void QLeAdvertiserBluez::setData(bool isScanResponseData)
+{
+    AdvData theData;
+    buildData(isScanResponseData, theData);
 
-    std::memset(theData.data + theData.length, 0, sizeof theData.data - theData.length);
-    const QByteArray dataToSend = byteArrayFromStruct(theData);
+    // the legacy commands carry a length byte and a zero padded payload
+    QByteArray dataToSend(1 + legacyAdvDataLength, '\0');
+    dataToSend[0] = char(theData.length);
+    std::memcpy(dataToSend.data() + 1, theData.data, theData.length);
 
     if (!isScanResponseData) {
         qCDebug(QT_BT_BLUEZ) << "advertising data:" << dataToSend.toHex();
-        queueCommand(QBluezConst::OcfLeSetAdvData, dataToSend);
+        queueCommand(QBluezConst::OcfLeSetAdvData, dataToSend,
+                     HciCommandScheduler::SkipIfApplied);
     } else if ((parameters().mode() == QLowEnergyAdvertisingParameters::AdvScanInd
                || parameters().mode() == QLowEnergyAdvertisingParameters::AdvInd)
                && theData.length > 0) {
         qCDebug(QT_BT_BLUEZ) << "scan response data:" << dataToSend.toHex();
-        queueCommand(QBluezConst::OcfLeSetScanResponseData, dataToSend);
+        queueCommand(QBluezConst::OcfLeSetScanResponseData, dataToSend,
+                     HciCommandScheduler::SkipIfApplied);
     }
 }
 
@@ -406,32 +530,217 @@ void QLeAdvertiserBluez::setWhiteList()
     }
 }
 
-void QLeAdvertiserBluez::handleCommandCompleted(quint16 opCode, quint8 status,
-                                                const QByteArray &data)
+bool QLeAdvertiserBluez::acquireAdvertisingHandle()
+{
+    if (m_advertisingHandle >= 0)
+        return true;
+
+    QSet<int> *handles = advertisingHandlesInUse();
+    for (int handle = 0; handle <= maxAdvertisingHandle; ++handle) {
+        if (!handles->contains(handle)) {
+            handles->insert(handle);
+            m_advertisingHandle = handle;
+            return true;
+        }
+    }
+    return false;
+}
+
+void QLeAdvertiserBluez::queueExtendedAdvertisingCommands()
+{
+    toggleExtendedAdvertising(false); // Stop advertising first, in case the set is active.
+    setWhiteList();
+    // the data follows once the controller reported the selected TX power
+    setExtendedAdvertisingParams();
+}
+
+void QLeAdvertiserBluez::toggleExtendedAdvertising(bool enable)
+{
+    // Spec v5.2, Vol 4, Part E, 7.8.56
+    // One set, neither duration nor maximum number of events
+    QByteArray command(6, '\0');
+    command[0] = char(enable);
+    command[1] = 1;
+    command[2] = char(m_advertisingHandle);
+    queueCommand(QBluezConst::OcfLeSetExtAdvEnable, command,
+                 enable ? HciCommandScheduler::Barrier : HciCommandScheduler::NoCommandFlags);
+}
+
+static void putInterval(quint16 interval, quint8 (&dest)[3])
+{
+    dest[0] = interval & 0xff;
+    dest[1] = interval >> 8;
+    dest[2] = 0;
+}
+
+void QLeAdvertiserBluez::setExtendedAdvertisingParams()
+{
+    // Payloads which fit into legacy PDUs keep the set visible to scanners
+    // which do not support extended advertising.
+    AdvData advData;
+    AdvData responseData;
+    advData.capacity = responseData.capacity = m_maxDataLength;
+    buildData(false, advData);
+    buildData(true, responseData);
+    const bool legacyPdus = advData.length <= legacyAdvDataLength
+            && responseData.length <= legacyAdvDataLength;
+
+    switch (parameters().mode()) {
+    case QLowEnergyAdvertisingParameters::AdvInd:
+        m_advertisingProperties = legacyPdus
+                ? ExtAdvLegacyPdu | ExtAdvConnectable | ExtAdvScannable
+                : ExtAdvConnectable;
+        break;
+    case QLowEnergyAdvertisingParameters::AdvScanInd:
+        m_advertisingProperties = legacyPdus
+                ? ExtAdvLegacyPdu | ExtAdvScannable
+                : ExtAdvScannable;
+        break;
+    default:
+        m_advertisingProperties = legacyPdus ? ExtAdvLegacyPdu : 0;
+        break;
+    }
+
+    // Spec v5.2, Vol 4, Part E, 7.8.53
+    ExtAdvParams params;
+    static_assert(sizeof params == 25, "unexpected struct size");
+    std::memset(&params, 0, sizeof params);
+    params.handle = m_advertisingHandle;
+    params.properties = qToLittleEndian(m_advertisingProperties);
+    AdvParams intervals;
+    setAdvertisingInterval(intervals);
+    putInterval(qFromLittleEndian(intervals.minInterval), params.primaryMinInterval);
+    putInterval(qFromLittleEndian(intervals.maxInterval), params.primaryMaxInterval);
+    params.primaryChannelMap = 0x7; // All channels.
+    params.ownAddrType = QLowEnergyController::PublicAddress; // TODO: Make configurable.
+    params.filterPolicy = advertisingFilterPolicy();
+    params.txPower = 0x7f; // No preference
+    params.primaryPhy = 0x1; // LE 1M
+    params.secondaryPhy = 0x1;
+    params.sid = m_advertisingHandle & 0xf;
+
+    const QByteArray paramsData = byteArrayFromStruct(params);
+    qCDebug(QT_BT_BLUEZ) << "extended advertising parameters:" << paramsData.toHex();
+    queueCommand(QBluezConst::OcfLeSetExtAdvParams, paramsData,
+                 HciCommandScheduler::SkipIfApplied);
+}
+
+bool QLeAdvertiserBluez::extendedDataApplicable(bool isScanResponseData) const
+{
+    const bool scannable = m_advertisingProperties & ExtAdvScannable;
+    if (isScanResponseData)
+        return scannable;
+    // scannable extended advertisements carry their payload in the scan response
+    return !scannable || (m_advertisingProperties & ExtAdvLegacyPdu);
+}
+
+void QLeAdvertiserBluez::buildExtendedData(bool isScanResponseData, AdvData &theData)
+{
+    if (m_advertisingProperties & ExtAdvLegacyPdu)
+        theData.capacity = legacyAdvDataLength;
+    else if (m_advertisingProperties & ExtAdvConnectable)
+        theData.capacity = qMin<int>(m_maxDataLength, maxConnectableExtAdvDataLength);
+    else
+        theData.capacity = m_maxDataLength;
+
+    if (!extendedDataApplicable(isScanResponseData)) {
+        const QLowEnergyAdvertisingData &sourceData = isScanResponseData
+                ? scanResponseData() : advertisingData();
+        if (sourceData != QLowEnergyAdvertisingData()) {
+            qCWarning(QT_BT_BLUEZ) << (isScanResponseData ? "scan response" : "advertising")
+                                   << "data is not supported by the extended advertising "
+                                      "mode and is dropped";
+        }
+        return;
+    }
+
+    buildData(isScanResponseData, theData);
+}
+
+void QLeAdvertiserBluez::setExtendedData(bool isScanResponseData, const AdvData &theData)
 {
-    if (m_pendingCommands.isEmpty())
+    // Spec v5.2, Vol 4, Part E, 7.8.54-55
+    if (!extendedDataApplicable(isScanResponseData))
         return;
-    const QBluezConst::OpCodeCommandField ocf = QBluezConst::OpCodeCommandField(ocfFromOpCode(opCode));
-    const Command currentCmd = m_pendingCommands.first();
-    if (currentCmd.ocf != ocf)
-        return; // Not one of our commands.
-    m_pendingCommands.takeFirst();
+
+    const QBluezConst::OpCodeCommandField ocf = isScanResponseData
+            ? QBluezConst::OcfLeSetExtScanResponseData : QBluezConst::OcfLeSetExtAdvData;
+    int offset = 0;
+    do {
+        const int fragmentLength = qMin(theData.length - offset, maxExtAdvDataFragmentLength);
+        const bool first = offset == 0;
+        const bool last = offset + fragmentLength == theData.length;
+        quint8 operation = ExtAdvDataIntermediateFragment;
+        if (first && last)
+            operation = ExtAdvDataComplete;
+        else if (first)
+            operation = ExtAdvDataFirstFragment;
+        else if (last)
+            operation = ExtAdvDataLastFragment;
+
+        QByteArray command(4 + fragmentLength, Qt::Uninitialized);
+        command[0] = char(m_advertisingHandle);
+        command[1] = char(operation);
+        command[2] = 0x1; // The controller should not fragment the data
+        command[3] = char(fragmentLength);
+        std::memcpy(command.data() + 4, theData.data + offset, fragmentLength);
+        qCDebug(QT_BT_BLUEZ) << (isScanResponseData ? "extended scan response data:"
+                                                    : "extended advertising data:")
+                             << command.toHex();
+        // only complete data can be compared, fragments invalidate the recorded state
+        queueCommand(ocf, command, operation == ExtAdvDataComplete
+                     ? HciCommandScheduler::SkipIfApplied : HciCommandScheduler::NoCommandFlags);
+        offset += fragmentLength;
+    } while (offset < theData.length);
+}
+
+void QLeAdvertiserBluez::queueExtendedDataCommands(bool advertisingEnabled)
+{
+    AdvData advData;
+    AdvData responseData;
+    buildExtendedData(false, advData);
+    buildExtendedData(true, responseData);
+
+    // The data of an enabled set can only be replaced by a single command,
+    // larger payloads require the set to be disabled briefly.
+    const bool fragmented = advData.length > maxExtAdvDataFragmentLength
+            || responseData.length > maxExtAdvDataFragmentLength;
+    const bool toggle = advertisingEnabled && fragmented;
+    if (toggle)
+        toggleExtendedAdvertising(false);
+    setExtendedData(false, advData);
+    setExtendedData(true, responseData);
+    if (toggle || !advertisingEnabled)
+        toggleExtendedAdvertising(true);
+}
+
+static bool isDisableCommand(QBluezConst::OpCodeCommandField ocf, const QByteArray &data)
+{
+    return (ocf == QBluezConst::OcfLeSetAdvEnable || ocf == QBluezConst::OcfLeSetExtAdvEnable)
+            && !data.isEmpty() && data.at(0) == '\0';
+}
+
+void QLeAdvertiserBluez::handleCommandCompleted(QBluezConst::OpCodeCommandField ocf,
+                                                quint8 status, const QByteArray &parameters,
+                                                const QByteArray &data)
+{
     if (status != 0) {
         qCDebug(QT_BT_BLUEZ) << "command" << ocf
                              << "failed with status" << (HciManager::HciError)status
                              << "status code" << status;
-        if (ocf == QBluezConst::OcfLeSetAdvEnable && status == 0xc && currentCmd.data == QByteArray(1, '\0')) {
+        // 0x42: Unknown Advertising Identifier, the set was never enabled
+        if (isDisableCommand(ocf, parameters) && (status == 0xc || status == 0x42)) {
             // we ignore OcfLeSetAdvEnable if it tries to disable an active advertisement
             // it seems the platform often automatically turns off advertisements
             // subsequently the explicit stopAdvertisement call fails when re-issued
             qCDebug(QT_BT_BLUEZ) << "Advertising disable failed, ignoring";
-            sendNextCommand();
-            return;
-        }
-        if (ocf == QBluezConst::OcfLeReadTxPowerLevel) {
+        } else if (ocf == QBluezConst::OcfLeReadTxPowerLevel) {
             qCDebug(QT_BT_BLUEZ) << "reading power level failed, leaving it out of the "
                                     "advertising data";
             m_sendPowerLevel = false;
+        } else if (ocf == QBluezConst::OcfLeReadLocalSupportedFeatures
+                   || ocf == QBluezConst::OcfLeReadMaxAdvDataLength) {
+            qCDebug(QT_BT_BLUEZ) << "reading controller capabilities failed";
         } else {
             handleError();
             return;
@@ -446,18 +755,53 @@ void QLeAdvertiserBluez::handleCommandCompleted(quint16 opCode, quint8 status,
             m_powerLevel = data.at(0);
             qCDebug(QT_BT_BLUEZ) << "TX power level is" << m_powerLevel;
         }
-        queueAdvertisingCommands();
+        if (m_started)
+            queueAdvertisingCommands();
+        break;
+    case QBluezConst::OcfLeReadLocalSupportedFeatures:
+        // Spec v5.2, Vol 6, Part B, 4.6: bit 12 is LE Extended Advertising
+        m_mode = (status == 0 && data.size() >= 2 && (data.at(1) & 0x10))
+                ? Mode::Extended : Mode::Legacy;
+        qCDebug(QT_BT_BLUEZ) << "controller supports extended advertising:"
+                             << (m_mode == Mode::Extended);
+        if (m_mode == Mode::Extended) {
+            // Spec v5.2, Vol 4, Part E, 7.8.57
+            queueCommand(QBluezConst::OcfLeReadMaxAdvDataLength, QByteArray());
+        } else if (m_started) {
+            queueStartCommands();
+        }
+        break;
+    case QBluezConst::OcfLeReadMaxAdvDataLength:
+        if (status == 0 && data.size() >= 2) {
+            m_maxDataLength = qMin<int>(qFromLittleEndian<quint16>(data.constData()),
+                                        maxExtAdvDataLength);
+        }
+        if (m_started)
+            queueStartCommands();
+        break;
+    case QBluezConst::OcfLeSetExtAdvParams:
+        if (m_sendPowerLevel && !data.isEmpty()) {
+            m_powerLevel = data.at(0);
+            qCDebug(QT_BT_BLUEZ) << "selected TX power level is" << m_powerLevel;
+        }
+        if (m_started)
+            queueExtendedDataCommands(false);
         break;
     default:
         break;
     }
 
-    sendNextCommand();
+    // the scheduler sends the queued commands once this returns
+    if (m_dataUpdatePending && m_commandScheduler->isIdle()) {
+        m_dataUpdatePending = false;
+        queueDataUpdateCommands();
+    }
 }
 
 void QLeAdvertiserBluez::handleError()
 {
-    m_pendingCommands.clear();
+    m_commandScheduler->reset();
+    m_dataUpdatePending = false;
     // TODO: Unmonitor event
     emit errorOccurred();
 }
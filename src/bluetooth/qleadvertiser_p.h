@@ -56,6 +56,7 @@
 
 #if QT_CONFIG(bluez)
 #include "bluez/bluez_data_p.h"
+#include "bluez/hcicommandscheduler_p.h"
 #endif
 
 #include <QtCore/qlist.h>
@@ -69,6 +70,13 @@ class QLeAdvertiser : public QObject
 public:
     void startAdvertising() { doStartAdvertising(); }
     void stopAdvertising() { doStopAdvertising(); }
+    void updateAdvertisingData(const QLowEnergyAdvertisingData &advertisingData,
+                               const QLowEnergyAdvertisingData &scanResponseData)
+    {
+        m_advData = advertisingData;
+        m_responseData = scanResponseData;
+        doUpdateAdvertisingData();
+    }
 
 signals:
     void errorOccurred();
@@ -88,10 +96,11 @@ protected:
 private:
     virtual void doStartAdvertising() = 0;
     virtual void doStopAdvertising() = 0;
+    virtual void doUpdateAdvertisingData() = 0;
 
     const QLowEnergyAdvertisingParameters m_params;
-    const QLowEnergyAdvertisingData m_advData;
-    const QLowEnergyAdvertisingData m_responseData;
+    QLowEnergyAdvertisingData m_advData;
+    QLowEnergyAdvertisingData m_responseData;
 };
 
 
@@ -100,7 +109,7 @@ struct AdvData;
 struct AdvParams;
 class HciManager;
 
-class QLeAdvertiserBluez : public QLeAdvertiser
+class Q_AUTOTEST_EXPORT QLeAdvertiserBluez : public QLeAdvertiser
 {
 public:
     QLeAdvertiserBluez(const QLowEnergyAdvertisingParameters &params,
@@ -109,9 +118,15 @@ public:
                        QObject *parent = nullptr);
     ~QLeAdvertiserBluez() override;
 
+    bool usesExtendedAdvertising() const { return m_mode == Mode::Extended; }
+    int advertisingHandle() const { return m_advertisingHandle; }
+
 private:
+    enum class Mode { Unknown, Legacy, Extended };
+
     void doStartAdvertising() override;
     void doStopAdvertising() override;
+    void doUpdateAdvertisingData() override;
 
     void setPowerLevel(AdvData &advData);
     void setFlags(AdvData &advData);
@@ -119,33 +134,47 @@ private:
     void setManufacturerData(const QLowEnergyAdvertisingData &src, AdvData &dest);
     void setLocalNameData(const QLowEnergyAdvertisingData &src, AdvData &dest);
 
-    void queueCommand(QBluezConst::OpCodeCommandField ocf, const QByteArray &advertisingData);
-    void sendNextCommand();
+    void queueCommand(QBluezConst::OpCodeCommandField ocf, const QByteArray &advertisingData,
+                      HciCommandScheduler::CommandFlags flags = HciCommandScheduler::NoCommandFlags);
+    void queueStartCommands();
+    void queueDataUpdateCommands();
     void queueAdvertisingCommands();
     void queueReadTxPowerLevelCommand();
     void toggleAdvertising(bool enable);
     void setAdvertisingParams();
     void setAdvertisingInterval(AdvParams &params);
+    quint8 advertisingFilterPolicy() const;
+    void buildData(bool isScanResponseData, AdvData &theData);
     void setData(bool isScanResponseData);
     void setAdvertisingData();
     void setScanResponseData();
     void setWhiteList();
 
-    void handleCommandCompleted(quint16 opCode, quint8 status, const QByteArray &advertisingData);
+    // LE Extended Advertising, Spec v5.2, Vol 4, Part E, 7.8.53-56
+    void queueExtendedAdvertisingCommands();
+    void queueExtendedDataCommands(bool advertisingEnabled);
+    void toggleExtendedAdvertising(bool enable);
+    void setExtendedAdvertisingParams();
+    bool extendedDataApplicable(bool isScanResponseData) const;
+    void buildExtendedData(bool isScanResponseData, AdvData &theData);
+    void setExtendedData(bool isScanResponseData, const AdvData &theData);
+    bool acquireAdvertisingHandle();
+
+    void handleCommandCompleted(QBluezConst::OpCodeCommandField ocf, quint8 status,
+                                const QByteArray &parameters, const QByteArray &returnParameters);
     void handleError();
 
     HciManager &m_hciManager;
-
-    struct Command {
-        Command() {}
-        Command(QBluezConst::OpCodeCommandField ocf, const QByteArray &data) : ocf(ocf), data(data) { }
-        QBluezConst::OpCodeCommandField ocf;
-        QByteArray data;
-    };
-    QList<Command> m_pendingCommands;
-
-    quint8 m_powerLevel;
-    bool m_sendPowerLevel;
+    HciCommandScheduler *m_commandScheduler = nullptr;
+
+    Mode m_mode = Mode::Unknown;
+    int m_advertisingHandle = -1;
+    quint16 m_maxDataLength = 31;
+    quint16 m_advertisingProperties = 0;
+    quint8 m_powerLevel = 0;
+    bool m_sendPowerLevel = false;
+    bool m_started = false;
+    bool m_dataUpdatePending = false;
 };
 #endif // QT_CONFIG(bluez)
 
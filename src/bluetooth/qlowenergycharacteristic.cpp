@@ -203,6 +203,13 @@ QLowEnergyCharacteristic::PropertyTypes QLowEnergyCharacteristic::properties() c
     the \l QLowEnergyService::characteristicChanged() or
     \l QLowEnergyService::characteristicWritten() may provice information about the
     value of this characteristic.
+
+    If the service details were discovered using
+    \l {QLowEnergyService::LazyValueDiscovery}{LazyValueDiscovery}, the first
+    call to this function schedules reading the value from the remote device.
+    In this case an empty value is returned and the
+    \l QLowEnergyService::characteristicRead() signal indicates when the cached
+    value becomes available.
 */
 QByteArray QLowEnergyCharacteristic::value() const
 {
@@ -210,7 +217,11 @@ QByteArray QLowEnergyCharacteristic::value() const
         || !d_ptr->characteristicList.contains(data->handle))
         return QByteArray();
 
-    return d_ptr->characteristicList[data->handle].value;
+    const QLowEnergyServicePrivate::CharData &charData = d_ptr->characteristicList[data->handle];
+    if (d_ptr->readsValueOnAccess(charData))
+        d_ptr->requestValueRead(data->handle);
+
+    return charData.value;
 }
 
 /*!
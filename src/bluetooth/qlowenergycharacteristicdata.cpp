@@ -67,6 +67,7 @@ struct QLowEnergyCharacteristicDataPrivate : public QSharedData
     QBluetooth::AttAccessConstraints writeConstraints;
     int minimumValueLength;
     int maximumValueLength;
+    bool updateCoalescing = false;
 };
 
 /*!
@@ -240,6 +241,39 @@ int QLowEnergyCharacteristicData::maximumValueLength() const
     return d->maximumValueLength;
 }
 
+/*!
+  Specifies whether updates of the characteristic's value are coalesced if \a enabled
+  is \c true.
+
+  A notification or indication which cannot be sent yet, because the link to the client
+  is busy, is queued. For a characteristic with coalescing enabled, at most one update
+  is queued: a new value replaces the value of the queued update, so the client receives
+  the latest value instead of every intermediate one. This is useful for values which
+  change faster than the link can transmit them, such as sensor readings.
+
+  By default, every update is sent. The number of coalesced updates is reported by
+  \l QLowEnergyService::coalescedUpdates(). Coalescing is only supported by the BlueZ
+  backend.
+
+  \sa isUpdateCoalescingEnabled()
+  \since 6.2
+ */
+void QLowEnergyCharacteristicData::setUpdateCoalescingEnabled(bool enabled)
+{
+    d->updateCoalescing = enabled;
+}
+
+/*!
+  Returns \c true if updates of the characteristic's value are coalesced.
+
+  \sa setUpdateCoalescingEnabled()
+  \since 6.2
+ */
+bool QLowEnergyCharacteristicData::isUpdateCoalescingEnabled() const
+{
+    return d->updateCoalescing;
+}
+
 /*!
   Returns true if and only if this characteristic is valid, that is, it has a non-null UUID.
  */
@@ -267,7 +301,8 @@ bool QLowEnergyCharacteristicData::equals(const QLowEnergyCharacteristicData &a,
                 && a.readConstraints() == b.readConstraints()
                 && a.writeConstraints() == b.writeConstraints()
                 && a.minimumValueLength() == b.maximumValueLength()
-                && a.maximumValueLength() == b.maximumValueLength());
+                && a.maximumValueLength() == b.maximumValueLength()
+                && a.isUpdateCoalescingEnabled() == b.isUpdateCoalescingEnabled());
 }
 
 /*!
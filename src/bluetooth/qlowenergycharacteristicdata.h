@@ -88,6 +88,9 @@ public:
     int minimumValueLength() const;
     int maximumValueLength() const;
 
+    void setUpdateCoalescingEnabled(bool enabled);
+    bool isUpdateCoalescingEnabled() const;
+
     bool isValid() const;
 
     void swap(QLowEnergyCharacteristicData &other) Q_DECL_NOTHROW { qSwap(d, other.d); }
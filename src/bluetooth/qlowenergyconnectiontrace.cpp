@@ -0,0 +1,307 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qlowenergyconnectiontrace.h"
+#include "qlowenergyconnectiontrace_p.h"
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \since 6.2
+    \class QLowEnergyConnectionTrace
+    \brief The QLowEnergyConnectionTrace class records where the time goes while
+           a Bluetooth Low Energy connection is established and its services are
+           discovered.
+
+    \inmodule QtBluetooth
+    \ingroup shared
+
+    A connection attempt of QLowEnergyController passes through several
+    \l {Phase}{phases}, some of which depend on the platform and on the remote
+    device. The trace holds, per phase, when it started relative to
+    QLowEnergyController::connectToDevice(), how long it took, how often
+    requests were repeated, and the ATT round trips and bytes exchanged while
+    the phase was the most recent one in progress.
+
+    Phases may overlap. For example, the MTU exchange continues after the
+    \l ConnectPhase ended, and the detail discovery of a service may start
+    while others are still being discovered. The \l ServiceDetailsDiscoveryPhase
+    lasts from the start of the first detail discovery until no service is being
+    discovered anymore. ATT traffic is only attributed to the phase which
+    started last of those in progress, so it is not counted twice.
+
+    The controller starts a new trace with each connection attempt and keeps
+    it after the connection has been closed. The trace returned by
+    QLowEnergyController::connectionTrace() is a snapshot; later phases are not
+    added to it. The same information is logged to the
+    \c qt.bluetooth.le.trace logging category at the end of each phase.
+
+    \note Currently, the phases specific to a platform and the ATT traffic are
+    only recorded on Linux if the controller does not use the BlueZ DBus
+    backend.
+
+    \sa QLowEnergyController::connectionTrace()
+*/
+
+/*!
+    \enum QLowEnergyConnectionTrace::Phase
+
+    This enum describes the phases of a connection attempt and of the service
+    discovery.
+
+    \value ConnectPhase     From QLowEnergyController::connectToDevice() until the
+                            controller is in the \l {QLowEnergyController::}{ConnectedState}.
+    \value ConnectionQueuePhase
+                            Waiting for connection attempts of other controllers on
+                            the same adapter to finish. Bluetooth controllers create one
+                            LE connection at a time.
+    \value ExternalConnectionsPhase
+                            Closing LE connections of the adapter which prevent the
+                            connection attempt.
+    \value AddressLookupPhase
+                            Determining whether the remote device uses a random address.
+    \value L2capConnectPhase
+                            Establishing the LE link and the L2CAP channel of the
+                            ATT protocol.
+    \value SecurityPhase    Raising the security level of the link after the remote
+                            device refused a request due to insufficient security.
+                            Each such request is counted as a retry of the phase which
+                            sent it.
+    \value MtuExchangePhase Negotiating the ATT MTU.
+    \value ServiceDiscoveryPhase
+                            From QLowEnergyController::discoverServices() until
+                            \l {QLowEnergyController::}{discoveryFinished()}.
+    \value ServiceDetailsDiscoveryPhase
+                            Discovering the details of services.
+*/
+
+const char *QLowEnergyConnectionTracePrivate::phaseName(Phase phase)
+{
+    switch (phase) {
+    case QLowEnergyConnectionTrace::ConnectPhase:
+        return "connect";
+    case QLowEnergyConnectionTrace::ConnectionQueuePhase:
+        return "connection queue";
+    case QLowEnergyConnectionTrace::ExternalConnectionsPhase:
+        return "external connections";
+    case QLowEnergyConnectionTrace::AddressLookupPhase:
+        return "address lookup";
+    case QLowEnergyConnectionTrace::L2capConnectPhase:
+        return "L2CAP connect";
+    case QLowEnergyConnectionTrace::SecurityPhase:
+        return "security";
+    case QLowEnergyConnectionTrace::MtuExchangePhase:
+        return "MTU exchange";
+    case QLowEnergyConnectionTrace::ServiceDiscoveryPhase:
+        return "service discovery";
+    case QLowEnergyConnectionTrace::ServiceDetailsDiscoveryPhase:
+        return "service details discovery";
+    }
+    return "unknown";
+}
+
+const QLowEnergyConnectionTracePrivate::PhaseRecord *
+QLowEnergyConnectionTracePrivate::record(Phase phase) const
+{
+    for (const PhaseRecord &record : records) {
+        if (record.phase == phase)
+            return &record;
+    }
+    return nullptr;
+}
+
+QLowEnergyConnectionTracePrivate::PhaseRecord *
+QLowEnergyConnectionTracePrivate::recordFor(Phase phase)
+{
+    for (PhaseRecord &record : records) {
+        if (record.phase == phase)
+            return &record;
+    }
+    PhaseRecord record;
+    record.phase = phase;
+    records.append(record);
+    return &records.last();
+}
+
+void QLowEnergyConnectionTracePrivate::begin(Phase phase, qint64 now)
+{
+    PhaseRecord *record = recordFor(phase);
+    if (record->openCount++ > 0)
+        return;
+
+    if (record->start < 0)
+        record->start = now;
+    record->end = -1;
+    openPhases.removeOne(phase);
+    openPhases.append(phase);
+}
+
+const QLowEnergyConnectionTracePrivate::PhaseRecord *
+QLowEnergyConnectionTracePrivate::end(Phase phase, qint64 now)
+{
+    // does not create a record for a phase which never began
+    if (!openPhases.contains(phase))
+        return nullptr;
+
+    PhaseRecord *record = recordFor(phase);
+    if (--record->openCount > 0)
+        return nullptr;
+
+    record->end = now;
+    openPhases.removeOne(phase);
+    return record;
+}
+
+void QLowEnergyConnectionTracePrivate::abort()
+{
+    for (PhaseRecord &record : records)
+        record.openCount = 0;
+    openPhases.clear();
+}
+
+/*!
+    Constructs an empty trace.
+ */
+QLowEnergyConnectionTrace::QLowEnergyConnectionTrace()
+    : d(new QLowEnergyConnectionTracePrivate)
+{
+}
+
+/*! Constructs a new object of this class that is a copy of \a other. */
+QLowEnergyConnectionTrace::QLowEnergyConnectionTrace(const QLowEnergyConnectionTrace &other)
+    : d(other.d)
+{
+}
+
+/*! Destroys this object. */
+QLowEnergyConnectionTrace::~QLowEnergyConnectionTrace()
+{
+}
+
+/*! Makes this object a copy of \a other and returns the new value of this object. */
+QLowEnergyConnectionTrace &QLowEnergyConnectionTrace::operator=(const QLowEnergyConnectionTrace &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Returns \c true if no phase was recorded.
+ */
+bool QLowEnergyConnectionTrace::isEmpty() const
+{
+    return d->records.isEmpty();
+}
+
+/*!
+    Returns the recorded phases in the order in which they started.
+ */
+QList<QLowEnergyConnectionTrace::Phase> QLowEnergyConnectionTrace::phases() const
+{
+    QList<Phase> result;
+    result.reserve(d->records.size());
+    for (const auto &record : qAsConst(d->records))
+        result.append(record.phase);
+    return result;
+}
+
+/*!
+    Returns the time in nanoseconds from the start of the connection attempt to
+    the start of \a phase, or \c -1 if the phase was not recorded.
+ */
+qint64 QLowEnergyConnectionTrace::startTime(Phase phase) const
+{
+    const auto record = d->record(phase);
+    return record ? record->start : -1;
+}
+
+/*!
+    Returns the duration of \a phase in nanoseconds, or \c -1 if the phase was
+    not recorded or has not finished. A phase does not finish if the
+    connection attempt failed or the connection was closed while the phase was
+    in progress.
+ */
+qint64 QLowEnergyConnectionTrace::duration(Phase phase) const
+{
+    const auto record = d->record(phase);
+    return record && record->end >= 0 ? record->end - record->start : -1;
+}
+
+/*!
+    Returns how often a request was repeated during \a phase.
+ */
+int QLowEnergyConnectionTrace::retryCount(Phase phase) const
+{
+    const auto record = d->record(phase);
+    return record ? record->retries : 0;
+}
+
+/*!
+    Returns the number of ATT requests which were answered during \a phase.
+ */
+int QLowEnergyConnectionTrace::roundTrips(Phase phase) const
+{
+    const auto record = d->record(phase);
+    return record ? record->roundTrips : 0;
+}
+
+/*!
+    Returns the number of ATT bytes sent during \a phase.
+ */
+qint64 QLowEnergyConnectionTrace::bytesSent(Phase phase) const
+{
+    const auto record = d->record(phase);
+    return record ? record->bytesSent : 0;
+}
+
+/*!
+    Returns the number of ATT bytes received during \a phase.
+ */
+qint64 QLowEnergyConnectionTrace::bytesReceived(Phase phase) const
+{
+    const auto record = d->record(phase);
+    return record ? record->bytesReceived : 0;
+}
+
+/*!
+    \fn void QLowEnergyConnectionTrace::swap(QLowEnergyConnectionTrace &other)
+    Swaps this object with \a other.
+ */
+
+QT_END_NAMESPACE
@@ -0,0 +1,96 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QLOWENERGYCONNECTIONTRACE_H
+#define QLOWENERGYCONNECTIONTRACE_H
+
+#include <QtBluetooth/qtbluetoothglobal.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmetatype.h>
+#include <QtCore/qshareddata.h>
+
+QT_BEGIN_NAMESPACE
+
+class QLowEnergyConnectionTracePrivate;
+
+class Q_BLUETOOTH_EXPORT QLowEnergyConnectionTrace
+{
+public:
+    enum Phase {
+        ConnectPhase,
+        ConnectionQueuePhase,
+        ExternalConnectionsPhase,
+        AddressLookupPhase,
+        L2capConnectPhase,
+        SecurityPhase,
+        MtuExchangePhase,
+        ServiceDiscoveryPhase,
+        ServiceDetailsDiscoveryPhase
+    };
+
+    QLowEnergyConnectionTrace();
+    QLowEnergyConnectionTrace(const QLowEnergyConnectionTrace &other);
+    ~QLowEnergyConnectionTrace();
+
+    QLowEnergyConnectionTrace &operator=(const QLowEnergyConnectionTrace &other);
+
+    bool isEmpty() const;
+    QList<Phase> phases() const;
+
+    qint64 startTime(Phase phase) const;
+    qint64 duration(Phase phase) const;
+    int retryCount(Phase phase) const;
+    int roundTrips(Phase phase) const;
+    qint64 bytesSent(Phase phase) const;
+    qint64 bytesReceived(Phase phase) const;
+
+    void swap(QLowEnergyConnectionTrace &other) Q_DECL_NOTHROW { qSwap(d, other.d); }
+
+private:
+    friend class QLowEnergyConnectionTracePrivate;
+    QSharedDataPointer<QLowEnergyConnectionTracePrivate> d;
+};
+
+Q_DECLARE_SHARED(QLowEnergyConnectionTrace)
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QLowEnergyConnectionTrace)
+
+#endif // QLOWENERGYCONNECTIONTRACE_H
@@ -0,0 +1,110 @@
+/***************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QLOWENERGYCONNECTIONTRACE_P_H
+#define QLOWENERGYCONNECTIONTRACE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtBluetooth/qlowenergyconnectiontrace.h>
+
+QT_BEGIN_NAMESPACE
+
+class QLowEnergyConnectionTracePrivate : public QSharedData
+{
+public:
+    using Phase = QLowEnergyConnectionTrace::Phase;
+
+    struct PhaseRecord {
+        Phase phase;
+        // nanoseconds since the connection attempt started
+        qint64 start = -1;
+        qint64 end = -1;
+        int retries = 0;
+        int roundTrips = 0;
+        qint64 bytesSent = 0;
+        qint64 bytesReceived = 0;
+        // phases like the detail discovery of several services may overlap themselves
+        int openCount = 0;
+    };
+
+    static QLowEnergyConnectionTracePrivate *get(QLowEnergyConnectionTrace &trace)
+    {
+        return trace.d.data();
+    }
+    static const QLowEnergyConnectionTracePrivate *get(const QLowEnergyConnectionTrace &trace)
+    {
+        return trace.d.constData();
+    }
+
+    static const char *phaseName(Phase phase);
+
+    const PhaseRecord *record(Phase phase) const;
+    // ATT traffic counts for the phase which began last of those in progress
+    PhaseRecord *activeRecord()
+    {
+        return openPhases.isEmpty() ? nullptr : recordFor(openPhases.constLast());
+    }
+
+    void begin(Phase phase, qint64 now);
+    // returns the record if this ended the phase
+    const PhaseRecord *end(Phase phase, qint64 now);
+    // phases in progress remain unfinished
+    void abort();
+
+    // in the order in which the phases began
+    QList<PhaseRecord> records;
+    QList<Phase> openPhases;
+
+private:
+    PhaseRecord *recordFor(Phase phase);
+};
+
+QT_END_NAMESPACE
+
+#endif // QLOWENERGYCONNECTIONTRACE_P_H
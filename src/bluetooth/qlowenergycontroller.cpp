@@ -190,6 +190,20 @@ Q_DECLARE_LOGGING_CATEGORY(QT_BT_WINDOWS)
                          connect to a peripheral.
  */
 
+/*!
+    \enum QLowEnergyController::Phy
+
+    Indicates a physical layer (PHY) of a Bluetooth Low Energy connection.
+
+    \value Phy1M    The LE 1M PHY with a symbol rate of 1 Msym/s, which every device supports.
+    \value Phy2M    The LE 2M PHY with a symbol rate of 2 Msym/s. It roughly doubles the
+                    throughput at a slightly reduced range.
+    \value PhyCoded The LE Coded PHY, which trades throughput for range.
+
+    \since 6.2
+    \sa requestPhy(), phyChanged()
+ */
+
 /*!
     \enum QLowEnergyController::Role
 
@@ -286,6 +300,29 @@ Q_DECLARE_LOGGING_CATEGORY(QT_BT_WINDOWS)
     \sa requestConnectionUpdate()
 */
 
+/*!
+    \fn void QLowEnergyController::phyChanged(QLowEnergyController::Phy txPhy, QLowEnergyController::Phy rxPhy)
+
+    This signal is emitted when the physical layer of the connection changes, either as a
+    result of calling \l requestPhy() or because the remote device requested it. \a txPhy
+    is used for sending and \a rxPhy for receiving data.
+
+    \since 6.2
+    \sa requestPhy()
+*/
+
+/*!
+    \fn void QLowEnergyController::dataLengthChanged(int maxTxOctets, int maxRxOctets)
+
+    This signal is emitted when the maximum payload of the link layer packets of the
+    connection changes. \a maxTxOctets is the number of bytes a sent packet may carry,
+    \a maxRxOctets the number of bytes a received packet may carry. The change may be
+    a result of calling \l requestDataLength() or of a request from the remote device.
+
+    \since 6.2
+    \sa requestDataLength()
+*/
+
 
 void registerQLowEnergyControllerMetaType()
 {
@@ -665,6 +702,39 @@ void QLowEnergyController::discoverServices()
     d->discoverServices();
 }
 
+/*!
+    Discovers the details of all services found by \l discoverServices() which
+    have not been discovered yet. The \a mode determines whether the values of
+    characteristics and descriptors are read too.
+
+    This is the equivalent of calling \l QLowEnergyService::discoverDetails() on
+    every service. Each service advertises the progress via its
+    \l QLowEnergyService::stateChanged() signal; the details are also visible to
+    service objects created by \l createServiceObject() afterwards. On Linux
+    with the BlueZ ATT backend the whole attribute database is walked in a
+    single pass, which requires far fewer round trips than discovering the
+    services one after the other.
+
+    The function does nothing if the controller is not in the
+    \l DiscoveredState.
+
+    \sa discoverServices(), QLowEnergyService::discoverDetails()
+    \since 6.2
+ */
+void QLowEnergyController::discoverAllServiceDetails(QLowEnergyService::DiscoveryMode mode)
+{
+    Q_D(QLowEnergyController);
+
+    if (d->role != CentralRole) {
+        qCWarning(QT_BT) << "Cannot discover service details in peripheral role";
+        return;
+    }
+    if (d->state != QLowEnergyController::DiscoveredState)
+        return;
+
+    d->discoverAllServiceDetails(mode);
+}
+
 /*!
     Returns the list of services offered by the remote device, if the controller is in
     the \l CentralRole. Otherwise, the result is unspecified.
@@ -726,11 +796,20 @@ QLowEnergyService *QLowEnergyController::createServiceObject(
    also starts listening for incoming client connections.
 
    Providing \a scanResponseData is not required, as it is not applicable for certain
-   configurations of \c parameters. \a advertisingData and \a scanResponseData are limited
-   to 31 byte user data. If, for example, several 128bit uuids are added to \a advertisingData,
-   the advertised packets may not contain all uuids. The existing limit may have caused the truncation
+   configurations of \c parameters. Unless extended advertising is used, as described
+   below, \a advertisingData and \a scanResponseData are limited to 31 byte user data.
+   If, for example, several 128bit uuids are added to \a advertisingData, the advertised
+   packets may not contain all uuids. The existing limit may have caused the truncation
    of uuids. In such cases \a scanResponseData may be used for additional information.
 
+   On Linux, if the local Bluetooth controller supports LE Extended Advertising, every
+   controller advertises in its own advertising set and larger payloads are possible.
+   Payloads exceeding 31 bytes are only visible to scanners supporting extended
+   advertising. Connectable extended advertisements carry up to 191 bytes and have no
+   scan response; scannable extended advertisements carry their payload in
+   \a scanResponseData. Non-connectable advertisements may carry up to 1650 bytes,
+   subject to the limit of the controller.
+
    If this object is currently not in the \l UnconnectedState, nothing happens.
    \note Advertising will stop automatically once a client connects to the local device.
 
@@ -750,6 +829,7 @@ void QLowEnergyController::startAdvertising(const QLowEnergyAdvertisingParameter
         qCWarning(QT_BT) << "Cannot start advertising in state" << state();
         return;
     }
+    d->advertisingParameters = parameters;
     d->startAdvertising(parameters, advertisingData, scanResponseData);
 }
 
@@ -772,6 +852,33 @@ void QLowEnergyController::stopAdvertising()
     d->stopAdvertising();
 }
 
+/*!
+   Replaces the data which is advertised by this object with \a advertisingData
+   and \a scanResponseData. The parameters passed to \l startAdvertising()
+   remain unchanged.
+
+   This is considerably cheaper than stopping and restarting the advertisement, which
+   makes it suitable for payloads that change frequently. On Linux, the advertisement
+   continues while the data is replaced. Other platforms may restart the advertisement.
+   If the function is called again before an earlier update has been applied, only the
+   latest data is sent.
+
+   The controller has to be in the \l AdvertisingState.
+
+   \since 6.2
+   \sa startAdvertising()
+ */
+void QLowEnergyController::updateAdvertisingData(const QLowEnergyAdvertisingData &advertisingData,
+                                                 const QLowEnergyAdvertisingData &scanResponseData)
+{
+    Q_D(QLowEnergyController);
+    if (state() != AdvertisingState) {
+        qCWarning(QT_BT) << "Cannot update advertising data in state" << state();
+        return;
+    }
+    d->updateAdvertisingData(advertisingData, scanResponseData);
+}
+
 /*!
   Constructs and returns a \l QLowEnergyService object with \a parent from \a service.
   The controller must be in the \l PeripheralRole and in the \l UnconnectedState. The \a service
@@ -846,6 +953,63 @@ void QLowEnergyController::requestConnectionUpdate(const QLowEnergyConnectionPar
     }
 }
 
+/*!
+  Requests the physical layers to be used by the connection. \a txPhys are the layers
+  preferred for sending, \a rxPhys the layers preferred for receiving data. An empty set
+  expresses no preference for that direction. The remote device and the local Bluetooth
+  controller may choose a different layer, for instance if one of them does not support
+  LE 2M. If the layer in use changes, the \l phyChanged() signal is emitted.
+
+  \note Currently, this functionality is only implemented on Linux if the controller does
+  not use the BlueZ DBus backend, which is the case for the \l PeripheralRole. It requires
+  a Bluetooth 5 controller.
+
+  \sa phyChanged()
+  \since 6.2
+ */
+void QLowEnergyController::requestPhy(QLowEnergyController::Phys txPhys,
+                                      QLowEnergyController::Phys rxPhys)
+{
+    switch (state()) {
+    case ConnectedState:
+    case DiscoveredState:
+    case DiscoveringState:
+        d_ptr->requestPhy(txPhys, rxPhys);
+        break;
+    default:
+        qCWarning(QT_BT) << "PHY update request only possible in connected state";
+    }
+}
+
+/*!
+  Requests link layer packets which carry up to \a maxTxOctets bytes of payload, which is
+  also known as LE Data Length Extension. The value is limited to the range from 27, the
+  payload every device supports, to 251 bytes. Larger packets considerably increase the
+  throughput. For instance, with an ATT MTU of 517 a notification of 512 bytes is sent
+  in three link layer packets rather than twenty. The remote device and the local
+  Bluetooth controller may choose a smaller value. If the lengths in use change, the
+  \l dataLengthChanged() signal is emitted.
+
+  \note Currently, this functionality is only implemented on Linux if the controller does
+  not use the BlueZ DBus backend, which is the case for the \l PeripheralRole. It requires
+  a Bluetooth 4.2 controller.
+
+  \sa dataLengthChanged()
+  \since 6.2
+ */
+void QLowEnergyController::requestDataLength(int maxTxOctets)
+{
+    switch (state()) {
+    case ConnectedState:
+    case DiscoveredState:
+    case DiscoveringState:
+        d_ptr->requestDataLength(maxTxOctets);
+        break;
+    default:
+        qCWarning(QT_BT) << "Data length request only possible in connected state";
+    }
+}
+
 /*!
     Returns the last occurred error or \l NoError.
 */
@@ -899,4 +1063,71 @@ int QLowEnergyController::mtu() const
     return d_ptr->mtu();
 }
 
+/*!
+   Sets the ATT MTU which the controller asks for to \a mtu. In the \l CentralRole,
+   it is requested from the remote device right after connecting and before any
+   other request. In the \l PeripheralRole, it is offered to a central which
+   requests an MTU exchange. The negotiated MTU is the smaller of the values of both
+   devices and reported by \l mtu() and \l mtuChanged().
+
+   A large MTU lets long characteristic values be read, written and notified in a
+   single packet, rather than in a chain of requests carrying \b {mtu-3} bytes each.
+   The value is limited to the range from \c 23, the default MTU of every connection,
+   to \c 517. The value \c 23 disables the MTU exchange. The default is \c 512.
+
+   The value applies to connections established after this call.
+
+   \note Currently, this functionality is only implemented on Linux if the controller
+   does not use the BlueZ DBus backend, which is the case for the \l PeripheralRole.
+   Other platforms negotiate the MTU on their own.
+
+   \since 6.2
+   \sa preferredMtu(), mtu()
+ */
+void QLowEnergyController::setPreferredMtu(int mtu)
+{
+    // Spec v5.2, Vol 3, Part F, 3.2.8-9: attributes have at most 512 bytes,
+    // plus the five byte header of a Prepare Write Request
+    const int boundedMtu = qBound(23, mtu, 517);
+    if (boundedMtu != mtu)
+        qCWarning(QT_BT) << "MTU" << mtu << "is out of range, using" << boundedMtu;
+    d_ptr->preferredMtu = boundedMtu;
+}
+
+/*!
+   Returns the ATT MTU which the controller asks for.
+
+   \since 6.2
+   \sa setPreferredMtu()
+ */
+int QLowEnergyController::preferredMtu() const
+{
+    return d_ptr->preferredMtu;
+}
+
+/*!
+   Returns the trace of the most recent connection attempt of this controller.
+
+   The trace tells how long the phases of establishing the connection and of
+   the service discovery took, how often requests were repeated, and how many
+   ATT round trips and bytes each phase needed. Each call to
+   \l connectToDevice() starts a new trace. The returned object is a snapshot
+   of the trace at the time of the call.
+
+   Each phase is also logged to the \c qt.bluetooth.le.trace logging category
+   when it ends.
+
+   \note Currently, apart from the \l {QLowEnergyConnectionTrace::}{ConnectPhase},
+   \l {QLowEnergyConnectionTrace::}{ServiceDiscoveryPhase} and
+   \l {QLowEnergyConnectionTrace::}{ServiceDetailsDiscoveryPhase}, the trace is only
+   recorded on Linux if the controller does not use the BlueZ DBus backend.
+
+   \since 6.2
+   \sa QLowEnergyConnectionTrace
+ */
+QLowEnergyConnectionTrace QLowEnergyController::connectionTrace() const
+{
+    return d_ptr->connectionTrace;
+}
+
 QT_END_NAMESPACE
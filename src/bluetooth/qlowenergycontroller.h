@@ -46,6 +46,7 @@
 #include <QtBluetooth/QBluetoothUuid>
 #include <QtBluetooth/QLowEnergyAdvertisingData>
 #include <QtBluetooth/QLowEnergyConnectionParameters>
+#include <QtBluetooth/QLowEnergyConnectionTrace>
 #include <QtBluetooth/QLowEnergyService>
 
 QT_BEGIN_NAMESPACE
@@ -88,6 +89,15 @@ public:
     };
     Q_ENUM(RemoteAddressType)
 
+    enum Phy {
+        Phy1M = 0x1,
+        Phy2M = 0x2,
+        PhyCoded = 0x4
+    };
+    Q_ENUM(Phy)
+    Q_DECLARE_FLAGS(Phys, Phy)
+    Q_FLAG(Phys)
+
     enum Role { CentralRole, PeripheralRole };
     Q_ENUM(Role)
 
@@ -120,6 +130,8 @@ public:
     void disconnectFromDevice();
 
     void discoverServices();
+    void discoverAllServiceDetails(
+            QLowEnergyService::DiscoveryMode mode = QLowEnergyService::FullDiscovery);
     QList<QBluetoothUuid> services() const;
     QLowEnergyService *createServiceObject(const QBluetoothUuid &service, QObject *parent = nullptr);
 
@@ -127,10 +139,14 @@ public:
                           const QLowEnergyAdvertisingData &advertisingData,
                           const QLowEnergyAdvertisingData &scanResponseData = QLowEnergyAdvertisingData());
     void stopAdvertising();
+    void updateAdvertisingData(const QLowEnergyAdvertisingData &advertisingData,
+                               const QLowEnergyAdvertisingData &scanResponseData = QLowEnergyAdvertisingData());
 
     QLowEnergyService *addService(const QLowEnergyServiceData &service, QObject *parent = nullptr);
 
     void requestConnectionUpdate(const QLowEnergyConnectionParameters &parameters);
+    void requestPhy(QLowEnergyController::Phys txPhys, QLowEnergyController::Phys rxPhys);
+    void requestDataLength(int maxTxOctets);
 
     Error error() const;
     QString errorString() const;
@@ -138,6 +154,10 @@ public:
     Role role() const;
 
     int mtu() const;
+    void setPreferredMtu(int mtu);
+    int preferredMtu() const;
+
+    QLowEnergyConnectionTrace connectionTrace() const;
 
 Q_SIGNALS:
     void connected();
@@ -149,6 +169,8 @@ Q_SIGNALS:
     void serviceDiscovered(const QBluetoothUuid &newService);
     void discoveryFinished();
     void connectionUpdated(const QLowEnergyConnectionParameters &parameters);
+    void phyChanged(QLowEnergyController::Phy txPhy, QLowEnergyController::Phy rxPhy);
+    void dataLengthChanged(int maxTxOctets, int maxRxOctets);
 
 private:
     // peripheral role ctor
@@ -164,6 +186,8 @@ private:
     QLowEnergyControllerPrivate *d_ptr;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(QLowEnergyController::Phys)
+
 QT_END_NAMESPACE
 
 Q_DECLARE_METATYPE(QLowEnergyController::Error)
@@ -38,7 +38,12 @@
 **
 ****************************************************************************/
 
+#include "leatttransmitqueue_p.h"
 #include "lecmaccalculator_p.h"
+#include "leconnectionhub_p.h"
+#include "legattdatabasewalker_p.h"
+#include "lepeerdatastore_p.h"
+#include "lepreparedwrite_p.h"
 #include "qlowenergycontroller_bluez_p.h"
 #include "qbluetoothsocketbase_p.h"
 #include "qbluetoothsocket_bluez_p.h"
@@ -55,9 +60,8 @@
 #include "bluez/device_p.h"
 #include "bluez/manager_p.h"
 
-#include <QtCore/QFileInfo>
 #include <QtCore/QLoggingCategory>
-#include <QtCore/QSettings>
+#include <QtCore/QSet>
 #include <QtCore/QTimer>
 #include <QtBluetooth/QBluetoothLocalDevice>
 #include <QtBluetooth/QBluetoothSocket>
@@ -75,7 +79,6 @@
 #include <unistd.h>
 
 #define ATT_DEFAULT_LE_MTU 23
-#define ATT_MAX_LE_MTU 0x200
 
 #define GATT_PRIMARY_SERVICE    quint16(0x2800)
 #define GATT_SECONDARY_SERVICE  quint16(0x2801)
@@ -90,8 +93,6 @@
 #define READ_REQUEST_HEADER_SIZE 3
 #define READ_BLOB_REQUEST_HEADER_SIZE 5
 #define WRITE_REQUEST_HEADER_SIZE 3    // same size for WRITE_COMMAND header
-#define PREPARE_WRITE_HEADER_SIZE 5
-#define EXECUTE_WRITE_HEADER_SIZE 2
 #define MTU_EXCHANGE_HEADER_SIZE 3
 
 #define APPEND_VALUE true
@@ -228,32 +229,57 @@ QLowEnergyControllerPrivateBluez::QLowEnergyControllerPrivateBluez()
 
 void QLowEnergyControllerPrivateBluez::init()
 {
-    hciManager = new HciManager(localAdapter, this);
-    if (!hciManager->isValid()){
+    transmitQueue = new LeAttTransmitQueue(this);
+    connect(transmitQueue, &LeAttTransmitQueue::errorOccurred, this, [this](int errorCode) {
+        qCDebug(QT_BT_BLUEZ) << "Cannot write L2CP packet:" << qt_error_string(errorCode);
+        setError(QLowEnergyController::NetworkError);
+    });
+    connect(transmitQueue, &LeAttTransmitQueue::writeCommandsDrained, this, [](QObject *owner) {
+        if (auto service = qobject_cast<QLowEnergyServicePrivate *>(owner))
+            emit service->writeQueueDrained();
+    });
+
+    peerDataStore = new LePeerDataStore(localAdapter, this);
+
+    hciLink = new LeHciLink(LeConnectionHub::forAdapter(localAdapter), this);
+    if (!hciLink->hciManager()->isValid()){
         setError(QLowEnergyController::InvalidBluetoothAdapterError);
         return;
     }
-        return;
 
-    hciManager->monitorEvent(HciManager::HciEvent::EVT_ENCRYPT_CHANGE);
-    connect(hciManager, SIGNAL(encryptionChangedEvent(QBluetoothAddress,bool)),
-            this, SLOT(encryptionChangedEvent(QBluetoothAddress,bool)));
-    hciManager->monitorEvent(HciManager::HciEvent::EVT_LE_META_EVENT);
-    hciManager->monitorAclPackets();
-    connect(hciManager, &HciManager::connectionComplete, [this](quint16 handle) {
+    // the hub already filters the events by connection handle and peer address
+    if (role == QLowEnergyController::CentralRole)
+        hciLink->setRemoteDevice(remoteDevice);
+    connect(hciLink, &LeHciLink::encryptionChanged, this, [this](bool wasSuccess) {
+        encryptionChangedEvent(remoteDevice, wasSuccess);
+    });
+    connect(hciLink, &LeHciLink::connectionComplete, this, [this](quint16 handle) {
         connectionHandle = handle;
-        qCDebug(QT_BT_BLUEZ) << "received connection complete event, handle:" << handle;
     });
-    connect(hciManager, &HciManager::connectionUpdate,
-            [this](quint16 handle, const QLowEnergyConnectionParameters &params) {
-                if (handle == connectionHandle)
-                    emit q_ptr->connectionUpdated(params);
+    connect(hciLink, &LeHciLink::connectionSlotGranted,
+            this, &QLowEnergyControllerPrivateBluez::startConnectionAttempt,
+            Qt::QueuedConnection);
+    connect(hciLink, &LeHciLink::connectionUpdate,
+            this, [this](const QLowEnergyConnectionParameters &params) {
+                emit q_ptr->connectionUpdated(params);
             }
     );
-    connect(hciManager, &HciManager::signatureResolvingKeyReceived,
-            [this](quint16 handle, bool remoteKey, const quint128 &csrk) {
-                if (handle != connectionHandle)
-                    return;
+    connect(hciLink, &LeHciLink::phyUpdate, this, [this](quint8 txPhy, quint8 rxPhy) {
+                // Spec v5.2, Vol 4, Part E, 7.7.65.12: 1 is LE 1M, 2 is LE 2M, 3 is LE Coded
+                const auto toPhy = [](quint8 phy) {
+                    return phy == 3 ? QLowEnergyController::PhyCoded
+                                    : QLowEnergyController::Phy(phy);
+                };
+                emit q_ptr->phyChanged(toPhy(txPhy), toPhy(rxPhy));
+            }
+    );
+    connect(hciLink, &LeHciLink::dataLengthChange,
+            this, [this](quint16 maxTxOctets, quint16 maxRxOctets) {
+                emit q_ptr->dataLengthChanged(maxTxOctets, maxRxOctets);
+            }
+    );
+    connect(hciLink, &LeHciLink::signatureResolvingKeyReceived,
+            this, [this](bool remoteKey, const quint128 &csrk) {
                 if ((remoteKey && role == QLowEnergyController::CentralRole)
                         || (!remoteKey && role == QLowEnergyController::PeripheralRole)) {
                     return;
@@ -261,7 +287,10 @@ void QLowEnergyControllerPrivateBluez::init()
                 qCDebug(QT_BT_BLUEZ) << "received new signature resolving key"
                                      << QByteArray(reinterpret_cast<const char *>(csrk.data),
                                                    sizeof csrk).toHex();
-                signingData.insert(remoteDevice.toUInt64(), SigningData(csrk));
+                peerDataStore->setSigningKey(remoteDevice,
+                                             remoteKey ? LePeerDataStore::RemoteSigningKey
+                                                       : LePeerDataStore::LocalSigningKey,
+                                             csrk);
         }
     );
 
@@ -322,6 +351,7 @@ void QLowEnergyControllerPrivateBluez::handleGattRequestTimeout()
         case QBluezConst::AttCommand::ATT_OP_EXCHANGE_MTU_REQUEST: // MTU change request
             // never received reply to MTU request
             // it is safe to skip and go to next request
+            endTracePhase(QLowEnergyConnectionTrace::MtuExchangePhase);
             break;
         case QBluezConst::AttCommand::ATT_OP_READ_BY_GROUP_REQUEST: // primary or secondary service
                                                                     // discovery
@@ -347,15 +377,18 @@ void QLowEnergyControllerPrivateBluez::handleGattRequestTimeout()
             processReply(currentRequest, createRequestErrorMessage(
                                             command, currentRequest.reference2.toUInt()));
             break;
+        case QBluezConst::AttCommand::ATT_OP_READ_MULTIPLE_VARIABLE_REQUEST: // batched value read
+                                                                            // during service discovery
+            processReply(currentRequest, createRequestErrorMessage(command, 0));
+            break;
         case QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST: // prepare to write long desc or
                                                                     // char
         case QBluezConst::AttCommand::ATT_OP_EXECUTE_WRITE_REQUEST: // execute long write of desc or
                                                                     // char
         {
-            uint handleData = currentRequest.reference.toUInt();
-            const QLowEnergyHandle attrHandle = (handleData & 0xffff);
-            processReply(currentRequest,
-                         createRequestErrorMessage(command, attrHandle));
+            const QLowEnergyHandle attrHandle
+                    = currentRequest.preparedWrite->parts().constFirst().targetHandle;
+            processReply(currentRequest, createRequestErrorMessage(command, attrHandle));
         } break;
         default:
             // not a command used by central role implementation
@@ -373,6 +406,7 @@ QLowEnergyControllerPrivateBluez::~QLowEnergyControllerPrivateBluez()
 {
     closeServerSocket();
     delete cmacCalculator;
+    delete databaseWalker;
 }
 
 class ServerSocket
@@ -431,8 +465,8 @@ void QLowEnergyControllerPrivateBluez::startAdvertising(const QLowEnergyAdvertis
 {
     qCDebug(QT_BT_BLUEZ) << "Starting to advertise";
     if (!advertiser) {
-        advertiser = new QLeAdvertiserBluez(params, advertisingData, scanResponseData, *hciManager,
-                                            this);
+        advertiser = new QLeAdvertiserBluez(params, advertisingData, scanResponseData,
+                                            *hciLink->hciManager(), this);
         connect(advertiser, &QLeAdvertiser::errorOccurred, this,
                 &QLowEnergyControllerPrivateBluez::handleAdvertisingError);
     }
@@ -464,6 +498,13 @@ void QLowEnergyControllerPrivateBluez::stopAdvertising()
     advertiser->stopAdvertising();
 }
 
+void QLowEnergyControllerPrivateBluez::updateAdvertisingData(
+        const QLowEnergyAdvertisingData &advertisingData,
+        const QLowEnergyAdvertisingData &scanResponseData)
+{
+    advertiser->updateAdvertisingData(advertisingData, scanResponseData);
+}
+
 void QLowEnergyControllerPrivateBluez::requestConnectionUpdate(const QLowEnergyConnectionParameters &params)
 {
     // The spec says that the connection update command can be used by both slave and master
@@ -471,9 +512,25 @@ void QLowEnergyControllerPrivateBluez::requestConnectionUpdate(const QLowEnergyC
     // connection parameter update request, which we need to wrap in an ACL command, as BlueZ
     // does not allow user-space sockets for the signaling channel.
     if (role == QLowEnergyController::CentralRole)
-        hciManager->sendConnectionUpdateCommand(connectionHandle, params);
+        hciLink->hciManager()->sendConnectionUpdateCommand(connectionHandle, params);
     else
-        hciManager->sendConnectionParameterUpdateRequest(connectionHandle, params);
+        hciLink->hciManager()->sendConnectionParameterUpdateRequest(connectionHandle, params);
+}
+
+void QLowEnergyControllerPrivateBluez::requestPhy(QLowEnergyController::Phys txPhys,
+                                                  QLowEnergyController::Phys rxPhys)
+{
+    // The flags match the bits of the LE Set PHY command.
+    if (!hciLink->hciManager()->sendSetPhyCommand(connectionHandle, quint8(txPhys.toInt()),
+                                                  quint8(rxPhys.toInt())))
+        qCWarning(QT_BT_BLUEZ) << "Cannot request PHY update";
+}
+
+void QLowEnergyControllerPrivateBluez::requestDataLength(int maxTxOctets)
+{
+    const quint16 txOctets = quint16(qBound(0, maxTxOctets, 0xffff));
+    if (!hciLink->hciManager()->sendSetDataLengthCommand(connectionHandle, txOctets))
+        qCWarning(QT_BT_BLUEZ) << "Cannot request data length update";
 }
 
 void QLowEnergyControllerPrivateBluez::connectToDevice()
@@ -492,6 +549,27 @@ void QLowEnergyControllerPrivateBluez::connectToDevice()
 
     createServicesForCentralIfRequired();
 
+    // the controller creates one LE connection at a time, leave the queue to the hub
+    hciLink->setRemoteDevice(remoteDevice);
+    if (!hciLink->requestConnectionSlot()) {
+        qCDebug(QT_BT_BLUEZ) << "Waiting for other connection attempts on the adapter";
+        beginTracePhase(QLowEnergyConnectionTrace::ConnectionQueuePhase);
+        return;
+    }
+    startConnectionAttempt();
+}
+
+/*!
+ * Starts connecting once the hub granted a connection slot.
+ */
+void QLowEnergyControllerPrivateBluez::startConnectionAttempt()
+{
+    endTracePhase(QLowEnergyConnectionTrace::ConnectionQueuePhase);
+    if (state != QLowEnergyController::ConnectingState || l2cpSocket) {
+        hciLink->releaseConnectionSlot();
+        return;
+    }
+
     // check for active running connections
     // BlueZ 5.37+ (maybe even earlier versions) can have pending BTLE connections
     // Only one active L2CP socket to CID 0x4 possible at a time
@@ -503,7 +581,8 @@ void QLowEnergyControllerPrivateBluez::connectToDevice()
         return;
     }
 
-    QList<quint16> activeHandles = hciManager->activeLowEnergyConnections();
+    // connections of other controllers in this process are neither stale nor pending
+    QList<quint16> activeHandles = hciLink->hub()->externalLowEnergyConnections();
     if (!activeHandles.isEmpty()) {
         qCWarning(QT_BT_BLUEZ) << "Cannot connect due to pending active LE connections";
 
@@ -515,10 +594,12 @@ void QLowEnergyControllerPrivateBluez::connectToDevice()
 
         QList<QBluetoothAddress> connectedAddresses;
         for (const auto handle: activeHandles) {
-            const QBluetoothAddress addr = hciManager->addressForConnectionHandle(handle);
+            const QBluetoothAddress addr
+                    = hciLink->hciManager()->addressForConnectionHandle(handle);
             if (!addr.isNull())
                 connectedAddresses.push_back(addr);
         }
+        beginTracePhase(QLowEnergyConnectionTrace::ExternalConnectionsPhase);
         device1Manager->scheduleJob(RemoteDeviceManager::JobType::JobDisconnectDevice, connectedAddresses);
     } else {
         establishL2cpClientSocket();
@@ -535,8 +616,9 @@ void QLowEnergyControllerPrivateBluez::activeConnectionTerminationDone()
 
     qCDebug(QT_BT_BLUEZ) << "RemoteDeviceManager finished attempting"
                          << "to close external connections";
+    endTracePhase(QLowEnergyConnectionTrace::ExternalConnectionsPhase);
 
-    QList<quint16> activeHandles = hciManager->activeLowEnergyConnections();
+    QList<quint16> activeHandles = hciLink->hub()->externalLowEnergyConnections();
     if (!activeHandles.isEmpty()) {
         qCWarning(QT_BT_BLUEZ) << "Cannot close pending external BTLE connections. Aborting connect attempt";
         setError(QLowEnergyController::ConnectionError);
@@ -564,12 +646,14 @@ void QLowEnergyControllerPrivateBluez::establishL2cpClientSocket()
 
     quint32 addressTypeToUse = (addressType == QLowEnergyController::PublicAddress)
                                     ? BDADDR_LE_PUBLIC : BDADDR_LE_RANDOM;
+    beginTracePhase(QLowEnergyConnectionTrace::AddressLookupPhase);
     if (BluetoothManagement::instance()->isMonitoringEnabled()) {
         // if monitoring is possible and it's private then we force it to the relevant option
         if (BluetoothManagement::instance()->isAddressRandom(remoteDevice)) {
             addressTypeToUse = BDADDR_LE_RANDOM;
         }
     }
+    endTracePhase(QLowEnergyConnectionTrace::AddressLookupPhase);
 
     qCDebug(QT_BT_BLUEZ) << "addresstypeToUse:"
                          << (addressTypeToUse == BDADDR_LE_RANDOM
@@ -602,9 +686,10 @@ void QLowEnergyControllerPrivateBluez::establishL2cpClientSocket()
 
     // connect
     // Unbuffered mode required to separate each GATT packet
+    beginTracePhase(QLowEnergyConnectionTrace::L2capConnectPhase);
     l2cpSocket->connectToService(remoteDevice, ATTRIBUTE_CHANNEL_ID,
                                  QIODevice::ReadWrite | QIODevice::Unbuffered);
-    loadSigningDataIfNecessary(LocalSigningKey);
+    peerDataStore->loadSigningData(remoteDevice, LePeerDataStore::LocalSigningKey);
 }
 
 void QLowEnergyControllerPrivateBluez::createServicesForCentralIfRequired()
@@ -677,8 +762,13 @@ void QLowEnergyControllerPrivateBluez::l2cpConnected()
 {
     Q_Q(QLowEnergyController);
 
+    hciLink->releaseConnectionSlot();
+    endTracePhase(QLowEnergyConnectionTrace::L2capConnectPhase);
     securityLevelValue = securityLevel();
-    exchangeMTU();
+    transmitQueue->setSocketDescriptor(l2cpSocket->socketDescriptor());
+    // queued before any discovery request, so that long values need fewer round trips
+    if (preferredMtu > ATT_DEFAULT_LE_MTU)
+        exchangeMTU();
 
     setState(QLowEnergyController::ConnectedState);
     emit q->connected();
@@ -703,10 +793,12 @@ void QLowEnergyControllerPrivateBluez::l2cpDisconnected()
 {
     Q_Q(QLowEnergyController);
 
+    peerDataStore->flush();
     if (role == QLowEnergyController::PeripheralRole) {
         storeClientConfigurations();
         remoteDevice.clear();
         remoteName.clear();
+        hciLink->setRemoteDevice(remoteDevice);
     }
     invalidateServices();
     resetController();
@@ -749,6 +841,7 @@ void QLowEnergyControllerPrivateBluez::l2cpErrorChanged(QBluetoothSocket::Socket
 
 void QLowEnergyControllerPrivateBluez::resetController()
 {
+    transmitQueue->setSocketDescriptor(-1);
     openRequests.clear();
     openPrepareWriteRequests.clear();
     scheduledIndications.clear();
@@ -759,6 +852,10 @@ void QLowEnergyControllerPrivateBluez::resetController()
     mtuSize = ATT_DEFAULT_LE_MTU;
     securityLevelValue = -1;
     connectionHandle = 0;
+    hciLink->resetConnectionHandle();
+    hciLink->releaseConnectionSlot();
+    delete databaseWalker;
+    databaseWalker = nullptr;
 
     if (role == QLowEnergyController::PeripheralRole) {
         // public API behavior requires stop of advertisement
@@ -787,6 +884,7 @@ void QLowEnergyControllerPrivateBluez::l2cpReadyRead()
                          << incomingPacket.toHex();
     if (incomingPacket.isEmpty())
         return;
+    traceBytesReceived(incomingPacket.size());
 
     const QBluezConst::AttCommand command =
             static_cast<QBluezConst::AttCommand>(incomingPacket.constData()[0]);
@@ -853,6 +951,7 @@ void QLowEnergyControllerPrivateBluez::l2cpReadyRead()
     default:
         //only solicited replies finish pending requests
         requestPending = false;
+        traceRoundTrip();
         break;
     }
 
@@ -887,6 +986,7 @@ void QLowEnergyControllerPrivateBluez::encryptionChangedEvent(
         return;
 
     securityLevelValue = securityLevel();
+    endTracePhase(QLowEnergyConnectionTrace::SecurityPhase);
 
     // On success continue to process ATT command queue
     if (!wasSuccess) {
@@ -911,14 +1011,10 @@ void QLowEnergyControllerPrivateBluez::encryptionChangedEvent(
                     service->setError(QLowEnergyService::DescriptorWriteError);
             }
         } else if (failedRequest.command == QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST) {
-            uint handleData = failedRequest.reference.toUInt();
-            const QLowEnergyHandle attrHandle = (handleData & 0xffff);
-            const QByteArray newValue = failedRequest.reference2.toByteArray();
-
             // Prepare command failed, cancel pending prepare queue on
             // the device. The appropriate (Descriptor|Characteristic)WriteError
             // is emitted too once the execute write request comes through
-            sendExecuteWriteRequest(attrHandle, newValue, true);
+            sendExecuteWriteRequest(failedRequest.preparedWrite, true);
         }
     }
 
@@ -928,21 +1024,28 @@ void QLowEnergyControllerPrivateBluez::encryptionChangedEvent(
 
 void QLowEnergyControllerPrivateBluez::sendPacket(const QByteArray &packet)
 {
-    qint64 result = l2cpSocket->write(packet.constData(),
-                                      packet.size());
-    // We ignore result == 0 which is likely to be caused by EAGAIN.
-    // This packet is effectively discarded but the controller can still recover
+    // queued if the socket cannot take it right now
+    transmitQueue->send(packet);
+    traceBytesSent(packet.size());
+}
 
-    if (result == -1) {
-        qCDebug(QT_BT_BLUEZ) << "Cannot write L2CP packet:" << Qt::hex
-                             << packet.toHex()
-                             << l2cpSocket->errorString();
-        setError(QLowEnergyController::NetworkError);
-    } else if (result < packet.size()) {
-        qCWarning(QT_BT_BLUEZ) << "L2CP write request incomplete:"
-                               << result << "of" << packet.size();
-    }
+int QLowEnergyControllerPrivateBluez::pendingWriteCommands(
+        const QLowEnergyServicePrivate *service) const
+{
+    return transmitQueue ? transmitQueue->pendingWriteCommands(service) : 0;
+}
 
+/*!
+    Returns the TX buffer resized to \a size bytes, for a packet which is sent right away.
+    The buffer keeps a capacity of at least the negotiated MTU, so building such packets
+    does not allocate. The caller must not keep a copy of the returned buffer.
+ */
+QByteArray &QLowEnergyControllerPrivateBluez::txPacket(int size)
+{
+    if (txBuffer.capacity() < mtuSize)
+        txBuffer.reserve(mtuSize);
+    txBuffer.resize(size);
+    return txBuffer;
 }
 
 void QLowEnergyControllerPrivateBluez::sendNextPendingRequest()
@@ -959,6 +1062,50 @@ void QLowEnergyControllerPrivateBluez::sendNextPendingRequest()
     sendPacket(request.payload);
 }
 
+/*!
+    \internal
+
+    Queues a \a request which belongs to the detail discovery of a single
+    service. Such requests may overtake queued discovery requests of other
+    services: requests of a service with a higher
+    \l QLowEnergyService::DiscoveryPriority go first and services of the same
+    priority are interleaved, one request per service and round.
+
+    A head of the queue which is in flight or waits for an encryption change
+    keeps its place. While a reply is processed, its request was already
+    dequeued and the head is an ordinary queued request. Any request which
+    does not belong to a detail discovery keeps its FIFO position and so do
+    the previously queued requests of the same service.
+ */
+void QLowEnergyControllerPrivateBluez::enqueueDiscoveryRequest(const Request &request)
+{
+    const QLowEnergyServicePrivate *service = request.discoveredService.data();
+    Q_ASSERT(service);
+
+    const bool headPinned = requestPending || encryptionChangePending;
+    qsizetype first = headPinned ? qMin<qsizetype>(1, openRequests.size()) : 0;
+    for (qsizetype i = first; i < openRequests.size(); ++i) {
+        const QLowEnergyServicePrivate *other = openRequests.at(i).discoveredService.data();
+        if (!other || other == service)
+            first = i + 1;
+    }
+
+    // every service behind 'first' is in round 0 with its first request
+    QSet<const QLowEnergyServicePrivate *> seen;
+    qsizetype position = first;
+    for (; position < openRequests.size(); ++position) {
+        const QLowEnergyServicePrivate *other = openRequests.at(position).discoveredService.data();
+        if (other->priority < service->priority)
+            break;
+        if (other->priority == service->priority && seen.contains(other))
+            break;
+        seen.insert(other);
+    }
+
+    openRequests.insert(position, request);
+    sendNextPendingRequest();
+}
+
 QLowEnergyHandle parseReadByTypeCharDiscovery(
         QLowEnergyServicePrivate::CharData *charData,
         const char *data, quint16 elementLength)
@@ -1025,6 +1172,30 @@ void QLowEnergyControllerPrivateBluez::processReply(
         isErrorResponse = true;
     }
 
+    if (request.discoveredService) {
+        QLowEnergyServicePrivate *service = request.discoveredService.data();
+        emit service->discoveryProgress(++service->discoveryRoundTrips);
+    }
+
+    if (request.databaseWalk) {
+        if (isErrorResponse) {
+            Q_ASSERT(!encryptionChangePending);
+            QBluezConst::AttError err = static_cast<QBluezConst::AttError>(response.constData()[4]);
+            encryptionChangePending = increaseEncryptLevelfRequired(err);
+            if (encryptionChangePending) {
+                // Retry the same command again once the change has happened
+                openRequests.prepend(request);
+                return;
+            }
+        }
+
+        if (databaseWalker) {
+            databaseWalker->processResponse(response);
+            sendNextDatabaseWalkRequest();
+        }
+        return;
+    }
+
     switch (command) {
     case QBluezConst::AttCommand::ATT_OP_EXCHANGE_MTU_REQUEST: // in case of error
     case QBluezConst::AttCommand::ATT_OP_EXCHANGE_MTU_RESPONSE: {
@@ -1035,12 +1206,12 @@ void QLowEnergyControllerPrivateBluez::processReply(
         } else {
             const char *data = response.constData();
             quint16 mtu = bt_get_le16(&data[1]);
-            mtuSize = mtu;
-            if (mtuSize < ATT_DEFAULT_LE_MTU)
-                mtuSize = ATT_DEFAULT_LE_MTU;
+            // Spec v5.2, Vol 3, Part F, 3.4.2.2: the smaller of both RX MTUs applies
+            mtuSize = qBound<quint16>(ATT_DEFAULT_LE_MTU, mtu, preferredMtu);
 
             qCDebug(QT_BT_BLUEZ) << "Server MTU:" << mtu << "resulting mtu:" << mtuSize;
         }
+        endTracePhase(QLowEnergyConnectionTrace::MtuExchangePhase);
         if (oldMtuSize != mtuSize)
             emit q->mtuChanged(mtuSize);
     } break;
@@ -1224,7 +1395,8 @@ void QLowEnergyControllerPrivateBluez::processReply(
                          << service->characteristicList[charHandle].uuid.toString();
                 // Potentially more data -> switch to blob reads
                 readServiceValuesByOffset(handleData, mtuSize-1,
-                                          request.reference2.toBool());
+                                          request.reference2.toBool(),
+                                          request.discoveredService);
                 break;
             } else if (!isServiceDiscoveryRun) {
                 // readCharacteristic() or readDescriptor() ongoing
@@ -1279,7 +1451,8 @@ void QLowEnergyControllerPrivateBluez::processReply(
 
             if (response.size() == mtuSize) {
                 readServiceValuesByOffset(handleData, length,
-                                          request.reference2.toBool());
+                                          request.reference2.toBool(),
+                                          request.discoveredService);
                 break;
             } else if (service->state == QLowEnergyService::RemoteServiceDiscovered) {
                 // readCharacteristic() or readDescriptor() ongoing
@@ -1470,11 +1643,7 @@ void QLowEnergyControllerPrivateBluez::processReply(
     case QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_RESPONSE: {
         //Prepare write command response
         Q_ASSERT(request.command == QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST);
-
-        uint handleData = request.reference.toUInt();
-        const QLowEnergyHandle attrHandle = (handleData & 0xffff);
-        const QByteArray newValue = request.reference2.toByteArray();
-        const int writtenPayload = ((handleData >> 16) & 0xffff);
+        Q_ASSERT(request.preparedWrite);
 
         if (isErrorResponse) {
             Q_ASSERT(!encryptionChangePending);
@@ -1485,49 +1654,57 @@ void QLowEnergyControllerPrivateBluez::processReply(
                 break;
             }
             //emits error on cancellation and aborts existing prepare reuqests
-            sendExecuteWriteRequest(attrHandle, newValue, true);
+            sendExecuteWriteRequest(request.preparedWrite, true);
+        } else if (!LePreparedWrite::isEcho(request.payload, response)) {
+            // the server did not queue what we sent, do not commit it
+            qCWarning(QT_BT_BLUEZ) << "Prepare Write Response does not match request"
+                                   << request.payload.toHex();
+            sendExecuteWriteRequest(request.preparedWrite, true);
+        } else if (!request.preparedWrite->atEnd()) {
+            sendNextPrepareWriteRequest(request.preparedWrite);
         } else {
-            if (writtenPayload < newValue.size()) {
-                sendNextPrepareWriteRequest(attrHandle, newValue, writtenPayload);
-            } else {
-                sendExecuteWriteRequest(attrHandle, newValue, false);
-            }
+            sendExecuteWriteRequest(request.preparedWrite, false);
         }
     } break;
     case QBluezConst::AttCommand::ATT_OP_EXECUTE_WRITE_REQUEST: // error case
     case QBluezConst::AttCommand::ATT_OP_EXECUTE_WRITE_RESPONSE: {
-        // right now used in connection with long characteristic/descriptor value writes
-        // not catering for reliable writes
+        // long characteristic/descriptor value writes and reliable writes
         Q_ASSERT(request.command == QBluezConst::AttCommand::ATT_OP_EXECUTE_WRITE_REQUEST);
+        Q_ASSERT(request.preparedWrite);
 
-        uint handleData = request.reference.toUInt();
-        const QLowEnergyHandle attrHandle = handleData & 0xffff;
-        bool wasCancellation = !((handleData >> 16) & 0xffff);
-        const QByteArray newValue = request.reference2.toByteArray();
-
-        // is it a descriptor or characteristic?
-        const QLowEnergyDescriptor descriptor = descriptorForHandle(attrHandle);
-        QSharedPointer<QLowEnergyServicePrivate> service = serviceForHandle(attrHandle);
+        const LePreparedWrite &preparedWrite = *request.preparedWrite;
+        const bool wasCancellation = !request.reference.toBool();
+        QSharedPointer<QLowEnergyServicePrivate> service
+                = serviceForHandle(preparedWrite.parts().constFirst().attributeHandle);
         Q_ASSERT(!service.isNull());
 
-        if (isErrorResponse || wasCancellation) {
-            // charHandle == 0 -> cancellation
-            if (descriptor.isValid())
-                service->setError(QLowEnergyService::DescriptorWriteError);
-            else
-                service->setError(QLowEnergyService::CharacteristicWriteError);
-        } else {
-            if (descriptor.isValid()) {
+        if (preparedWrite.isReliable() && (isErrorResponse || wasCancellation)) {
+            service->setError(QLowEnergyService::CharacteristicWriteError);
+            emit service->reliableWriteFinished(false);
+            break;
+        }
+
+        for (const LePreparedWrite::Part &part : preparedWrite.parts()) {
+            // is it a descriptor or characteristic?
+            const QLowEnergyDescriptor descriptor = descriptorForHandle(part.attributeHandle);
+            if (isErrorResponse || wasCancellation) {
+                if (descriptor.isValid())
+                    service->setError(QLowEnergyService::DescriptorWriteError);
+                else
+                    service->setError(QLowEnergyService::CharacteristicWriteError);
+            } else if (descriptor.isValid()) {
                 updateValueOfDescriptor(descriptor.characteristicHandle(),
-                                        attrHandle, newValue, NEW_VALUE);
-                emit service->descriptorWritten(descriptor, newValue);
+                                        part.attributeHandle, part.value, NEW_VALUE);
+                emit service->descriptorWritten(descriptor, part.value);
             } else {
-                QLowEnergyCharacteristic ch(service, attrHandle);
+                QLowEnergyCharacteristic ch(service, part.attributeHandle);
                 if (ch.properties() & QLowEnergyCharacteristic::Read)
-                    updateValueOfCharacteristic(attrHandle, newValue, NEW_VALUE);
-                emit service->characteristicWritten(ch, newValue);
+                    updateValueOfCharacteristic(part.attributeHandle, part.value, NEW_VALUE);
+                emit service->characteristicWritten(ch, part.value);
             }
         }
+        if (preparedWrite.isReliable())
+            emit service->reliableWriteFinished(true);
     } break;
     default:
         qCDebug(QT_BT_BLUEZ) << "Unknown packet: " << response.toHex();
@@ -1576,6 +1753,7 @@ void QLowEnergyControllerPrivateBluez::discoverServiceDetails(const QBluetoothUu
 
     QSharedPointer<QLowEnergyServicePrivate> serviceData = serviceList.value(service);
     serviceData->mode = mode;
+    serviceData->discoveryRoundTrips = 0;
     serviceData->characteristicList.clear();
     sendReadByTypeRequest(serviceData, serviceData->startHandle, GATT_INCLUDED_SERVICE);
 }
@@ -1602,9 +1780,8 @@ void QLowEnergyControllerPrivateBluez::sendReadByTypeRequest(
     request.command = QBluezConst::AttCommand::ATT_OP_READ_BY_TYPE_REQUEST;
     request.reference = QVariant::fromValue(serviceData);
     request.reference2 = attributeType;
-    openRequests.enqueue(request);
-
-    sendNextPendingRequest();
+    request.discoveredService = serviceData;
+    enqueueDiscoveryRequest(request);
 }
 
 /*!
@@ -1660,6 +1837,11 @@ void QLowEnergyControllerPrivateBluez::readServiceValues(
             if (!(charDetails.properties & QLowEnergyCharacteristic::Read))
                 continue;
 
+            if (!QLowEnergyServicePrivate::readsValueDuringDiscovery(
+                        service->mode, service->readPolicies, charDetails.uuid)) {
+                continue;
+            }
+
             pair.first = charDetails.valueHandle;
             pair.second  = charHandle;
             targetHandles.append(pair);
@@ -1670,6 +1852,11 @@ void QLowEnergyControllerPrivateBluez::readServiceValues(
             for ( ; descIt != charDetails.descriptorList.constEnd(); ++descIt) {
                 const QLowEnergyHandle descriptorHandle = descIt.key();
 
+                if (!QLowEnergyServicePrivate::readsDescriptorDuringDiscovery(
+                            service->mode, descIt.value().uuid)) {
+                    continue;
+                }
+
                 pair.first = descriptorHandle;
                 pair.second = (charHandle | (descriptorHandle << 16));
                 targetHandles.append(pair);
@@ -1704,10 +1891,9 @@ void QLowEnergyControllerPrivateBluez::readServiceValues(
         request.reference = pair.second;
         // last entry?
         request.reference2 = QVariant((bool)(i + 1 == targetHandles.count()));
-        openRequests.enqueue(request);
+        request.discoveredService = service;
+        enqueueDiscoveryRequest(request);
     }
-
-    sendNextPendingRequest();
 }
 
 /*!
@@ -1718,10 +1904,12 @@ void QLowEnergyControllerPrivateBluez::readServiceValues(
 
     The BLOB read request is prepended to the list of
     open requests to finish the current value read up before
-    starting the next read request.
+    starting the next read request. \a discoveredService is set if the
+    read is part of a service's detail discovery.
  */
 void QLowEnergyControllerPrivateBluez::readServiceValuesByOffset(
-        uint handleData, quint16 offset, bool isLastValue)
+        uint handleData, quint16 offset, bool isLastValue,
+        const QSharedPointer<QLowEnergyServicePrivate> &discoveredService)
 {
     const QLowEnergyHandle charHandle = (handleData & 0xffff);
     const QLowEnergyHandle descriptorHandle = ((handleData >> 16) & 0xffff);
@@ -1756,6 +1944,7 @@ void QLowEnergyControllerPrivateBluez::readServiceValuesByOffset(
     request.command = QBluezConst::AttCommand::ATT_OP_READ_BLOB_REQUEST;
     request.reference = handleData;
     request.reference2 = isLastValue;
+    request.discoveredService = discoveredService;
     openRequests.prepend(request);
 }
 
@@ -1779,6 +1968,101 @@ void QLowEnergyControllerPrivateBluez::discoverServiceDescriptors(
     discoverNextDescriptor(service, keys, keys[0]);
 }
 
+/*!
+    \internal
+
+    Discovers the details of all services which are still in the
+    \l QLowEnergyService::RemoteService state. Rather than running the per
+    service sequence of discoverServiceDetails() for each of them, the
+    attribute database is walked once by \l LeGattDatabaseWalker.
+ */
+void QLowEnergyControllerPrivateBluez::discoverAllServiceDetails(
+        QLowEnergyService::DiscoveryMode mode)
+{
+    if (databaseWalker) {
+        qCWarning(QT_BT_BLUEZ) << "Discovery of all service details is already running";
+        return;
+    }
+
+    QList<QSharedPointer<QLowEnergyServicePrivate>> pendingServices;
+    QList<LeGattDatabaseWalker::Service> walkerServices;
+    for (const QSharedPointer<QLowEnergyServicePrivate> &service : qAsConst(serviceList)) {
+        if (service->state != QLowEnergyService::RemoteService)
+            continue;
+
+        service->mode = mode;
+        service->characteristicList.clear();
+        pendingServices.append(service);
+
+        LeGattDatabaseWalker::Service details;
+        details.startHandle = service->startHandle;
+        details.endHandle = service->endHandle;
+        details.uuid = service->uuid;
+        details.readPolicies = service->readPolicies;
+        walkerServices.append(details);
+    }
+
+    if (pendingServices.isEmpty())
+        return;
+
+    databaseWalker = new LeGattDatabaseWalker(walkerServices, mtuSize, mode);
+    for (const QSharedPointer<QLowEnergyServicePrivate> &service : qAsConst(pendingServices))
+        service->setState(QLowEnergyService::RemoteServiceDiscovering);
+
+    sendNextDatabaseWalkRequest();
+}
+
+void QLowEnergyControllerPrivateBluez::sendNextDatabaseWalkRequest()
+{
+    // the walker is gone if a state change caused a disconnect
+    if (!databaseWalker)
+        return;
+
+    const QByteArray data = databaseWalker->nextRequest();
+    if (data.isEmpty()) {
+        finishDatabaseWalk();
+        return;
+    }
+
+    Request request;
+    request.payload = data;
+    request.command = static_cast<QBluezConst::AttCommand>(data.at(0));
+    request.databaseWalk = true;
+    openRequests.enqueue(request);
+
+    sendNextPendingRequest();
+}
+
+void QLowEnergyControllerPrivateBluez::finishDatabaseWalk()
+{
+    qCDebug(QT_BT_BLUEZ) << "Discovered details of all services using"
+                         << databaseWalker->requestCount() << "requests";
+
+    const QList<LeGattDatabaseWalker::Service> walkerServices = databaseWalker->services();
+    delete databaseWalker;
+    databaseWalker = nullptr;
+
+    QList<QSharedPointer<QLowEnergyServicePrivate>> discoveredServices;
+    for (const LeGattDatabaseWalker::Service &details : walkerServices) {
+        const QSharedPointer<QLowEnergyServicePrivate> service = serviceList.value(details.uuid);
+        if (service.isNull())
+            continue;
+
+        service->includedServices = details.includedServices;
+        service->characteristicList = details.characteristics;
+        for (const QBluetoothUuid &uuid : details.includedServices) {
+            if (serviceList.contains(uuid))
+                serviceList[uuid]->type |= QLowEnergyService::IncludedService;
+        }
+        discoveredServices.append(service);
+    }
+
+    // only announce the services once all of them are complete as
+    // they may refer to each other via their included services
+    for (const QSharedPointer<QLowEnergyServicePrivate> &service : qAsConst(discoveredServices))
+        service->setState(QLowEnergyService::RemoteServiceDiscovered);
+}
+
 void QLowEnergyControllerPrivateBluez::processUnsolicitedReply(const QByteArray &payload)
 {
     const char *data = payload.constData();
@@ -1810,7 +2094,7 @@ void QLowEnergyControllerPrivateBluez::exchangeMTU()
 
     quint8 packet[MTU_EXCHANGE_HEADER_SIZE];
     packet[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_EXCHANGE_MTU_REQUEST);
-    putBtData(quint16(ATT_MAX_LE_MTU), &packet[1]);
+    putBtData(quint16(preferredMtu), &packet[1]);
 
     QByteArray data(MTU_EXCHANGE_HEADER_SIZE, Qt::Uninitialized);
     memcpy(data.data(), packet, MTU_EXCHANGE_HEADER_SIZE);
@@ -1820,6 +2104,7 @@ void QLowEnergyControllerPrivateBluez::exchangeMTU()
     request.command = QBluezConst::AttCommand::ATT_OP_EXCHANGE_MTU_REQUEST;
     openRequests.enqueue(request);
 
+    beginTracePhase(QLowEnergyConnectionTrace::MtuExchangePhase);
     sendNextPendingRequest();
 }
 
@@ -1941,97 +2226,120 @@ void QLowEnergyControllerPrivateBluez::discoverNextDescriptor(
     request.command = QBluezConst::AttCommand::ATT_OP_FIND_INFORMATION_REQUEST;
     request.reference = QVariant::fromValue<QList<QLowEnergyHandle> >(pendingCharHandles);
     request.reference2 = startingHandle;
-    openRequests.enqueue(request);
-
-    sendNextPendingRequest();
+    request.discoveredService = serviceData;
+    enqueueDiscoveryRequest(request);
 }
 
-void QLowEnergyControllerPrivateBluez::sendNextPrepareWriteRequest(
-        const QLowEnergyHandle handle, const QByteArray &newValue,
-        quint16 offset)
-{
-    // is it a descriptor or characteristic?
-    QLowEnergyHandle targetHandle = 0;
-    const QLowEnergyDescriptor descriptor = descriptorForHandle(handle);
-    if (descriptor.isValid())
-        targetHandle = descriptor.handle();
-    else
-        targetHandle = characteristicForHandle(handle).handle();
-
-    if (!targetHandle) {
-        qCWarning(QT_BT_BLUEZ) << "sendNextPrepareWriteRequest cancelled due to invalid handle"
-                               << handle;
-        return;
-    }
-
-    quint8 packet[PREPARE_WRITE_HEADER_SIZE];
-    packet[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST);
-    putBtData(targetHandle, &packet[1]); // attribute handle
-    putBtData(offset, &packet[3]); // offset into newValue
-
-    qCDebug(QT_BT_BLUEZ) << "Writing long characteristic (prepare):"
-                         << Qt::hex << handle;
-
+/*!
+    \internal
 
-    const int maxAvailablePayload = mtuSize - PREPARE_WRITE_HEADER_SIZE;
-    const int requiredPayload = qMin(newValue.size() - offset, maxAvailablePayload);
-    const int dataSize = PREPARE_WRITE_HEADER_SIZE + requiredPayload;
+    Starts a long write of \a newValue to the attribute \a targetHandle on the
+    server. \a attrHandle is the characteristic or descriptor handle reported
+    back to the service.
+ */
+void QLowEnergyControllerPrivateBluez::startLongWrite(
+        QLowEnergyHandle attrHandle, QLowEnergyHandle targetHandle, const QByteArray &newValue)
+{
+    const auto preparedWrite = QSharedPointer<LePreparedWrite>::create(mtuSize);
+    preparedWrite->addValue(attrHandle, targetHandle, newValue);
+    startPreparedWrite(preparedWrite);
+}
 
-    Q_ASSERT((offset + requiredPayload) <= newValue.size());
-    Q_ASSERT(dataSize <= mtuSize);
+/*!
+    \internal
 
-    QByteArray data(dataSize, Qt::Uninitialized);
-    memcpy(data.data(), packet, PREPARE_WRITE_HEADER_SIZE);
-    memcpy(&(data.data()[PREPARE_WRITE_HEADER_SIZE]), &(newValue.constData()[offset]),
-                                               requiredPayload);
+    Sends the first Prepare Write Request of \a preparedWrite. The following
+    ones and the Execute Write Request are sent right after the response to
+    the previous request, ahead of other queued requests. Otherwise another
+    write could execute or cancel the server's queue halfway.
+ */
+void QLowEnergyControllerPrivateBluez::startPreparedWrite(
+        const QSharedPointer<LePreparedWrite> &preparedWrite)
+{
+    qCDebug(QT_BT_BLUEZ) << "Writing" << preparedWrite->parts().count() << "values with"
+                         << preparedWrite->packetCount() << "prepare write requests";
 
     Request request;
-    request.payload = data;
+    request.payload = preparedWrite->nextPacket();
     request.command = QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST;
-    request.reference = (handle | ((offset + requiredPayload) << 16));
-    request.reference2 = newValue;
+    request.preparedWrite = preparedWrite;
     openRequests.enqueue(request);
+    sendNextPendingRequest();
+}
+
+void QLowEnergyControllerPrivateBluez::sendNextPrepareWriteRequest(
+        const QSharedPointer<LePreparedWrite> &preparedWrite)
+{
+    Request request;
+    request.payload = preparedWrite->nextPacket();
+    request.command = QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST;
+    request.preparedWrite = preparedWrite;
+    openRequests.prepend(request);
 }
 
 /*!
-    Sends an "Execute Write Request" for a long characteristic or descriptor write.
-    This cannot be used for executes in relation to reliable write requests.
+    Sends an "Execute Write Request" for a long characteristic or descriptor
+    write or for a reliable write.
 
     A cancellation removes all pending prepare write request on the GATT server.
     Otherwise this function sends an execute request for all pending prepare
     write requests.
  */
 void QLowEnergyControllerPrivateBluez::sendExecuteWriteRequest(
-        const QLowEnergyHandle attrHandle, const QByteArray &newValue,
-        bool isCancelation)
+        const QSharedPointer<LePreparedWrite> &preparedWrite, bool isCancelation)
 {
-    quint8 packet[EXECUTE_WRITE_HEADER_SIZE];
-    packet[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_EXECUTE_WRITE_REQUEST);
-    if (isCancelation)
-        packet[1] = 0x00; // cancel pending write prepare requests
-    else
-        packet[1] = 0x01; // execute pending write prepare requests
-
-    QByteArray data(EXECUTE_WRITE_HEADER_SIZE, Qt::Uninitialized);
-    memcpy(data.data(), packet, EXECUTE_WRITE_HEADER_SIZE);
-
-    qCDebug(QT_BT_BLUEZ) << "Sending Execute Write Request for long characteristic value"
-                         << Qt::hex << attrHandle;
+    qCDebug(QT_BT_BLUEZ) << "Sending Execute Write Request for"
+                         << preparedWrite->parts().count() << "values, cancel:" << isCancelation;
 
     Request request;
-    request.payload = data;
+    request.payload = LePreparedWrite::executePacket(!isCancelation);
     request.command = QBluezConst::AttCommand::ATT_OP_EXECUTE_WRITE_REQUEST;
-    request.reference  = (attrHandle | ((isCancelation ? 0x00 : 0x01) << 16));
-    request.reference2 = newValue;
+    request.reference = !isCancelation;
+    request.preparedWrite = preparedWrite;
     openRequests.prepend(request);
 }
 
+void QLowEnergyControllerPrivateBluez::writeCharacteristicsReliably(
+        const QSharedPointer<QLowEnergyServicePrivate> service,
+        const QList<QPair<QLowEnergyHandle, QByteArray>> &values)
+{
+    Q_ASSERT(!service.isNull());
+
+    if (role == QLowEnergyController::PeripheralRole) {
+        // Local values are applied all or none.
+        for (const auto &value : values) {
+            const Attribute &attribute
+                    = localAttributes.at(service->characteristicList[value.first].valueHandle);
+            if (value.second.count() < attribute.minLength
+                    || value.second.count() > attribute.maxLength) {
+                qCWarning(QT_BT_BLUEZ) << "reliable write rejected: invalid length"
+                                       << value.second.count() << "for attribute"
+                                       << attribute.handle;
+                service->setError(QLowEnergyService::CharacteristicWriteError);
+                emit service->reliableWriteFinished(false);
+                return;
+            }
+        }
+        for (const auto &value : values) {
+            writeCharacteristicForPeripheral(*service, service->characteristicList[value.first],
+                                             value.second);
+        }
+        emit service->reliableWriteFinished(true);
+        return;
+    }
+
+    const auto preparedWrite = QSharedPointer<LePreparedWrite>::create(mtuSize, true);
+    for (const auto &value : values) {
+        preparedWrite->addValue(value.first, service->characteristicList[value.first].valueHandle,
+                                value.second);
+    }
+    startPreparedWrite(preparedWrite);
+}
+
 
 /*!
     Writes long (prepare write request), short (write request)
     and writeWithoutResponse characteristic values.
-
-    TODO Reliable/prepare write across multiple characteristics is not supported
  */
 void QLowEnergyControllerPrivateBluez::writeCharacteristic(
         const QSharedPointer<QLowEnergyServicePrivate> service,
@@ -2046,7 +2354,7 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristic(
 
     QLowEnergyServicePrivate::CharData &charData = service->characteristicList[charHandle];
     if (role == QLowEnergyController::PeripheralRole)
-        writeCharacteristicForPeripheral(charData, newValue);
+        writeCharacteristicForPeripheral(*service, charData, newValue);
     else
         writeCharacteristicForCentral(service, charHandle, charData.valueHandle, newValue, mode);
 }
@@ -2157,13 +2465,16 @@ bool QLowEnergyControllerPrivateBluez::increaseEncryptLevelfRequired(
     case QBluezConst::AttError::ATT_ERROR_INSUF_ENCRYPTION:
     case QBluezConst::AttError::ATT_ERROR_INSUF_AUTHENTICATION:
     case QBluezConst::AttError::ATT_ERROR_INSUF_ENCR_KEY_SIZE:
-        if (!hciManager->isValid())
+        if (!hciLink->hciManager()->isValid())
             return false;
-        if (!hciManager->monitorEvent(HciManager::HciEvent::EVT_ENCRYPT_CHANGE))
+        if (!hciLink->hciManager()->monitorEvent(HciManager::HciEvent::EVT_ENCRYPT_CHANGE))
             return false;
         if (securityLevelValue != BT_SECURITY_HIGH) {
             qCDebug(QT_BT_BLUEZ) << "Requesting encrypted link";
             if (setSecurityLevel(BT_SECURITY_HIGH)) {
+                // the refused request is sent again once the link is encrypted
+                traceRetry();
+                beginTracePhase(QLowEnergyConnectionTrace::SecurityPhase);
                 restartRequestTimer();
                 return true;
             }
@@ -2235,15 +2546,15 @@ void QLowEnergyControllerPrivateBluez::handleExchangeMtuRequest(const QByteArray
     // Send reply.
     QByteArray reply(MTU_EXCHANGE_HEADER_SIZE, Qt::Uninitialized);
     reply[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_EXCHANGE_MTU_RESPONSE);
-    putBtData(static_cast<quint16>(ATT_MAX_LE_MTU), reply.data() + 1);
+    putBtData(static_cast<quint16>(preferredMtu), reply.data() + 1);
     sendPacket(reply);
 
     // Apply requested MTU.
     const quint16 clientRxMtu = bt_get_le16(packet.constData() + 1);
-    mtuSize = qMax<quint16>(ATT_DEFAULT_LE_MTU, qMin<quint16>(clientRxMtu, ATT_MAX_LE_MTU));
+    mtuSize = qBound<quint16>(ATT_DEFAULT_LE_MTU, clientRxMtu, preferredMtu);
     qCDebug(QT_BT_BLUEZ) << "MTU request from client:" << clientRxMtu
                          << "effective client RX MTU:" << mtuSize;
-    qCDebug(QT_BT_BLUEZ) << "Sending server RX MTU" << ATT_MAX_LE_MTU;
+    qCDebug(QT_BT_BLUEZ) << "Sending server RX MTU" << preferredMtu;
 }
 
 void QLowEnergyControllerPrivateBluez::handleFindInformationRequest(const QByteArray &packet)
@@ -2398,7 +2709,7 @@ void QLowEnergyControllerPrivateBluez::handleReadRequest(const QByteArray &packe
     }
 
     const int sentValueLength = qMin(attribute.value.count(), mtuSize - 1);
-    QByteArray response(1 + sentValueLength, Qt::Uninitialized);
+    QByteArray &response = txPacket(1 + sentValueLength);
     response[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_RESPONSE);
     using namespace std;
     memcpy(response.data() + 1, attribute.value.constData(), sentValueLength);
@@ -2440,7 +2751,7 @@ void QLowEnergyControllerPrivateBluez::handleReadBlobRequest(const QByteArray &p
     // Yes, this value can be zero.
     const int sentValueLength = qMin(attribute.value.count() - valueOffset, mtuSize - 1);
 
-    QByteArray response(1 + sentValueLength, Qt::Uninitialized);
+    QByteArray &response = txPacket(1 + sentValueLength);
     response[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_BLOB_RESPONSE);
     using namespace std;
     memcpy(response.data() + 1, attribute.value.constData() + valueOffset, sentValueLength);
@@ -2468,8 +2779,8 @@ void QLowEnergyControllerPrivateBluez::handleReadMultipleRequest(const QByteArra
         return;
     }
     const QList<Attribute> results = getAttributes(handles.first(), handles.last());
-    QByteArray response(
-            1, static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_MULTIPLE_RESPONSE));
+    // Permission errors are reported for all handles, even those whose values
+    // would not fit into the response anymore.
     for (const Attribute &attr : results) {
         const QBluezConst::AttError error = checkReadPermissions(attr);
         if (error != QBluezConst::AttError::ATT_ERROR_NO_ERROR) {
@@ -2477,10 +2788,15 @@ void QLowEnergyControllerPrivateBluez::handleReadMultipleRequest(const QByteArra
                               error);
             return;
         }
+    }
 
-        // Note: We do not abort if no more values fit into the packet, because we still have to
-        //       report possible permission errors for the other handles.
-        response += attr.value.left(mtuSize - response.count());
+    QByteArray &response = txPacket(1);
+    response[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_MULTIPLE_RESPONSE);
+    for (const Attribute &attr : results) {
+        const int length = qMin<int>(attr.value.count(), mtuSize - response.count());
+        if (length <= 0)
+            break;
+        response.append(attr.value.constData(), length);
     }
 
     qCDebug(QT_BT_BLUEZ) << "sending response:" << response.toHex();
@@ -2552,41 +2868,88 @@ void QLowEnergyControllerPrivateBluez::handleReadByGroupTypeRequest(const QByteA
     sendListResponse(responsePrefix, elementSize, results, elemWriter);
 }
 
+/*!
+    Returns the value which the local service owning \a handle keeps for the characteristic
+    value or descriptor at \a handle, or \c nullptr if \a handle is neither.
+    It is the counterpart of \c localAttributes[handle].value and shares its data.
+ */
+QByteArray *QLowEnergyControllerPrivateBluez::localServiceValue(
+        QLowEnergyHandle handle, QSharedPointer<QLowEnergyServicePrivate> *service)
+{
+    if (handle == 0 || handle >= localAttributes.size())
+        return nullptr;
+    const QLowEnergyHandle charHandle = localAttributes.at(handle).charHandle;
+    if (charHandle == 0)
+        return nullptr;
+    for (const auto &s : qAsConst(localServices)) {
+        if (handle < s->startHandle || handle > s->endHandle)
+            continue;
+        const auto charIt = s->characteristicList.find(charHandle);
+        if (charIt == s->characteristicList.end())
+            return nullptr;
+        if (service)
+            *service = s;
+        if (handle == charIt->valueHandle)
+            return &charIt->value;
+        const auto descIt = charIt->descriptorList.find(handle);
+        return descIt == charIt->descriptorList.end() ? nullptr : &descIt->value;
+    }
+    return nullptr;
+}
+
 void QLowEnergyControllerPrivateBluez::updateLocalAttributeValue(
         QLowEnergyHandle handle,
         const QByteArray &value,
         QLowEnergyCharacteristic &characteristic,
         QLowEnergyDescriptor &descriptor)
 {
-    localAttributes[handle].value = value;
-    for (const auto &service : qAsConst(localServices)) {
-        if (handle < service->startHandle || handle > service->endHandle)
-            continue;
-        for (auto charIt = service->characteristicList.begin();
-             charIt != service->characteristicList.end(); ++charIt) {
-            QLowEnergyServicePrivate::CharData &charData = charIt.value();
-            if (handle == charIt.key() + 1) { // Char value decl comes right after char decl.
-                charData.value = value;
-                characteristic = QLowEnergyCharacteristic(service, charIt.key());
-                return;
-            }
-            for (auto descIt = charData.descriptorList.begin();
-                 descIt != charData.descriptorList.end(); ++descIt) {
-                if (handle == descIt.key()) {
-                    descIt.value().value = value;
-                    descriptor = QLowEnergyDescriptor(service, charIt.key(), handle);
-                    return;
-                }
+    QSharedPointer<QLowEnergyServicePrivate> service;
+    QByteArray * const serviceValue = localServiceValue(handle, &service);
+    if (!serviceValue)
+        qFatal("local services map inconsistent with local attribute map");
+
+    // Both views refer to the same data, so the value is stored once.
+    Attribute &attribute = localAttributes[handle];
+    attribute.value = value;
+    *serviceValue = attribute.value;
+    if (handle == attribute.charHandle + 1) // Char value decl comes right after char decl.
+        characteristic = QLowEnergyCharacteristic(service, attribute.charHandle);
+    else
+        descriptor = QLowEnergyDescriptor(service, attribute.charHandle, handle);
+}
+
+QLowEnergyControllerPrivateBluez::AttributeMemory
+QLowEnergyControllerPrivateBluez::localAttributeMemory() const
+{
+    AttributeMemory memory;
+    for (const Attribute &attribute : localAttributes)
+        memory.valueBytes += attribute.value.size();
+
+    const auto account = [this, &memory](QLowEnergyHandle handle, const QByteArray &value) {
+        if (handle < localAttributes.size() && value.isSharedWith(localAttributes.at(handle).value)) {
+            memory.sharedBytes += value.size();
+        } else {
+            memory.separateBytes += value.size();
+            memory.valueBytes += value.size();
+        }
+    };
+    for (const auto &service : localServices) {
+        for (const QLowEnergyServicePrivate::CharData &charData : service->characteristicList) {
+            account(charData.valueHandle, charData.value);
+            for (auto descIt = charData.descriptorList.cbegin();
+                 descIt != charData.descriptorList.cend(); ++descIt) {
+                account(descIt.key(), descIt->value);
             }
         }
     }
-    qFatal("local services map inconsistent with local attribute map");
+    return memory;
 }
 
 static bool isNotificationEnabled(quint16 clientConfigValue) { return clientConfigValue & 0x1; }
 static bool isIndicationEnabled(quint16 clientConfigValue) { return clientConfigValue & 0x2; }
 
 void QLowEnergyControllerPrivateBluez::writeCharacteristicForPeripheral(
+        QLowEnergyServicePrivate &service,
         QLowEnergyServicePrivate::CharData &charData,
         const QByteArray &newValue)
 {
@@ -2599,7 +2962,7 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristicForPeripheral(
         return;
     }
     attribute.value = newValue;
-    charData.value = newValue;
+    charData.value = attribute.value;
     const bool hasNotifyProperty = attribute.properties & QLowEnergyCharacteristic::Notify;
     const bool hasIndicateProperty
             = attribute.properties & QLowEnergyCharacteristic::Indicate;
@@ -2615,30 +2978,38 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristicForPeripheral(
             Q_ASSERT(desc.value.count() == 2);
             quint16 configValue = bt_get_le16(desc.value.constData());
             if (isNotificationEnabled(configValue) && hasNotifyProperty) {
-                sendNotification(valueHandle);
+                switch (sendNotification(valueHandle)) {
+                case LeAttTransmitQueue::NotificationAccepted:
+                    break;
+                case LeAttTransmitQueue::NotificationCoalesced:
+                    ++service.coalescedUpdates;
+                    break;
+                case LeAttTransmitQueue::NotificationDropped:
+                    qCDebug(QT_BT_BLUEZ) << "notification queue full, dropping update of"
+                                         << Qt::hex << valueHandle;
+                    ++service.droppedUpdates;
+                    break;
+                }
             } else if (isIndicationEnabled(configValue) && hasIndicateProperty) {
-                if (indicationInFlight)
-                    scheduledIndications << valueHandle;
-                else
+                if (!indicationInFlight) {
                     sendIndication(valueHandle);
+                } else if (attribute.coalesceUpdates
+                           && scheduledIndications.contains(valueHandle)) {
+                    // the scheduled indication reads the value when it is sent
+                    ++service.coalescedUpdates;
+                } else if (scheduledIndications.count()
+                           >= LeAttTransmitQueue::DefaultNotificationLimit) {
+                    qCDebug(QT_BT_BLUEZ) << "indication queue full, dropping update of"
+                                         << Qt::hex << valueHandle;
+                    ++service.droppedUpdates;
+                } else {
+                    scheduledIndications << valueHandle;
+                }
             }
         }
 
         // Prepare notification/indication of unconnected, bonded clients.
-        for (auto it = clientConfigData.begin(); it != clientConfigData.end(); ++it) {
-            if (isConnected && it.key() == remoteDevice.toUInt64())
-                continue;
-            QList<ClientConfigurationData> &configDataList = it.value();
-            for (ClientConfigurationData &configData : configDataList) {
-                if (configData.charValueHandle != valueHandle)
-                    continue;
-                if ((isNotificationEnabled(configData.configValue) && hasNotifyProperty)
-                        || (isIndicationEnabled(configData.configValue) && hasIndicateProperty)) {
-                    configData.charValueWasUpdated = true;
-                    break;
-                }
-            }
-        }
+        peerDataStore->characteristicValueUpdated(valueHandle);
         break;
     }
 }
@@ -2649,17 +3020,25 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristicForCentral(const QShar
         const QByteArray &newValue,
         QLowEnergyService::WriteMode mode)
 {
-    QByteArray packet(WRITE_REQUEST_HEADER_SIZE + newValue.count(), Qt::Uninitialized);
+    if (mode == QLowEnergyService::WriteWithResponse
+            && newValue.size() > (mtuSize - WRITE_REQUEST_HEADER_SIZE)) {
+        startLongWrite(charHandle, valueHandle, newValue);
+        return;
+    }
+
+    // Write commands are sent right away and reuse the TX buffer,
+    // requests and signed commands keep their own packet.
+    const int packetSize = WRITE_REQUEST_HEADER_SIZE + newValue.count();
+    QByteArray ownPacket;
+    if (mode != QLowEnergyService::WriteWithoutResponse)
+        ownPacket.resize(packetSize);
+    QByteArray &packet = mode == QLowEnergyService::WriteWithoutResponse
+            ? txPacket(packetSize) : ownPacket;
     putBtData(valueHandle, packet.data() + 1);
     memcpy(packet.data() + 3, newValue.constData(), newValue.count());
     bool writeWithResponse = false;
     switch (mode) {
     case QLowEnergyService::WriteWithResponse:
-        if (newValue.size() > (mtuSize - WRITE_REQUEST_HEADER_SIZE)) {
-            sendNextPrepareWriteRequest(charHandle, newValue, 0);
-            sendNextPendingRequest();
-            return;
-        }
         // write value fits into single package
         packet[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_WRITE_REQUEST);
         writeWithResponse = true;
@@ -2679,18 +3058,18 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristicForCentral(const QShar
             service->setError(QLowEnergyService::CharacteristicWriteError);
             return;
         }
-        const auto signingDataIt = signingData.find(remoteDevice.toUInt64());
-        if (signingDataIt == signingData.end()) {
+        LePeerDataStore::SigningData *signingData = peerDataStore->signingData(remoteDevice);
+        if (!signingData) {
             qCWarning(QT_BT_BLUEZ) << "signed write not possible: no signature key found";
             service->setError(QLowEnergyService::CharacteristicWriteError);
             return;
         }
-        ++signingDataIt.value().counter;
-        packet = LeCmacCalculator::createFullMessage(packet, signingDataIt.value().counter);
-        const quint64 mac = LeCmacCalculator().calculateMac(packet, signingDataIt.value().key);
+        ++signingData->counter;
+        peerDataStore->commitSignCounter(remoteDevice);
+        packet = LeCmacCalculator::createFullMessage(packet, signingData->counter);
+        const quint64 mac = LeCmacCalculator().calculateMac(packet, signingData->key);
         packet.resize(packet.count() + sizeof mac);
         putBtData(mac, packet.data() + packet.count() - sizeof mac);
-        storeSignCounter(LocalSigningKey);
         break;
     }
 
@@ -2703,7 +3082,13 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristicForCentral(const QShar
     // It can be sent at any time and does not produce responses.
     // Therefore we will not put them into the openRequest queue at all.
     if (!writeWithResponse) {
-        sendPacket(packet);
+        if (!transmitQueue->sendWriteCommand(packet, service.data())) {
+            qCWarning(QT_BT_BLUEZ) << "Too many queued write commands, dropping write of"
+                                   << Qt::hex << charHandle;
+            service->setError(QLowEnergyService::OperationError);
+        } else {
+            traceBytesSent(packet.size());
+        }
         return;
     }
 
@@ -2740,8 +3125,7 @@ void QLowEnergyControllerPrivateBluez::writeDescriptorForCentral(
         const QByteArray &newValue)
 {
     if (newValue.size() > (mtuSize - WRITE_REQUEST_HEADER_SIZE)) {
-        sendNextPrepareWriteRequest(descriptorHandle, newValue, 0);
-        sendNextPendingRequest();
+        startLongWrite(descriptorHandle, descriptorHandle, newValue);
         return;
     }
 
@@ -2805,32 +3189,32 @@ void QLowEnergyControllerPrivateBluez::handleWriteRequestOrCommand(const QByteAr
             qCWarning(QT_BT_BLUEZ) << "Ignoring signed write on encrypted link.";
             return;
         }
-        const auto signingDataIt = signingData.find(remoteDevice.toUInt64());
-        if (signingDataIt == signingData.constEnd()) {
+        LePeerDataStore::SigningData *signingData = peerDataStore->signingData(remoteDevice);
+        if (!signingData) {
             qCWarning(QT_BT_BLUEZ) << "No CSRK found for peer device, ignoring signed write";
             return;
         }
 
         const quint32 signCounter = getBtData<quint32>(packet.data() + packet.count() - 12);
-        if (signCounter < signingDataIt.value().counter + 1) {
+        if (signCounter < signingData->counter + 1) {
             qCWarning(QT_BT_BLUEZ) << "Client's' sign counter" << signCounter
                                    << "not greater than local sign counter"
-                                   << signingDataIt.value().counter
+                                   << signingData->counter
                                    << "; ignoring signed write command.";
             return;
         }
 
         const quint64 macFromClient = getBtData<quint64>(packet.data() + packet.count() - 8);
         const bool signatureCorrect = verifyMac(packet.left(packet.count() - 12),
-                signingDataIt.value().key, signCounter, macFromClient);
+                signingData->key, signCounter, macFromClient);
         if (!signatureCorrect) {
             qCWarning(QT_BT_BLUEZ) << "Signed Write packet has wrong signature, disconnecting";
             disconnectFromDevice(); // Recommended by spec v4.2, Vol 3, part C, 10.4.2
             return;
         }
 
-        signingDataIt.value().counter = signCounter;
-        storeSignCounter(RemoteSigningKey);
+        signingData->counter = signCounter;
+        peerDataStore->commitSignCounter(remoteDevice);
         valueLength = packet.count() - 15;
     } else {
         valueLength = packet.count() - 3;
@@ -2915,31 +3299,42 @@ void QLowEnergyControllerPrivateBluez::handleExecuteWriteRequest(const QByteArra
     QList<QLowEnergyCharacteristic> characteristics;
     QList<QLowEnergyDescriptor> descriptors;
     if (!cancel) {
+        // All values are checked before any of them is applied, so that a reliable
+        // write across several attributes takes effect completely or not at all.
+        QList<QLowEnergyHandle> handles;
+        QHash<QLowEnergyHandle, QByteArray> newValues;
         for (const WriteRequest &request : qAsConst(requests)) {
-            Attribute &attribute = localAttributes[request.handle];
-            if (request.valueOffset > attribute.value.count()) {
+            const Attribute &attribute = localAttributes.at(request.handle);
+            auto valueIt = newValues.find(request.handle);
+            if (valueIt == newValues.end()) {
+                valueIt = newValues.insert(request.handle, attribute.value);
+                handles << request.handle;
+            }
+            QByteArray &newValue = valueIt.value();
+            if (request.valueOffset > newValue.count()) {
                 sendErrorResponse(static_cast<QBluezConst::AttCommand>(packet.at(0)),
                                   request.handle, QBluezConst::AttError::ATT_ERROR_INVALID_OFFSET);
                 return;
             }
-            const QByteArray newValue = attribute.value.left(request.valueOffset) + request.value;
-            if (newValue.count() > attribute.maxLength) {
+            if (request.valueOffset + request.value.count() > attribute.maxLength) {
                 sendErrorResponse(static_cast<QBluezConst::AttCommand>(packet.at(0)),
                                   request.handle,
                                   QBluezConst::AttError::ATT_ERROR_INVAL_ATTR_VALUE_LEN);
                 return;
             }
+            // Assemble in place; the stored value is copied once at most, on the first
+            // truncation, instead of once per prepared part.
+            newValue.truncate(request.valueOffset);
+            newValue.append(request.value);
+        }
+        for (const QLowEnergyHandle handle : qAsConst(handles)) {
             QLowEnergyCharacteristic characteristic;
             QLowEnergyDescriptor descriptor;
-            // TODO: Redundant attribute lookup for the case of the same handle appearing
-            //       more than once.
-            updateLocalAttributeValue(request.handle, newValue, characteristic, descriptor);
-            if (characteristic.isValid()) {
+            updateLocalAttributeValue(handle, newValues.value(handle), characteristic, descriptor);
+            if (characteristic.isValid())
                 characteristics << characteristic;
-            } else if (descriptor.isValid()) {
-                Q_ASSERT(descriptor.isValid());
+            else if (descriptor.isValid())
                 descriptors << descriptor;
-            }
         }
     }
 
@@ -2978,7 +3373,7 @@ void QLowEnergyControllerPrivateBluez::sendListResponse(const QByteArray &packet
     const int offset = packetStart.count();
     const int elemCount = qMin(attributes.count(), (mtuSize - offset) / elemSize);
     const int totalPacketSize = offset + elemCount * elemSize;
-    QByteArray response(totalPacketSize, Qt::Uninitialized);
+    QByteArray &response = txPacket(totalPacketSize);
     using namespace std;
     memcpy(response.data(), packetStart.constData(), offset);
     char *data = response.data() + offset;
@@ -2988,31 +3383,35 @@ void QLowEnergyControllerPrivateBluez::sendListResponse(const QByteArray &packet
     sendPacket(response);
 }
 
-void QLowEnergyControllerPrivateBluez::sendNotification(QLowEnergyHandle handle)
+LeAttTransmitQueue::NotificationResult
+QLowEnergyControllerPrivateBluez::sendNotification(QLowEnergyHandle handle)
 {
-    sendNotificationOrIndication(QBluezConst::AttCommand::ATT_OP_HANDLE_VAL_NOTIFICATION, handle);
+    const QByteArray &packet = handleValuePacket(
+                QBluezConst::AttCommand::ATT_OP_HANDLE_VAL_NOTIFICATION, handle);
+    return transmitQueue->sendNotification(packet, handle,
+                                           localAttributes.at(handle).coalesceUpdates);
 }
 
 void QLowEnergyControllerPrivateBluez::sendIndication(QLowEnergyHandle handle)
 {
     Q_ASSERT(!indicationInFlight);
     indicationInFlight = true;
-    sendNotificationOrIndication(QBluezConst::AttCommand::ATT_OP_HANDLE_VAL_INDICATION, handle);
+    sendPacket(handleValuePacket(QBluezConst::AttCommand::ATT_OP_HANDLE_VAL_INDICATION, handle));
 }
 
-void QLowEnergyControllerPrivateBluez::sendNotificationOrIndication(QBluezConst::AttCommand opCode,
-                                                                    QLowEnergyHandle handle)
+const QByteArray &QLowEnergyControllerPrivateBluez::handleValuePacket(
+        QBluezConst::AttCommand opCode, QLowEnergyHandle handle)
 {
     Q_ASSERT(handle <= lastLocalHandle);
     const Attribute &attribute = localAttributes.at(handle);
     const int maxValueLength = qMin(attribute.value.count(), mtuSize - 3);
-    QByteArray packet(3 + maxValueLength, Qt::Uninitialized);
+    QByteArray &packet = txPacket(3 + maxValueLength);
     packet[0] = static_cast<quint8>(opCode);
     putBtData(handle, packet.data() + 1);
     using namespace std;
     memcpy(packet.data() + 3, attribute.value.constData(), maxValueLength);
     qCDebug(QT_BT_BLUEZ) << "sending notification/indication:" << packet.toHex();
-    sendPacket(packet);
+    return packet;
 }
 
 void QLowEnergyControllerPrivateBluez::sendNextIndication()
@@ -3104,12 +3503,28 @@ void QLowEnergyControllerPrivateBluez::handleConnectionRequest()
     }
 
     remoteDevice = QBluetoothAddress(convertAddress(clientAddr.l2_bdaddr.b));
+    hciLink->setRemoteDevice(remoteDevice);
     remoteName = nameOfRemoteCentral(remoteDevice, localAdapter);
     qCDebug(QT_BT_BLUEZ) << "GATT connection from device" << remoteDevice << remoteName;
 
     if (connectionHandle == 0)
         qCWarning(QT_BT_BLUEZ) << "Received client connection, but no connection complete event";
 
+    closeServerSocket();
+    attachL2cpSocket(clientSocket);
+    restoreClientConfigurations();
+    peerDataStore->loadSigningData(remoteDevice, LePeerDataStore::RemoteSigningKey);
+
+    Q_Q(QLowEnergyController);
+    setState(QLowEnergyController::ConnectedState);
+    emit q->connected();
+}
+
+/*!
+    Wraps the connected ATT channel \a socketDescriptor into the L2CP socket.
+ */
+void QLowEnergyControllerPrivateBluez::attachL2cpSocket(int socketDescriptor)
+{
     if (l2cpSocket) {
         disconnect(l2cpSocket);
         if (l2cpSocket->isOpen())
@@ -3118,8 +3533,6 @@ void QLowEnergyControllerPrivateBluez::handleConnectionRequest()
         l2cpSocket->deleteLater();
         l2cpSocket = nullptr;
     }
-    closeServerSocket();
-
     QBluetoothSocketPrivateBluez *rawSocketPrivate = new QBluetoothSocketPrivateBluez();
     l2cpSocket = new QBluetoothSocket(
                 rawSocketPrivate, QBluetoothServiceInfo::L2capProtocol, this);
@@ -3130,14 +3543,39 @@ void QLowEnergyControllerPrivateBluez::handleConnectionRequest()
     connect(l2cpSocket, &QIODevice::readyRead, this, &QLowEnergyControllerPrivateBluez::l2cpReadyRead);
     l2cpSocket->d_ptr->lowEnergySocketType = addressType == QLowEnergyController::PublicAddress
             ? BDADDR_LE_PUBLIC : BDADDR_LE_RANDOM;
-    l2cpSocket->setSocketDescriptor(clientSocket, QBluetoothServiceInfo::L2capProtocol,
+    l2cpSocket->setSocketDescriptor(socketDescriptor, QBluetoothServiceInfo::L2capProtocol,
             QBluetoothSocket::SocketState::ConnectedState, QIODevice::ReadWrite | QIODevice::Unbuffered);
-    restoreClientConfigurations();
-    loadSigningDataIfNecessary(RemoteSigningKey);
+    transmitQueue->setSocketDescriptor(socketDescriptor);
+}
 
+/*!
+    Takes over the ATT channel \a socketDescriptor which is already connected to
+    \a peer, for instance one end of a socket pair. This skips advertising and the
+    L2CAP connect, so autotests and benchmarks can run the ATT protocol handling
+    without Bluetooth hardware. Bonding data is neither loaded nor required.
+
+    Returns \c false if the controller is not unconnected.
+ */
+bool QLowEnergyControllerPrivateBluez::attachConnectedChannel(int socketDescriptor,
+                                                             const QBluetoothAddress &peer)
+{
+    if (state != QLowEnergyController::UnconnectedState)
+        return false;
+
+    remoteDevice = peer;
+    hciLink->setRemoteDevice(remoteDevice);
+    if (role == QLowEnergyController::CentralRole) {
+        setState(QLowEnergyController::ConnectingState);
+        attachL2cpSocket(socketDescriptor);
+        l2cpConnected();
+        return true;
+    }
+
+    attachL2cpSocket(socketDescriptor);
     Q_Q(QLowEnergyController);
     setState(QLowEnergyController::ConnectedState);
     emit q->connected();
+    return true;
 }
 
 void QLowEnergyControllerPrivateBluez::closeServerSocket()
@@ -3183,7 +3621,7 @@ QLowEnergyControllerPrivateBluez::gatherClientConfigData()
 void QLowEnergyControllerPrivateBluez::storeClientConfigurations()
 {
     if (!isBonded()) {
-        clientConfigData.remove(remoteDevice.toUInt64());
+        peerDataStore->removeClientConfigurations(remoteDevice);
         return;
     }
     QList<ClientConfigurationData> clientConfigs;
@@ -3196,34 +3634,43 @@ void QLowEnergyControllerPrivateBluez::storeClientConfigurations()
                                                      tempConfigData.configHandle, value);
         }
     }
-    clientConfigData.insert(remoteDevice.toUInt64(), clientConfigs);
+    peerDataStore->setClientConfigurations(remoteDevice, clientConfigs);
 }
 
 void QLowEnergyControllerPrivateBluez::restoreClientConfigurations()
 {
     const QList<TempClientConfigurationData> &tempConfigList = gatherClientConfigData();
-    const QList<ClientConfigurationData> &restoredClientConfigs = isBonded()
-            ? clientConfigData.value(remoteDevice.toUInt64())
-            : QList<ClientConfigurationData>();
+    QHash<QLowEnergyHandle, ClientConfigurationData> restoredClientConfigs;
+    if (isBonded()) {
+        const QList<ClientConfigurationData> configs
+                = peerDataStore->clientConfigurations(remoteDevice);
+        for (const ClientConfigurationData &config : configs)
+            restoredClientConfigs.insert(config.charValueHandle, config);
+    }
     QList<QLowEnergyHandle> notifications;
     for (const auto &tempConfigData : tempConfigList) {
-        bool wasRestored = false;
-        for (const auto &restoredData : restoredClientConfigs) {
-            if (restoredData.charValueHandle == tempConfigData.charValueHandle) {
-                Q_ASSERT(tempConfigData.descData->value.count() == 2);
-                putBtData(restoredData.configValue, tempConfigData.descData->value.data());
-                wasRestored = true;
-                if (restoredData.charValueWasUpdated) {
-                    if (isNotificationEnabled(restoredData.configValue))
-                        notifications << restoredData.charValueHandle;
-                    else if (isIndicationEnabled(restoredData.configValue))
-                        scheduledIndications << restoredData.charValueHandle;
+        const auto restoredIt = restoredClientConfigs.constFind(tempConfigData.charValueHandle);
+        if (restoredIt != restoredClientConfigs.constEnd()) {
+            const ClientConfigurationData &restoredData = restoredIt.value();
+            Q_ASSERT(tempConfigData.descData->value.count() == 2);
+            // Fill a fresh value rather than detaching the one shared with the attribute table.
+            QByteArray configValue(2, Qt::Uninitialized);
+            putBtData(restoredData.configValue, configValue.data());
+            tempConfigData.descData->value = configValue;
+            if (restoredData.charValueWasUpdated) {
+                const QLowEnergyCharacteristic::PropertyTypes properties
+                        = localAttributes.at(restoredData.charValueHandle).properties;
+                if (isNotificationEnabled(restoredData.configValue)
+                        && (properties & QLowEnergyCharacteristic::Notify)) {
+                    notifications << restoredData.charValueHandle;
+                } else if (isIndicationEnabled(restoredData.configValue)
+                           && (properties & QLowEnergyCharacteristic::Indicate)) {
+                    scheduledIndications << restoredData.charValueHandle;
                 }
-                break;
             }
-        }
-        if (!wasRestored)
+        } else {
             tempConfigData.descData->value = QByteArray(2, 0); // Default value.
+        }
         Q_ASSERT(lastLocalHandle >= tempConfigData.configHandle);
         Q_ASSERT(tempConfigData.configHandle > tempConfigData.charValueHandle);
         localAttributes[tempConfigData.configHandle].value = tempConfigData.descData->value;
@@ -3234,70 +3681,6 @@ void QLowEnergyControllerPrivateBluez::restoreClientConfigurations()
     sendNextIndication();
 }
 
-void QLowEnergyControllerPrivateBluez::loadSigningDataIfNecessary(SigningKeyType keyType)
-{
-    const auto signingDataIt = signingData.constFind(remoteDevice.toUInt64());
-    if (signingDataIt != signingData.constEnd())
-        return; // We are up to date for this device.
-    const QString settingsFilePath = keySettingsFilePath();
-    if (!QFileInfo(settingsFilePath).exists()) {
-        qCDebug(QT_BT_BLUEZ) << "No settings found for peer device.";
-        return;
-    }
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-    const QString group = signingKeySettingsGroup(keyType);
-    settings.beginGroup(group);
-    const QByteArray keyString = settings.value(QLatin1String("Key")).toByteArray();
-    if (keyString.isEmpty()) {
-        qCDebug(QT_BT_BLUEZ) << "Group" << group << "not found in settings file";
-        return;
-    }
-    const QByteArray keyData = QByteArray::fromHex(keyString);
-    if (keyData.count() != int(sizeof(quint128))) {
-        qCWarning(QT_BT_BLUEZ) << "Signing key in settings file has invalid size"
-                               << keyString.count();
-        return;
-    }
-    qCDebug(QT_BT_BLUEZ) << "CSRK of peer device is" << keyString;
-    const quint32 counter = settings.value(QLatin1String("Counter"), 0).toUInt();
-    quint128 csrk;
-    using namespace std;
-    memcpy(csrk.data, keyData.constData(), keyData.count());
-    signingData.insert(remoteDevice.toUInt64(), SigningData(csrk, counter - 1));
-}
-
-void QLowEnergyControllerPrivateBluez::storeSignCounter(SigningKeyType keyType) const
-{
-    const auto signingDataIt = signingData.constFind(remoteDevice.toUInt64());
-    if (signingDataIt == signingData.constEnd())
-        return;
-    const QString settingsFilePath = keySettingsFilePath();
-    if (!QFileInfo(settingsFilePath).exists())
-        return;
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-    if (!settings.isWritable())
-        return;
-    settings.beginGroup(signingKeySettingsGroup(keyType));
-    const QString counterKey = QLatin1String("Counter");
-    if (!settings.allKeys().contains(counterKey))
-        return;
-    const quint32 counterValue = signingDataIt.value().counter + 1;
-    if (counterValue == settings.value(counterKey).toUInt())
-        return;
-    settings.setValue(counterKey, counterValue);
-}
-
-QString QLowEnergyControllerPrivateBluez::signingKeySettingsGroup(SigningKeyType keyType) const
-{
-    return QLatin1String(keyType == LocalSigningKey ? "LocalSignatureKey" : "RemoteSignatureKey");
-}
-
-QString QLowEnergyControllerPrivateBluez::keySettingsFilePath() const
-{
-    return QString::fromLatin1("/var/lib/bluetooth/%1/%2/info")
-            .arg(localAdapter.toString(), remoteDevice.toString());
-}
-
 static QByteArray uuidToByteArray(const QBluetoothUuid &uuid)
 {
     QByteArray ba;
@@ -3360,6 +3743,7 @@ void QLowEnergyControllerPrivateBluez::addToGenericAttributeList(const QLowEnerg
         localAttributes[attribute.handle] = attribute;
 
         // Characteristic value declaration.
+        attribute.charHandle = attribute.handle;
         attribute.handle = ++currentHandle;
         attribute.groupEndHandle = attribute.handle;
         attribute.type = cd.uuid();
@@ -3369,6 +3753,7 @@ void QLowEnergyControllerPrivateBluez::addToGenericAttributeList(const QLowEnerg
         attribute.value = cd.value();
         attribute.minLength = cd.minimumValueLength();
         attribute.maxLength = cd.maximumValueLength();
+        attribute.coalesceUpdates = cd.isUpdateCoalescingEnabled();
         localAttributes[attribute.handle] = attribute;
 
         const QList<QLowEnergyDescriptorData> descriptors = cd.descriptors();
@@ -3421,6 +3806,9 @@ void QLowEnergyControllerPrivateBluez::addToGenericAttributeList(const QLowEnerg
                 attribute.value = QByteArray(attribute.minLength, 0);
             }
             localAttributes[attribute.handle] = attribute;
+            // The service's view of the descriptor shares the attribute's value, which
+            // may have been replaced above.
+            *localServiceValue(attribute.handle) = attribute.value;
         }
     }
     serviceAttribute.groupEndHandle = currentHandle;
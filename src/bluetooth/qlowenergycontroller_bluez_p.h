@@ -58,6 +58,8 @@
 #include <QtBluetooth/qlowenergycharacteristic.h>
 #include "qlowenergycontroller.h"
 #include "qlowenergycontrollerbase_p.h"
+#include "leatttransmitqueue_p.h"
+#include "lepeerdatastore_p.h"
 #include "bluez/bluez_data_p.h"
 
 #include <QtBluetooth/QBluetoothSocket>
@@ -68,8 +70,10 @@ QT_BEGIN_NAMESPACE
 class QLowEnergyServiceData;
 class QTimer;
 
-class HciManager;
 class LeCmacCalculator;
+class LeGattDatabaseWalker;
+class LeHciLink;
+class LePreparedWrite;
 class QSocketNotifier;
 class RemoteDeviceManager;
 
@@ -77,7 +81,7 @@ extern void registerQLowEnergyControllerMetaType();
 
 class QLeAdvertiser;
 
-class QLowEnergyControllerPrivateBluez final: public QLowEnergyControllerPrivate
+class Q_AUTOTEST_EXPORT QLowEnergyControllerPrivateBluez final: public QLowEnergyControllerPrivate
 {
     Q_OBJECT
 public:
@@ -92,13 +96,19 @@ public:
     void discoverServices() override;
     void discoverServiceDetails(const QBluetoothUuid &service,
                                 QLowEnergyService::DiscoveryMode mode) override;
+    void discoverAllServiceDetails(QLowEnergyService::DiscoveryMode mode) override;
 
     void startAdvertising(const QLowEnergyAdvertisingParameters &params,
                           const QLowEnergyAdvertisingData &advertisingData,
                           const QLowEnergyAdvertisingData &scanResponseData) override;
     void stopAdvertising() override;
+    void updateAdvertisingData(const QLowEnergyAdvertisingData &advertisingData,
+                               const QLowEnergyAdvertisingData &scanResponseData) override;
 
     void requestConnectionUpdate(const QLowEnergyConnectionParameters &params) override;
+    void requestPhy(QLowEnergyController::Phys txPhys,
+                    QLowEnergyController::Phys rxPhys) override;
+    void requestDataLength(int maxTxOctets) override;
 
     // read data
     void readCharacteristic(const QSharedPointer<QLowEnergyServicePrivate> service,
@@ -115,12 +125,18 @@ public:
                          const QLowEnergyHandle charHandle,
                          const QLowEnergyHandle descriptorHandle,
                          const QByteArray &newValue) override;
+    int pendingWriteCommands(const QLowEnergyServicePrivate *service) const override;
+    void writeCharacteristicsReliably(
+            const QSharedPointer<QLowEnergyServicePrivate> service,
+            const QList<QPair<QLowEnergyHandle, QByteArray>> &values) override;
 
     void addToGenericAttributeList(const QLowEnergyServiceData &service,
                                    QLowEnergyHandle startHandle) override;
 
     int mtu() const override;
 
+    bool attachConnectedChannel(int socketDescriptor, const QBluetoothAddress &peer);
+
     struct Attribute {
         Attribute() : handle(0) {}
 
@@ -130,12 +146,27 @@ public:
         QBluetooth::AttAccessConstraints readConstraints;
         QBluetooth::AttAccessConstraints writeConstraints;
         QBluetoothUuid type;
+        // characteristic values and descriptors share the value with the
+        // CharData or DescData of their local service
         QByteArray value;
+        // declaration of the characteristic the value or descriptor belongs to
+        QLowEnergyHandle charHandle = 0;
         int minLength;
         int maxLength;
+        bool coalesceUpdates = false;
     };
     QList<Attribute> localAttributes;
 
+    struct AttributeMemory {
+        // value bytes of the attribute table and the local services, shared values count once
+        qsizetype valueBytes = 0;
+        // value bytes which the attribute table shares with the local services
+        qsizetype sharedBytes = 0;
+        // value bytes which the local services hold in a copy of their own
+        qsizetype separateBytes = 0;
+    };
+    AttributeMemory localAttributeMemory() const;
+
 private:
     quint16 connectionHandle = 0;
     QBluetoothSocket *l2cpSocket = nullptr;
@@ -146,6 +177,12 @@ private:
         // requirements this is WIP
         QVariant reference;
         QVariant reference2;
+        // issued by databaseWalker, the response is handled there
+        bool databaseWalk = false;
+        // set for requests of a single service's detail discovery
+        QSharedPointer<QLowEnergyServicePrivate> discoveredService;
+        // set for the prepare and execute requests of a long or reliable write
+        QSharedPointer<LePreparedWrite> preparedWrite;
     };
     QQueue<Request> openRequests;
 
@@ -173,36 +210,20 @@ private:
         QLowEnergyHandle configHandle;
     };
 
-    struct ClientConfigurationData {
-        ClientConfigurationData(QLowEnergyHandle chHndl = 0, QLowEnergyHandle coHndl = 0,
-                                quint16 val = 0)
-            : charValueHandle(chHndl), configHandle(coHndl), configValue(val) {}
-
-        QLowEnergyHandle charValueHandle;
-        QLowEnergyHandle configHandle;
-        quint16 configValue;
-        bool charValueWasUpdated = false;
-    };
-    QHash<quint64, QList<ClientConfigurationData>> clientConfigData;
-
-    struct SigningData {
-        SigningData() = default;
-        SigningData(const quint128 &csrk, quint32 signCounter = quint32(-1))
-            : key(csrk), counter(signCounter) {}
-
-        quint128 key;
-        quint32 counter = quint32(-1);
-    };
-    QHash<quint64, SigningData> signingData;
+    using ClientConfigurationData = LePeerDataStore::ClientConfigurationData;
+    LePeerDataStore *peerDataStore = nullptr;
     LeCmacCalculator *cmacCalculator = nullptr;
+    LeGattDatabaseWalker *databaseWalker = nullptr;
+    LeAttTransmitQueue *transmitQueue = nullptr;
 
     bool requestPending;
     quint16 mtuSize;
+    QByteArray txBuffer;
     int securityLevelValue;
     bool encryptionChangePending;
     bool receivedMtuExchangeRequest = false;
 
-    HciManager *hciManager = nullptr;
+    LeHciLink *hciLink = nullptr;
     QLeAdvertiser *advertiser = nullptr;
     QSocketNotifier *serverSocketNotifier = nullptr;
     QTimer *requestTimer = nullptr;
@@ -226,6 +247,7 @@ private:
     int gattRequestTimeout = 20000;
 
     void handleConnectionRequest();
+    void attachL2cpSocket(int socketDescriptor);
     void closeServerSocket();
 
     bool isBonded() const;
@@ -233,14 +255,10 @@ private:
     void storeClientConfigurations();
     void restoreClientConfigurations();
 
-    enum SigningKeyType { LocalSigningKey, RemoteSigningKey };
-    void loadSigningDataIfNecessary(SigningKeyType keyType);
-    void storeSignCounter(SigningKeyType keyType) const;
-    QString signingKeySettingsGroup(SigningKeyType keyType) const;
-    QString keySettingsFilePath() const;
-
     void sendPacket(const QByteArray &packet);
+    QByteArray &txPacket(int size);
     void sendNextPendingRequest();
+    void enqueueDiscoveryRequest(const Request &request);
     void processReply(const Request &request, const QByteArray &reply);
 
     void sendReadByGroupRequest(QLowEnergyHandle start, QLowEnergyHandle end,
@@ -251,21 +269,25 @@ private:
     void readServiceValues(const QBluetoothUuid &service,
                            bool readCharacteristics);
     void readServiceValuesByOffset(uint handleData, quint16 offset,
-                                   bool isLastValue);
+                                   bool isLastValue,
+                                   const QSharedPointer<QLowEnergyServicePrivate> &discoveredService);
 
     void discoverServiceDescriptors(const QBluetoothUuid &serviceUuid);
     void discoverNextDescriptor(QSharedPointer<QLowEnergyServicePrivate> serviceData,
                                 const QList<QLowEnergyHandle> pendingCharHandles,
                                 QLowEnergyHandle startingHandle);
+    void sendNextDatabaseWalkRequest();
+    void finishDatabaseWalk();
     void processUnsolicitedReply(const QByteArray &msg);
     void exchangeMTU();
     bool setSecurityLevel(int level);
     int securityLevel() const;
-    void sendExecuteWriteRequest(const QLowEnergyHandle attrHandle,
-                                 const QByteArray &newValue,
+    void startLongWrite(QLowEnergyHandle attrHandle, QLowEnergyHandle targetHandle,
+                        const QByteArray &newValue);
+    void startPreparedWrite(const QSharedPointer<LePreparedWrite> &preparedWrite);
+    void sendExecuteWriteRequest(const QSharedPointer<LePreparedWrite> &preparedWrite,
                                  bool isCancelation);
-    void sendNextPrepareWriteRequest(const QLowEnergyHandle handle,
-                                     const QByteArray &newValue, quint16 offset);
+    void sendNextPrepareWriteRequest(const QSharedPointer<LePreparedWrite> &preparedWrite);
     bool increaseEncryptLevelfRequired(QBluezConst::AttError errorCode);
 
     void resetController();
@@ -296,9 +318,9 @@ private:
     void sendListResponse(const QByteArray &packetStart, int elemSize,
                           const QList<Attribute> &attributes, const ElemWriter &elemWriter);
 
-    void sendNotification(QLowEnergyHandle handle);
+    LeAttTransmitQueue::NotificationResult sendNotification(QLowEnergyHandle handle);
     void sendIndication(QLowEnergyHandle handle);
-    void sendNotificationOrIndication(QBluezConst::AttCommand opCode, QLowEnergyHandle handle);
+    const QByteArray &handleValuePacket(QBluezConst::AttCommand opCode, QLowEnergyHandle handle);
     void sendNextIndication();
 
     void ensureUniformAttributes(QList<Attribute> &attributes,
@@ -319,6 +341,8 @@ private:
     bool verifyMac(const QByteArray &message, const quint128 &csrk, quint32 signCounter,
                    quint64 expectedMac);
 
+    QByteArray *localServiceValue(QLowEnergyHandle handle,
+                                  QSharedPointer<QLowEnergyServicePrivate> *service = nullptr);
     void updateLocalAttributeValue(
             QLowEnergyHandle handle,
             const QByteArray &value,
@@ -326,6 +350,7 @@ private:
             QLowEnergyDescriptor &descriptor);
 
     void writeCharacteristicForPeripheral(
+            QLowEnergyServicePrivate &service,
             QLowEnergyServicePrivate::CharData &charData,
             const QByteArray &newValue);
     void writeCharacteristicForCentral(const QSharedPointer<QLowEnergyServicePrivate> &service,
@@ -355,6 +380,7 @@ private slots:
     void l2cpReadyRead();
     void encryptionChangedEvent(const QBluetoothAddress&, bool);
     void handleGattRequestTimeout();
+    void startConnectionAttempt();
     void activeConnectionTerminationDone();
 };
 
@@ -650,7 +650,8 @@ void QLowEnergyControllerPrivateBluezDBus::discoverServiceDetails(
         charData.uuid = QBluetoothUuid(dbusChar.characteristic->uUID());
 
         // schedule read for initial char value
-        if (mode == QLowEnergyService::FullDiscovery
+        if (QLowEnergyServicePrivate::readsValueDuringDiscovery(
+                    mode, serviceData->readPolicies, charData.uuid)
             && charData.properties.testFlag(QLowEnergyCharacteristic::Read)) {
             GattJob job;
             job.flags = GattJob::JobFlags({GattJob::CharRead, GattJob::ServiceDiscovery});
@@ -683,7 +684,7 @@ void QLowEnergyControllerPrivateBluezDBus::discoverServiceDetails(
                 });
             }
 
-            if (mode == QLowEnergyService::FullDiscovery) {
+            if (QLowEnergyServicePrivate::readsDescriptorDuringDiscovery(mode, descData.uuid)) {
                 // schedule read for initial descriptor value
                 GattJob job;
                 job.flags = GattJob::JobFlags({ GattJob::DescRead, GattJob::ServiceDiscovery });
@@ -717,6 +718,28 @@ void QLowEnergyControllerPrivateBluezDBus::prepareNextJob()
     scheduleNextJob(); // continue with next job - if available
 }
 
+/*
+    Ends the reliable write of the current job without success. The values of
+    the same reliable write which were not written yet are dropped.
+ */
+void QLowEnergyControllerPrivateBluezDBus::failReliableWrite()
+{
+    const GattJob failedJob = jobs.constFirst();
+    Q_ASSERT(failedJob.flags.testFlag(GattJob::ReliableWrite));
+
+    if (!failedJob.flags.testFlag(GattJob::LastReliableWrite)) {
+        while (jobs.size() > 1) {
+            const GattJob dropped = jobs.takeAt(1);
+            Q_ASSERT(dropped.flags.testFlag(GattJob::ReliableWrite));
+            if (dropped.flags.testFlag(GattJob::LastReliableWrite))
+                break;
+        }
+    }
+    const QSharedPointer<QLowEnergyServicePrivate> service = failedJob.service;
+    service->setError(QLowEnergyService::CharacteristicWriteError);
+    emit service->reliableWriteFinished(false);
+}
+
 void QLowEnergyControllerPrivateBluezDBus::onCharReadFinished(QDBusPendingCallWatcher *call)
 {
     if (!jobPending || jobs.isEmpty()) {
@@ -846,6 +869,8 @@ void QLowEnergyControllerPrivateBluezDBus::onCharWriteFinished(QDBusPendingCallW
     QSharedPointer<QLowEnergyServicePrivate> service = nextJob.service;
     if (!dbusServices.contains(service->uuid)) {
         qCWarning(QT_BT_BLUEZ) << "onCharWriteFinished: Invalid GATT job. Skipping.";
+        if (nextJob.flags.testFlag(GattJob::ReliableWrite))
+            failReliableWrite();
         call->deleteLater();
         prepareNextJob();
         return;
@@ -859,7 +884,10 @@ void QLowEnergyControllerPrivateBluezDBus::onCharWriteFinished(QDBusPendingCallW
         qCWarning(QT_BT_BLUEZ) << "Cannot initiate writing of" << charData.uuid
                                << "of service" << service->uuid
                                << reply.error().name() << reply.error().message();
-        service->setError(QLowEnergyService::CharacteristicWriteError);
+        if (nextJob.flags.testFlag(GattJob::ReliableWrite))
+            failReliableWrite();
+        else
+            service->setError(QLowEnergyService::CharacteristicWriteError);
     } else {
         if (charData.properties.testFlag(QLowEnergyCharacteristic::Read))
             updateValueOfCharacteristic(nextJob.handle, nextJob.value, false);
@@ -870,6 +898,8 @@ void QLowEnergyControllerPrivateBluezDBus::onCharWriteFinished(QDBusPendingCallW
             qCDebug(QT_BT_BLUEZ) << "Written Char:" << charData.uuid << nextJob.value.toHex();
             emit service->characteristicWritten(ch, nextJob.value);
         }
+        if (nextJob.flags.testFlag(GattJob::LastReliableWrite))
+            emit service->reliableWriteFinished(true);
     }
 
     call->deleteLater();
@@ -935,6 +965,8 @@ void QLowEnergyControllerPrivateBluezDBus::scheduleNextJob()
     QSharedPointer<QLowEnergyServicePrivate> service = serviceForHandle(nextJob.handle);
     if (service.isNull() || !dbusServices.contains(service->uuid)) {
         qCWarning(QT_BT_BLUEZ) << "Invalid GATT job (scheduleNextJob). Skipping.";
+        if (nextJob.flags.testFlag(GattJob::ReliableWrite))
+            failReliableWrite();
         prepareNextJob();
         return;
     }
@@ -974,6 +1006,8 @@ void QLowEnergyControllerPrivateBluezDBus::scheduleNextJob()
         // characteristic writing ***************************************
         if (!service->characteristicList.contains(nextJob.handle)) {
             qCWarning(QT_BT_BLUEZ) << "Invalid Char handle when writing. Skipping.";
+            if (nextJob.flags.testFlag(GattJob::ReliableWrite))
+                failReliableWrite();
             prepareNextJob();
             return;
         }
@@ -987,8 +1021,13 @@ void QLowEnergyControllerPrivateBluezDBus::scheduleNextJob()
 
             QVariantMap options;
             // The "type" option only works with BlueZ >= 5.50, older versions always write with response
-            options[QStringLiteral("type")] = nextJob.writeMode == QLowEnergyService::WriteWithoutResponse ?
-                QStringLiteral("command") : QStringLiteral("request");
+            if (nextJob.flags.testFlag(GattJob::ReliableWrite)) {
+                // BlueZ sends prepare write requests, checks their echoes and executes them
+                options[QStringLiteral("type")] = QStringLiteral("reliable");
+            } else {
+                options[QStringLiteral("type")] = nextJob.writeMode == QLowEnergyService::WriteWithoutResponse ?
+                    QStringLiteral("command") : QStringLiteral("request");
+            }
             QDBusPendingReply<> reply = gattChar.characteristic->WriteValue(nextJob.value, options);
 
             QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(reply, this);
@@ -1001,6 +1040,8 @@ void QLowEnergyControllerPrivateBluezDBus::scheduleNextJob()
 
         if (!foundChar) {
             qCWarning(QT_BT_BLUEZ) << "Cannot find char for writing. Skipping.";
+            if (nextJob.flags.testFlag(GattJob::ReliableWrite))
+                failReliableWrite();
             prepareNextJob();
             return;
         }
@@ -1280,6 +1321,55 @@ void QLowEnergyControllerPrivateBluezDBus::writeDescriptor(
     }
 }
 
+void QLowEnergyControllerPrivateBluezDBus::writeCharacteristicsReliably(
+                    const QSharedPointer<QLowEnergyServicePrivate> service,
+                    const QList<QPair<QLowEnergyHandle, QByteArray>> &values)
+{
+    Q_ASSERT(!service.isNull());
+
+    if (role != QLowEnergyController::CentralRole) {
+        QLowEnergyControllerPrivate::writeCharacteristicsReliably(service, values);
+        return;
+    }
+
+    const GattService &gattService = dbusServices[service->uuid];
+    if (gattService.hasBatteryService && !gattService.batteryInterface.isNull()) {
+        //Battery1 interface is readonly
+        service->setError(QLowEnergyService::CharacteristicWriteError);
+        emit service->reliableWriteFinished(false);
+        return;
+    }
+
+    // BlueZ executes the prepared writes of every WriteValue call on its own, so
+    // only a single value can be written atomically.
+    if (values.size() != 1) {
+        qCWarning(QT_BT_BLUEZ) << "Reliable writes of more than one value are not supported"
+                                  " by BlueZ DBus";
+        service->setError(QLowEnergyService::OperationError);
+        emit service->reliableWriteFinished(false);
+        return;
+    }
+
+    const QLowEnergyHandle handle = values.constFirst().first;
+    if (!service->characteristicList.contains(handle)) {
+        qCWarning(QT_BT_BLUEZ) << "Write characteristic does not belong to service"
+                               << service->uuid;
+        service->setError(QLowEnergyService::CharacteristicWriteError);
+        emit service->reliableWriteFinished(false);
+        return;
+    }
+
+    GattJob job;
+    job.flags = GattJob::JobFlags({GattJob::CharWrite, GattJob::ReliableWrite,
+                                   GattJob::LastReliableWrite});
+    job.service = service;
+    job.handle = handle;
+    job.value = values.constFirst().second;
+    jobs.append(job);
+
+    scheduleNextJob();
+}
+
 void QLowEnergyControllerPrivateBluezDBus::startAdvertising(
                     const QLowEnergyAdvertisingParameters &/* params */,
                     const QLowEnergyAdvertisingData &/* advertisingData */,
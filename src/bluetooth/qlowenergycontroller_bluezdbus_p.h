@@ -103,6 +103,9 @@ public:
                 const QLowEnergyHandle charHandle,
                 const QLowEnergyHandle descriptorHandle,
                 const QByteArray &newValue) override;
+    void writeCharacteristicsReliably(
+                const QSharedPointer<QLowEnergyServicePrivate> service,
+                const QList<QPair<QLowEnergyHandle, QByteArray>> &values) override;
 
     void startAdvertising(
                 const QLowEnergyAdvertisingParameters &params,
@@ -175,7 +178,9 @@ private:
             DescRead                = 0x04,
             DescWrite               = 0x08,
             ServiceDiscovery        = 0x10,
-            LastServiceDiscovery    = 0x20
+            LastServiceDiscovery    = 0x20,
+            ReliableWrite           = 0x40,
+            LastReliableWrite       = 0x80
         };
         Q_DECLARE_FLAGS(JobFlags, JobFlag)
 
@@ -190,6 +195,7 @@ private:
     bool jobPending = false;
 
     void prepareNextJob();
+    void failReliableWrite();
     void discoverBatteryServiceDetails(GattService &dbusData,
                                        QSharedPointer<QLowEnergyServicePrivate> serviceData);
     void executeClose(QLowEnergyController::Error newError);
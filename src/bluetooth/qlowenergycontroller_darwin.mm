@@ -865,6 +865,8 @@ quint16 QLowEnergyControllerPrivateDarwin::updateValueOfCharacteristic(QLowEnerg
         CharacteristicDataMap::iterator charIt = service->characteristicList.find(charHandle);
         if (charIt != service->characteristicList.end()) {
             QLowEnergyServicePrivate::CharData &charData = charIt.value();
+            charData.valueRequested = true;
+            service->lazyValueReads.remove(charHandle);
             if (appendValue)
                 charData.value += value;
             else
@@ -49,6 +49,7 @@
 QT_BEGIN_NAMESPACE
 
 Q_DECLARE_LOGGING_CATEGORY(QT_BT)
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_LE_TRACE)
 
 QLowEnergyControllerPrivate::QLowEnergyControllerPrivate()
     : QObject()
@@ -133,9 +134,96 @@ void QLowEnergyControllerPrivate::setState(
             && role == QLowEnergyController::PeripheralRole) {
         remoteDevice.clear();
     }
+
+    switch (state) {
+    case QLowEnergyController::ConnectingState:
+        connectionTrace = QLowEnergyConnectionTrace();
+        connectionTraceTimer.start();
+        beginTracePhase(QLowEnergyConnectionTrace::ConnectPhase);
+        break;
+    case QLowEnergyController::ConnectedState:
+        endTracePhase(QLowEnergyConnectionTrace::ConnectPhase);
+        break;
+    case QLowEnergyController::DiscoveringState:
+        beginTracePhase(QLowEnergyConnectionTrace::ServiceDiscoveryPhase);
+        break;
+    case QLowEnergyController::DiscoveredState:
+        endTracePhase(QLowEnergyConnectionTrace::ServiceDiscoveryPhase);
+        break;
+    case QLowEnergyController::UnconnectedState:
+        if (connectionTraceTimer.isValid()) {
+            QLowEnergyConnectionTracePrivate::get(connectionTrace)->abort();
+            connectionTraceTimer.invalidate();
+        }
+        break;
+    default:
+        break;
+    }
+
     emit q->stateChanged(state);
 }
 
+void QLowEnergyControllerPrivate::beginTracePhase(QLowEnergyConnectionTrace::Phase phase)
+{
+    // nothing is traced outside of connections the controller established
+    if (!connectionTraceTimer.isValid())
+        return;
+
+    QLowEnergyConnectionTracePrivate::get(connectionTrace)->begin(
+            phase, connectionTraceTimer.nsecsElapsed());
+}
+
+void QLowEnergyControllerPrivate::endTracePhase(QLowEnergyConnectionTrace::Phase phase)
+{
+    if (!connectionTraceTimer.isValid())
+        return;
+
+    const auto record = QLowEnergyConnectionTracePrivate::get(connectionTrace)->end(
+            phase, connectionTraceTimer.nsecsElapsed());
+    if (!record)
+        return;
+
+    qCDebug(QT_BT_LE_TRACE).nospace()
+            << remoteDevice.toString() << ": "
+            << QLowEnergyConnectionTracePrivate::phaseName(phase) << " took "
+            << (record->end - record->start) / 1000 << " us, started after "
+            << record->start / 1000 << " us, retries: " << record->retries
+            << ", round trips: " << record->roundTrips << ", bytes sent: " << record->bytesSent
+            << ", bytes received: " << record->bytesReceived;
+}
+
+QLowEnergyConnectionTracePrivate::PhaseRecord *QLowEnergyControllerPrivate::activeTraceRecord()
+{
+    // checked without detaching, the caller may hold a copy of the trace
+    if (QLowEnergyConnectionTracePrivate::get(qAsConst(connectionTrace))->openPhases.isEmpty())
+        return nullptr;
+    return QLowEnergyConnectionTracePrivate::get(connectionTrace)->activeRecord();
+}
+
+void QLowEnergyControllerPrivate::traceRetry()
+{
+    if (auto record = activeTraceRecord())
+        ++record->retries;
+}
+
+void QLowEnergyControllerPrivate::traceBytesSent(qsizetype size)
+{
+    if (auto record = activeTraceRecord())
+        record->bytesSent += size;
+}
+
+void QLowEnergyControllerPrivate::traceBytesReceived(qsizetype size)
+{
+    if (auto record = activeTraceRecord())
+        record->bytesReceived += size;
+}
+
+void QLowEnergyControllerPrivate::traceRoundTrip()
+{
+    if (auto record = activeTraceRecord())
+        ++record->roundTrips;
+}
+
 QSharedPointer<QLowEnergyServicePrivate> QLowEnergyControllerPrivate::serviceForHandle(
         QLowEnergyHandle handle)
 {
@@ -214,6 +302,8 @@ quint16 QLowEnergyControllerPrivate::updateValueOfCharacteristic(
         CharacteristicDataMap::iterator charIt = service->characteristicList.find(charHandle);
         if (charIt != service->characteristicList.end()) {
             QLowEnergyServicePrivate::CharData &charDetails = charIt.value();
+            charDetails.valueRequested = true;
+            service->lazyValueReads.remove(charHandle);
 
             if (appendValue)
                 charDetails.value += value;
@@ -270,6 +360,56 @@ void QLowEnergyControllerPrivate::invalidateServices()
     lastLocalHandle = {};
 }
 
+void QLowEnergyControllerPrivate::discoverAllServiceDetails(QLowEnergyService::DiscoveryMode mode)
+{
+    // Backends without a dedicated implementation discover one service after the other.
+    // The copy protects against slots modifying the service list.
+    const ServiceDataMap services = serviceList;
+    for (const QSharedPointer<QLowEnergyServicePrivate> &service : services) {
+        if (service->state != QLowEnergyService::RemoteService)
+            continue;
+
+        service->setState(QLowEnergyService::RemoteServiceDiscovering);
+        discoverServiceDetails(service->uuid, mode);
+    }
+}
+
+void QLowEnergyControllerPrivate::updateAdvertisingData(
+        const QLowEnergyAdvertisingData &advertisingData,
+        const QLowEnergyAdvertisingData &scanResponseData)
+{
+    // Backends which cannot replace the data of a running advertisement restart it.
+    stopAdvertising();
+    startAdvertising(advertisingParameters, advertisingData, scanResponseData);
+}
+
+int QLowEnergyControllerPrivate::pendingWriteCommands(
+        const QLowEnergyServicePrivate * /* service */) const
+{
+    // write commands are handed to the platform right away
+    return 0;
+}
+
+void QLowEnergyControllerPrivate::writeCharacteristicsReliably(
+        const QSharedPointer<QLowEnergyServicePrivate> service,
+        const QList<QPair<QLowEnergyHandle, QByteArray>> & /* values */)
+{
+    qCWarning(QT_BT) << "Reliable writes are not supported on this platform";
+    service->setError(QLowEnergyService::CharacteristicWriteError);
+    emit service->reliableWriteFinished(false);
+}
+
+void QLowEnergyControllerPrivate::requestPhy(QLowEnergyController::Phys /* txPhys */,
+                                             QLowEnergyController::Phys /* rxPhys */)
+{
+    qCWarning(QT_BT) << "PHY selection is not supported on this platform";
+}
+
+void QLowEnergyControllerPrivate::requestDataLength(int /* maxTxOctets */)
+{
+    qCWarning(QT_BT) << "Data length selection is not supported on this platform";
+}
+
 QLowEnergyService *QLowEnergyControllerPrivate::addServiceHelper(
                             const QLowEnergyServiceData &service)
 {
@@ -52,10 +52,13 @@
 //
 
 #include <qglobal.h>
+#include <QtCore/qelapsedtimer.h>
 #include <QtCore/qobject.h>
 
+#include <QtBluetooth/qlowenergyadvertisingparameters.h>
 #include <QtBluetooth/qlowenergycontroller.h>
 
+#include "qlowenergyconnectiontrace_p.h"
 #include "qlowenergyserviceprivate_p.h"
 
 QT_BEGIN_NAMESPACE
@@ -74,6 +77,8 @@ public:
     QLowEnergyControllerPrivate();
     virtual ~QLowEnergyControllerPrivate();
 
+    static QLowEnergyControllerPrivate *get(QLowEnergyController *q) { return q->d_func(); }
+
     // interface definition
     virtual void init() = 0;
     virtual void connectToDevice() = 0;
@@ -82,6 +87,7 @@ public:
     virtual void discoverServices() = 0;
     virtual void discoverServiceDetails(const QBluetoothUuid &service,
                                         QLowEnergyService::DiscoveryMode mode) = 0;
+    virtual void discoverAllServiceDetails(QLowEnergyService::DiscoveryMode mode);
 
     virtual void readCharacteristic(
                         const QSharedPointer<QLowEnergyServicePrivate> service,
@@ -101,15 +107,24 @@ public:
                         const QLowEnergyHandle charHandle,
                         const QLowEnergyHandle descriptorHandle,
                         const QByteArray &newValue) = 0;
+    virtual int pendingWriteCommands(const QLowEnergyServicePrivate *service) const;
+    virtual void writeCharacteristicsReliably(
+                        const QSharedPointer<QLowEnergyServicePrivate> service,
+                        const QList<QPair<QLowEnergyHandle, QByteArray>> &values);
 
     virtual void startAdvertising(
                         const QLowEnergyAdvertisingParameters &params,
                         const QLowEnergyAdvertisingData &advertisingData,
                         const QLowEnergyAdvertisingData &scanResponseData) = 0;
     virtual void stopAdvertising() = 0;
+    virtual void updateAdvertisingData(const QLowEnergyAdvertisingData &advertisingData,
+                                       const QLowEnergyAdvertisingData &scanResponseData);
 
     virtual void requestConnectionUpdate(
                         const QLowEnergyConnectionParameters & params) = 0;
+    virtual void requestPhy(QLowEnergyController::Phys txPhys,
+                            QLowEnergyController::Phys rxPhys);
+    virtual void requestDataLength(int maxTxOctets);
     virtual void addToGenericAttributeList(
                         const QLowEnergyServiceData &service,
                         QLowEnergyHandle startHandle) = 0;
@@ -124,6 +139,14 @@ public:
     void setError(QLowEnergyController::Error newError);
     void setState(QLowEnergyController::ControllerState newState);
 
+    // connection trace, ATT traffic counts for the phase which began last
+    void beginTracePhase(QLowEnergyConnectionTrace::Phase phase);
+    void endTracePhase(QLowEnergyConnectionTrace::Phase phase);
+    void traceRetry();
+    void traceBytesSent(qsizetype size);
+    void traceBytesReceived(qsizetype size);
+    void traceRoundTrip();
+
     // public variables
     QLowEnergyController::Role role;
     QLowEnergyController::RemoteAddressType addressType;
@@ -132,6 +155,12 @@ public:
     ServiceDataMap serviceList;
     // list of all found service uuids on local peripheral device
     ServiceDataMap localServices;
+    // parameters of the most recent startAdvertising() call
+    QLowEnergyAdvertisingParameters advertisingParameters;
+    // ATT MTU requested from or offered to the remote device
+    int preferredMtu = 512;
+    // restarted by each connection attempt
+    QLowEnergyConnectionTrace connectionTrace;
 
     //common helper functions
     QSharedPointer<QLowEnergyServicePrivate> serviceForHandle(QLowEnergyHandle handle);
@@ -161,6 +190,11 @@ protected:
 
     Q_DECLARE_PUBLIC(QLowEnergyController)
     QLowEnergyController *q_ptr;
+
+private:
+    QLowEnergyConnectionTracePrivate::PhaseRecord *activeTraceRecord();
+
+    QElapsedTimer connectionTraceTimer;
 };
 
 QT_END_NAMESPACE
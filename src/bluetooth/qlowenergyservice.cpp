@@ -254,11 +254,71 @@ QT_BEGIN_NAMESPACE
     \value SkipValueDiscovery   During a minimal discovery, all characteristics
                                 are discovered. Characteristic values and
                                 descriptors are not read.
+    \value LazyValueDiscovery   All characteristics are discovered. Only the
+                                \l {QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration}
+                                {client characteristic configuration} and
+                                \l {QBluetoothUuid::DescriptorType::CharacteristicUserDescription}
+                                {user description} descriptors are read. A
+                                characteristic value is read when it is accessed
+                                for the first time and cached afterwards. The
+                                behavior for individual characteristics can be
+                                adjusted via \l setCharacteristicReadPolicy().
+                                On platforms which do not support selective
+                                reads during discovery, no descriptors are read,
+                                as in a \l SkipValueDiscovery.
+                                This value was introduced by Qt 6.2.
 
     \sa discoverDetails()
     \since 6.2
 */
 
+/*!
+    \enum QLowEnergyService::DiscoveryPriority
+
+    This enum describes how the detail discovery of a service is scheduled
+    relative to the detail discovery of other services of the same device.
+
+    \value LowPriority      The discovery only proceeds while no service with
+                            a higher priority is being discovered.
+    \value NormalPriority   The discovery is interleaved with the discovery of
+                            other services of the same priority. This is the
+                            default.
+    \value HighPriority     The discovery proceeds before the discovery of
+                            services with a lower priority.
+
+    Pending reads and writes are never overtaken by a discovery, regardless of
+    its priority. The priority is only honored by the BlueZ backend; on other
+    platforms the operating system schedules the discovery.
+
+    \sa discoverDetails()
+    \since 6.2
+*/
+
+/*!
+    \enum QLowEnergyService::CharacteristicReadPolicy
+
+    This enum describes when the value of a characteristic is read during a
+    \l LazyValueDiscovery. The policy has no effect on the other discovery
+    modes.
+
+    \value ReadOnFirstAccess    The value is read when
+                                \l QLowEnergyCharacteristic::value() is called
+                                for the first time. Until the read completes,
+                                \l QLowEnergyCharacteristic::value() returns an
+                                empty value; completion is indicated by the
+                                \l characteristicRead() signal. If the read
+                                fails, \l CharacteristicReadError is set and
+                                the next access reads the value again. This
+                                is the default.
+    \value ReadDuringDiscovery  The value is read while the service details are
+                                discovered, as in a \l FullDiscovery.
+    \value ReadOnRequest        The value is only read when
+                                \l readCharacteristic() is called.
+
+    \sa setCharacteristicReadPolicy()
+    \since 6.2
+*/
+
 /*!
   \enum QLowEnergyService::WriteMode
 
@@ -315,6 +375,47 @@ QT_BEGIN_NAMESPACE
     \since 6.2
  */
 
+/*!
+    \fn void QLowEnergyService::discoveryProgress(int roundTrips)
+
+    This signal is emitted while the details of the service are discovered,
+    each time a response to a discovery request was received from the remote
+    device. \a roundTrips is the number of request/response round trips the
+    discovery of this service has needed so far.
+
+    Together with the \l stateChanged() signal announcing
+    \l RemoteServiceDiscovered, this permits profiling how long it takes
+    until a service becomes usable. The signal is only emitted by the BlueZ
+    backend.
+
+    \sa discoverDetails()
+    \since 6.2
+ */
+
+/*!
+    \fn void QLowEnergyService::writeQueueDrained()
+
+    This signal is emitted when the last queued \l WriteWithoutResponse or
+    \l WriteSigned write of this service was handed to the link, which means
+    \l pendingWrites() dropped to \c 0.
+
+    \sa writeCharacteristic()
+    \since 6.2
+ */
+
+/*!
+    \fn void QLowEnergyService::reliableWriteFinished(bool success)
+
+    This signal is emitted when a reliable write started by
+    \l commitReliableWrite() finished. If \a success is \c true, all values were
+    written and \l characteristicWritten() was emitted for each of them before
+    this signal. Otherwise none of the values was written and
+    \l CharacteristicWriteError is set.
+
+    \sa beginReliableWrite()
+    \since 6.2
+ */
+
 /*!
     \fn void QLowEnergyService::characteristicRead(const QLowEnergyCharacteristic &characteristic, const QByteArray &value)
 
@@ -425,6 +526,12 @@ QLowEnergyService::QLowEnergyService(QSharedPointer<QLowEnergyServicePrivate> p,
             this, &QLowEnergyService::characteristicRead);
     connect(p.data(), &QLowEnergyServicePrivate::descriptorRead,
             this, &QLowEnergyService::descriptorRead);
+    connect(p.data(), &QLowEnergyServicePrivate::discoveryProgress,
+            this, &QLowEnergyService::discoveryProgress);
+    connect(p.data(), &QLowEnergyServicePrivate::writeQueueDrained,
+            this, &QLowEnergyService::writeQueueDrained);
+    connect(p.data(), &QLowEnergyServicePrivate::reliableWriteFinished,
+            this, &QLowEnergyService::reliableWriteFinished);
 }
 
 /*!
@@ -602,12 +709,21 @@ QString QLowEnergyService::serviceName() const
     \l readCharacteristic() / \l readDescriptor() and wait for them to
     finish successfully before accessing the value of a characteristic or
     descriptor.
+    A \l LazyValueDiscovery only reads the descriptors which are needed to
+    manage notifications and defers reading characteristic values until
+    they are accessed; see \l CharacteristicReadPolicy.
+
+    The \a priority determines the order in which the discoveries of several
+    services proceed when discoverDetails() is called for more than one
+    service of the same device. A service which the application needs first
+    should be discovered with \l HighPriority. The progress of the discovery
+    is reported via the \l discoveryProgress() signal.
 
-    The argument \a mode was introduced in Qt 6.2.
+    The arguments \a mode and \a priority were introduced in Qt 6.2.
 
     \sa state()
  */
-void QLowEnergyService::discoverDetails(DiscoveryMode mode)
+void QLowEnergyService::discoverDetails(DiscoveryMode mode, DiscoveryPriority priority)
 {
     Q_D(QLowEnergyService);
 
@@ -619,11 +735,47 @@ void QLowEnergyService::discoverDetails(DiscoveryMode mode)
     if (d->state != QLowEnergyService::RemoteService)
         return;
 
+    d->priority = priority;
     d->setState(QLowEnergyService::RemoteServiceDiscovering);
 
     d->controller->discoverServiceDetails(d->uuid, mode);
 }
 
+/*!
+    Sets the read \a policy for all characteristics of this service with
+    the given \a characteristicUuid.
+
+    The policy only applies to a \l LazyValueDiscovery. It should be set
+    before \l discoverDetails() is called, since characteristics with the
+    \l ReadDuringDiscovery policy are read as part of the discovery.
+
+    \sa characteristicReadPolicy()
+    \since 6.2
+ */
+void QLowEnergyService::setCharacteristicReadPolicy(const QBluetoothUuid &characteristicUuid,
+                                                    CharacteristicReadPolicy policy)
+{
+    Q_D(QLowEnergyService);
+
+    if (policy == ReadOnFirstAccess)
+        d->readPolicies.remove(characteristicUuid);
+    else
+        d->readPolicies.insert(characteristicUuid, policy);
+}
+
+/*!
+    Returns the read policy for characteristics with the given
+    \a characteristicUuid. The default is \l ReadOnFirstAccess.
+
+    \sa setCharacteristicReadPolicy()
+    \since 6.2
+ */
+QLowEnergyService::CharacteristicReadPolicy
+QLowEnergyService::characteristicReadPolicy(const QBluetoothUuid &characteristicUuid) const
+{
+    return d_ptr->readPolicies.value(characteristicUuid, ReadOnFirstAccess);
+}
+
 /*!
     Returns the last occurred error or \l NoError.
  */
@@ -713,8 +865,8 @@ void QLowEnergyService::readCharacteristic(
     For example, if the same descriptor is set to the value A and immediately afterwards
     to B, the two write request are executed in the given order.
 
-    \note Currently, it is not possible to use signed or reliable writes as defined by the
-    Bluetooth specification.
+    Between \l beginReliableWrite() and \l commitReliableWrite(), writes in the
+    \l WriteWithResponse mode are not sent right away but become part of the reliable write.
 
     A characteristic can only be written if this service is in the \l ServiceDiscovered state
     and belongs to the service. If one of these conditions is
@@ -741,6 +893,16 @@ void QLowEnergyService::readCharacteristic(
 
     \note The \a mode argument is ignored in peripheral mode.
 
+    \b {Write commands}
+
+    A \l WriteWithoutResponse or \l WriteSigned is not confirmed by the remote device.
+    When the link cannot take further packets, such writes are queued and sent as soon
+    as the link is ready again; \l pendingWrites() returns their number and
+    \l writeQueueDrained() is emitted once all of them were sent. Applications streaming
+    large amounts of data should stop writing while \l pendingWrites() is non-zero and
+    continue once \l writeQueueDrained() is emitted. At most 128 write commands are
+    queued per controller; further writes are rejected with the \l OperationError.
+
     \sa QLowEnergyService::characteristicWritten(), QLowEnergyService::readCharacteristic()
 
  */
@@ -759,6 +921,11 @@ void QLowEnergyService::writeCharacteristic(
         return;
     }
 
+    if (d->reliableWriteOpen && mode == WriteWithResponse) {
+        d->reliableWrites.append(qMakePair(characteristic.attributeHandle(), newValue));
+        return;
+    }
+
     // don't write if properties don't permit it
     d->controller->writeCharacteristic(characteristic.d_ptr,
                                        characteristic.attributeHandle(),
@@ -766,6 +933,161 @@ void QLowEnergyService::writeCharacteristic(
                                        mode);
 }
 
+/*!
+    Returns the number of \l WriteWithoutResponse and \l WriteSigned writes of this
+    service which are queued because the link to the remote device could not take
+    them yet.
+
+    Only the BlueZ backend queues such writes; on other platforms the function
+    always returns \c 0.
+
+    \sa writeQueueDrained(), writeCharacteristic()
+    \since 6.2
+ */
+int QLowEnergyService::pendingWrites() const
+{
+    if (!d_ptr->controller)
+        return 0;
+    return d_ptr->controller->pendingWriteCommands(d_ptr.data());
+}
+
+/*!
+    Starts a reliable write. The values of the following \l writeCharacteristic()
+    calls in the \l WriteWithResponse mode are collected until
+    \l commitReliableWrite() writes all of them at once, or
+    \l abortReliableWrite() discards them.
+
+    In the central role, the values are sent to the remote device with Prepare
+    Write Requests and applied by a single Execute Write Request. The remote
+    device either applies all of them or none, and it only needs to check their
+    consistency once. In the peripheral role, the values are applied to the
+    local database together.
+
+    Only one reliable write can be open per service. If one is already open, or
+    if the service could not be written with \l writeCharacteristic(), the
+    \l OperationError is set.
+
+    Reliable writes are supported by the BlueZ backends. The BlueZ DBus
+    backend, which is used for the central role with bluetoothd 5.42 or newer,
+    cannot apply several values atomically. It only commits reliable writes of
+    a single value and sets the \l OperationError for more values. This
+    requires bluetoothd 5.50 or newer.
+    Other platforms report a \l CharacteristicWriteError when the write is
+    committed.
+
+    \sa reliableWriteFinished(), isReliableWriteOpen()
+    \since 6.2
+ */
+void QLowEnergyService::beginReliableWrite()
+{
+    Q_D(QLowEnergyService);
+
+    if (d->controller == nullptr || d->reliableWriteOpen
+            || (d->controller->role == QLowEnergyController::CentralRole
+                && state() != RemoteServiceDiscovered)) {
+        d->setError(QLowEnergyService::OperationError);
+        return;
+    }
+
+    d->reliableWriteOpen = true;
+    d->reliableWrites.clear();
+}
+
+/*!
+    Writes all values collected since \l beginReliableWrite(). The
+    \l reliableWriteFinished() signal reports the outcome. Committing an empty
+    reliable write succeeds right away.
+
+    If no reliable write is open, or the service can no longer be written, the
+    \l OperationError is set.
+
+    \sa abortReliableWrite()
+    \since 6.2
+ */
+void QLowEnergyService::commitReliableWrite()
+{
+    Q_D(QLowEnergyService);
+
+    if (!d->reliableWriteOpen) {
+        d->setError(QLowEnergyService::OperationError);
+        return;
+    }
+    d->reliableWriteOpen = false;
+    const QList<QPair<QLowEnergyHandle, QByteArray>> values = std::move(d->reliableWrites);
+    d->reliableWrites.clear();
+
+    if (d->controller == nullptr
+            || (d->controller->role == QLowEnergyController::CentralRole
+                && state() != RemoteServiceDiscovered)) {
+        d->setError(QLowEnergyService::OperationError);
+        return;
+    }
+
+    if (values.isEmpty()) {
+        emit d->reliableWriteFinished(true);
+        return;
+    }
+    d->controller->writeCharacteristicsReliably(d_ptr, values);
+}
+
+/*!
+    Discards the values collected since \l beginReliableWrite(). A reliable write
+    which was committed already cannot be aborted.
+
+    \sa commitReliableWrite()
+    \since 6.2
+ */
+void QLowEnergyService::abortReliableWrite()
+{
+    Q_D(QLowEnergyService);
+
+    d->reliableWriteOpen = false;
+    d->reliableWrites.clear();
+}
+
+/*!
+    Returns \c true if \l beginReliableWrite() was called and the reliable write was
+    neither committed nor aborted yet; otherwise \c false.
+
+    \since 6.2
+ */
+bool QLowEnergyService::isReliableWriteOpen() const
+{
+    return d_ptr->reliableWriteOpen;
+}
+
+/*!
+    Returns the number of value updates of this service's characteristics which
+    were coalesced into an already queued notification or indication.
+
+    Only characteristics for which
+    \l {QLowEnergyCharacteristicData::setUpdateCoalescingEnabled()}{coalescing}
+    is enabled are coalesced. The counter applies to the peripheral role on BlueZ.
+
+    \sa droppedUpdates()
+    \since 6.2
+ */
+int QLowEnergyService::coalescedUpdates() const
+{
+    return d_ptr->coalescedUpdates;
+}
+
+/*!
+    Returns the number of value updates of this service's characteristics which
+    were not sent to the connected client, because too many notifications or
+    indications were queued already. At most 64 notifications and 64 indications
+    are queued per controller.
+
+    The counter applies to the peripheral role on BlueZ.
+
+    \sa coalescedUpdates()
+    \since 6.2
+ */
+int QLowEnergyService::droppedUpdates() const
+{
+    return d_ptr->droppedUpdates;
+}
+
 /*!
     Returns \c true if \a descriptor belongs to this service; otherwise \c false.
  */
@@ -96,10 +96,25 @@ public:
 
     enum DiscoveryMode {
         FullDiscovery,      // standard, reads all attributes
-        SkipValueDiscovery  // does not read characteristic values and descriptors
+        SkipValueDiscovery, // does not read characteristic values and descriptors
+        LazyValueDiscovery  // reads configuration descriptors, values on first access
     };
     Q_ENUM(DiscoveryMode)
 
+    enum DiscoveryPriority {
+        LowPriority,
+        NormalPriority,
+        HighPriority
+    };
+    Q_ENUM(DiscoveryPriority)
+
+    enum CharacteristicReadPolicy {
+        ReadOnFirstAccess,
+        ReadDuringDiscovery,
+        ReadOnRequest
+    };
+    Q_ENUM(CharacteristicReadPolicy)
+
     enum WriteMode {
         WriteWithResponse = 0,
         WriteWithoutResponse,
@@ -119,7 +134,12 @@ public:
     QBluetoothUuid serviceUuid() const;
     QString serviceName() const;
 
-    void discoverDetails(DiscoveryMode mode = FullDiscovery);
+    void discoverDetails(DiscoveryMode mode = FullDiscovery,
+                         DiscoveryPriority priority = NormalPriority);
+
+    void setCharacteristicReadPolicy(const QBluetoothUuid &characteristicUuid,
+                                     CharacteristicReadPolicy policy);
+    CharacteristicReadPolicy characteristicReadPolicy(const QBluetoothUuid &characteristicUuid) const;
 
     ServiceError error() const;
 
@@ -128,6 +148,13 @@ public:
     void writeCharacteristic(const QLowEnergyCharacteristic &characteristic,
                              const QByteArray &newValue,
                              WriteMode mode = WriteWithResponse);
+    int pendingWrites() const;
+    void beginReliableWrite();
+    void commitReliableWrite();
+    void abortReliableWrite();
+    bool isReliableWriteOpen() const;
+    int coalescedUpdates() const;
+    int droppedUpdates() const;
 
     bool contains(const QLowEnergyDescriptor &descriptor) const;
     void readDescriptor(const QLowEnergyDescriptor &descriptor);
@@ -147,6 +174,9 @@ Q_SIGNALS:
     void descriptorWritten(const QLowEnergyDescriptor &info,
                            const QByteArray &value);
     void errorOccurred(QLowEnergyService::ServiceError error);
+    void discoveryProgress(int roundTrips);
+    void writeQueueDrained();
+    void reliableWriteFinished(bool success);
 
 private:
     Q_DECLARE_PRIVATE(QLowEnergyService)
@@ -61,6 +61,16 @@ void QLowEnergyServicePrivate::setController(QLowEnergyControllerPrivate *contro
 
 void QLowEnergyServicePrivate::setError(QLowEnergyService::ServiceError newError)
 {
+    if (newError == QLowEnergyService::CharacteristicReadError) {
+        // the next access retries the lazy reads
+        for (const QLowEnergyHandle handle : qAsConst(lazyValueReads)) {
+            const auto it = characteristicList.find(handle);
+            if (it != characteristicList.end())
+                it->valueRequested = false;
+        }
+        lazyValueReads.clear();
+    }
+
     lastError = newError;
     emit errorOccurred(newError);
 }
@@ -70,8 +80,110 @@ void QLowEnergyServicePrivate::setState(QLowEnergyService::ServiceState newState
     if (state == newState)
         return;
 
+    const QLowEnergyService::ServiceState oldState = state;
     state = newState;
+    if (controller) {
+        if (newState == QLowEnergyService::RemoteServiceDiscovering)
+            controller->beginTracePhase(QLowEnergyConnectionTrace::ServiceDetailsDiscoveryPhase);
+        else if (oldState == QLowEnergyService::RemoteServiceDiscovering)
+            controller->endTracePhase(QLowEnergyConnectionTrace::ServiceDetailsDiscoveryPhase);
+    }
     emit stateChanged(newState);
 }
 
+bool QLowEnergyServicePrivate::readsValueDuringDiscovery(
+        QLowEnergyService::DiscoveryMode mode, const CharacteristicReadPolicyMap &policies,
+        const QBluetoothUuid &characteristicUuid)
+{
+    switch (mode) {
+    case QLowEnergyService::FullDiscovery:
+        return true;
+    case QLowEnergyService::SkipValueDiscovery:
+        return false;
+    case QLowEnergyService::LazyValueDiscovery:
+        return policies.value(characteristicUuid, QLowEnergyService::ReadOnFirstAccess)
+                == QLowEnergyService::ReadDuringDiscovery;
+    }
+    return true;
+}
+
+bool QLowEnergyServicePrivate::readsDescriptorDuringDiscovery(
+        QLowEnergyService::DiscoveryMode mode, const QBluetoothUuid &descriptorUuid)
+{
+    switch (mode) {
+    case QLowEnergyService::FullDiscovery:
+        return true;
+    case QLowEnergyService::SkipValueDiscovery:
+        return false;
+    case QLowEnergyService::LazyValueDiscovery:
+        // required to manage notifications and to present the characteristic
+        return descriptorUuid == QBluetoothUuid(
+                           QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration)
+                || descriptorUuid == QBluetoothUuid(
+                           QBluetoothUuid::DescriptorType::CharacteristicUserDescription);
+    }
+    return true;
+}
+
+/*
+    Returns \c true if accessing the value of \a characteristic should
+    trigger a read from the remote device.
+ */
+bool QLowEnergyServicePrivate::readsValueOnAccess(const CharData &characteristic) const
+{
+    if (mode != QLowEnergyService::LazyValueDiscovery
+            || state != QLowEnergyService::RemoteServiceDiscovered || !controller) {
+        return false;
+    }
+
+    if (characteristic.valueRequested
+            || !(characteristic.properties & QLowEnergyCharacteristic::Read)) {
+        return false;
+    }
+
+    return readPolicies.value(characteristic.uuid, QLowEnergyService::ReadOnFirstAccess)
+            == QLowEnergyService::ReadOnFirstAccess;
+}
+
+/*
+    Schedules the lazy read of the characteristic at \a characteristicHandle.
+    QLowEnergyCharacteristic::value() is const, the read request is sent
+    from the event loop.
+ */
+void QLowEnergyServicePrivate::requestValueRead(QLowEnergyHandle characteristicHandle)
+{
+    const auto it = characteristicList.find(characteristicHandle);
+    if (it == characteristicList.end() || it->valueRequested)
+        return;
+
+    it->valueRequested = true;
+    lazyValueReads.insert(characteristicHandle);
+    QMetaObject::invokeMethod(this, [this, characteristicHandle]() {
+        startValueRead(characteristicHandle);
+    }, Qt::QueuedConnection);
+}
+
+void QLowEnergyServicePrivate::startValueRead(QLowEnergyHandle characteristicHandle)
+{
+    // the read failed or was answered in the meantime
+    if (!lazyValueReads.contains(characteristicHandle))
+        return;
+
+    // same checks as QLowEnergyService::readCharacteristic()
+    const auto it = characteristicList.find(characteristicHandle);
+    QSharedPointer<QLowEnergyServicePrivate> service;
+    if (controller && state == QLowEnergyService::RemoteServiceDiscovered)
+        service = controller->serviceForHandle(characteristicHandle);
+
+    if (service.data() != this || it == characteristicList.end()
+            || !(it->properties & QLowEnergyCharacteristic::Read)) {
+        lazyValueReads.remove(characteristicHandle);
+        if (it != characteristicList.end())
+            it->valueRequested = false;
+        return;
+    }
+
+    controller->readCharacteristic(service, characteristicHandle);
+}
+
 QT_END_NAMESPACE
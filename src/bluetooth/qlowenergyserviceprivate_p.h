@@ -52,7 +52,9 @@
 //
 
 #include <QtCore/QObject>
+#include <QtCore/QPair>
 #include <QtCore/QPointer>
+#include <QtCore/QSet>
 #include <QtBluetooth/qbluetooth.h>
 #include <QtBluetooth/QLowEnergyService>
 #include <QtBluetooth/QLowEnergyCharacteristic>
@@ -65,6 +67,8 @@ QT_BEGIN_NAMESPACE
 
 class QLowEnergyControllerPrivate;
 
+typedef QHash<QBluetoothUuid, QLowEnergyService::CharacteristicReadPolicy> CharacteristicReadPolicyMap;
+
 class QLowEnergyServicePrivate : public QObject
 {
     Q_OBJECT
@@ -83,6 +87,8 @@ public:
         QLowEnergyCharacteristic::PropertyTypes properties;
         QByteArray value;
         QHash<QLowEnergyHandle, DescData> descriptorList;
+        // set once a value was read or requested; prevents repeated lazy reads
+        bool valueRequested = false;
     };
 
     enum GattAttributeTypes {
@@ -96,6 +102,17 @@ public:
     void setError(QLowEnergyService::ServiceError newError);
     void setState(QLowEnergyService::ServiceState newState);
 
+    static bool readsValueDuringDiscovery(QLowEnergyService::DiscoveryMode mode,
+                                          const CharacteristicReadPolicyMap &policies,
+                                          const QBluetoothUuid &characteristicUuid);
+    static bool readsDescriptorDuringDiscovery(QLowEnergyService::DiscoveryMode mode,
+                                               const QBluetoothUuid &descriptorUuid);
+    bool readsValueOnAccess(const CharData &characteristic) const;
+    void requestValueRead(QLowEnergyHandle characteristicHandle);
+
+private:
+    void startValueRead(QLowEnergyHandle characteristicHandle);
+
 signals:
     void stateChanged(QLowEnergyService::ServiceState newState);
     void errorOccurred(QLowEnergyService::ServiceError error);
@@ -109,6 +126,9 @@ signals:
                         const QByteArray &value);
     void descriptorWritten(const QLowEnergyDescriptor &descriptor,
                            const QByteArray &newValue);
+    void discoveryProgress(int roundTrips);
+    void writeQueueDrained();
+    void reliableWriteFinished(bool success);
 
 public:
     QLowEnergyHandle startHandle = 0;
@@ -120,6 +140,18 @@ public:
     QLowEnergyService::ServiceState state = QLowEnergyService::InvalidService;
     QLowEnergyService::ServiceError lastError = QLowEnergyService::NoError;
     QLowEnergyService::DiscoveryMode mode = QLowEnergyService::FullDiscovery;
+    QLowEnergyService::DiscoveryPriority priority = QLowEnergyService::NormalPriority;
+    // number of request/response pairs used by the current detail discovery
+    int discoveryRoundTrips = 0;
+    // notifications and indications which were merged or not sent, peripheral role only
+    int coalescedUpdates = 0;
+    int droppedUpdates = 0;
+    // values collected between beginReliableWrite() and commitReliableWrite()
+    bool reliableWriteOpen = false;
+    QList<QPair<QLowEnergyHandle, QByteArray>> reliableWrites;
+    CharacteristicReadPolicyMap readPolicies;
+    // characteristics whose value was accessed and is being read lazily
+    QSet<QLowEnergyHandle> lazyValueReads;
 
     QHash<QLowEnergyHandle, CharData> characteristicList;
 
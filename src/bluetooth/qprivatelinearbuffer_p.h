@@ -70,6 +70,9 @@ public:
     bool isEmpty() const {
         return len == 0;
     }
+    const char* readPointer() const {
+        return first;
+    }
     void skip(int n) {
         if (n >= len) {
             clear();
@@ -0,0 +1,73 @@
+/*
+ * This file was generated by qdbusxml2cpp version 0.8
+ * Command line was: qdbusxml2cpp -N -p adapter_p.h:adapter.cpp org.neard.Adapter.xml
+ *
+ * qdbusxml2cpp is Copyright (C) 2020 The Qt Company Ltd.
+ *
+ * This is an auto-generated file.
+ * Do not edit! All changes made to it will be lost.
+ */
+
+#ifndef ADAPTER_P_H
+#define ADAPTER_P_H
+
+#include <QtCore/QObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVariant>
+#include <QtDBus/QtDBus>
+
+/*
+ * Proxy class for interface org.neard.Adapter
+ */
+class OrgNeardAdapterInterface: public QDBusAbstractInterface
+{
+    Q_OBJECT
+public:
+    static inline const char *staticInterfaceName()
+    { return "org.neard.Adapter"; }
+
+public:
+    OrgNeardAdapterInterface(const QString &service, const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
+
+    ~OrgNeardAdapterInterface();
+
+    Q_PROPERTY(QString Mode READ mode)
+    inline QString mode() const
+    { return qvariant_cast< QString >(property("Mode")); }
+
+    Q_PROPERTY(bool Polling READ polling)
+    inline bool polling() const
+    { return qvariant_cast< bool >(property("Polling")); }
+
+    Q_PROPERTY(bool Powered READ powered WRITE setPowered)
+    inline bool powered() const
+    { return qvariant_cast< bool >(property("Powered")); }
+    inline void setPowered(bool value)
+    { setProperty("Powered", QVariant::fromValue(value)); }
+
+    Q_PROPERTY(QStringList Protocols READ protocols)
+    inline QStringList protocols() const
+    { return qvariant_cast< QStringList >(property("Protocols")); }
+
+public Q_SLOTS: // METHODS
+    inline QDBusPendingReply<> StartPollLoop(const QString &mode)
+    {
+        QList<QVariant> argumentList;
+        argumentList << QVariant::fromValue(mode);
+        return asyncCallWithArgumentList(QStringLiteral("StartPollLoop"), argumentList);
+    }
+
+    inline QDBusPendingReply<> StopPollLoop()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QStringLiteral("StopPollLoop"), argumentList);
+    }
+
+Q_SIGNALS: // SIGNALS
+};
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * This file was generated by qdbusxml2cpp version 0.8
+ * Command line was: qdbusxml2cpp -N -c NeardPropertiesInterface -p properties_p.h:properties.cpp org.freedesktop.dbus.properties.xml
+ *
+ * qdbusxml2cpp is Copyright (C) 2020 The Qt Company Ltd.
+ *
+ * This is an auto-generated file.
+ * This file may have been hand-edited. Look for HAND-EDIT comments
+ * before re-generating it.
+ */
+
+#include "properties_p.h"
+
+/*
+ * Implementation of interface class NeardPropertiesInterface
+ */
+
+NeardPropertiesInterface::NeardPropertiesInterface(const QString &service, const QString &path, const QDBusConnection &connection, QObject *parent)
+    : QDBusAbstractInterface(service, path, staticInterfaceName(), connection, parent)
+{
+}
+
+NeardPropertiesInterface::~NeardPropertiesInterface()
+{
+}
+
@@ -0,0 +1,71 @@
+/*
+ * This file was generated by qdbusxml2cpp version 0.8
+ * Command line was: qdbusxml2cpp -N -p tag_p.h:tag.cpp org.neard.Tag.xml
+ *
+ * qdbusxml2cpp is Copyright (C) 2020 The Qt Company Ltd.
+ *
+ * This is an auto-generated file.
+ * Do not edit! All changes made to it will be lost.
+ */
+
+#ifndef TAG_P_H
+#define TAG_P_H
+
+#include <QtCore/QObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVariant>
+#include <QtDBus/QtDBus>
+
+/*
+ * Proxy class for interface org.neard.Tag
+ */
+class OrgNeardTagInterface: public QDBusAbstractInterface
+{
+    Q_OBJECT
+public:
+    static inline const char *staticInterfaceName()
+    { return "org.neard.Tag"; }
+
+public:
+    OrgNeardTagInterface(const QString &service, const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
+
+    ~OrgNeardTagInterface();
+
+    Q_PROPERTY(QDBusObjectPath Adapter READ adapter)
+    inline QDBusObjectPath adapter() const
+    { return qvariant_cast< QDBusObjectPath >(property("Adapter")); }
+
+    Q_PROPERTY(QString Protocol READ protocol)
+    inline QString protocol() const
+    { return qvariant_cast< QString >(property("Protocol")); }
+
+    Q_PROPERTY(bool ReadOnly READ readOnly)
+    inline bool readOnly() const
+    { return qvariant_cast< bool >(property("ReadOnly")); }
+
+    Q_PROPERTY(QString Type READ type)
+    inline QString type() const
+    { return qvariant_cast< QString >(property("Type")); }
+
+public Q_SLOTS: // METHODS
+    inline QDBusPendingReply<QByteArray> GetRawNDEF()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QStringLiteral("GetRawNDEF"), argumentList);
+    }
+
+    inline QDBusPendingReply<> Write(const QVariantMap &attributes)
+    {
+        QList<QVariant> argumentList;
+        argumentList << QVariant::fromValue(attributes);
+        return asyncCallWithArgumentList(QStringLiteral("Write"), argumentList);
+    }
+
+Q_SIGNALS: // SIGNALS
+};
+
+#endif
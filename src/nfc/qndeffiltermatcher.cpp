@@ -0,0 +1,299 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qndeffiltermatcher_p.h"
+#include "qndefmessage.h"
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+/*
+    QNdefCompiledFilter is the preprocessed form of a QNdefFilter, as used by
+    QNdefFilter::match() and QNdefFilterMatcher.
+
+    Compiling a filter joins equal filter records once, following the rules
+    described in the QNdefFilter documentation, and replaces every distinct
+    type name format and type pair by an integer key from a
+    QNdefRecordClassTable. Matching a message then only needs one hash lookup
+    per message record to classify it. All further work is done on integers.
+
+    QNdefFilterMatcher shares one QNdefRecordClassTable between all its
+    filters, so that a message is classified only once, no matter how many
+    filters it is evaluated against.
+*/
+
+int QNdefRecordClassTable::insert(QNdefRecord::TypeNameFormat typeNameFormat,
+                                  const QByteArray &type)
+{
+    const auto key = qMakePair(int(typeNameFormat), type);
+    const auto it = m_keys.constFind(key);
+    if (it != m_keys.cend())
+        return it.value();
+
+    const int value = int(m_keys.size());
+    m_keys.insert(key, value);
+    return value;
+}
+
+int QNdefRecordClassTable::lookup(QNdefRecord::TypeNameFormat typeNameFormat,
+                                  const QByteArray &type) const
+{
+    return m_keys.value(qMakePair(int(typeNameFormat), type), -1);
+}
+
+void QNdefRecordClassTable::classify(const QNdefMessage &message,
+                                     QNdefRecordClassList *classes) const
+{
+    classes->clear();
+    classes->reserve(message.size());
+    for (const QNdefRecord &record : message) {
+        const QNdefRecord::TypeNameFormat typeNameFormat = record.typeNameFormat();
+        classes->append({ lookup(typeNameFormat, record.type()), quint8(typeNameFormat) });
+    }
+}
+
+QNdefCompiledFilter::QNdefCompiledFilter()
+{
+    std::fill(std::begin(m_wildcardRule), std::end(m_wildcardRule), -1);
+}
+
+void QNdefCompiledFilter::compile(const QList<QNdefFilter::Record> &records, bool orderMatch,
+                                  QNdefRecordClassTable *classes)
+{
+    m_rules.clear();
+    m_ruleForKey.clear();
+    std::fill(std::begin(m_wildcardRule), std::end(m_wildcardRule), -1);
+    m_minimumTotal = 0;
+    m_maximumTotal = 0;
+    m_orderMatch = orderMatch;
+
+    for (const QNdefFilter::Record &record : records) {
+        const int key = classes->insert(record.typeNameFormat, record.type);
+
+        if (m_orderMatch) {
+            // Only consecutive equal records can be joined.
+            if (!m_rules.isEmpty() && m_rules.last().key == key) {
+                m_rules.last().minimum += record.minimum;
+                m_rules.last().maximum += record.maximum;
+                continue;
+            }
+        } else {
+            // All equal records are joined.
+            if (key < m_ruleForKey.size() && m_ruleForKey.at(key) >= 0) {
+                Rule &rule = m_rules[m_ruleForKey.at(key)];
+                rule.minimum += record.minimum;
+                rule.maximum += record.maximum;
+                continue;
+            }
+            if (key >= m_ruleForKey.size())
+                m_ruleForKey.resize(key + 1, -1);
+            m_ruleForKey[key] = int(m_rules.size());
+            if (record.type.isEmpty())
+                m_wildcardRule[record.typeNameFormat & 0x07] = int(m_rules.size());
+        }
+
+        m_rules.append({ key, quint8(record.typeNameFormat), record.type.isEmpty(),
+                         record.minimum, record.maximum });
+    }
+
+    for (const Rule &rule : qAsConst(m_rules)) {
+        m_minimumTotal += rule.minimum;
+        m_maximumTotal += rule.maximum;
+    }
+}
+
+bool QNdefCompiledFilter::match(const QNdefRecordClass *records, qsizetype count) const
+{
+    // empty filter matches only empty message
+    if (m_rules.isEmpty())
+        return count == 0;
+
+    // Every message record has to be covered by exactly one filter record.
+    if (quint64(count) < m_minimumTotal || quint64(count) > m_maximumTotal)
+        return false;
+
+    return m_orderMatch ? matchOrdered(records, count) : matchUnordered(records, count);
+}
+
+bool QNdefCompiledFilter::matchUnordered(const QNdefRecordClass *records, qsizetype count) const
+{
+    QVarLengthArray<unsigned int, 16> counts(m_rules.size());
+    std::fill(counts.begin(), counts.end(), 0u);
+
+    for (qsizetype i = 0; i < count; ++i) {
+        const QNdefRecordClass &record = records[i];
+        int rule = -1;
+        if (record.key >= 0 && record.key < m_ruleForKey.size())
+            rule = m_ruleForKey.at(record.key);
+        // Do not forget that we handle an empty type as "any type".
+        if (rule < 0)
+            rule = m_wildcardRule[record.typeNameFormat & 0x07];
+        // The record does not match any record from the filter.
+        if (rule < 0)
+            return false;
+        ++counts[rule];
+    }
+
+    for (qsizetype i = 0; i < m_rules.size(); ++i) {
+        const Rule &rule = m_rules.at(i);
+        if (counts[i] < rule.minimum || counts[i] > rule.maximum)
+            return false;
+    }
+    return true;
+}
+
+bool QNdefCompiledFilter::matchOrdered(const QNdefRecordClass *records, qsizetype count) const
+{
+    QVarLengthArray<unsigned int, 16> counts(m_rules.size());
+    std::fill(counts.begin(), counts.end(), 0u);
+
+    qsizetype filterIndex = 0;
+    for (qsizetype messageIndex = 0; messageIndex < count; ++messageIndex) {
+        const QNdefRecordClass &record = records[messageIndex];
+        // Try to find a filter record that matches the message record.
+        // We start from the last processed filter record, not from the very
+        // beginning (because the order matters).
+        qsizetype idx = filterIndex;
+        for (; idx < m_rules.size(); ++idx) {
+            const Rule &rule = m_rules.at(idx);
+            if (rule.typeNameFormat == record.typeNameFormat
+                && (rule.wildcard || rule.key == record.key)) {
+                ++counts[idx];
+                break;
+            } else if (counts[idx] < rule.minimum || counts[idx] > rule.maximum) {
+                // The current message record does not match the current
+                // filter record, but we didn't get enough records to
+                // fulfill the filter => that's an error.
+                return false;
+            }
+        }
+        filterIndex = idx;
+    }
+
+    qsizetype totalCount = 0;
+    for (qsizetype i = 0; i < m_rules.size(); ++i) {
+        const Rule &rule = m_rules.at(i);
+        totalCount += counts[i];
+        if (counts[i] < rule.minimum || counts[i] > rule.maximum)
+            return false;
+    }
+
+    // Records that do not match any record from the filter are not counted.
+    return totalCount == count;
+}
+
+/*
+    Compiles \a filter and registers it with the matcher. \a handler is
+    invoked by dispatch() for every message matching the filter.
+
+    Returns an identifier that can be passed to removeFilter().
+*/
+int QNdefFilterMatcher::addFilter(const QNdefFilter &filter, const Handler &handler)
+{
+    QList<QNdefFilter::Record> records;
+    records.reserve(filter.recordCount());
+    for (qsizetype i = 0; i < filter.recordCount(); ++i)
+        records.append(filter.recordAt(i));
+
+    Entry entry { m_nextId++, QNdefCompiledFilter(), handler };
+    entry.filter.compile(records, filter.orderMatch(), &m_classes);
+    m_entries.append(entry);
+    return entry.id;
+}
+
+/*
+    Removes the filter with the identifier \a id. Returns \c true if such a
+    filter was registered.
+*/
+bool QNdefFilterMatcher::removeFilter(int id)
+{
+    const auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                                 [id](const Entry &entry) { return entry.id == id; });
+    if (it == m_entries.end())
+        return false;
+
+    m_entries.erase(it);
+    return true;
+}
+
+void QNdefFilterMatcher::clear()
+{
+    m_entries.clear();
+    m_classes.clear();
+}
+
+/*
+    Returns the identifiers of all filters matching \a message, in the
+    order the filters were added.
+*/
+QList<int> QNdefFilterMatcher::matchingFilters(const QNdefMessage &message) const
+{
+    QNdefRecordClassList classes;
+    m_classes.classify(message, &classes);
+
+    QList<int> result;
+    for (const Entry &entry : m_entries) {
+        if (entry.filter.match(classes.constData(), classes.size()))
+            result.append(entry.id);
+    }
+    return result;
+}
+
+/*
+    Invokes the handler of every filter matching \a message and returns the
+    number of matching filters.
+*/
+int QNdefFilterMatcher::dispatch(const QNdefMessage &message) const
+{
+    QNdefRecordClassList classes;
+    m_classes.classify(message, &classes);
+
+    int matched = 0;
+    for (const Entry &entry : m_entries) {
+        if (!entry.filter.match(classes.constData(), classes.size()))
+            continue;
+        ++matched;
+        if (entry.handler)
+            entry.handler(message);
+    }
+    return matched;
+}
+
+QT_END_NAMESPACE
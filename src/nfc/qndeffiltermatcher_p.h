@@ -0,0 +1,155 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QNDEFFILTERMATCHER_P_H
+#define QNDEFFILTERMATCHER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qtnfcglobal.h"
+#include "qndeffilter.h"
+#include "qndefrecord.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QVarLengthArray>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+
+class QNdefMessage;
+
+// Type name format and type of a record, reduced to an integer key.
+struct QNdefRecordClass
+{
+    int key;
+    quint8 typeNameFormat;
+};
+
+using QNdefRecordClassList = QVarLengthArray<QNdefRecordClass, 16>;
+
+class Q_NFC_EXPORT QNdefRecordClassTable
+{
+public:
+    int insert(QNdefRecord::TypeNameFormat typeNameFormat, const QByteArray &type);
+    int lookup(QNdefRecord::TypeNameFormat typeNameFormat, const QByteArray &type) const;
+    qsizetype size() const { return m_keys.size(); }
+    void clear() { m_keys.clear(); }
+
+    void classify(const QNdefMessage &message, QNdefRecordClassList *classes) const;
+
+private:
+    QHash<QPair<int, QByteArray>, int> m_keys;
+};
+
+class Q_NFC_EXPORT QNdefCompiledFilter
+{
+public:
+    QNdefCompiledFilter();
+
+    void compile(const QList<QNdefFilter::Record> &records, bool orderMatch,
+                 QNdefRecordClassTable *classes);
+
+    bool match(const QNdefRecordClass *records, qsizetype count) const;
+
+private:
+    struct Rule
+    {
+        int key;
+        quint8 typeNameFormat;
+        bool wildcard;
+        unsigned int minimum;
+        unsigned int maximum;
+    };
+
+    bool matchUnordered(const QNdefRecordClass *records, qsizetype count) const;
+    bool matchOrdered(const QNdefRecordClass *records, qsizetype count) const;
+
+    QList<Rule> m_rules;
+    // Unordered matching only: rule index per record class key, -1 if none.
+    QList<int> m_ruleForKey;
+    // Unordered matching only: rule index of the empty type per type name format.
+    int m_wildcardRule[8];
+    quint64 m_minimumTotal = 0;
+    quint64 m_maximumTotal = 0;
+    bool m_orderMatch = false;
+};
+
+class Q_NFC_EXPORT QNdefFilterMatcher
+{
+public:
+    using Handler = std::function<void(const QNdefMessage &message)>;
+
+    int addFilter(const QNdefFilter &filter, const Handler &handler = Handler());
+    bool removeFilter(int id);
+    void clear();
+
+    qsizetype filterCount() const { return m_entries.size(); }
+
+    QList<int> matchingFilters(const QNdefMessage &message) const;
+    int dispatch(const QNdefMessage &message) const;
+
+private:
+    struct Entry
+    {
+        int id;
+        QNdefCompiledFilter filter;
+        Handler handler;
+    };
+
+    QNdefRecordClassTable m_classes;
+    QList<Entry> m_entries;
+    int m_nextId = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif // QNDEFFILTERMATCHER_P_H
@@ -0,0 +1,433 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qndefmessageview_p.h"
+
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+/*
+    QNdefMessageView, QNdefRecordView and QNdefMessageWriter provide
+    allocation-free access to the raw NDEF message format defined in the NFC
+    Data Exchange Format technical specification.
+
+    QNdefMessageView validates all record headers of a message in a single pass
+    when it is constructed. Iterating over a valid view yields QNdefRecordView
+    objects that reference the type, id and payload directly inside the
+    original buffer. A QNdefRecord is only created when toRecord() is called.
+    Chunked records are presented as one logical record; their payload is
+    assembled with a single allocation by payloadData().
+
+    The viewed data is not copied, it must outlive the view and all
+    QNdefRecordView objects obtained from it.
+*/
+
+namespace {
+
+enum RecordFlag : quint8 {
+    MessageBeginFlag = 0x80,
+    MessageEndFlag = 0x40,
+    ChunkFlag = 0x20,
+    ShortRecordFlag = 0x10,
+    IdLengthFlag = 0x08,
+    TypeNameFormatMask = 0x07
+};
+
+// TNF used by all but the first chunk of a chunked record.
+constexpr quint8 Unchanged = 0x06;
+
+struct RecordHeader
+{
+    quint8 flags = 0;
+    quint8 typeLength = 0;
+    quint8 idLength = 0;
+    quint32 payloadLength = 0;
+    // Size of the header in bytes, including the flags byte.
+    qsizetype size = 0;
+
+    quint8 typeNameFormat() const { return flags & TypeNameFormatMask; }
+};
+
+inline qsizetype headerSize(quint8 flags)
+{
+    return 2 + ((flags & ShortRecordFlag) ? 1 : 4) + ((flags & IdLengthFlag) ? 1 : 0);
+}
+
+// The caller must make sure that headerSize(*data) bytes are available.
+inline RecordHeader decodeHeader(const uchar *data)
+{
+    RecordHeader header;
+    header.flags = data[0];
+    header.typeLength = data[1];
+    header.size = 2;
+
+    if (header.flags & ShortRecordFlag) {
+        header.payloadLength = data[header.size++];
+    } else {
+        header.payloadLength = quint32(data[2]) << 24 | quint32(data[3]) << 16
+                | quint32(data[4]) << 8 | quint32(data[5]);
+        header.size += 4;
+    }
+
+    if (header.flags & IdLengthFlag)
+        header.idLength = data[header.size++];
+
+    return header;
+}
+
+inline const uchar *bytes(QByteArrayView data)
+{
+    return reinterpret_cast<const uchar *>(data.data());
+}
+
+} // namespace
+
+/*
+    Returns the complete payload of the record. For chunked records the
+    payload of all chunks is concatenated into a single buffer.
+*/
+QByteArray QNdefRecordView::payloadData() const
+{
+    if (!isChunked())
+        return m_firstChunk.toByteArray();
+
+    QByteArray payload(m_payloadSize, Qt::Uninitialized);
+    char *out = payload.data();
+    if (!m_firstChunk.isEmpty()) {
+        memcpy(out, m_firstChunk.data(), m_firstChunk.size());
+        out += m_firstChunk.size();
+    }
+
+    // The chunks were validated by QNdefMessageView, they carry neither type nor id.
+    const uchar *data = bytes(m_otherChunks);
+    qsizetype pos = 0;
+    while (pos < m_otherChunks.size()) {
+        const RecordHeader header = decodeHeader(data + pos);
+        pos += header.size;
+        if (header.payloadLength > 0) {
+            memcpy(out, data + pos, header.payloadLength);
+            out += header.payloadLength;
+        }
+        pos += header.payloadLength;
+    }
+
+    return payload;
+}
+
+/*
+    Creates a QNdefRecord holding a copy of the viewed record.
+*/
+QNdefRecord QNdefRecordView::toRecord() const
+{
+    QNdefRecord record;
+    record.setTypeNameFormat(typeNameFormat());
+    if (!m_type.isEmpty())
+        record.setType(m_type.toByteArray());
+    if (!m_id.isEmpty())
+        record.setId(m_id.toByteArray());
+    if (m_payloadSize > 0)
+        record.setPayload(payloadData());
+    return record;
+}
+
+/*
+    Validates the NDEF message at the beginning of \a message.
+
+    If a parse error occurs a warning is printed and the view is invalid.
+    Any data following the record carrying the message end flag is ignored.
+*/
+QNdefMessageView::QNdefMessageView(QByteArrayView message)
+{
+    bool seenMessageBegin = false;
+    bool seenMessageEnd = false;
+    bool inChunk = false;
+
+    const uchar *data = bytes(message);
+    const qsizetype size = message.size();
+
+    qsizetype recordCount = 0;
+    qsizetype lastRecordEnd = 0;
+
+    qsizetype idx = 0;
+    while (idx < size) {
+        const quint8 flags = data[idx];
+
+        const bool messageBegin = flags & MessageBeginFlag;
+        const bool messageEnd = flags & MessageEndFlag;
+        const bool cf = flags & ChunkFlag;
+        const bool il = flags & IdLengthFlag;
+        const quint8 typeNameFormat = flags & TypeNameFormatMask;
+
+        if (messageBegin && seenMessageBegin) {
+            qWarning("Got message begin but already parsed some records");
+            return;
+        } else if (!messageBegin && !seenMessageBegin) {
+            qWarning("Haven't got message begin yet");
+            return;
+        } else if (messageBegin && !seenMessageBegin) {
+            seenMessageBegin = true;
+        }
+        if (messageEnd && seenMessageEnd) {
+            qWarning("Got message end but already parsed final record");
+            return;
+        } else if (messageEnd && !seenMessageEnd) {
+            seenMessageEnd = true;
+        }
+        // TNF must be 0x06 even for the last chunk, when cf == 0.
+        if ((typeNameFormat != Unchanged) && inChunk) {
+            qWarning("Partial chunk not empty, but TNF not 0x06 as expected");
+            return;
+        }
+
+        const qsizetype headerLength = headerSize(flags);
+        if (headerLength > size - idx) {
+            qWarning("Unexpected end of message");
+            return;
+        }
+
+        const RecordHeader header = decodeHeader(data + idx);
+
+        if ((typeNameFormat == Unchanged) && (header.typeLength != 0)) {
+            qWarning("Invalid chunked data, TYPE_LENGTH != 0");
+            return;
+        }
+
+        // On 32-bit systems this can overflow
+        const qsizetype convertedPayloadLength = static_cast<qsizetype>(header.payloadLength);
+        const qsizetype contentLength =
+                convertedPayloadLength + header.typeLength + header.idLength;
+
+        // On a 32 bit platform the payload can theoretically exceed the max.
+        // size of a QByteArray. This will never happen in practice with correct
+        // data because there are no NFC tags that can store such data sizes,
+        // but still can be possible if the data is corrupted.
+        if ((contentLength < 0) || (convertedPayloadLength < 0)
+            || ((std::numeric_limits<qsizetype>::max() - idx - headerLength) < contentLength)) {
+            qWarning("Payload can't fit into QByteArray");
+            return;
+        }
+
+        if (contentLength > size - idx - headerLength) {
+            qWarning("Unexpected end of message");
+            return;
+        }
+
+        if ((typeNameFormat == Unchanged) && il) {
+            qWarning("Invalid chunked data, IL != 0");
+            return;
+        }
+
+        idx += headerLength + contentLength;
+        inChunk = cf;
+
+        if (!cf) {
+            ++recordCount;
+            lastRecordEnd = idx;
+            if (seenMessageEnd)
+                break;
+        }
+    }
+
+    if (!seenMessageBegin || !seenMessageEnd) {
+        qWarning("Malformed NDEF Message, missing begin or end");
+        return;
+    }
+
+    m_data = message.first(lastRecordEnd);
+    m_recordCount = recordCount;
+    m_valid = true;
+}
+
+/*
+    Returns a QNdefMessage holding copies of all records in the view.
+*/
+QNdefMessage QNdefMessageView::toMessage() const
+{
+    QNdefMessage message;
+    message.reserve(m_recordCount);
+    for (const QNdefRecordView &record : *this)
+        message.append(record.toRecord());
+    return message;
+}
+
+void QNdefMessageView::const_iterator::advance(qsizetype offset)
+{
+    m_offset = offset;
+    m_next = offset;
+    m_record = QNdefRecordView();
+
+    if (offset >= m_data.size())
+        return;
+
+    // The data was validated by QNdefMessageView, no bounds checks needed.
+    const uchar *data = bytes(m_data);
+    const RecordHeader header = decodeHeader(data + offset);
+
+    qsizetype pos = offset + header.size;
+    // An unchanged TNF outside of a chunked record is treated as empty.
+    if (header.typeNameFormat() != Unchanged)
+        m_record.m_typeNameFormat = header.typeNameFormat();
+    m_record.m_type = m_data.sliced(pos, header.typeLength);
+    pos += header.typeLength;
+    m_record.m_id = m_data.sliced(pos, header.idLength);
+    pos += header.idLength;
+    m_record.m_firstChunk = m_data.sliced(pos, header.payloadLength);
+    pos += header.payloadLength;
+    m_record.m_payloadSize = header.payloadLength;
+    m_record.m_chunkCount = 1;
+
+    if (header.flags & ChunkFlag) {
+        const qsizetype chunksBegin = pos;
+        RecordHeader chunk;
+        do {
+            chunk = decodeHeader(data + pos);
+            pos += chunk.size + chunk.payloadLength;
+            m_record.m_payloadSize += chunk.payloadLength;
+            ++m_record.m_chunkCount;
+        } while (chunk.flags & ChunkFlag);
+        m_record.m_otherChunks = m_data.sliced(chunksBegin, pos - chunksBegin);
+    }
+
+    m_next = pos;
+}
+
+/*
+    Returns the number of bytes needed to encode a record with the given
+    \a type, \a id and \a payloadSize.
+*/
+qsizetype QNdefMessageWriter::recordSize(QByteArrayView type, QByteArrayView id,
+                                         qsizetype payloadSize)
+{
+    qsizetype size = 2; // flags, type length
+    size += (payloadSize < 255) ? 1 : 4;
+    if (!id.isEmpty())
+        size += 1 + id.size();
+    return size + type.size() + payloadSize;
+}
+
+/*
+    Returns the number of bytes needed to encode \a records as an NDEF message.
+*/
+qsizetype QNdefMessageWriter::messageSize(const QList<QNdefRecord> &records)
+{
+    // An empty message is encoded as a message containing a single empty record.
+    if (records.isEmpty())
+        return recordSize(QByteArrayView(), QByteArrayView(), 0);
+
+    qsizetype size = 0;
+    for (const QNdefRecord &record : records)
+        size += recordSize(record.type(), record.id(), record.payload().size());
+    return size;
+}
+
+/*
+    Appends a single record to the buffer.
+*/
+void QNdefMessageWriter::writeRecord(QNdefRecord::TypeNameFormat typeNameFormat,
+                                     QByteArrayView type, QByteArrayView id,
+                                     QByteArrayView payload,
+                                     bool messageBegin, bool messageEnd)
+{
+    quint8 flags = typeNameFormat;
+
+    if (messageBegin)
+        flags |= MessageBeginFlag;
+    if (messageEnd)
+        flags |= MessageEndFlag;
+
+    // cf (chunked records) not supported yet
+
+    if (payload.size() < 255)
+        flags |= ShortRecordFlag;
+
+    if (!id.isEmpty())
+        flags |= IdLengthFlag;
+
+    m_buffer->append(char(flags));
+    m_buffer->append(char(type.size()));
+
+    if (flags & ShortRecordFlag) {
+        m_buffer->append(char(payload.size()));
+    } else {
+        const quint32 length = quint32(payload.size());
+        const char encodedLength[4] = { char(length >> 24), char(length >> 16),
+                                        char(length >> 8), char(length & 0x000000ff) };
+        m_buffer->append(encodedLength, 4);
+    }
+
+    if (flags & IdLengthFlag)
+        m_buffer->append(char(id.size()));
+
+    if (!type.isEmpty())
+        m_buffer->append(type);
+
+    if (!id.isEmpty())
+        m_buffer->append(id);
+
+    if (!payload.isEmpty())
+        m_buffer->append(payload);
+}
+
+/*
+    Appends \a records as a complete NDEF message to the buffer. The buffer
+    is grown at most once.
+*/
+void QNdefMessageWriter::writeMessage(const QList<QNdefRecord> &records)
+{
+    m_buffer->reserve(m_buffer->size() + messageSize(records));
+
+    // An empty message is treated as a message containing a single empty record.
+    if (records.isEmpty()) {
+        writeRecord(QNdefRecord::Empty, QByteArrayView(), QByteArrayView(), QByteArrayView(),
+                    true, true);
+        return;
+    }
+
+    const qsizetype last = records.size() - 1;
+    for (qsizetype i = 0; i <= last; ++i) {
+        const QNdefRecord &record = records.at(i);
+        const QByteArray type = record.type();
+        const QByteArray id = record.id();
+        const QByteArray payload = record.payload();
+        writeRecord(record.typeNameFormat(), type, id, payload, i == 0, i == last);
+    }
+}
+
+QT_END_NAMESPACE
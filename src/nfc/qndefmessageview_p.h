@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QNDEFMESSAGEVIEW_P_H
+#define QNDEFMESSAGEVIEW_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qtnfcglobal.h"
+#include "qndefmessage.h"
+#include "qndefrecord.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QByteArrayView>
+
+#include <iterator>
+
+QT_BEGIN_NAMESPACE
+
+class Q_NFC_EXPORT QNdefRecordView
+{
+public:
+    QNdefRecordView() = default;
+
+    QNdefRecord::TypeNameFormat typeNameFormat() const
+    { return QNdefRecord::TypeNameFormat(m_typeNameFormat); }
+    QByteArrayView type() const { return m_type; }
+    QByteArrayView id() const { return m_id; }
+
+    bool isChunked() const { return m_chunkCount > 1; }
+    int chunkCount() const { return m_chunkCount; }
+    qsizetype payloadSize() const { return m_payloadSize; }
+
+    // Only the complete payload for non-chunked records, the first chunk otherwise.
+    QByteArrayView payload() const { return m_firstChunk; }
+    QByteArray payloadData() const;
+
+    QNdefRecord toRecord() const;
+
+private:
+    friend class QNdefMessageView;
+
+    QByteArrayView m_type;
+    QByteArrayView m_id;
+    QByteArrayView m_firstChunk;
+    // Raw bytes of all chunk records following the first one.
+    QByteArrayView m_otherChunks;
+    qsizetype m_payloadSize = 0;
+    int m_chunkCount = 0;
+    quint8 m_typeNameFormat = QNdefRecord::Empty;
+};
+
+class Q_NFC_EXPORT QNdefMessageView
+{
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = qsizetype;
+        using value_type = QNdefRecordView;
+        using pointer = const QNdefRecordView *;
+        using reference = const QNdefRecordView &;
+
+        const_iterator() = default;
+
+        reference operator*() const { return m_record; }
+        pointer operator->() const { return &m_record; }
+
+        const_iterator &operator++() { advance(m_next); return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; ++*this; return it; }
+
+        friend bool operator==(const const_iterator &lhs, const const_iterator &rhs)
+        { return lhs.m_offset == rhs.m_offset && lhs.m_data.data() == rhs.m_data.data(); }
+        friend bool operator!=(const const_iterator &lhs, const const_iterator &rhs)
+        { return !(lhs == rhs); }
+
+    private:
+        friend class QNdefMessageView;
+
+        const_iterator(QByteArrayView data, qsizetype offset) : m_data(data) { advance(offset); }
+        void advance(qsizetype offset);
+
+        QByteArrayView m_data;
+        qsizetype m_offset = 0;
+        qsizetype m_next = 0;
+        QNdefRecordView m_record;
+    };
+
+    QNdefMessageView() = default;
+    explicit QNdefMessageView(QByteArrayView message);
+
+    bool isValid() const { return m_valid; }
+    qsizetype recordCount() const { return m_recordCount; }
+
+    // Number of bytes of the input consumed by the message.
+    qsizetype size() const { return m_data.size(); }
+
+    const_iterator begin() const { return const_iterator(m_data, 0); }
+    const_iterator end() const { return const_iterator(m_data, m_data.size()); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    QNdefMessage toMessage() const;
+
+private:
+    QByteArrayView m_data;
+    qsizetype m_recordCount = 0;
+    bool m_valid = false;
+};
+
+class Q_NFC_EXPORT QNdefMessageWriter
+{
+public:
+    explicit QNdefMessageWriter(QByteArray *buffer) : m_buffer(buffer) { }
+
+    static qsizetype recordSize(QByteArrayView type, QByteArrayView id, qsizetype payloadSize);
+    static qsizetype messageSize(const QList<QNdefRecord> &records);
+
+    void writeRecord(QNdefRecord::TypeNameFormat typeNameFormat, QByteArrayView type,
+                     QByteArrayView id, QByteArrayView payload,
+                     bool messageBegin, bool messageEnd);
+    void writeMessage(const QList<QNdefRecord> &records);
+
+private:
+    QByteArray *m_buffer;
+};
+
+QT_END_NAMESPACE
+
+#endif // QNDEFMESSAGEVIEW_P_H
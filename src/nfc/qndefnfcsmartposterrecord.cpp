@@ -39,6 +39,8 @@
 
 #include <qndefnfcsmartposterrecord.h>
 #include "qndefnfcsmartposterrecord_p.h"
+#include "qndefmessageview_p.h"
+#include "qndefrecord_p.h"
 #include <qndefmessage.h>
 
 #include <QtCore/QString>
@@ -47,6 +49,12 @@
 
 QT_BEGIN_NAMESPACE
 
+static bool isType(QByteArrayView type, const char *expected)
+{
+    const qsizetype length = qsizetype(qstrlen(expected));
+    return type.size() == length && memcmp(type.data(), expected, length) == 0;
+}
+
 /*!
     \class QNdefNfcIconRecord
     \brief The QNdefNfcIconRecord class provides an NFC MIME record to hold an
@@ -129,8 +137,10 @@ QNdefNfcSmartPosterRecord::QNdefNfcSmartPosterRecord(const QNdefNfcSmartPosterRe
 */
 QNdefNfcSmartPosterRecord &QNdefNfcSmartPosterRecord::operator=(const QNdefNfcSmartPosterRecord &other)
 {
-    if (this != &other)
+    if (this != &other) {
+        QNdefRecord::operator=(other);
         d = other.d;
+    }
 
     return *this;
 }
@@ -147,11 +157,11 @@ void QNdefNfcSmartPosterRecord::cleanup()
     if (d) {
         // Clean-up existing internal structure
         d->m_titleList.clear();
-        if (d->m_uri) delete d->m_uri;
-        if (d->m_action) delete d->m_action;
+        d->m_uri.reset();
+        d->m_action.reset();
         d->m_iconList.clear();
-        if (d->m_size) delete d->m_size;
-        if (d->m_type) delete d->m_type;
+        d->m_size.reset();
+        d->m_type.reset();
     }
 }
 
@@ -165,74 +175,107 @@ void QNdefNfcSmartPosterRecord::setPayload(const QByteArray &payload)
 
     cleanup();
 
-    if (!payload.isEmpty()) {
-        // Create new structure
-        const QNdefMessage message = QNdefMessage::fromByteArray(payload);
-
-        // Iterate through all the records contained in the payload's message.
-        for (const QNdefRecord& record : message) {
-            // Title
-            if (record.isRecordType<QNdefNfcTextRecord>()) {
-                addTitleInternal(record);
-            }
-
-            // URI
-            else if (record.isRecordType<QNdefNfcUriRecord>()) {
-                d->m_uri = new QNdefNfcUriRecord(record);
-            }
-
-            // Action
-            else if (record.isRecordType<QNdefNfcActRecord>()) {
-                d->m_action = new QNdefNfcActRecord(record);
-            }
-
-            // Icon
-            else if (record.isRecordType<QNdefNfcIconRecord>()) {
-                addIconInternal(record);
-            }
-
-            // Size
-            else if (record.isRecordType<QNdefNfcSizeRecord>()) {
-                d->m_size = new QNdefNfcSizeRecord(record);
-            }
-
-            // Type
-            else if (record.isRecordType<QNdefNfcTypeRecord>()) {
-                d->m_type = new QNdefNfcTypeRecord(record);
-            }
+    if (payload.isEmpty())
+        return;
+
+    // Walk the nested message in place, only the known records are copied out of it.
+    // The payload itself is kept, so it is handed out unchanged until the poster is modified.
+    const QNdefMessageView message(payload);
+    if (!message.isValid())
+        return;
+
+    for (const QNdefRecordView &record : message) {
+        const QNdefRecord::TypeNameFormat typeNameFormat = record.typeNameFormat();
+
+        // Icon
+        if (typeNameFormat == QNdefRecord::Mime) {
+            addIconInternal(record.toRecord());
+            continue;
         }
+
+        if (typeNameFormat != QNdefRecord::NfcRtd)
+            continue;
+
+        const QByteArrayView type = record.type();
+
+        // Title
+        if (isType(type, "T"))
+            addTitleInternal(record.toRecord());
+
+        // URI
+        else if (isType(type, "U"))
+            d->m_uri = QNdefNfcUriRecord(record.toRecord());
+
+        // Action
+        else if (isType(type, "act"))
+            d->m_action = QNdefNfcActRecord(record.toRecord());
+
+        // Size
+        else if (isType(type, "s"))
+            d->m_size = QNdefNfcSizeRecord(record.toRecord());
+
+        // Type
+        else if (isType(type, "t"))
+            d->m_type = QNdefNfcTypeRecord(record.toRecord());
     }
 }
 
+/*
+    Drops the pending payload builder before the structured content is modified. The builder
+    references the content, so keeping it would detach (copy) all title and icon lists on every
+    change.
+*/
+void QNdefNfcSmartPosterRecord::prepareChange()
+{
+    QNdefRecord::d->payloadBuilder = nullptr;
+}
+
+/*
+    Serializing all sub-records on every change is quadratic when building posters with many
+    titles or icons, so the payload is only built once it is actually requested. The builder
+    holds a reference to the current content; sub-record payloads are implicitly shared into
+    the message and not copied until they are written out.
+*/
 void QNdefNfcSmartPosterRecord::convertToPayload()
 {
-    QNdefMessage message;
+    const QSharedDataPointer<QNdefNfcSmartPosterRecordPrivate> data = d;
+
+    QNdefRecord::d->payload.clear();
+    QNdefRecord::d->payloadBuilder = [data]() { return data->toPayload(); };
+}
+
+QByteArray QNdefNfcSmartPosterRecordPrivate::toPayload() const
+{
+    QList<QNdefRecord> records;
+    records.reserve(m_titleList.size() + m_iconList.size() + 4);
 
     // Title
-    for (qsizetype t = 0; t < titleCount(); t++)
-        message.append(titleRecord(t));
+    for (const QNdefNfcTextRecord &title : m_titleList)
+        records.append(title);
 
     // URI
-    if (d->m_uri)
-        message.append(*(d->m_uri));
+    if (m_uri)
+        records.append(*m_uri);
 
     // Action
-    if (d->m_action)
-        message.append(*(d->m_action));
+    if (m_action)
+        records.append(*m_action);
 
     // Icon
-    for (qsizetype i = 0; i < iconCount(); i++)
-        message.append(iconRecord(i));
+    for (const QNdefNfcIconRecord &icon : m_iconList)
+        records.append(icon);
 
     // Size
-    if (d->m_size)
-        message.append(*(d->m_size));
+    if (m_size)
+        records.append(*m_size);
 
     // Type
-    if (d->m_type)
-        message.append(*(d->m_type));
+    if (m_type)
+        records.append(*m_type);
 
-    QNdefRecord::setPayload(message.toByteArray());
+    QByteArray payload;
+    QNdefMessageWriter(&payload).writeMessage(records);
+    return payload;
 }
 
 /*!
@@ -259,7 +302,7 @@ bool QNdefNfcSmartPosterRecord::hasTitle(const QString &locale) const
  */
 bool QNdefNfcSmartPosterRecord::hasAction() const
 {
-    return d->m_action != nullptr;
+    return d->m_action.has_value();
 }
 
 /*!
@@ -286,7 +329,7 @@ bool QNdefNfcSmartPosterRecord::hasIcon(const QByteArray &mimetype) const
  */
 bool QNdefNfcSmartPosterRecord::hasSize() const
 {
-    return d->m_size != nullptr;
+    return d->m_size.has_value();
 }
 
 /*!
@@ -295,7 +338,7 @@ bool QNdefNfcSmartPosterRecord::hasSize() const
  */
 bool QNdefNfcSmartPosterRecord::hasTypeInfo() const
 {
-    return d->m_type != nullptr;
+    return d->m_type.has_value();
 }
 
 /*!
@@ -351,13 +394,18 @@ QList<QNdefNfcTextRecord> QNdefNfcSmartPosterRecord::titleRecords() const
  */
 bool QNdefNfcSmartPosterRecord::addTitle(const QNdefNfcTextRecord &text)
 {
-    const bool status = addTitleInternal(text);
+    for (const QNdefNfcTextRecord &rec : std::as_const(d)->m_titleList) {
+        if (rec.locale() == text.locale())
+            return false;
+    }
 
-    // Convert to payload if the title is added
-    if (status)
-        convertToPayload();
+    prepareChange();
+    d->m_titleList.append(text);
+
+    // Convert to payload
+    convertToPayload();
 
-    return status;
+    return true;
 }
 
 bool QNdefNfcSmartPosterRecord::addTitleInternal(const QNdefNfcTextRecord &text)
@@ -395,23 +443,22 @@ bool QNdefNfcSmartPosterRecord::addTitle(const QString &text, const QString &loc
  */
 bool QNdefNfcSmartPosterRecord::removeTitle(const QNdefNfcTextRecord &text)
 {
-    bool status = false;
+    const QList<QNdefNfcTextRecord> &titles = std::as_const(d)->m_titleList;
 
-    for (qsizetype i = 0; i < d->m_titleList.length(); ++i) {
-        const QNdefNfcTextRecord &rec = d->m_titleList[i];
+    for (qsizetype i = 0; i < titles.length(); ++i) {
+        const QNdefNfcTextRecord &rec = titles[i];
 
         if (rec.text() == text.text() && rec.locale() == text.locale() && rec.encoding() == text.encoding()) {
+            prepareChange();
             d->m_titleList.removeAt(i);
-            status = true;
-            break;
+
+            // Convert to payload as the title list has changed
+            convertToPayload();
+            return true;
         }
     }
 
-    // Convert to payload if the title list has changed
-    if (status)
-        convertToPayload();
-
-    return status;
+    return false;
 }
 
 /*!
@@ -421,23 +468,22 @@ bool QNdefNfcSmartPosterRecord::removeTitle(const QNdefNfcTextRecord &text)
  */
 bool QNdefNfcSmartPosterRecord::removeTitle(const QString &locale)
 {
-    bool status = false;
+    const QList<QNdefNfcTextRecord> &titles = std::as_const(d)->m_titleList;
 
-    for (qsizetype i = 0; i < d->m_titleList.length(); ++i) {
-        const QNdefNfcTextRecord &rec = d->m_titleList[i];
+    for (qsizetype i = 0; i < titles.length(); ++i) {
+        const QNdefNfcTextRecord &rec = titles[i];
 
         if (rec.locale() == locale) {
+            prepareChange();
             d->m_titleList.removeAt(i);
-            status = true;
-            break;
+
+            // Convert to payload as the title list has changed
+            convertToPayload();
+            return true;
         }
     }
 
-    // Convert to payload if the title list has changed
-    if (status)
-        convertToPayload();
-
-    return status;
+    return false;
 }
 
 /*!
@@ -445,6 +491,7 @@ bool QNdefNfcSmartPosterRecord::removeTitle(const QString &locale)
  */
 void QNdefNfcSmartPosterRecord::setTitles(const QList<QNdefNfcTextRecord> &titles)
 {
+    prepareChange();
     d->m_titleList.clear();
 
     for (qsizetype i = 0; i < titles.length(); ++i) {
@@ -482,10 +529,8 @@ QNdefNfcUriRecord QNdefNfcSmartPosterRecord::uriRecord() const
  */
 void QNdefNfcSmartPosterRecord::setUri(const QNdefNfcUriRecord &url)
 {
-    if (d->m_uri)
-        delete d->m_uri;
-
-    d->m_uri = new QNdefNfcUriRecord(url);
+    prepareChange();
+    d->m_uri = url;
 
     // Convert to payload
     convertToPayload();
@@ -518,8 +563,9 @@ QNdefNfcSmartPosterRecord::Action QNdefNfcSmartPosterRecord::action() const
  */
 void QNdefNfcSmartPosterRecord::setAction(Action act)
 {
+    prepareChange();
     if (!d->m_action)
-        d->m_action = new QNdefNfcActRecord();
+        d->m_action.emplace();
 
     d->m_action->setAction(act);
 
@@ -578,6 +624,7 @@ QList<QNdefNfcIconRecord> QNdefNfcSmartPosterRecord::iconRecords() const
  */
 void QNdefNfcSmartPosterRecord::addIcon(const QNdefNfcIconRecord &icon)
 {
+    prepareChange();
     addIconInternal(icon);
 
     // Convert to payload
@@ -616,23 +663,22 @@ void QNdefNfcSmartPosterRecord::addIcon(const QByteArray &type, const QByteArray
  */
 bool QNdefNfcSmartPosterRecord::removeIcon(const QNdefNfcIconRecord &icon)
 {
-    bool status = false;
+    const QList<QNdefNfcIconRecord> &icons = std::as_const(d)->m_iconList;
 
-    for (qsizetype i = 0; i < d->m_iconList.length(); ++i) {
-        const QNdefNfcIconRecord &rec = d->m_iconList[i];
+    for (qsizetype i = 0; i < icons.length(); ++i) {
+        const QNdefNfcIconRecord &rec = icons[i];
 
         if (rec.type() == icon.type() && rec.data() == icon.data()) {
+            prepareChange();
             d->m_iconList.removeAt(i);
-            status = true;
-            break;
+
+            // Convert to payload as the icon list has changed
+            convertToPayload();
+            return true;
         }
     }
 
-    // Convert to payload if the icon list has changed
-    if (status)
-        convertToPayload();
-
-    return status;
+    return false;
 }
 
 /*!
@@ -642,23 +688,22 @@ bool QNdefNfcSmartPosterRecord::removeIcon(const QNdefNfcIconRecord &icon)
  */
 bool QNdefNfcSmartPosterRecord::removeIcon(const QByteArray &type)
 {
-    bool status = false;
+    const QList<QNdefNfcIconRecord> &icons = std::as_const(d)->m_iconList;
 
-    for (qsizetype i = 0; i < d->m_iconList.length(); ++i) {
-        const QNdefNfcIconRecord &rec = d->m_iconList[i];
+    for (qsizetype i = 0; i < icons.length(); ++i) {
+        const QNdefNfcIconRecord &rec = icons[i];
 
         if (rec.type() == type) {
+            prepareChange();
             d->m_iconList.removeAt(i);
-            status = true;
-            break;
+
+            // Convert to payload as the icon list has changed
+            convertToPayload();
+            return true;
         }
     }
 
-    // Convert to payload if the icon list has changed
-    if (status)
-        convertToPayload();
-
-    return status;
+    return false;
 }
 
 /*!
@@ -669,6 +714,7 @@ bool QNdefNfcSmartPosterRecord::removeIcon(const QByteArray &type)
  */
 void QNdefNfcSmartPosterRecord::setIcons(const QList<QNdefNfcIconRecord> &icons)
 {
+    prepareChange();
     d->m_iconList.clear();
 
     for (qsizetype i = 0; i < icons.length(); ++i) {
@@ -704,8 +750,9 @@ quint32 QNdefNfcSmartPosterRecord::size() const
  */
 void QNdefNfcSmartPosterRecord::setSize(quint32 size)
 {
+    prepareChange();
     if (!d->m_size)
-        d->m_size = new QNdefNfcSizeRecord();
+        d->m_size.emplace();
 
     d->m_size->setSize(size);
 
@@ -737,10 +784,8 @@ QString QNdefNfcSmartPosterRecord::typeInfo() const
  */
 void QNdefNfcSmartPosterRecord::setTypeInfo(const QString &type)
 {
-    if (d->m_type)
-        delete d->m_type;
-
-    d->m_type = new QNdefNfcTypeRecord();
+    prepareChange();
+    d->m_type.emplace();
     d->m_type->setTypeInfo(type);
 
     // Convert to payload
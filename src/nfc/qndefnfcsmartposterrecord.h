@@ -139,6 +139,7 @@ private:
     QSharedDataPointer<QNdefNfcSmartPosterRecordPrivate> d;
 
     void cleanup();
+    void prepareChange();
     void convertToPayload();
 
     bool addTitleInternal(const QNdefNfcTextRecord &text);
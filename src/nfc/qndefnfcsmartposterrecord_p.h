@@ -51,6 +51,8 @@
 // We mean it.
 //
 
+#include <optional>
+
 QT_BEGIN_NAMESPACE
 
 class QNdefNfcActRecord : public QNdefRecord
@@ -86,12 +88,14 @@ public:
     QNdefNfcSmartPosterRecordPrivate() {}
 
 public:
+    QByteArray toPayload() const;
+
     QList<QNdefNfcTextRecord> m_titleList;
-    QNdefNfcUriRecord *m_uri = nullptr;
-    QNdefNfcActRecord *m_action = nullptr;
+    std::optional<QNdefNfcUriRecord> m_uri;
+    std::optional<QNdefNfcActRecord> m_action;
     QList<QNdefNfcIconRecord> m_iconList;
-    QNdefNfcSizeRecord *m_size = nullptr;
-    QNdefNfcTypeRecord *m_type = nullptr;
+    std::optional<QNdefNfcSizeRecord> m_size;
+    std::optional<QNdefNfcTypeRecord> m_type;
 };
 
 QT_END_NAMESPACE
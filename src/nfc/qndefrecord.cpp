@@ -167,6 +167,9 @@ QNdefRecord::QNdefRecord()
 */
 QNdefRecord::QNdefRecord(const QNdefRecord &other)
 {
+    if (other.d)
+        other.d->buildPayload();
+
     d = other.d;
 }
 
@@ -181,6 +184,7 @@ QNdefRecord::QNdefRecord(const QNdefRecord &other, TypeNameFormat typeNameFormat
                          const QByteArray &type)
 {
     if (other.d->typeNameFormat == quint8(typeNameFormat) && other.d->type == type) {
+        other.d->buildPayload();
         d = other.d;
     } else {
         d = new QNdefRecordPrivate;
@@ -199,6 +203,7 @@ QNdefRecord::QNdefRecord(const QNdefRecord &other, TypeNameFormat typeNameFormat
 QNdefRecord::QNdefRecord(const QNdefRecord &other, TypeNameFormat typeNameFormat)
 {
     if (other.d->typeNameFormat == quint8(typeNameFormat)) {
+        other.d->buildPayload();
         d = other.d;
     } else {
         d = new QNdefRecordPrivate;
@@ -231,8 +236,12 @@ QNdefRecord::~QNdefRecord()
 */
 QNdefRecord &QNdefRecord::operator=(const QNdefRecord &other)
 {
-    if (this != &other)
+    if (this != &other) {
+        if (other.d)
+            other.d->buildPayload();
+
         d = other.d;
+    }
 
     return *this;
 }
@@ -314,6 +323,7 @@ void QNdefRecord::setPayload(const QByteArray &payload)
     if (!d)
         d = new QNdefRecordPrivate;
 
+    d->payloadBuilder = nullptr;
     d->payload = payload;
 }
 
@@ -325,6 +335,7 @@ QByteArray QNdefRecord::payload() const
     if (!d)
         return QByteArray();
 
+    d->buildPayload();
     return d->payload;
 }
 
@@ -339,6 +350,7 @@ bool QNdefRecord::isEmpty() const
     if (!d)
         return true;
 
+    d->buildPayload();
     return d->payload.isEmpty();
 }
 
@@ -363,6 +375,9 @@ bool QNdefRecord::operator==(const QNdefRecord &other) const
     if (d->id != other.d->id)
         return false;
 
+    d->buildPayload();
+    other.d->buildPayload();
+
     if (d->payload != other.d->payload)
         return false;
 
@@ -383,6 +398,7 @@ void QNdefRecord::clear()
         d->typeNameFormat = 0;
         d->type.clear();
         d->id.clear();
+        d->payloadBuilder = nullptr;
         d->payload.clear();
     }
 }
@@ -98,6 +98,8 @@ protected:
     QNdefRecord(TypeNameFormat typeNameFormat, const QByteArray &type);
 
 private:
+    friend class QNdefNfcSmartPosterRecord;
+
     QSharedDataPointer<QNdefRecordPrivate> d;
 };
 
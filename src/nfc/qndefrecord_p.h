@@ -55,6 +55,10 @@
 
 #include <QtCore/QSharedData>
 #include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+
+#include <functional>
+#include <utility>
 
 QT_BEGIN_NAMESPACE
 
@@ -66,11 +70,33 @@ public:
         typeNameFormat = 0; //TypeNameFormat::Empty
     }
 
+    QNdefRecordPrivate(const QNdefRecordPrivate &other)
+    :   QSharedData(other), typeNameFormat(other.typeNameFormat), type(other.type), id(other.id)
+    {
+        QMutexLocker locker(&other.payloadMutex);
+        payload = other.payload;
+        payloadBuilder = other.payloadBuilder;
+    }
+
     unsigned int typeNameFormat : 3;
 
     QByteArray type;
     QByteArray id;
-    QByteArray payload;
+    mutable QByteArray payload;
+
+    // Records which keep their content in structured form (QNdefNfcSmartPosterRecord) install
+    // a builder instead of serializing on every change. It is only ever set while the private
+    // is not shared, QNdefRecord builds the payload before handing out the private to a copy.
+    mutable std::function<QByteArray()> payloadBuilder;
+    // Const accessors may run concurrently on the same record, only one of them builds.
+    mutable QMutex payloadMutex;
+
+    void buildPayload() const
+    {
+        QMutexLocker locker(&payloadMutex);
+        if (payloadBuilder)
+            payload = std::exchange(payloadBuilder, nullptr)();
+    }
 };
 
 QT_END_NAMESPACE
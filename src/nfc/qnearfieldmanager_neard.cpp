@@ -0,0 +1,357 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qnearfieldmanager_neard_p.h"
+#include "qnearfieldtarget_neard_p.h"
+
+#include "neard/adapter_p.h"
+#include "neard/objectmanager_p.h"
+#include "neard/properties_p.h"
+
+#include <utility>
+
+QT_BEGIN_NAMESPACE
+
+QNearFieldManagerPrivateImpl::QNearFieldManagerPrivateImpl()
+{
+    initializeNeard();
+
+    m_objectManager = new NeardObjectManagerInterface(NEARD_SERVICE, QStringLiteral("/"),
+                                                      neardConnection(), this);
+
+    // Also watch for adapters being plugged in later on
+    connect(m_objectManager, &NeardObjectManagerInterface::InterfacesAdded,
+            this, &QNearFieldManagerPrivateImpl::onInterfacesAdded);
+    connect(m_objectManager, &NeardObjectManagerInterface::InterfacesRemoved,
+            this, &QNearFieldManagerPrivateImpl::onInterfacesRemoved);
+
+    ManagedObjectList managedObjects;
+    if (!readManagedObjects(&managedObjects))
+        return;
+
+    selectAdapter(managedObjects);
+    if (m_adapterPath.isEmpty())
+        qCWarning(QT_NFC_NEARD) << "neard does not report any NFC adapter";
+}
+
+QNearFieldManagerPrivateImpl::~QNearFieldManagerPrivateImpl()
+{
+    if (m_detecting)
+        m_adapter->StopPollLoop();
+}
+
+bool QNearFieldManagerPrivateImpl::isEnabled() const
+{
+    return m_adapter && m_powered;
+}
+
+bool QNearFieldManagerPrivateImpl::isSupported(QNearFieldTarget::AccessMethod accessMethod) const
+{
+    if (!m_adapter)
+        return false;
+
+    switch (accessMethod) {
+    case QNearFieldTarget::AnyAccess:
+    case QNearFieldTarget::NdefAccess:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool QNearFieldManagerPrivateImpl::startTargetDetection(QNearFieldTarget::AccessMethod accessMethod)
+{
+    if (!isSupported(accessMethod))
+        return false;
+
+    if (m_detecting)
+        return true;
+
+    if (!m_powered) {
+        QDBusPendingReply<> reply = m_adapterProperties->Set(NEARD_ADAPTER_INTERFACE,
+                                                             QStringLiteral("Powered"),
+                                                             QDBusVariant(true));
+        reply.waitForFinished();
+        if (reply.isError()) {
+            qCWarning(QT_NFC_NEARD) << "Cannot power on" << m_adapterPath << ":"
+                                    << reply.error().message();
+            return false;
+        }
+        m_powered = true;
+    }
+
+    m_detecting = true;
+
+    // Tags which were already in range are not announced by neard again
+    ManagedObjectList managedObjects;
+    if (readManagedObjects(&managedObjects))
+        addExistingTags(managedObjects);
+
+    // neard refuses to poll while a tag is still connected; polling is
+    // resumed once the tag is gone.
+    if (m_targets.isEmpty())
+        startPollLoop();
+
+    return true;
+}
+
+void QNearFieldManagerPrivateImpl::stopTargetDetection(const QString &)
+{
+    if (!m_detecting)
+        return;
+
+    m_detecting = false;
+    m_adapter->StopPollLoop();
+    Q_EMIT targetDetectionStopped();
+}
+
+void QNearFieldManagerPrivateImpl::onInterfacesAdded(const QDBusObjectPath &path,
+                                                     const InterfaceList &interfaces)
+{
+    const auto adapter = interfaces.constFind(NEARD_ADAPTER_INTERFACE);
+    if (adapter != interfaces.cend()) {
+        if (m_adapterPath.isEmpty()) {
+            setAdapter(path.path(), adapter.value());
+            if (m_powered)
+                Q_EMIT adapterStateChanged(QNearFieldManager::AdapterState::Online);
+        }
+        return;
+    }
+
+    // Only objects below the adapter in use are of interest
+    if (m_adapterPath.isEmpty() || !path.path().startsWith(m_adapterPath + QLatin1Char('/')))
+        return;
+
+    const auto tag = interfaces.constFind(NEARD_TAG_INTERFACE);
+    if (tag != interfaces.cend())
+        addTag(path, tag.value());
+
+    if (interfaces.contains(NEARD_RECORD_INTERFACE))
+        addRecord(path);
+}
+
+void QNearFieldManagerPrivateImpl::onInterfacesRemoved(const QDBusObjectPath &path,
+                                                       const QStringList &interfaces)
+{
+    if (interfaces.contains(NEARD_ADAPTER_INTERFACE)) {
+        if (path.path() != m_adapterPath)
+            return;
+
+        qCDebug(QT_NFC_NEARD) << "NFC adapter" << m_adapterPath << "was removed";
+        removeAdapter();
+
+        // Fall back to another adapter, if there is one
+        ManagedObjectList managedObjects;
+        if (readManagedObjects(&managedObjects)) {
+            managedObjects.remove(path);
+            selectAdapter(managedObjects);
+            if (m_powered)
+                Q_EMIT adapterStateChanged(QNearFieldManager::AdapterState::Online);
+        }
+    } else if (interfaces.contains(NEARD_TAG_INTERFACE)) {
+        removeTag(path);
+    } else if (interfaces.contains(NEARD_RECORD_INTERFACE)) {
+        const QString tagPath = path.path().section(QLatin1Char('/'), 0, -2);
+        if (QNearFieldTargetPrivateImpl *target = m_targets.value(tagPath))
+            target->removeRecord(path);
+    }
+}
+
+void QNearFieldManagerPrivateImpl::onPropertiesChanged(const QString &interface,
+                                                       const QVariantMap &changedProperties,
+                                                       const QStringList &)
+{
+    if (interface != NEARD_ADAPTER_INTERFACE)
+        return;
+
+    const auto powered = changedProperties.constFind(QStringLiteral("Powered"));
+    if (powered != changedProperties.cend() && powered.value().toBool() != m_powered) {
+        m_powered = powered.value().toBool();
+        if (!m_powered) {
+            clearTargets();
+            if (m_detecting) {
+                m_detecting = false;
+                Q_EMIT targetDetectionStopped();
+            }
+        }
+        Q_EMIT adapterStateChanged(m_powered ? QNearFieldManager::AdapterState::Online
+                                             : QNearFieldManager::AdapterState::Offline);
+    }
+}
+
+bool QNearFieldManagerPrivateImpl::readManagedObjects(ManagedObjectList *managedObjects) const
+{
+    QDBusPendingReply<ManagedObjectList> reply = m_objectManager->GetManagedObjects();
+    reply.waitForFinished();
+    if (reply.isError()) {
+        qCWarning(QT_NFC_NEARD) << "Cannot find neard:" << reply.error().message();
+        return false;
+    }
+
+    *managedObjects = reply.value();
+    return true;
+}
+
+void QNearFieldManagerPrivateImpl::selectAdapter(const ManagedObjectList &managedObjects)
+{
+    for (auto it = managedObjects.cbegin(), end = managedObjects.cend(); it != end; ++it) {
+        const auto adapter = it.value().constFind(NEARD_ADAPTER_INTERFACE);
+        if (adapter == it.value().cend())
+            continue;
+
+        // Use the first adapter, as the other backends do for their single NFC controller
+        setAdapter(it.key().path(), adapter.value());
+        return;
+    }
+}
+
+void QNearFieldManagerPrivateImpl::setAdapter(const QString &path, const QVariantMap &properties)
+{
+    m_adapterPath = path;
+    m_powered = properties.value(QStringLiteral("Powered")).toBool();
+
+    qCDebug(QT_NFC_NEARD) << "Using NFC adapter" << m_adapterPath;
+
+    const QDBusConnection connection = neardConnection();
+    m_adapter = new OrgNeardAdapterInterface(NEARD_SERVICE, m_adapterPath, connection, this);
+    m_adapterProperties = new NeardPropertiesInterface(NEARD_SERVICE, m_adapterPath,
+                                                       connection, this);
+
+    connect(m_adapterProperties, &NeardPropertiesInterface::PropertiesChanged,
+            this, &QNearFieldManagerPrivateImpl::onPropertiesChanged);
+}
+
+void QNearFieldManagerPrivateImpl::removeAdapter()
+{
+    clearTargets();
+    if (m_detecting) {
+        m_detecting = false;
+        Q_EMIT targetDetectionStopped();
+    }
+
+    delete m_adapter;
+    m_adapter = nullptr;
+    delete m_adapterProperties;
+    m_adapterProperties = nullptr;
+    m_adapterPath.clear();
+
+    if (std::exchange(m_powered, false))
+        Q_EMIT adapterStateChanged(QNearFieldManager::AdapterState::Offline);
+}
+
+void QNearFieldManagerPrivateImpl::addExistingTags(const ManagedObjectList &managedObjects)
+{
+    const QString prefix = m_adapterPath + QLatin1Char('/');
+
+    // Records live below their tag, so all tags have to be known first
+    for (auto it = managedObjects.cbegin(), end = managedObjects.cend(); it != end; ++it) {
+        const auto tag = it.value().constFind(NEARD_TAG_INTERFACE);
+        if (tag != it.value().cend() && it.key().path().startsWith(prefix))
+            addTag(it.key(), tag.value());
+    }
+    for (auto it = managedObjects.cbegin(), end = managedObjects.cend(); it != end; ++it) {
+        if (it.value().contains(NEARD_RECORD_INTERFACE) && it.key().path().startsWith(prefix))
+            addRecord(it.key());
+    }
+}
+
+void QNearFieldManagerPrivateImpl::addTag(const QDBusObjectPath &path,
+                                          const QVariantMap &properties)
+{
+    // Tags found while not detecting are reported once detection starts
+    if (!m_detecting || m_targets.contains(path.path()))
+        return;
+
+    QNearFieldTargetPrivateImpl *target = new QNearFieldTargetPrivateImpl(path, properties, this);
+    m_targets.insert(path.path(), target);
+    Q_EMIT targetDetected(new NearFieldTarget(target, this));
+}
+
+void QNearFieldManagerPrivateImpl::addRecord(const QDBusObjectPath &path)
+{
+    const QString tagPath = path.path().section(QLatin1Char('/'), 0, -2);
+    if (QNearFieldTargetPrivateImpl *target = m_targets.value(tagPath))
+        target->addRecord(path);
+}
+
+void QNearFieldManagerPrivateImpl::removeTag(const QDBusObjectPath &path)
+{
+    if (!m_targets.contains(path.path()))
+        return;
+
+    // The application may delete the target at any time, also when told it is lost
+    const QPointer<QNearFieldTargetPrivateImpl> target = m_targets.take(path.path());
+    if (target)
+        Q_EMIT targetLost(target->q_ptr);
+    if (target)
+        target->invalidate();
+
+    if (m_detecting && m_targets.isEmpty())
+        startPollLoop();
+}
+
+void QNearFieldManagerPrivateImpl::startPollLoop()
+{
+    QDBusPendingCallWatcher *watcher =
+            new QDBusPendingCallWatcher(m_adapter->StartPollLoop(QStringLiteral("Initiator")), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this,
+            [this](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        const QDBusPendingReply<> reply = *watcher;
+        if (reply.isError() && m_detecting) {
+            qCWarning(QT_NFC_NEARD) << "Cannot start polling on" << m_adapterPath << ":"
+                                    << reply.error().message();
+            m_detecting = false;
+            Q_EMIT targetDetectionStopped();
+        }
+    });
+}
+
+void QNearFieldManagerPrivateImpl::clearTargets()
+{
+    const auto targets = std::exchange(m_targets, {});
+    for (const QPointer<QNearFieldTargetPrivateImpl> &target : targets) {
+        if (target)
+            Q_EMIT targetLost(target->q_ptr);
+        if (target)
+            target->invalidate();
+    }
+}
+
+QT_END_NAMESPACE
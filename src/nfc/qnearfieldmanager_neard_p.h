@@ -0,0 +1,113 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QNEARFIELDMANAGER_NEARD_P_H
+#define QNEARFIELDMANAGER_NEARD_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qnearfieldmanager_p.h"
+#include "neard/neard_helper_p.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
+#include <QtDBus/QDBusObjectPath>
+
+class NeardObjectManagerInterface;
+class NeardPropertiesInterface;
+class OrgNeardAdapterInterface;
+
+QT_BEGIN_NAMESPACE
+
+class QNearFieldTargetPrivateImpl;
+
+class QNearFieldManagerPrivateImpl : public QNearFieldManagerPrivate
+{
+    Q_OBJECT
+
+public:
+    QNearFieldManagerPrivateImpl();
+    ~QNearFieldManagerPrivateImpl() override;
+
+    bool isEnabled() const override;
+    bool isSupported(QNearFieldTarget::AccessMethod accessMethod) const override;
+
+    bool startTargetDetection(QNearFieldTarget::AccessMethod accessMethod) override;
+    void stopTargetDetection(const QString &errorMessage) override;
+
+private Q_SLOTS:
+    void onInterfacesAdded(const QDBusObjectPath &path, const InterfaceList &interfaces);
+    void onInterfacesRemoved(const QDBusObjectPath &path, const QStringList &interfaces);
+    void onPropertiesChanged(const QString &interface, const QVariantMap &changedProperties,
+                             const QStringList &invalidatedProperties);
+
+private:
+    bool readManagedObjects(ManagedObjectList *managedObjects) const;
+    void selectAdapter(const ManagedObjectList &managedObjects);
+    void setAdapter(const QString &path, const QVariantMap &properties);
+    void removeAdapter();
+    void addExistingTags(const ManagedObjectList &managedObjects);
+    void addTag(const QDBusObjectPath &path, const QVariantMap &properties);
+    void addRecord(const QDBusObjectPath &path);
+    void removeTag(const QDBusObjectPath &path);
+    void startPollLoop();
+    void clearTargets();
+
+    NeardObjectManagerInterface *m_objectManager = nullptr;
+    OrgNeardAdapterInterface *m_adapter = nullptr;
+    NeardPropertiesInterface *m_adapterProperties = nullptr;
+    QString m_adapterPath;
+    bool m_powered = false;
+    bool m_detecting = false;
+    // the targets are owned by the application, which may delete them at any time
+    QHash<QString, QPointer<QNearFieldTargetPrivateImpl>> m_targets;
+};
+
+QT_END_NAMESPACE
+
+#endif // QNEARFIELDMANAGER_NEARD_P_H
@@ -0,0 +1,588 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qnearfieldtagtype2memory_p.h"
+#include "qnearfieldtarget_p.h"
+#include "qtlv_p.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QNearFieldTagType2Memory
+    \brief The QNearFieldTagType2Memory class provides NDEF access to the memory of an NFC Forum
+           Type 2 tag.
+
+    \ingroup connectivity-nfc
+    \inmodule QtNfc
+    \internal
+
+    QNearFieldTagType2Memory implements readNdefMessages() and writeNdefMessages() on top of the
+    raw READ, FAST_READ and WRITE commands of a target which supports
+    QNearFieldTarget::TagTypeSpecificAccess.
+
+    The tag memory is fetched in bulk: after the capability container has been read, the whole
+    data area is requested with as few FAST_READ commands as the frame size reported by
+    QNearFieldTarget::maxCommandLength() allows. All commands of a step are sent without waiting
+    for the previous response. If the tag rejects FAST_READ, the memory is read with READ
+    commands instead.
+
+    The memory is cached for the lifetime of the object, which is expected to be one session with
+    the tag. Subsequent reads are served from the cache and writes only send WRITE commands for
+    the pages which differ from the cached memory. The owner must call invalidate() if it
+    modifies the tag memory by other means.
+
+    Only sector 0 is accessed, which limits the usable data area to 1008 bytes.
+*/
+
+namespace {
+constexpr int PageSize = 4;
+constexpr int ReadPages = 4;        // pages returned by one READ command
+constexpr int HeaderSize = 16;      // UID, lock bytes and capability container
+constexpr int SectorSize = 1024;
+
+constexpr quint8 ReadCommand = 0x30;
+constexpr quint8 FastReadCommand = 0x3a;
+constexpr quint8 WriteCommand = 0xa2;
+
+constexpr quint8 NdefMagicNumber = 0xe1;
+}
+
+/*!
+    Constructs a memory access object for \a target with \a parent. The commands are sent using
+    QNearFieldTargetPrivate::sendCommand().
+*/
+QNearFieldTagType2Memory::QNearFieldTagType2Memory(QNearFieldTargetPrivate *target,
+                                                   QObject *parent)
+:   QObject(parent), m_target(target)
+{
+    connect(m_target, &QNearFieldTargetPrivate::requestCompleted,
+            this, &QNearFieldTagType2Memory::handleRequestCompleted);
+    connect(m_target, &QNearFieldTargetPrivate::error,
+            this, &QNearFieldTagType2Memory::handleError);
+}
+
+QNearFieldTagType2Memory::~QNearFieldTagType2Memory()
+{
+}
+
+/*!
+    Returns true if the header and the complete data area of the tag are cached.
+*/
+bool QNearFieldTagType2Memory::isCached() const
+{
+    return m_memorySize != -1 && m_cachedPages.count(true) == m_cachedPages.size();
+}
+
+/*!
+    Returns the cached memory of the tag starting at page 0. Pages which have not been read yet
+    are filled with zeros.
+*/
+QByteArray QNearFieldTagType2Memory::cachedMemory() const
+{
+    return m_memory;
+}
+
+/*!
+    Drops the cached memory. The next operation reads the tag memory again.
+*/
+void QNearFieldTagType2Memory::invalidate()
+{
+    m_memory.clear();
+    m_cachedPages.clear();
+    m_memorySize = -1;
+}
+
+/*!
+    Reads the whole tag memory into the cache. requestCompleted() is emitted for \a id once the
+    cache is filled; error() is emitted for \a id if the tag cannot be read.
+*/
+void QNearFieldTagType2Memory::fillCache(const QNearFieldTarget::RequestId &id)
+{
+    enqueue({ OperationType::FillCache, id, QByteArray() });
+}
+
+/*!
+    Returns true if the cached tag memory contains a non-empty NDEF message. Returns false if
+    the memory has not been cached yet, see fillCache().
+*/
+bool QNearFieldTagType2Memory::hasNdefMessage() const
+{
+    if (!isCached() || !isNdefFormatted())
+        return false;
+
+    const QList<QByteArray> messages = cachedNdefMessages();
+    return std::any_of(messages.cbegin(), messages.cend(), [](const QByteArray &message) {
+        return !message.isEmpty();
+    });
+}
+
+/*!
+    Reads the NDEF messages stored on the tag. ndefMessageRead() is emitted for every message
+    found, followed by requestCompleted() for \a id. error() is emitted for \a id if the tag
+    cannot be read.
+*/
+void QNearFieldTagType2Memory::readNdefMessages(const QNearFieldTarget::RequestId &id)
+{
+    enqueue({ OperationType::ReadNdef, id, QByteArray() });
+}
+
+/*!
+    Writes \a message to the tag. requestCompleted() is emitted for \a id once all changed pages
+    have been written; error() is emitted for \a id if the message cannot be written.
+*/
+void QNearFieldTagType2Memory::writeNdefMessage(const QNearFieldTarget::RequestId &id,
+                                                const QNdefMessage &message)
+{
+    enqueue({ OperationType::WriteNdef, id, message.toByteArray() });
+}
+
+/*!
+    Returns the command counters. lastNdefReadCommands and lastNdefWriteCommands are the number of
+    commands sent by the most recent NDEF read and write operation.
+*/
+QNearFieldTagType2Memory::Statistics QNearFieldTagType2Memory::statistics() const
+{
+    return m_statistics;
+}
+
+void QNearFieldTagType2Memory::resetStatistics()
+{
+    m_statistics = Statistics();
+}
+
+void QNearFieldTagType2Memory::enqueue(const Operation &operation)
+{
+    m_operations.append(operation);
+
+    // Completion is always reported asynchronously, so that the caller
+    // has a chance to store the request id.
+    if (m_operations.size() == 1)
+        scheduleContinue();
+}
+
+void QNearFieldTagType2Memory::scheduleContinue()
+{
+    if (m_continueScheduled)
+        return;
+
+    m_continueScheduled = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        m_continueScheduled = false;
+        continueOperation();
+    }, Qt::QueuedConnection);
+}
+
+void QNearFieldTagType2Memory::continueOperation()
+{
+    if (m_operations.isEmpty() || !m_pendingCommands.isEmpty())
+        return;
+
+    if (m_commandError != QNearFieldTarget::NoError) {
+        finishOperation(m_commandError);
+        return;
+    }
+
+    if (m_memorySize == -1) {
+        // The capability container tells how much memory has to be read
+        sendCommand({ CommandType::Read, 0, ReadPages, QByteArray() });
+        if (m_pendingCommands.isEmpty())
+            scheduleContinue();
+        return;
+    }
+
+    if (!isCached()) {
+        readMissingPages();
+        if (m_pendingCommands.isEmpty())
+            scheduleContinue();
+        return;
+    }
+
+    Operation &operation = m_operations.first();
+
+    switch (operation.type) {
+    case OperationType::FillCache:
+        finishOperation();
+        break;
+    case OperationType::ReadNdef: {
+        if (!isNdefFormatted()) {
+            finishOperation(QNearFieldTarget::NdefReadError);
+            break;
+        }
+
+        const QList<QByteArray> messages = cachedNdefMessages();
+        for (const QByteArray &message : messages)
+            Q_EMIT ndefMessageRead(QNdefMessage::fromByteArray(message));
+
+        finishOperation();
+        break;
+    }
+    case OperationType::WriteNdef: {
+        if (operation.written) {
+            finishOperation();
+            break;
+        }
+
+        if (!isNdefFormatted() || !isWritable()) {
+            finishOperation(QNearFieldTarget::NdefWriteError);
+            break;
+        }
+
+        const QByteArray image = memoryImage(operation.ndef);
+        if (image.isEmpty()) {
+            qWarning("QNearFieldTarget::writeNdefMessages: NDEF message does not fit on the tag.");
+            finishOperation(QNearFieldTarget::NdefWriteError);
+            break;
+        }
+
+        operation.written = true;
+        writeChangedPages(image);
+        if (m_pendingCommands.isEmpty())
+            scheduleContinue();
+        break;
+    }
+    }
+}
+
+void QNearFieldTagType2Memory::finishOperation(QNearFieldTarget::Error error)
+{
+    const Operation operation = m_operations.takeFirst();
+    const int commands = std::exchange(m_operationCommands, 0);
+    m_commandError = QNearFieldTarget::NoError;
+
+    switch (operation.type) {
+    case OperationType::FillCache:
+        break;
+    case OperationType::ReadNdef:
+        m_statistics.lastNdefReadCommands = commands;
+        break;
+    case OperationType::WriteNdef:
+        m_statistics.lastNdefWriteCommands = commands;
+        // Some pages may have been written, the cache cannot be trusted anymore
+        if (error != QNearFieldTarget::NoError)
+            invalidate();
+        break;
+    }
+
+    if (!m_operations.isEmpty())
+        scheduleContinue();
+
+    if (error == QNearFieldTarget::NoError)
+        Q_EMIT requestCompleted(operation.id);
+    else
+        Q_EMIT this->error(error, operation.id);
+}
+
+/*!
+    Requests the pages from \a firstPage to \a lastPage, both inclusive, with as few commands as
+    possible. All commands are sent at once.
+*/
+void QNearFieldTagType2Memory::readPages(int firstPage, int lastPage)
+{
+    const int fastReadPages = pagesPerFastRead();
+
+    for (int page = firstPage; page <= lastPage;) {
+        int count = lastPage - page + 1;
+
+        // READ returns four pages anyway, FAST_READ only pays off for more
+        if (fastReadPages > ReadPages && count > ReadPages) {
+            count = qMin(count, fastReadPages);
+            if (!sendCommand({ CommandType::FastRead, page, count, QByteArray() }))
+                return;
+        } else {
+            count = qMin(count, ReadPages);
+            if (!sendCommand({ CommandType::Read, page, count, QByteArray() }))
+                return;
+        }
+
+        page += count;
+    }
+}
+
+void QNearFieldTagType2Memory::readMissingPages()
+{
+    const int pageCount = m_cachedPages.size();
+
+    for (int page = 0; page < pageCount;) {
+        if (m_cachedPages.testBit(page)) {
+            ++page;
+            continue;
+        }
+
+        int lastPage = page;
+        while (lastPage + 1 < pageCount && !m_cachedPages.testBit(lastPage + 1))
+            ++lastPage;
+
+        readPages(page, lastPage);
+        page = lastPage + 1;
+    }
+}
+
+/*!
+    Sends a WRITE command for every page of \a image which differs from the cached memory.
+    Returns false if a command could not be sent.
+*/
+bool QNearFieldTagType2Memory::writeChangedPages(const QByteArray &image)
+{
+    for (int offset = HeaderSize; offset < m_memorySize; offset += PageSize) {
+        if (memcmp(image.constData() + offset, m_memory.constData() + offset, PageSize) == 0)
+            continue;
+
+        if (!sendCommand({ CommandType::Write, offset / PageSize, 1, image.mid(offset, PageSize) }))
+            return false;
+    }
+
+    return true;
+}
+
+bool QNearFieldTagType2Memory::sendCommand(const Command &command)
+{
+    QByteArray data;
+    data.reserve(2 + PageSize);
+
+    switch (command.type) {
+    case CommandType::Read:
+        data.append(char(ReadCommand));
+        data.append(char(command.page));
+        break;
+    case CommandType::FastRead:
+        data.append(char(FastReadCommand));
+        data.append(char(command.page));
+        data.append(char(command.page + command.pageCount - 1));
+        break;
+    case CommandType::Write:
+        data.append(char(WriteCommand));
+        data.append(char(command.page));
+        data.append(command.data);
+        break;
+    }
+
+    const QNearFieldTarget::RequestId id = m_target->sendCommand(data);
+    if (!id.isValid()) {
+        if (m_commandError == QNearFieldTarget::NoError) {
+            m_commandError = command.type == CommandType::Write ? QNearFieldTarget::NdefWriteError
+                                                                : QNearFieldTarget::NdefReadError;
+        }
+        return false;
+    }
+
+    m_pendingCommands.insert(id, command);
+
+    ++m_operationCommands;
+    if (command.type == CommandType::Write)
+        ++m_statistics.writeCommands;
+    else
+        ++m_statistics.readCommands;
+
+    return true;
+}
+
+void QNearFieldTagType2Memory::handleRequestCompleted(const QNearFieldTarget::RequestId &id)
+{
+    const auto it = m_pendingCommands.constFind(id);
+    if (it == m_pendingCommands.cend())
+        return;
+
+    const Command command = it.value();
+    m_pendingCommands.erase(it);
+
+    handleResponse(command, m_target->requestResponse(id).toByteArray());
+
+    if (m_pendingCommands.isEmpty())
+        continueOperation();
+}
+
+void QNearFieldTagType2Memory::handleError(QNearFieldTarget::Error error,
+                                           const QNearFieldTarget::RequestId &id)
+{
+    const auto it = m_pendingCommands.constFind(id);
+    if (it == m_pendingCommands.cend())
+        return;
+
+    const Command command = it.value();
+    m_pendingCommands.erase(it);
+
+    if (command.type == CommandType::FastRead && error != QNearFieldTarget::TargetOutOfRangeError) {
+        // FAST_READ is optional, fall back to READ
+        m_fastReadSupported = false;
+        readPages(command.page, command.page + command.pageCount - 1);
+    } else if (m_commandError == QNearFieldTarget::NoError) {
+        if (error == QNearFieldTarget::TargetOutOfRangeError)
+            m_commandError = error;
+        else if (command.type == CommandType::Write)
+            m_commandError = QNearFieldTarget::NdefWriteError;
+        else
+            m_commandError = QNearFieldTarget::NdefReadError;
+    }
+
+    if (m_pendingCommands.isEmpty())
+        continueOperation();
+}
+
+void QNearFieldTagType2Memory::handleResponse(const Command &command, const QByteArray &response)
+{
+    switch (command.type) {
+    case CommandType::Read:
+        if (response.size() < ReadPages * PageSize) {
+            m_commandError = QNearFieldTarget::NdefReadError;
+            return;
+        }
+
+        if (m_memorySize == -1) {
+            // Stale response of a read sent before the cache was invalidated
+            if (command.page != 0)
+                return;
+
+            const QByteArray header = response.left(HeaderSize);
+            if (quint8(header.at(12)) == NdefMagicNumber)
+                m_memorySize = qMin(HeaderSize + 8 * quint8(header.at(14)), SectorSize);
+            else
+                m_memorySize = HeaderSize;
+
+            m_memory = header + QByteArray(m_memorySize - HeaderSize, '\0');
+            m_cachedPages = QBitArray(m_memorySize / PageSize);
+        }
+        break;
+    case CommandType::FastRead:
+        if (response.size() != command.pageCount * PageSize) {
+            // The tag NACKed the command, fall back to READ
+            m_fastReadSupported = false;
+            readPages(command.page, command.page + command.pageCount - 1);
+            return;
+        }
+        break;
+    case CommandType::Write:
+        if (response.size() != 1 || (quint8(response.at(0)) & 0x0f) != 0x0a) {
+            m_commandError = QNearFieldTarget::NdefWriteError;
+            return;
+        }
+        break;
+    }
+
+    if (m_memorySize == -1)
+        return;
+
+    const QByteArray &data = command.type == CommandType::Write ? command.data : response;
+    const int pageCount = qMin(command.pageCount, m_cachedPages.size() - command.page);
+    for (int i = 0; i < pageCount; ++i) {
+        m_memory.replace((command.page + i) * PageSize, PageSize, data.mid(i * PageSize, PageSize));
+        m_cachedPages.setBit(command.page + i);
+    }
+}
+
+bool QNearFieldTagType2Memory::isNdefFormatted() const
+{
+    return m_memory.size() >= HeaderSize && quint8(m_memory.at(12)) == NdefMagicNumber;
+}
+
+bool QNearFieldTagType2Memory::isWritable() const
+{
+    // The lower nibble of the last capability container byte grants write access
+    return (quint8(m_memory.at(15)) & 0x0f) == 0x00;
+}
+
+QList<QByteArray> QNearFieldTagType2Memory::cachedNdefMessages() const
+{
+    QList<QByteArray> messages;
+
+    QTlvReader reader(m_memory);
+    reader.addReservedMemory(0, HeaderSize);
+    while (!reader.atEnd()) {
+        if (!reader.readNext())
+            break;
+
+        // NDEF Message TLV
+        if (reader.tag() == 0x03)
+            messages.append(reader.data());
+    }
+
+    return messages;
+}
+
+/*!
+    Returns the tag memory with \a ndef stored in an NDEF Message TLV, or an empty byte array if
+    \a ndef does not fit into the data area. Lock and Memory Control TLVs are kept in front of
+    the NDEF Message TLV.
+*/
+QByteArray QNearFieldTagType2Memory::memoryImage(const QByteArray &ndef) const
+{
+    QList<QPair<quint8, QByteArray>> controlTlvs;
+
+    QTlvReader reader(m_memory);
+    reader.addReservedMemory(0, HeaderSize);
+    while (!reader.atEnd()) {
+        if (!reader.readNext())
+            break;
+
+        if (reader.tag() == 0x01 || reader.tag() == 0x02)
+            controlTlvs.append(qMakePair(reader.tag(), reader.data()));
+        else if (reader.tag() == 0x03)
+            break;
+    }
+
+    QByteArray image = m_memory;
+    {
+        QTlvWriter writer(&image);
+        writer.addReservedMemory(0, HeaderSize);
+
+        for (const auto &tlv : qAsConst(controlTlvs))
+            writer.writeTlv(tlv.first, tlv.second);
+
+        writer.writeTlv(0x03, ndef);
+        writer.writeTlv(0xfe);
+
+        if (!writer.process(true))
+            return QByteArray();
+    }
+
+    return image;
+}
+
+int QNearFieldTagType2Memory::pagesPerFastRead() const
+{
+    if (!m_fastReadSupported)
+        return 0;
+
+    return m_target->maxCommandLength() / PageSize;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,168 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QNEARFIELDTAGTYPE2MEMORY_P_H
+#define QNEARFIELDTAGTYPE2MEMORY_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qtnfcglobal_p.h"
+#include "qndefmessage.h"
+#include "qnearfieldtarget.h"
+
+#include <QtCore/QBitArray>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QObject>
+
+QT_BEGIN_NAMESPACE
+
+class QNearFieldTargetPrivate;
+
+class Q_AUTOTEST_EXPORT QNearFieldTagType2Memory : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Statistics
+    {
+        int readCommands = 0;
+        int writeCommands = 0;
+        int lastNdefReadCommands = 0;
+        int lastNdefWriteCommands = 0;
+    };
+
+    explicit QNearFieldTagType2Memory(QNearFieldTargetPrivate *target, QObject *parent = nullptr);
+    ~QNearFieldTagType2Memory() override;
+
+    bool isCached() const;
+    QByteArray cachedMemory() const;
+    void invalidate();
+
+    void fillCache(const QNearFieldTarget::RequestId &id);
+    bool hasNdefMessage() const;
+    void readNdefMessages(const QNearFieldTarget::RequestId &id);
+    void writeNdefMessage(const QNearFieldTarget::RequestId &id, const QNdefMessage &message);
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+Q_SIGNALS:
+    void ndefMessageRead(const QNdefMessage &message);
+    void requestCompleted(const QNearFieldTarget::RequestId &id);
+    void error(QNearFieldTarget::Error error, const QNearFieldTarget::RequestId &id);
+
+private:
+    enum class OperationType {
+        FillCache,
+        ReadNdef,
+        WriteNdef
+    };
+
+    struct Operation
+    {
+        OperationType type;
+        QNearFieldTarget::RequestId id;
+        QByteArray ndef;
+        bool written = false;
+    };
+
+    enum class CommandType {
+        Read,
+        FastRead,
+        Write
+    };
+
+    struct Command
+    {
+        CommandType type;
+        int page;
+        int pageCount;
+        QByteArray data;
+    };
+
+    void enqueue(const Operation &operation);
+    void continueOperation();
+    void finishOperation(QNearFieldTarget::Error error = QNearFieldTarget::NoError);
+
+    void readPages(int firstPage, int lastPage);
+    void readMissingPages();
+    bool writeChangedPages(const QByteArray &image);
+    bool sendCommand(const Command &command);
+    void scheduleContinue();
+
+    void handleRequestCompleted(const QNearFieldTarget::RequestId &id);
+    void handleError(QNearFieldTarget::Error error, const QNearFieldTarget::RequestId &id);
+    void handleResponse(const Command &command, const QByteArray &response);
+
+    bool isNdefFormatted() const;
+    bool isWritable() const;
+    QList<QByteArray> cachedNdefMessages() const;
+    QByteArray memoryImage(const QByteArray &ndef) const;
+    int pagesPerFastRead() const;
+
+    QNearFieldTargetPrivate *m_target;
+
+    QByteArray m_memory;
+    QBitArray m_cachedPages;
+    int m_memorySize = -1;
+    bool m_fastReadSupported = true;
+
+    QList<Operation> m_operations;
+    bool m_continueScheduled = false;
+    QMap<QNearFieldTarget::RequestId, Command> m_pendingCommands;
+    QNearFieldTarget::Error m_commandError = QNearFieldTarget::NoError;
+    int m_operationCommands = 0;
+
+    Statistics m_statistics;
+};
+
+QT_END_NAMESPACE
+
+#endif // QNEARFIELDTAGTYPE2MEMORY_P_H
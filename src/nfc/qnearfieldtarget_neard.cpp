@@ -0,0 +1,221 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qnearfieldtarget_neard_p.h"
+#include "neard/neard_helper_p.h"
+#include "neard/tag_p.h"
+
+QT_BEGIN_NAMESPACE
+
+static QNearFieldTarget::Type typeFromProperties(const QVariantMap &properties)
+{
+    const QString type = properties.value(QStringLiteral("Type")).toString();
+
+    if (type == QLatin1String("Type 1"))
+        return QNearFieldTarget::NfcTagType1;
+    if (type == QLatin1String("Type 2"))
+        return QNearFieldTarget::NfcTagType2;
+    if (type == QLatin1String("Type 3"))
+        return QNearFieldTarget::NfcTagType3;
+    if (type == QLatin1String("Type 4A"))
+        return QNearFieldTarget::NfcTagType4A;
+    if (type == QLatin1String("Type 4B"))
+        return QNearFieldTarget::NfcTagType4B;
+    if (type.startsWith(QLatin1String("Type 4")))
+        return QNearFieldTarget::NfcTagType4;
+    if (type.startsWith(QLatin1String("MIFARE")))
+        return QNearFieldTarget::MifareTag;
+
+    return QNearFieldTarget::ProprietaryTag;
+}
+
+QNearFieldTargetPrivateImpl::QNearFieldTargetPrivateImpl(const QDBusObjectPath &tagPath,
+                                                         const QVariantMap &properties,
+                                                         QObject *parent)
+:   QNearFieldTargetPrivate(parent),
+    m_tagPath(tagPath),
+    m_type(typeFromProperties(properties)),
+    m_readOnly(properties.value(QStringLiteral("ReadOnly")).toBool())
+{
+    m_tag = new OrgNeardTagInterface(NEARD_SERVICE, tagPath.path(), neardConnection(), this);
+    qCDebug(QT_NFC_NEARD) << "tag" << tagPath.path() << "type" << m_type
+                          << "read only" << m_readOnly;
+}
+
+QNearFieldTargetPrivateImpl::~QNearFieldTargetPrivateImpl()
+{
+}
+
+QByteArray QNearFieldTargetPrivateImpl::uid() const
+{
+    // neard does not expose the UID of a tag
+    return QByteArray();
+}
+
+QNearFieldTarget::Type QNearFieldTargetPrivateImpl::type() const
+{
+    return m_type;
+}
+
+QNearFieldTarget::AccessMethods QNearFieldTargetPrivateImpl::accessMethods() const
+{
+    // neard only offers NDEF level access to tags
+    return QNearFieldTarget::NdefAccess;
+}
+
+bool QNearFieldTargetPrivateImpl::disconnect()
+{
+    // neard keeps the tag connected as long as it is in range
+    return false;
+}
+
+bool QNearFieldTargetPrivateImpl::hasNdefMessage()
+{
+    return m_valid && !m_recordPaths.isEmpty();
+}
+
+QNearFieldTarget::RequestId QNearFieldTargetPrivateImpl::readNdefMessages()
+{
+    QNearFieldTarget::RequestId requestId(new QNearFieldTarget::RequestIdPrivate);
+    if (!m_valid) {
+        reportError(QNearFieldTarget::TargetOutOfRangeError, requestId);
+        return requestId;
+    }
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_tag->GetRawNDEF(), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this,
+            [this, requestId](QDBusPendingCallWatcher *watcher) {
+        handleReadFinished(watcher, requestId);
+    });
+
+    return requestId;
+}
+
+QNearFieldTarget::RequestId
+QNearFieldTargetPrivateImpl::writeNdefMessages(const QList<QNdefMessage> &messages)
+{
+    if (messages.isEmpty())
+        return QNearFieldTarget::RequestId();
+
+    if (messages.size() > 1)
+        qCWarning(QT_NFC_NEARD, "QNearFieldTarget::writeNdefMessages: neard supports writing only one NDEF message per tag.");
+
+    QNearFieldTarget::RequestId requestId(new QNearFieldTarget::RequestIdPrivate);
+    if (!m_valid) {
+        reportError(QNearFieldTarget::TargetOutOfRangeError, requestId);
+        return requestId;
+    }
+
+    if (m_readOnly) {
+        reportError(QNearFieldTarget::NdefWriteError, requestId);
+        return requestId;
+    }
+
+    // The raw NDEF message is written as it is, so that all record types
+    // are supported and not only those neard knows how to build.
+    QVariantMap attributes;
+    attributes.insert(QStringLiteral("Type"), QStringLiteral("Raw"));
+    attributes.insert(QStringLiteral("NDEF"), messages.first().toByteArray());
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_tag->Write(attributes), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this,
+            [this, requestId](QDBusPendingCallWatcher *watcher) {
+        handleWriteFinished(watcher, requestId);
+    });
+
+    return requestId;
+}
+
+void QNearFieldTargetPrivateImpl::addRecord(const QDBusObjectPath &recordPath)
+{
+    m_recordPaths.insert(recordPath.path());
+}
+
+void QNearFieldTargetPrivateImpl::removeRecord(const QDBusObjectPath &recordPath)
+{
+    m_recordPaths.remove(recordPath.path());
+}
+
+void QNearFieldTargetPrivateImpl::invalidate()
+{
+    if (!m_valid)
+        return;
+
+    m_valid = false;
+    m_recordPaths.clear();
+    Q_EMIT disconnected();
+}
+
+void QNearFieldTargetPrivateImpl::handleReadFinished(QDBusPendingCallWatcher *watcher,
+                                                     const QNearFieldTarget::RequestId &id)
+{
+    watcher->deleteLater();
+
+    const QDBusPendingReply<QByteArray> reply = *watcher;
+    if (reply.isError()) {
+        qCWarning(QT_NFC_NEARD) << "Reading NDEF message from" << m_tagPath.path()
+                                << "failed:" << reply.error().message();
+        reportError(m_valid ? QNearFieldTarget::NdefReadError
+                            : QNearFieldTarget::TargetOutOfRangeError, id);
+        return;
+    }
+
+    const QNdefMessage message = QNdefMessage::fromByteArray(reply.value());
+    Q_EMIT ndefMessageRead(message);
+    setResponseForRequest(id, QVariant());
+}
+
+void QNearFieldTargetPrivateImpl::handleWriteFinished(QDBusPendingCallWatcher *watcher,
+                                                      const QNearFieldTarget::RequestId &id)
+{
+    watcher->deleteLater();
+
+    const QDBusPendingReply<> reply = *watcher;
+    if (reply.isError()) {
+        qCWarning(QT_NFC_NEARD) << "Writing NDEF message to" << m_tagPath.path()
+                                << "failed:" << reply.error().message();
+        reportError(m_valid ? QNearFieldTarget::NdefWriteError
+                            : QNearFieldTarget::TargetOutOfRangeError, id);
+        return;
+    }
+
+    setResponseForRequest(id, QVariant());
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QNEARFIELDTARGET_NEARD_P_H
+#define QNEARFIELDTARGET_NEARD_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qnearfieldtarget_p.h"
+#include "qndefmessage.h"
+
+#include <QtCore/QSet>
+#include <QtCore/QVariant>
+#include <QtDBus/QDBusObjectPath>
+
+class OrgNeardTagInterface;
+
+QT_BEGIN_NAMESPACE
+
+class QDBusPendingCallWatcher;
+
+class QNearFieldTargetPrivateImpl : public QNearFieldTargetPrivate
+{
+    Q_OBJECT
+
+public:
+    QNearFieldTargetPrivateImpl(const QDBusObjectPath &tagPath, const QVariantMap &properties,
+                                QObject *parent = nullptr);
+    ~QNearFieldTargetPrivateImpl() override;
+
+    QDBusObjectPath tagPath() const { return m_tagPath; }
+
+    QByteArray uid() const override;
+    QNearFieldTarget::Type type() const override;
+    QNearFieldTarget::AccessMethods accessMethods() const override;
+
+    bool disconnect() override;
+
+    bool hasNdefMessage() override;
+    QNearFieldTarget::RequestId readNdefMessages() override;
+    QNearFieldTarget::RequestId writeNdefMessages(const QList<QNdefMessage> &messages) override;
+
+    void addRecord(const QDBusObjectPath &recordPath);
+    void removeRecord(const QDBusObjectPath &recordPath);
+
+    // Called by the manager once neard has removed the tag object.
+    void invalidate();
+
+private:
+    void handleReadFinished(QDBusPendingCallWatcher *watcher,
+                            const QNearFieldTarget::RequestId &id);
+    void handleWriteFinished(QDBusPendingCallWatcher *watcher,
+                             const QNearFieldTarget::RequestId &id);
+
+    QDBusObjectPath m_tagPath;
+    OrgNeardTagInterface *m_tag = nullptr;
+    QNearFieldTarget::Type m_type = QNearFieldTarget::ProprietaryTag;
+    bool m_readOnly = false;
+    bool m_valid = true;
+    QSet<QString> m_recordPaths;
+};
+
+QT_END_NAMESPACE
+
+#endif // QNEARFIELDTARGET_NEARD_P_H
@@ -39,14 +39,24 @@
 
 #include "qtlv_p.h"
 
-#include "qnearfieldtagtype1_p.h"
-
 #include <QtCore/QVariant>
 
 #include <QtCore/QDebug>
 
 QT_BEGIN_NAMESPACE
 
+/*!
+    \class QTlvReader
+    \brief The QTlvReader class reads the TLV blocks stored in the memory of an NFC Forum tag.
+
+    \ingroup connectivity-nfc
+    \inmodule QtNfc
+    \internal
+
+    The reader operates on a memory image given to the constructor. Subclasses can fetch the
+    memory from a target on demand by reimplementing fetchData().
+*/
+
 QPair<int, int> qParseReservedMemoryControlTlv(const QByteArray &tlvData)
 {
     quint8 position = tlvData.at(0);
@@ -88,19 +98,25 @@ QPair<int, int> qParseLockControlTlv(const QByteArray &tlvData)
     return qMakePair(byteAddress, size);
 }
 
-QTlvReader::QTlvReader(QNearFieldTargetPrivate *target)
-:   m_target(target), m_index(-1)
+/*!
+    Constructs a TLV reader for the memory image \a data. Offsets are relative to the start of
+    \a data.
+*/
+QTlvReader::QTlvReader(const QByteArray &data)
+:   m_rawData(data), m_index(-1)
 {
-    if (qobject_cast<QNearFieldTagType1 *>(m_target)) {
-        addReservedMemory(0, 12);   // skip uid, cc
-        addReservedMemory(104, 16); // skip reserved block D, lock block E
+}
 
-        addReservedMemory(120, 8);  // skip reserved block F
-    }
+/*!
+    Constructs a TLV reader without a memory image. Subclasses provide the memory through
+    fetchData().
+*/
+QTlvReader::QTlvReader()
+:   m_index(-1)
+{
 }
 
-QTlvReader::QTlvReader(const QByteArray &data)
-:   m_target(0), m_rawData(data), m_index(-1)
+QTlvReader::~QTlvReader()
 {
 }
 
@@ -238,41 +254,41 @@ QByteArray QTlvReader::data()
     return m_tlvData.mid(dataOffset, tlvLength);
 }
 
-bool QTlvReader::readMoreData(int sparseOffset)
+/*!
+    Returns the absolute memory offset of the current TLV, or -1 if readNext() has not been
+    called yet.
+*/
+int QTlvReader::offset() const
 {
-    while (sparseOffset >= m_tlvData.length()) {
-        int absOffset = absoluteOffset(m_tlvData.length());
-
-        QByteArray data;
-
-        if (!m_rawData.isEmpty()) {
-            data = m_rawData.mid(absOffset, dataLength(absOffset));
-        } else if (QNearFieldTagType1 *tag = qobject_cast<QNearFieldTagType1 *>(m_target)) {
-            quint8 segment = absOffset / 128;
-
-            if (m_requestId.isValid()) {
-                QVariant v = m_target->requestResponse(m_requestId);
-                if (!v.isValid())
-                    return false;
-
-                m_requestId = QNearFieldTarget::RequestId();
+    if (m_index == -1)
+        return -1;
 
-                data = v.toByteArray();
+    return absoluteOffset(m_index);
+}
 
-                if (absOffset < 120)
-                    data = data.mid(2);
+/*!
+    Fetches up to \a length bytes of memory starting at \a absoluteOffset into \a data. A
+    \a length of -1 requests all memory up to the end of the tag.
 
-                int length = dataLength(absOffset);
+    Returns false if the data is not available yet. Subclasses which have to request the data from
+    a target set m_requestId to the pending request and return false until it has completed.
+*/
+bool QTlvReader::fetchData(int absoluteOffset, int length, QByteArray *data)
+{
+    *data = m_rawData.mid(absoluteOffset, length);
+    return true;
+}
 
-                data = data.mid(absOffset - (segment * 128), length);
-            } else {
-                m_requestId = (absOffset < 120) ? tag->readAll() : tag->readSegment(segment);
+bool QTlvReader::readMoreData(int sparseOffset)
+{
+    while (sparseOffset >= m_tlvData.length()) {
+        int absOffset = absoluteOffset(m_tlvData.length());
 
-                return false;
-            }
-        }
+        QByteArray data;
+        if (!fetchData(absOffset, dataLength(absOffset), &data))
+            return false;
 
-        if (data.isEmpty() && sparseOffset >= m_tlvData.length())
+        if (data.isEmpty())
             return false;
 
         m_tlvData.append(data);
@@ -310,20 +326,33 @@ int QTlvReader::dataLength(int startOffset) const
     return -1;
 }
 
+/*!
+    \class QTlvWriter
+    \brief The QTlvWriter class writes TLV blocks into the memory of an NFC Forum tag.
 
-QTlvWriter::QTlvWriter(QNearFieldTargetPrivate *target)
-:   m_target(target), m_rawData(0), m_index(0), m_tagMemorySize(-1)
-{
-    if (qobject_cast<QNearFieldTagType1 *>(m_target)) {
-        addReservedMemory(0, 12);   // skip uid, cc
-        addReservedMemory(104, 16); // skip reserved block D, lock block E
+    \ingroup connectivity-nfc
+    \inmodule QtNfc
+    \internal
 
-        addReservedMemory(120, 8);  // skip reserved block F
-    }
-}
+    The writer operates on a memory image given to the constructor. Subclasses can write to a
+    target directly by reimplementing fetchMemorySize() and writeData().
+*/
 
+/*!
+    Constructs a TLV writer for the memory image \a data. TLVs are written from the start of
+    \a data and the size of \a data is the available memory.
+*/
 QTlvWriter::QTlvWriter(QByteArray *data)
-:   m_target(0), m_rawData(data), m_index(0), m_tagMemorySize(-1)
+:   m_index(0), m_rawData(data), m_tagMemorySize(-1)
+{
+}
+
+/*!
+    Constructs a TLV writer without a memory image. Subclasses write to the memory through
+    writeData().
+*/
+QTlvWriter::QTlvWriter()
+:   m_index(0), m_rawData(nullptr), m_tagMemorySize(-1)
 {
 }
 
@@ -381,24 +410,13 @@ void QTlvWriter::writeTlv(quint8 tagType, const QByteArray &data)
 */
 bool QTlvWriter::process(bool all)
 {
-    if (m_requestId.isValid()) {
-        QVariant v = m_target->requestResponse(m_requestId);
-        if (!v.isValid())
-            return false;
-    }
+    if (m_requestId.isValid() && !isRequestCompleted())
+        return false;
 
     if (m_tagMemorySize == -1) {
-        if (m_rawData)
-            m_tagMemorySize = m_rawData->length();
-        else if (QNearFieldTagType1 *tag = qobject_cast<QNearFieldTagType1 *>(m_target)) {
-            if (m_requestId.isValid()) {
-                m_tagMemorySize = 8 * (tag->requestResponse(m_requestId).toUInt() + 1);
-                m_requestId = QNearFieldTarget::RequestId();
-            } else {
-                m_requestId = tag->readByte(10);
-                return false;
-            }
-        }
+        m_tagMemorySize = fetchMemorySize();
+        if (m_tagMemorySize == -1)
+            return false;
     }
 
     while (!m_buffer.isEmpty()) {
@@ -406,94 +424,8 @@ bool QTlvWriter::process(bool all)
         if (spaceRemaining < 1)
             return false;
 
-        int length = qMin(spaceRemaining, m_buffer.length());
-
-        if (m_rawData) {
-            m_rawData->replace(m_index, length, m_buffer);
-            m_index += length;
-            m_buffer = m_buffer.mid(length);
-        } else if (QNearFieldTagType1 *tag = qobject_cast<QNearFieldTagType1 *>(m_target)) {
-            int bufferIndex = 0;
-
-            // static memory - can only use writeByte()
-            while (m_index < 120 && bufferIndex < length) {
-                if (m_requestId.isValid()) {
-                    if (!m_target->requestResponse(m_requestId).toBool())
-                        return false;
-
-                    m_requestId = QNearFieldTarget::RequestId();
-
-                    ++m_index;
-                    ++bufferIndex;
-                } else {
-                    m_requestId = tag->writeByte(m_index, m_buffer.at(bufferIndex));
-                    m_buffer = m_buffer.mid(bufferIndex);
-                    return false;
-                }
-            }
-
-
-            // dynamic memory - writeBlock() full
-            while (m_index >= 120 && (m_index % 8 == 0) && bufferIndex + 8 < length) {
-                if (m_requestId.isValid()) {
-                    if (!m_target->requestResponse(m_requestId).toBool())
-                        return false;
-
-                    m_requestId = QNearFieldTarget::RequestId();
-
-                    m_index += 8;
-                    bufferIndex += 8;
-                } else {
-                    m_requestId = tag->writeBlock(m_index / 8, m_buffer.mid(bufferIndex, 8));
-                    m_buffer = m_buffer.mid(bufferIndex);
-                    return false;
-                }
-            }
-
-            // partial block
-            int currentBlock = m_index / 8;
-            int nextBlock = currentBlock + 1;
-            int currentBlockStart = currentBlock * 8;
-            int nextBlockStart = nextBlock * 8;
-
-            int fillLength = qMin(nextBlockStart - m_index, spaceRemaining - bufferIndex);
-
-            if (fillLength && (all || m_buffer.length() - bufferIndex >= fillLength) &&
-                (m_buffer.length() != bufferIndex)) {
-                // sufficient data available
-                if (m_requestId.isValid()) {
-                    const QVariant v = tag->requestResponse(m_requestId);
-                    if (v.typeId() == QMetaType::QByteArray) {
-                        // read in block
-                        QByteArray block = v.toByteArray();
-
-                        int fill = qMin(fillLength, m_buffer.length() - bufferIndex);
-
-                        for (int i = m_index - currentBlockStart; i < fill; ++i)
-                            block[i] = m_buffer.at(bufferIndex++);
-
-                        // now write block
-                        m_requestId = tag->writeBlock(currentBlock, block);
-                        return false;
-                    } else if (v.typeId() == QMetaType::Bool) {
-                        m_requestId = QNearFieldTarget::RequestId();
-                        int fill = qMin(fillLength, m_buffer.length() - bufferIndex);
-                        bufferIndex = fill - (m_index - currentBlockStart);
-
-                        // write complete
-                        if (!v.toBool())
-                            return false;
-                    }
-                } else {
-                    // read in block
-                    m_requestId = tag->readBlock(currentBlock);
-                    m_buffer = m_buffer.mid(bufferIndex);
-                    return false;
-                }
-            }
-
-            m_buffer = m_buffer.mid(bufferIndex);
-        }
+        if (!writeData(spaceRemaining, all))
+            return false;
     }
 
     return true;
@@ -504,6 +436,44 @@ QNearFieldTarget::RequestId QTlvWriter::requestId() const
     return m_requestId;
 }
 
+/*!
+    Returns true if the request identified by m_requestId has completed. Subclasses which send
+    requests to a target must reimplement this function.
+*/
+bool QTlvWriter::isRequestCompleted() const
+{
+    return true;
+}
+
+/*!
+    Returns the size of the memory that can be written, or -1 if it is not known yet.
+*/
+int QTlvWriter::fetchMemorySize()
+{
+    return m_rawData ? m_rawData->length() : -1;
+}
+
+/*!
+    Writes up to \a spaceRemaining bytes of m_buffer at m_index and removes the written bytes
+    from m_buffer. Returns false if the write is pending or has failed. If \a all is true the
+    buffer is being flushed and partially filled blocks must be written as well.
+*/
+bool QTlvWriter::writeData(int spaceRemaining, bool all)
+{
+    Q_UNUSED(all);
+
+    if (!m_rawData)
+        return false;
+
+    int length = qMin(spaceRemaining, m_buffer.length());
+
+    m_rawData->replace(m_index, length, m_buffer.left(length));
+    m_index += length;
+    m_buffer = m_buffer.mid(length);
+
+    return true;
+}
+
 int QTlvWriter::moveToNextAvailable()
 {
     int length = -1;
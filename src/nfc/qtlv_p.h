@@ -51,8 +51,8 @@
 // We mean it.
 //
 
-#include <QtNfc/qnearfieldtarget.h>
-#include <QtNfc/private/qnearfieldtarget_p.h>
+#include "qtnfcglobal_p.h"
+#include "qnearfieldtarget.h"
 
 #include <QtCore/QByteArray>
 #include <QtCore/QMap>
@@ -60,12 +60,11 @@
 
 QT_BEGIN_NAMESPACE
 
-class QNearFieldTarget;
-class QTlvReader
+class Q_AUTOTEST_EXPORT QTlvReader
 {
 public:
-    explicit QTlvReader(QNearFieldTargetPrivate *target);
     explicit QTlvReader(const QByteArray &data);
+    virtual ~QTlvReader();
 
     void addReservedMemory(int offset, int length);
     int reservedMemorySize() const;
@@ -80,26 +79,32 @@ public:
     int length();
     QByteArray data();
 
+    int offset() const;
+
+protected:
+    QTlvReader();
+
+    virtual bool fetchData(int absoluteOffset, int length, QByteArray *data);
+
+    QNearFieldTarget::RequestId m_requestId;
+
 private:
     bool readMoreData(int sparseOffset);
     int absoluteOffset(int sparseOffset) const;
     int dataLength(int startOffset) const;
 
-    QNearFieldTargetPrivate *m_target;
     QByteArray m_rawData;
-    QNearFieldTarget::RequestId m_requestId;
 
     QByteArray m_tlvData;
     int m_index;
     QMap<int, int> m_reservedMemory;
 };
 
-class QTlvWriter
+class Q_AUTOTEST_EXPORT QTlvWriter
 {
 public:
-    explicit QTlvWriter(QNearFieldTargetPrivate *target);
     explicit QTlvWriter(QByteArray *data);
-    ~QTlvWriter();
+    virtual ~QTlvWriter();
 
     void addReservedMemory(int offset, int length);
 
@@ -109,23 +114,29 @@ public:
 
     QNearFieldTarget::RequestId requestId() const;
 
+protected:
+    QTlvWriter();
+
+    virtual bool isRequestCompleted() const;
+    virtual int fetchMemorySize();
+    virtual bool writeData(int spaceRemaining, bool all);
+
+    int m_index;
+    QByteArray m_buffer;
+
+    QNearFieldTarget::RequestId m_requestId;
+
 private:
     int moveToNextAvailable();
 
-    QNearFieldTargetPrivate *m_target;
     QByteArray *m_rawData;
 
-    int m_index;
     int m_tagMemorySize;
     QMap<int, int> m_reservedMemory;
-
-    QByteArray m_buffer;
-
-    QNearFieldTarget::RequestId m_requestId;
 };
 
-QPair<int, int> qParseReservedMemoryControlTlv(const QByteArray &tlvData);
-QPair<int, int> qParseLockControlTlv(const QByteArray &tlvData);
+Q_AUTOTEST_EXPORT QPair<int, int> qParseReservedMemoryControlTlv(const QByteArray &tlvData);
+Q_AUTOTEST_EXPORT QPair<int, int> qParseLockControlTlv(const QByteArray &tlvData);
 
 QT_END_NAMESPACE
 
@@ -0,0 +1,257 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtBluetooth/private/bluetoothmanagement_p.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+// DeviceFound events as recorded from the mgmt control channel
+static const char randomDeviceFound[] =
+        "120000001100" "5544332211c0" "02" "c4" "00000000" "0300" "020106";
+static const char publicDeviceFound[] =
+        "120000001100" "1371da7d1a00" "01" "b5" "00000000" "0300" "020106";
+static const char randomDeviceConnected[] =
+        "0b0000000d00" "6655443322c1" "02" "00000000" "0000";
+// connection events on the second controller
+static const char deviceConnectedWithEir[] =
+        "0b0001001000" "6655443322c1" "02" "01000000" "0300" "020106";
+static const char deviceDisconnected[] =
+        "0c0001000800" "6655443322c1" "02" "13";
+static const char deviceDisconnectedWithoutReason[] =
+        "0c0001000700" "6655443322c1" "02";
+static const char connectFailed[] =
+        "0d0001000800" "1371da7d1a00" "01" "04";
+
+/*
+    The BluetoothManagement under test reads from a socket pair, the test
+    plays the kernel on the other end and feeds it mgmt events.
+ */
+class tst_BluetoothManagement : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void deviceFound();
+    void deviceFoundSignal();
+    void malformedDeviceFound();
+    void connectionEvents();
+    void severalEventsPerRead();
+    void eventSplitAcrossReads();
+    void truncatedDeviceFound();
+    void fullProbeWindowKeepsAddresses();
+
+private:
+    void sendEvents(const QByteArray &events);
+    static QByteArray deviceFoundEvent(quint64 address, quint8 addressType);
+
+    BluetoothManagement *management = nullptr;
+    int kernelSocket = -1;
+};
+
+void tst_BluetoothManagement::init()
+{
+    int fds[2];
+    QVERIFY(::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == 0);
+    kernelSocket = fds[0];
+    management = new BluetoothManagement(fds[1]);
+    QVERIFY(management->isMonitoringEnabled());
+}
+
+void tst_BluetoothManagement::cleanup()
+{
+    delete management;
+    management = nullptr;
+    ::close(kernelSocket);
+    kernelSocket = -1;
+}
+
+void tst_BluetoothManagement::sendEvents(const QByteArray &events)
+{
+    QCOMPARE(qsizetype(::write(kernelSocket, events.constData(), events.size())), events.size());
+}
+
+QByteArray tst_BluetoothManagement::deviceFoundEvent(quint64 address, quint8 addressType)
+{
+    QByteArray event = QByteArray::fromHex("120000000e00");
+    for (int i = 0; i < 6; ++i)
+        event.append(char(address >> (8 * i)));
+    event.append(char(addressType));
+    event.append(QByteArray::fromHex("c4000000000000"));
+    return event;
+}
+
+void tst_BluetoothManagement::deviceFound()
+{
+    const QBluetoothAddress randomAddress(QStringLiteral("C0:11:22:33:44:55"));
+    const QBluetoothAddress publicAddress(QStringLiteral("00:1A:7D:DA:71:13"));
+
+    sendEvents(QByteArray::fromHex(publicDeviceFound));
+    sendEvents(QByteArray::fromHex(randomDeviceFound));
+    QTRY_VERIFY(management->isAddressRandom(randomAddress));
+    QVERIFY(!management->isAddressRandom(publicAddress));
+    QVERIFY(!management->isAddressRandom(QBluetoothAddress()));
+}
+
+void tst_BluetoothManagement::deviceFoundSignal()
+{
+    QSignalSpy foundSpy(management, &BluetoothManagement::deviceFound);
+
+    sendEvents(QByteArray::fromHex(randomDeviceFound));
+    QTRY_COMPARE(foundSpy.count(), 1);
+    const QList<QVariant> arguments = foundSpy.takeFirst();
+    QCOMPARE(arguments.at(0).value<quint16>(), quint16(0));
+    QCOMPARE(arguments.at(1).value<QBluetoothAddress>(),
+             QBluetoothAddress(QStringLiteral("C0:11:22:33:44:55")));
+    QCOMPARE(arguments.at(2).value<quint8>(), quint8(0x02));
+    QCOMPARE(arguments.at(3).value<qint8>(), qint8(-60));
+    QCOMPARE(arguments.at(4).value<quint32>(), quint32(0));
+    QCOMPARE(arguments.at(5).toByteArray(), QByteArray::fromHex("020106"));
+}
+
+void tst_BluetoothManagement::malformedDeviceFound()
+{
+    QSignalSpy foundSpy(management, &BluetoothManagement::deviceFound);
+
+    // the EIR length exceeds the event
+    const QByteArray malformed = QByteArray::fromHex(
+            "120000000e00" "6655443322c1" "02" "c4" "00000000" "0500");
+    sendEvents(malformed + QByteArray::fromHex(publicDeviceFound));
+    QTRY_COMPARE(foundSpy.count(), 1);
+    QCOMPARE(foundSpy.first().at(1).value<QBluetoothAddress>(),
+             QBluetoothAddress(QStringLiteral("00:1A:7D:DA:71:13")));
+    QVERIFY(!management->isAddressRandom(QBluetoothAddress(QStringLiteral("C1:22:33:44:55:66"))));
+}
+
+void tst_BluetoothManagement::connectionEvents()
+{
+    QSignalSpy connectedSpy(management, &BluetoothManagement::deviceConnected);
+    QSignalSpy disconnectedSpy(management, &BluetoothManagement::deviceDisconnected);
+    QSignalSpy failedSpy(management, &BluetoothManagement::connectFailed);
+    const QBluetoothAddress randomAddress(QStringLiteral("C1:22:33:44:55:66"));
+
+    sendEvents(QByteArray::fromHex(deviceConnectedWithEir)
+               + QByteArray::fromHex(deviceDisconnected)
+               + QByteArray::fromHex(deviceDisconnectedWithoutReason)
+               + QByteArray::fromHex(connectFailed));
+    QTRY_COMPARE(failedSpy.count(), 1);
+
+    QCOMPARE(connectedSpy.count(), 1);
+    QCOMPARE(connectedSpy.first().at(0).value<quint16>(), quint16(1));
+    QCOMPARE(connectedSpy.first().at(1).value<QBluetoothAddress>(), randomAddress);
+    QCOMPARE(connectedSpy.first().at(2).value<quint8>(), quint8(0x02));
+    QCOMPARE(connectedSpy.first().at(3).value<quint32>(), quint32(1));
+    QCOMPARE(connectedSpy.first().at(4).toByteArray(), QByteArray::fromHex("020106"));
+
+    // kernels before 3.5 send no reason
+    QCOMPARE(disconnectedSpy.count(), 2);
+    QCOMPARE(disconnectedSpy.at(0).at(0).value<quint16>(), quint16(1));
+    QCOMPARE(disconnectedSpy.at(0).at(1).value<QBluetoothAddress>(), randomAddress);
+    QCOMPARE(disconnectedSpy.at(0).at(3).value<quint8>(), quint8(0x13));
+    QCOMPARE(disconnectedSpy.at(1).at(3).value<quint8>(), quint8(0));
+
+    QCOMPARE(failedSpy.first().at(1).value<QBluetoothAddress>(),
+             QBluetoothAddress(QStringLiteral("00:1A:7D:DA:71:13")));
+    QCOMPARE(failedSpy.first().at(2).value<quint8>(), quint8(0x01));
+    QCOMPARE(failedSpy.first().at(3).value<quint8>(), quint8(0x04));
+
+    // connection events do not mark addresses as random
+    QVERIFY(!management->isAddressRandom(randomAddress));
+}
+
+void tst_BluetoothManagement::severalEventsPerRead()
+{
+    // a connected event for a random device does not mark it
+    sendEvents(QByteArray::fromHex(randomDeviceConnected)
+               + QByteArray::fromHex(publicDeviceFound)
+               + QByteArray::fromHex(randomDeviceFound));
+    QTRY_VERIFY(management->isAddressRandom(QBluetoothAddress(QStringLiteral("C0:11:22:33:44:55"))));
+    QVERIFY(!management->isAddressRandom(QBluetoothAddress(QStringLiteral("C1:22:33:44:55:66"))));
+    QVERIFY(!management->isAddressRandom(QBluetoothAddress(QStringLiteral("00:1A:7D:DA:71:13"))));
+}
+
+void tst_BluetoothManagement::eventSplitAcrossReads()
+{
+    const QByteArray events = QByteArray::fromHex(publicDeviceFound)
+            + QByteArray::fromHex(randomDeviceFound);
+    const QBluetoothAddress randomAddress(QStringLiteral("C0:11:22:33:44:55"));
+
+    // the second event is cut inside its header and again inside its parameters
+    const int firstCut = events.size() / 2 + 3;
+    const int secondCut = events.size() - 4;
+    sendEvents(events.left(firstCut));
+    sendEvents(events.mid(firstCut, secondCut - firstCut));
+    QTest::qWait(50);
+    QVERIFY(!management->isAddressRandom(randomAddress));
+
+    sendEvents(events.mid(secondCut));
+    QTRY_VERIFY(management->isAddressRandom(randomAddress));
+}
+
+void tst_BluetoothManagement::truncatedDeviceFound()
+{
+    // the header announces fewer parameters than a DeviceFound event has
+    QByteArray truncated = QByteArray::fromHex("120000000700" "6655443322c1" "02");
+    sendEvents(truncated + QByteArray::fromHex(randomDeviceFound));
+    QTRY_VERIFY(management->isAddressRandom(QBluetoothAddress(QStringLiteral("C0:11:22:33:44:55"))));
+    QVERIFY(!management->isAddressRandom(QBluetoothAddress(QStringLiteral("C1:22:33:44:55:66"))));
+}
+
+void tst_BluetoothManagement::fullProbeWindowKeepsAddresses()
+{
+    // more random devices than the address table has slots
+    constexpr int deviceCount = 4096;
+    constexpr int eventsPerRead = 500;
+    const quint64 firstAddress = Q_UINT64_C(0xC00000000000);
+
+    QByteArray events;
+    for (int i = 0; i < deviceCount; ++i) {
+        events.append(deviceFoundEvent(firstAddress + i, 0x02));
+        if ((i + 1) % eventsPerRead == 0 || i == deviceCount - 1) {
+            sendEvents(events);
+            events.clear();
+        }
+    }
+
+    QTRY_VERIFY(management->isAddressRandom(QBluetoothAddress(firstAddress + deviceCount - 1)));
+    for (int i = 0; i < deviceCount; ++i)
+        QVERIFY2(management->isAddressRandom(QBluetoothAddress(firstAddress + i)),
+                 qPrintable(QBluetoothAddress(firstAddress + i).toString()));
+    QVERIFY(!management->isAddressRandom(QBluetoothAddress(firstAddress + deviceCount)));
+}
+
+QTEST_MAIN(tst_BluetoothManagement)
+
+#include "tst_bluetoothmanagement.moc"
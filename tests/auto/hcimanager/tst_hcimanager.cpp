@@ -0,0 +1,167 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include <QtBluetooth/private/bluez_data_p.h>
+#include <QtBluetooth/private/hcimanager_p.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+/*
+    The HciManager under test talks to a socket pair, the test plays the
+    controller on the other end.
+ */
+class tst_HciManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void setPhyCommand();
+    void setDataLengthCommand_data();
+    void setDataLengthCommand();
+    void phyUpdateEvent();
+    void dataLengthChangeEvent();
+    void truncatedLeMetaEvent();
+
+private:
+    QByteArray readCommand();
+    void sendLeMetaEvent(const QByteArray &parameters);
+
+    HciManager *manager = nullptr;
+    int controllerSocket = -1;
+};
+
+void tst_HciManager::init()
+{
+    int fds[2];
+    QVERIFY(::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == 0);
+    controllerSocket = fds[0];
+    manager = new HciManager(fds[1], 0);
+}
+
+void tst_HciManager::cleanup()
+{
+    delete manager;
+    manager = nullptr;
+    ::close(controllerSocket);
+    controllerSocket = -1;
+}
+
+QByteArray tst_HciManager::readCommand()
+{
+    char buffer[HCI_MAX_EVENT_SIZE + 4];
+    const int size = ::read(controllerSocket, buffer, sizeof buffer);
+    return size > 0 ? QByteArray(buffer, size) : QByteArray();
+}
+
+void tst_HciManager::sendLeMetaEvent(const QByteArray &parameters)
+{
+    QByteArray event;
+    event.append(char(HCI_EVENT_PKT));
+    event.append(char(HciManager::HciEvent::EVT_LE_META_EVENT));
+    event.append(char(parameters.size()));
+    event.append(parameters);
+    QCOMPARE(qsizetype(::write(controllerSocket, event.constData(), event.size())), event.size());
+}
+
+void tst_HciManager::setPhyCommand()
+{
+    QVERIFY(manager->sendSetPhyCommand(0x40, 0x2, 0));
+    // LE Set PHY: handle, no RX preference, 2M for TX, any coding
+    QCOMPARE(readCommand().toHex(), QByteArray("0132200740000202000000"));
+}
+
+void tst_HciManager::setDataLengthCommand_data()
+{
+    QTest::addColumn<quint16>("txOctets");
+    QTest::addColumn<QByteArray>("expectedCommand");
+
+    // octets and time, which is (octets + 14) * 8 microseconds
+    QTest::newRow("maximum") << quint16(251) << QByteArray("012220064000fb004808");
+    QTest::newRow("too large") << quint16(1000) << QByteArray("012220064000fb004808");
+    QTest::newRow("too small") << quint16(0) << QByteArray("0122200640001b004801");
+}
+
+void tst_HciManager::setDataLengthCommand()
+{
+    QFETCH(quint16, txOctets);
+    QFETCH(QByteArray, expectedCommand);
+
+    QVERIFY(manager->sendSetDataLengthCommand(0x40, txOctets));
+    QCOMPARE(readCommand().toHex(), expectedCommand);
+}
+
+void tst_HciManager::phyUpdateEvent()
+{
+    QSignalSpy spy(manager, &HciManager::phyUpdate);
+
+    // a failed update is not reported
+    sendLeMetaEvent(QByteArray::fromHex("0c1e40000101"));
+    sendLeMetaEvent(QByteArray::fromHex("0c0040000203"));
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).value<quint16>(), quint16(0x40));
+    QCOMPARE(spy.at(0).at(1).value<quint8>(), quint8(2));
+    QCOMPARE(spy.at(0).at(2).value<quint8>(), quint8(3));
+}
+
+void tst_HciManager::dataLengthChangeEvent()
+{
+    QSignalSpy spy(manager, &HciManager::dataLengthChange);
+
+    sendLeMetaEvent(QByteArray::fromHex("074000fb0048081b004801"));
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).value<quint16>(), quint16(0x40));
+    QCOMPARE(spy.at(0).at(1).value<quint16>(), quint16(251));
+    QCOMPARE(spy.at(0).at(2).value<quint16>(), quint16(27));
+}
+
+void tst_HciManager::truncatedLeMetaEvent()
+{
+    QSignalSpy phySpy(manager, &HciManager::phyUpdate);
+    QSignalSpy dataLengthSpy(manager, &HciManager::dataLengthChange);
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Unexpected LE PHY update.*"));
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Unexpected LE data length.*"));
+    sendLeMetaEvent(QByteArray::fromHex("0c00400002"));
+    sendLeMetaEvent(QByteArray::fromHex("074000fb00"));
+    QTest::qWait(50);
+    QCOMPARE(phySpy.count(), 0);
+    QCOMPARE(dataLengthSpy.count(), 0);
+}
+
+QTEST_MAIN(tst_HciManager)
+
+#include "tst_hcimanager.moc"
@@ -0,0 +1,272 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtBluetooth/QLowEnergyConnectionParameters>
+#include <QtBluetooth/private/hcimanager_p.h>
+#include <QtBluetooth/private/leconnectionhub_p.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+static const QBluetoothAddress peerA(QStringLiteral("AA:BB:CC:DD:EE:01"));
+static const QBluetoothAddress peerB(QStringLiteral("AA:BB:CC:DD:EE:02"));
+static const QBluetoothAddress peerC(QStringLiteral("AA:BB:CC:DD:EE:03"));
+static const QBluetoothAddress resolvablePeer(QStringLiteral("5A:BB:CC:DD:EE:04"));
+
+class tst_LeConnectionHub : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void dispatchByHandle();
+    void acceptingLinks();
+    void handleReuse();
+    void connectionSlots();
+
+private:
+    HciManager *m_hciManager = nullptr;
+    QSharedPointer<LeConnectionHub> m_hub;
+    int m_controllerSocket = -1;
+};
+
+void tst_LeConnectionHub::init()
+{
+    // The events are emitted by the test, the socket only makes the manager valid.
+    int fds[2];
+    QVERIFY(::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == 0);
+    m_controllerSocket = fds[0];
+    m_hciManager = new HciManager(fds[1], 0);
+    QVERIFY(m_hciManager->isValid());
+    m_hub.reset(new LeConnectionHub(m_hciManager));
+}
+
+void tst_LeConnectionHub::cleanup()
+{
+    m_hub.reset();
+    delete m_hciManager;
+    m_hciManager = nullptr;
+    ::close(m_controllerSocket);
+    m_controllerSocket = -1;
+}
+
+void tst_LeConnectionHub::dispatchByHandle()
+{
+    LeHciLink linkA(m_hub);
+    LeHciLink linkB(m_hub);
+    linkA.setRemoteDevice(peerA);
+    linkB.setRemoteDevice(peerB);
+    QCOMPARE(m_hub->linkCount(), 2);
+
+    QSignalSpy completeA(&linkA, &LeHciLink::connectionComplete);
+    QSignalSpy completeB(&linkB, &LeHciLink::connectionComplete);
+    emit m_hciManager->connectionComplete(0x41, 0, peerB);
+    emit m_hciManager->connectionComplete(0x40, 0, peerA);
+    QCOMPARE(completeA.count(), 1);
+    QCOMPARE(completeA.first().first().value<quint16>(), quint16(0x40));
+    QCOMPARE(completeB.count(), 1);
+    QCOMPARE(linkA.connectionHandle(), quint16(0x40));
+    QCOMPARE(linkB.connectionHandle(), quint16(0x41));
+    QCOMPARE(m_hub->linkForConnectionHandle(0x40), &linkA);
+
+    QSignalSpy dataLengthA(&linkA, &LeHciLink::dataLengthChange);
+    QSignalSpy dataLengthB(&linkB, &LeHciLink::dataLengthChange);
+    emit m_hciManager->dataLengthChange(0x41, 251, 27);
+    QCOMPARE(dataLengthA.count(), 0);
+    QCOMPARE(dataLengthB.count(), 1);
+    QCOMPARE(dataLengthB.first().at(0).value<quint16>(), quint16(251));
+
+    int updatesA = 0;
+    connect(&linkA, &LeHciLink::connectionUpdate, this, [&updatesA]() { ++updatesA; });
+    QSignalSpy phyA(&linkA, &LeHciLink::phyUpdate);
+    emit m_hciManager->connectionUpdate(0x40, QLowEnergyConnectionParameters());
+    emit m_hciManager->phyUpdate(0x40, 2, 2);
+    emit m_hciManager->phyUpdate(0x42, 1, 1);
+    QCOMPARE(updatesA, 1);
+    QCOMPARE(phyA.count(), 1);
+
+    QSignalSpy encryptionA(&linkA, &LeHciLink::encryptionChanged);
+    QSignalSpy encryptionB(&linkB, &LeHciLink::encryptionChanged);
+    emit m_hciManager->encryptionChangedEvent(peerB, true);
+    QCOMPARE(encryptionA.count(), 0);
+    QCOMPARE(encryptionB.count(), 1);
+    QCOMPARE(encryptionB.first().first().toBool(), true);
+
+    linkB.resetConnectionHandle();
+    QCOMPARE(linkB.connectionHandle(), quint16(0));
+    QCOMPARE(m_hub->linkForConnectionHandle(0x41), nullptr);
+    emit m_hciManager->dataLengthChange(0x41, 27, 27);
+    QCOMPARE(dataLengthB.count(), 1);
+}
+
+void tst_LeConnectionHub::acceptingLinks()
+{
+    LeHciLink central(m_hub);
+    central.setRemoteDevice(peerA);
+    LeHciLink peripheral(m_hub);
+
+    QSignalSpy centralComplete(&central, &LeHciLink::connectionComplete);
+    QSignalSpy peripheralComplete(&peripheral, &LeHciLink::connectionComplete);
+    emit m_hciManager->connectionComplete(0x40, 0, peerC);
+    QCOMPARE(centralComplete.count(), 0);
+    QCOMPARE(peripheralComplete.count(), 1);
+    QCOMPARE(peripheral.connectionHandle(), quint16(0x40));
+
+    // the accepted client is known from the L2CAP socket
+    peripheral.setRemoteDevice(peerC);
+    QSignalSpy encryption(&peripheral, &LeHciLink::encryptionChanged);
+    emit m_hciManager->encryptionChangedEvent(peerC, false);
+    QCOMPARE(encryption.count(), 1);
+
+    // once it is serving a client, the link does not accept further connections
+    emit m_hciManager->connectionComplete(0x41, 0, peerB);
+    QCOMPARE(peripheralComplete.count(), 1);
+    QCOMPARE(m_hub->linkForConnectionHandle(0x41), nullptr);
+
+    peripheral.resetConnectionHandle();
+    peripheral.setRemoteDevice(QBluetoothAddress());
+    emit m_hciManager->connectionComplete(0x42, 0, peerB);
+    QCOMPARE(peripheralComplete.count(), 2);
+    QCOMPARE(m_hub->linkForConnectionHandle(0x42), &peripheral);
+}
+
+void tst_LeConnectionHub::handleReuse()
+{
+    LeHciLink linkA(m_hub);
+    LeHciLink linkB(m_hub);
+    linkA.setRemoteDevice(peerA);
+    linkB.setRemoteDevice(peerB);
+
+    emit m_hciManager->connectionComplete(0x40, 0, peerA);
+    QCOMPARE(linkA.connectionHandle(), quint16(0x40));
+
+    // peerA disconnected without linkA noticing yet, the controller reuses the handle
+    emit m_hciManager->connectionComplete(0x40, 0, peerB);
+    QCOMPARE(linkA.connectionHandle(), quint16(0));
+    QCOMPARE(linkB.connectionHandle(), quint16(0x40));
+    QCOMPARE(m_hub->linkForConnectionHandle(0x40), &linkB);
+
+    // a late reset of linkA must not unregister linkB
+    linkA.resetConnectionHandle();
+    QCOMPARE(m_hub->linkForConnectionHandle(0x40), &linkB);
+
+    // failed connections do not assign handles
+    const auto terminated = quint8(HciManager::HciError::HCI_CONNECTION_TERMINATED);
+    emit m_hciManager->connectionComplete(0x41, terminated, peerA);
+    QCOMPARE(linkA.connectionHandle(), quint16(0));
+    QCOMPARE(m_hub->linkForConnectionHandle(0x41), nullptr);
+}
+
+void tst_LeConnectionHub::connectionSlots()
+{
+    QCOMPARE(m_hub->maxPendingConnections(), int(LeConnectionHub::DefaultMaxPendingConnections));
+
+    LeHciLink linkA(m_hub);
+    LeHciLink linkB(m_hub);
+    auto linkC = new LeHciLink(m_hub);
+    linkA.setRemoteDevice(peerA);
+    linkB.setRemoteDevice(peerB);
+    linkC->setRemoteDevice(peerC);
+    QSignalSpy grantedB(&linkB, &LeHciLink::connectionSlotGranted);
+    QSignalSpy grantedC(linkC, &LeHciLink::connectionSlotGranted);
+
+    QVERIFY(linkA.requestConnectionSlot());
+    QVERIFY(linkA.hasConnectionSlot());
+    QVERIFY(!linkB.requestConnectionSlot());
+    QVERIFY(!linkC->requestConnectionSlot());
+    QVERIFY(!linkB.hasConnectionSlot());
+    QCOMPARE(m_hub->pendingConnectionCount(), 1);
+    QCOMPARE(m_hub->queuedConnectionCount(), 2);
+
+    // the connection of linkA completes, linkB is next
+    emit m_hciManager->connectionComplete(0x40, 0, peerA);
+    QVERIFY(!linkA.hasConnectionSlot());
+    QCOMPARE(grantedB.count(), 1);
+    QCOMPARE(grantedC.count(), 0);
+    QVERIFY(linkB.hasConnectionSlot());
+
+    // the connection of linkB fails, linkC is next
+    const auto timeout = quint8(HciManager::HciError::HCI_CONNECTION_TIMEOUT);
+    emit m_hciManager->connectionComplete(0, timeout, peerB);
+    QVERIFY(!linkB.hasConnectionSlot());
+    QCOMPARE(grantedC.count(), 1);
+    QCOMPARE(m_hub->pendingConnectionCount(), 1);
+    QCOMPARE(m_hub->queuedConnectionCount(), 0);
+
+    // linkB retries while linkC connects and gets the slot once linkC goes away
+    QVERIFY(!linkB.requestConnectionSlot());
+    delete linkC;
+    QCOMPARE(grantedB.count(), 2);
+    QCOMPARE(m_hub->linkCount(), 2);
+
+    // a second slot is granted right away
+    linkA.releaseConnectionSlot();
+    m_hub->setMaxPendingConnections(2);
+    QVERIFY(linkA.requestConnectionSlot());
+    QCOMPARE(m_hub->pendingConnectionCount(), 2);
+    linkA.releaseConnectionSlot();
+    linkB.releaseConnectionSlot();
+    QCOMPARE(m_hub->pendingConnectionCount(), 0);
+}
+
+void tst_LeConnectionHub::resolvedPrivateAddress()
+{
+    // the link connects to the private address the peer advertised with
+    LeHciLink central(m_hub);
+    LeHciLink peripheral(m_hub);
+    central.setRemoteDevice(resolvablePeer);
+    QVERIFY(central.requestConnectionSlot());
+
+    // the enhanced event reports the identity address the controller resolved it to
+    QSignalSpy centralComplete(&central, &LeHciLink::connectionComplete);
+    QSignalSpy peripheralComplete(&peripheral, &LeHciLink::connectionComplete);
+    emit m_hciManager->connectionComplete(0x40, 0, peerA, resolvablePeer);
+    QCOMPARE(centralComplete.count(), 1);
+    QCOMPARE(central.connectionHandle(), quint16(0x40));
+    QVERIFY(!central.hasConnectionSlot());
+    QCOMPARE(m_hub->pendingConnectionCount(), 0);
+    QCOMPARE(peripheralComplete.count(), 0);
+    QCOMPARE(m_hub->linkForConnectionHandle(0x40), &central);
+
+    // a failed attempt releases the slot as well
+    central.resetConnectionHandle();
+    QVERIFY(central.requestConnectionSlot());
+    const auto timeout = quint8(HciManager::HciError::HCI_CONNECTION_TIMEOUT);
+    emit m_hciManager->connectionComplete(0, timeout, peerA, resolvablePeer);
+    QVERIFY(!central.hasConnectionSlot());
+    QCOMPARE(centralComplete.count(), 1);
+}
+
+QTEST_MAIN(tst_LeConnectionHub)
+
+#include "tst_leconnectionhub.moc"
@@ -0,0 +1,245 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QDir>
+#include <QtCore/QSettings>
+#include <QtCore/QTemporaryDir>
+
+#include <QtBluetooth/private/lepeerdatastore_p.h>
+
+QT_USE_NAMESPACE
+
+static const QBluetoothAddress localAdapter(QStringLiteral("00:11:22:33:44:55"));
+static const QBluetoothAddress peer(QStringLiteral("AA:BB:CC:DD:EE:FF"));
+static const char keyHex[] = "0102030405060708090a0b0c0d0e0f10";
+
+class tst_LePeerDataStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void loadSigningData();
+    void localCounterReservation();
+    void remoteCounterBatching();
+    void newSigningKey();
+    void clientConfigurationIndex();
+
+private:
+    QString infoFilePath() const;
+    void writeInfoFile(const QString &group, quint32 counter);
+    quint32 storedCounter(const QString &group) const;
+
+    QScopedPointer<QTemporaryDir> m_storage;
+};
+
+void tst_LePeerDataStore::init()
+{
+    m_storage.reset(new QTemporaryDir);
+    QVERIFY(m_storage->isValid());
+}
+
+QString tst_LePeerDataStore::infoFilePath() const
+{
+    return m_storage->filePath(localAdapter.toString() + QLatin1Char('/')
+                               + peer.toString() + QLatin1String("/info"));
+}
+
+void tst_LePeerDataStore::writeInfoFile(const QString &group, quint32 counter)
+{
+    QVERIFY(QDir().mkpath(QFileInfo(infoFilePath()).path()));
+    QSettings settings(infoFilePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    settings.setValue(QLatin1String("Key"), QByteArray(keyHex));
+    settings.setValue(QLatin1String("Counter"), counter);
+    settings.endGroup();
+    settings.sync();
+    QCOMPARE(settings.status(), QSettings::NoError);
+}
+
+quint32 tst_LePeerDataStore::storedCounter(const QString &group) const
+{
+    QSettings settings(infoFilePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    return settings.value(QLatin1String("Counter")).toUInt();
+}
+
+void tst_LePeerDataStore::loadSigningData()
+{
+    writeInfoFile(QLatin1String("LocalSignatureKey"), 7);
+
+    LePeerDataStore store(localAdapter);
+    store.setStorageDirectory(m_storage->path());
+    QVERIFY(!store.signingData(peer));
+
+    store.loadSigningData(peer, LePeerDataStore::RemoteSigningKey);
+    QVERIFY(!store.signingData(peer));
+
+    store.loadSigningData(peer, LePeerDataStore::LocalSigningKey);
+    LePeerDataStore::SigningData *data = store.signingData(peer);
+    QVERIFY(data);
+    QCOMPARE(data->counter, 6u); // the stored counter is the next one to use
+    QCOMPARE(QByteArray(reinterpret_cast<const char *>(data->key.data), sizeof data->key).toHex(),
+             QByteArray(keyHex));
+    QCOMPARE(store.settingsWriteCount(), 0);
+}
+
+void tst_LePeerDataStore::localCounterReservation()
+{
+    const QString group = QLatin1String("LocalSignatureKey");
+    writeInfoFile(group, 0);
+
+    const quint32 reservation = 16;
+    const int signedWrites = 100;
+    {
+        LePeerDataStore store(localAdapter);
+        store.setStorageDirectory(m_storage->path());
+        store.setCounterReservation(reservation);
+        store.loadSigningData(peer, LePeerDataStore::LocalSigningKey);
+        LePeerDataStore::SigningData *data = store.signingData(peer);
+        QVERIFY(data);
+
+        for (int i = 0; i < signedWrites; ++i) {
+            ++data->counter;
+            store.commitSignCounter(peer);
+            // what a restart would read must never have been used already
+            QVERIFY2(storedCounter(group) > data->counter,
+                     qPrintable(QString::number(data->counter)));
+        }
+        QCOMPARE(store.settingsWriteCount(),
+                 int((signedWrites + reservation) / (reservation + 1)));
+    }
+
+    // after a restart, counting continues beyond the reservation
+    LePeerDataStore store(localAdapter);
+    store.setStorageDirectory(m_storage->path());
+    store.loadSigningData(peer, LePeerDataStore::LocalSigningKey);
+    LePeerDataStore::SigningData *data = store.signingData(peer);
+    QVERIFY(data);
+    QVERIFY(data->counter >= quint32(signedWrites - 1));
+}
+
+void tst_LePeerDataStore::remoteCounterBatching()
+{
+    const QString group = QLatin1String("RemoteSignatureKey");
+    writeInfoFile(group, 0);
+
+    LePeerDataStore store(localAdapter);
+    store.setStorageDirectory(m_storage->path());
+    store.setFlushInterval(50);
+    store.loadSigningData(peer, LePeerDataStore::RemoteSigningKey);
+    LePeerDataStore::SigningData *data = store.signingData(peer);
+    QVERIFY(data);
+
+    for (quint32 counter = 0; counter < 50; ++counter) {
+        data->counter = counter;
+        store.commitSignCounter(peer);
+    }
+    QCOMPARE(store.settingsWriteCount(), 0);
+    QTRY_COMPARE(storedCounter(group), 50u);
+    QCOMPARE(store.settingsWriteCount(), 1);
+
+    // e.g. on disconnect
+    data->counter = 60;
+    store.commitSignCounter(peer);
+    store.flush();
+    QCOMPARE(storedCounter(group), 61u);
+    QCOMPARE(store.settingsWriteCount(), 2);
+
+    // nothing pending
+    store.flush();
+    QCOMPARE(store.settingsWriteCount(), 2);
+}
+
+void tst_LePeerDataStore::newSigningKey()
+{
+    writeInfoFile(QLatin1String("LocalSignatureKey"), 40);
+
+    LePeerDataStore store(localAdapter);
+    store.setStorageDirectory(m_storage->path());
+    store.loadSigningData(peer, LePeerDataStore::LocalSigningKey);
+
+    quint128 csrk;
+    memset(csrk.data, 0x42, sizeof csrk.data);
+    store.setSigningKey(peer, LePeerDataStore::LocalSigningKey, csrk);
+    LePeerDataStore::SigningData *data = store.signingData(peer);
+    QVERIFY(data);
+    QCOMPARE(data->counter, quint32(-1));
+    QCOMPARE(data->key.data[0], quint8(0x42));
+
+    ++data->counter;
+    store.commitSignCounter(peer);
+    QVERIFY(storedCounter(QLatin1String("LocalSignatureKey")) > 0);
+}
+
+void tst_LePeerDataStore::clientConfigurationIndex()
+{
+    using Config = LePeerDataStore::ClientConfigurationData;
+    const QBluetoothAddress otherPeer(QStringLiteral("AA:BB:CC:DD:EE:00"));
+
+    LePeerDataStore store(localAdapter);
+    store.setClientConfigurations(peer, { Config(3, 4, 1), Config(6, 7, 2) });
+    store.setClientConfigurations(otherPeer, { Config(3, 4, 2) });
+    QCOMPARE(store.subscriberCount(3), 2);
+    QCOMPARE(store.subscriberCount(6), 1);
+    QCOMPARE(store.subscriberCount(9), 0);
+
+    store.characteristicValueUpdated(3);
+    store.characteristicValueUpdated(9);
+
+    QList<Config> configs = store.clientConfigurations(peer);
+    QCOMPARE(configs.count(), 2);
+    QCOMPARE(configs.at(0).charValueHandle, QLowEnergyHandle(3));
+    QCOMPARE(configs.at(0).configValue, quint16(1));
+    QVERIFY(configs.at(0).charValueWasUpdated);
+    QVERIFY(!configs.at(1).charValueWasUpdated);
+
+    // storing again, as on disconnect, acknowledges earlier updates
+    store.setClientConfigurations(otherPeer, { Config(6, 7, 1) });
+    QCOMPARE(store.subscriberCount(3), 1);
+    QCOMPARE(store.subscriberCount(6), 2);
+    QVERIFY(!store.clientConfigurations(otherPeer).at(0).charValueWasUpdated);
+    store.characteristicValueUpdated(6);
+    QVERIFY(store.clientConfigurations(otherPeer).at(0).charValueWasUpdated);
+    QVERIFY(store.clientConfigurations(peer).at(1).charValueWasUpdated);
+
+    store.removeClientConfigurations(peer);
+    QVERIFY(store.clientConfigurations(peer).isEmpty());
+    QCOMPARE(store.subscriberCount(3), 0);
+    QCOMPARE(store.subscriberCount(6), 1);
+
+    // a new subscriber does not see updates from before it subscribed
+    store.setClientConfigurations(peer, { Config(6, 7, 1) });
+    QVERIFY(!store.clientConfigurations(peer).at(0).charValueWasUpdated);
+}
+
+QTEST_MAIN(tst_LePeerDataStore)
+
+#include "tst_lepeerdatastore.moc"
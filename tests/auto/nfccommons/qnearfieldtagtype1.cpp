@@ -38,7 +38,7 @@
 ****************************************************************************/
 
 #include "qnearfieldtagtype1_p.h"
-#include "qtlv_p.h"
+#include "qtagtype1tlv_p.h"
 
 #include <QtNfc/private/qnearfieldtarget_p.h>
 #include <QtNfc/qndefmessage.h>
@@ -173,7 +173,7 @@ void QNearFieldTagType1Private::progressToNextNdefReadMessageState()
 
         m_readNdefMessageState = NdefReadReadingTlv;
         delete m_tlvReader;
-        m_tlvReader = new QTlvReader(q);
+        m_tlvReader = new QTagType1TlvReader(q);
 
         Q_FALLTHROUGH(); // fall through
     }
@@ -251,7 +251,7 @@ void QNearFieldTagType1Private::progressToNextNdefWriteMessageState()
 
         m_writeNdefMessageState = NdefWriteReadingTlv;
         delete m_tlvReader;
-        m_tlvReader = new QTlvReader(q);
+        m_tlvReader = new QTagType1TlvReader(q);
 
         Q_FALLTHROUGH(); // fall through
     }
@@ -277,7 +277,7 @@ void QNearFieldTagType1Private::progressToNextNdefWriteMessageState()
         // fall through
     case NdefWriteWritingTlv:
         delete m_tlvWriter;
-        m_tlvWriter = new QTlvWriter(q);
+        m_tlvWriter = new QTagType1TlvWriter(q);
 
         // write old TLVs
         for (const Tlv &tlv : qAsConst(m_tlvs))
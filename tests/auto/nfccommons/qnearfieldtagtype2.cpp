@@ -71,13 +71,15 @@ struct SectorSelectState {
 class QNearFieldTagType2Private
 {
 public:
-    QNearFieldTagType2Private() : m_currentSector(0) { }
+    QNearFieldTagType2Private() : m_currentSector(0), m_memory(nullptr) { }
 
     QMap<QNearFieldTarget::RequestId, QByteArray> m_pendingInternalCommands;
 
     quint8 m_currentSector;
 
     QMap<QNearFieldTarget::RequestId, SectorSelectState> m_pendingSectorSelectCommands;
+
+    QNearFieldTagType2Memory *m_memory;
 };
 
 static QVariant decodeResponse(const QByteArray &command, const QByteArray &response)
@@ -100,6 +102,19 @@ static QVariant decodeResponse(const QByteArray &command, const QByteArray &resp
 QNearFieldTagType2::QNearFieldTagType2(QObject *parent)
 :   QNearFieldTargetPrivate(parent), d_ptr(new QNearFieldTagType2Private)
 {
+    Q_D(QNearFieldTagType2);
+
+    d->m_memory = new QNearFieldTagType2Memory(this, this);
+    connect(d->m_memory, &QNearFieldTagType2Memory::ndefMessageRead,
+            this, &QNearFieldTagType2::ndefMessageRead);
+    connect(d->m_memory, &QNearFieldTagType2Memory::requestCompleted,
+            this, [this](const QNearFieldTarget::RequestId &id) {
+        QNearFieldTargetPrivate::setResponseForRequest(id, true);
+    });
+    connect(d->m_memory, &QNearFieldTagType2Memory::error,
+            this, [this](QNearFieldTarget::Error error, const QNearFieldTarget::RequestId &id) {
+        reportError(error, id);
+    });
 }
 
 /*!
@@ -115,8 +130,18 @@ QNearFieldTagType2::~QNearFieldTagType2()
 */
 bool QNearFieldTagType2::hasNdefMessage()
 {
-    qWarning() << Q_FUNC_INFO << "is unimplemeted";
-    return false;
+    Q_D(QNearFieldTagType2);
+    if (!selectFirstSector())
+        return false;
+
+    if (!d->m_memory->isCached()) {
+        QNearFieldTarget::RequestId id(new QNearFieldTarget::RequestIdPrivate);
+        d->m_memory->fillCache(id);
+        if (!waitForRequestCompleted(id))
+            return false;
+    }
+
+    return d->m_memory->hasNdefMessage();
 }
 
 /*!
@@ -124,7 +149,16 @@ bool QNearFieldTagType2::hasNdefMessage()
 */
 QNearFieldTarget::RequestId QNearFieldTagType2::readNdefMessages()
 {
-    return QNearFieldTarget::RequestId();
+    Q_D(QNearFieldTagType2);
+
+    QNearFieldTarget::RequestId id(new QNearFieldTarget::RequestIdPrivate);
+    if (!selectFirstSector()) {
+        reportError(QNearFieldTarget::NdefReadError, id);
+        return id;
+    }
+
+    d->m_memory->readNdefMessages(id);
+    return id;
 }
 
 /*!
@@ -132,9 +166,45 @@ QNearFieldTarget::RequestId QNearFieldTagType2::readNdefMessages()
 */
 QNearFieldTarget::RequestId QNearFieldTagType2::writeNdefMessages(const QList<QNdefMessage> &messages)
 {
-    Q_UNUSED(messages);
+    Q_D(QNearFieldTagType2);
+
+    if (messages.isEmpty())
+        return QNearFieldTarget::RequestId();
+
+    if (messages.size() > 1)
+        qWarning("QNearFieldTagType2::writeNdefMessages: only one NDEF message per tag is supported.");
 
-    return QNearFieldTarget::RequestId();
+    QNearFieldTarget::RequestId id(new QNearFieldTarget::RequestIdPrivate);
+    if (!selectFirstSector()) {
+        reportError(QNearFieldTarget::NdefWriteError, id);
+        return id;
+    }
+
+    d->m_memory->writeNdefMessage(id, messages.first());
+    return id;
+}
+
+/*!
+    Returns the object which caches the tag memory for NDEF access.
+*/
+QNearFieldTagType2Memory *QNearFieldTagType2::memory() const
+{
+    Q_D(const QNearFieldTagType2);
+    return d->m_memory;
+}
+
+/*!
+    Selects sector 0, which holds the NDEF data area, if another sector is selected. Returns
+    true on success.
+*/
+bool QNearFieldTagType2::selectFirstSector()
+{
+    Q_D(QNearFieldTagType2);
+    if (d->m_currentSector == 0)
+        return true;
+
+    QNearFieldTarget::RequestId id = selectSector(0);
+    return waitForRequestCompleted(id) && requestResponse(id).toBool();
 }
 
 /*!
@@ -221,6 +291,9 @@ QNearFieldTarget::RequestId QNearFieldTagType2::writeBlock(quint8 blockAddress,
 
     d->m_pendingInternalCommands.insert(id, command);
 
+    // the cached memory may not match the tag anymore
+    d->m_memory->invalidate();
+
     return id;
 }
 
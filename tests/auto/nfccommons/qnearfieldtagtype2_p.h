@@ -52,6 +52,7 @@
 //
 
 #include <QtNfc/private/qnearfieldtarget_p.h>
+#include <QtNfc/private/qnearfieldtagtype2memory_p.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -80,12 +81,16 @@ public:
     virtual QNearFieldTarget::RequestId writeBlock(quint8 blockAddress, const QByteArray &data);
     virtual QNearFieldTarget::RequestId selectSector(quint8 sector);
 
+    QNearFieldTagType2Memory *memory() const;
+
     void timerEvent(QTimerEvent *event) override;
 
 protected:
     void setResponseForRequest(const QNearFieldTarget::RequestId &id, const QVariant &response, bool emitRequestCompleted = true) override;
 
 private:
+    bool selectFirstSector();
+
     QNearFieldTagType2Private *d_ptr;
 };
 
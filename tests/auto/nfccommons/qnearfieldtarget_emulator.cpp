@@ -141,6 +141,12 @@ QNearFieldTarget::AccessMethods TagType2::accessMethods() const
     return QNearFieldTarget::NdefAccess | QNearFieldTarget::TagTypeSpecificAccess;
 }
 
+int TagType2::maxCommandLength() const
+{
+    // transceive length of a typical NFC-A reader
+    return 253;
+}
+
 QNearFieldTarget::RequestId TagType2::sendCommand(const QByteArray &command)
 {
     QMutexLocker locker(&tagMutex);
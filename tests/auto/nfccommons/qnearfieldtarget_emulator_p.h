@@ -90,6 +90,8 @@ public:
 
     QNearFieldTarget::AccessMethods accessMethods() const override;
 
+    int maxCommandLength() const override;
+
     QNearFieldTarget::RequestId sendCommand(const QByteArray &command) override;
     bool waitForRequestCompleted(const QNearFieldTarget::RequestId &id, int msecs);
 
@@ -0,0 +1,195 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qtagtype1tlv_p.h"
+
+#include "qnearfieldtagtype1_p.h"
+
+#include <QtCore/QVariant>
+
+QT_BEGIN_NAMESPACE
+
+QTagType1TlvReader::QTagType1TlvReader(QNearFieldTagType1 *target)
+:   m_target(target)
+{
+    addReservedMemory(0, 12);   // skip uid, cc
+    addReservedMemory(104, 16); // skip reserved block D, lock block E
+
+    addReservedMemory(120, 8);  // skip reserved block F
+}
+
+bool QTagType1TlvReader::fetchData(int absoluteOffset, int length, QByteArray *data)
+{
+    quint8 segment = absoluteOffset / 128;
+
+    if (!m_requestId.isValid()) {
+        m_requestId = (absoluteOffset < 120) ? m_target->readAll()
+                                             : m_target->readSegment(segment);
+        return false;
+    }
+
+    QVariant v = m_target->requestResponse(m_requestId);
+    if (!v.isValid())
+        return false;
+
+    m_requestId = QNearFieldTarget::RequestId();
+
+    QByteArray response = v.toByteArray();
+
+    if (absoluteOffset < 120)
+        response = response.mid(2);
+
+    *data = response.mid(absoluteOffset - (segment * 128), length);
+    return true;
+}
+
+QTagType1TlvWriter::QTagType1TlvWriter(QNearFieldTagType1 *target)
+:   m_target(target)
+{
+    addReservedMemory(0, 12);   // skip uid, cc
+    addReservedMemory(104, 16); // skip reserved block D, lock block E
+
+    addReservedMemory(120, 8);  // skip reserved block F
+}
+
+bool QTagType1TlvWriter::isRequestCompleted() const
+{
+    return m_target->requestResponse(m_requestId).isValid();
+}
+
+int QTagType1TlvWriter::fetchMemorySize()
+{
+    if (m_requestId.isValid()) {
+        int memorySize = 8 * (m_target->requestResponse(m_requestId).toUInt() + 1);
+        m_requestId = QNearFieldTarget::RequestId();
+        return memorySize;
+    }
+
+    m_requestId = m_target->readByte(10);
+    return -1;
+}
+
+bool QTagType1TlvWriter::writeData(int spaceRemaining, bool all)
+{
+    int length = qMin(spaceRemaining, m_buffer.length());
+    int bufferIndex = 0;
+
+    // static memory - can only use writeByte()
+    while (m_index < 120 && bufferIndex < length) {
+        if (m_requestId.isValid()) {
+            if (!m_target->requestResponse(m_requestId).toBool())
+                return false;
+
+            m_requestId = QNearFieldTarget::RequestId();
+
+            ++m_index;
+            ++bufferIndex;
+        } else {
+            m_requestId = m_target->writeByte(m_index, m_buffer.at(bufferIndex));
+            m_buffer = m_buffer.mid(bufferIndex);
+            return false;
+        }
+    }
+
+
+    // dynamic memory - writeBlock() full
+    while (m_index >= 120 && (m_index % 8 == 0) && bufferIndex + 8 < length) {
+        if (m_requestId.isValid()) {
+            if (!m_target->requestResponse(m_requestId).toBool())
+                return false;
+
+            m_requestId = QNearFieldTarget::RequestId();
+
+            m_index += 8;
+            bufferIndex += 8;
+        } else {
+            m_requestId = m_target->writeBlock(m_index / 8, m_buffer.mid(bufferIndex, 8));
+            m_buffer = m_buffer.mid(bufferIndex);
+            return false;
+        }
+    }
+
+    // partial block
+    int currentBlock = m_index / 8;
+    int nextBlock = currentBlock + 1;
+    int currentBlockStart = currentBlock * 8;
+    int nextBlockStart = nextBlock * 8;
+
+    int fillLength = qMin(nextBlockStart - m_index, spaceRemaining - bufferIndex);
+
+    if (fillLength && (all || m_buffer.length() - bufferIndex >= fillLength) &&
+        (m_buffer.length() != bufferIndex)) {
+        // sufficient data available
+        if (m_requestId.isValid()) {
+            const QVariant v = m_target->requestResponse(m_requestId);
+            if (v.typeId() == QMetaType::QByteArray) {
+                // read in block
+                QByteArray block = v.toByteArray();
+
+                int fill = qMin(fillLength, m_buffer.length() - bufferIndex);
+
+                for (int i = m_index - currentBlockStart; i < fill; ++i)
+                    block[i] = m_buffer.at(bufferIndex++);
+
+                // now write block
+                m_requestId = m_target->writeBlock(currentBlock, block);
+                return false;
+            } else if (v.typeId() == QMetaType::Bool) {
+                m_requestId = QNearFieldTarget::RequestId();
+                int fill = qMin(fillLength, m_buffer.length() - bufferIndex);
+                bufferIndex = fill - (m_index - currentBlockStart);
+
+                // write complete
+                if (!v.toBool())
+                    return false;
+            }
+        } else {
+            // read in block
+            m_requestId = m_target->readBlock(currentBlock);
+            m_buffer = m_buffer.mid(bufferIndex);
+            return false;
+        }
+    }
+
+    m_buffer = m_buffer.mid(bufferIndex);
+
+    return true;
+}
+
+QT_END_NAMESPACE
@@ -348,6 +348,19 @@ QByteArray NfcTagType2::processCommand(const QByteArray &command)
 
         break;
     }
+    case 0x3a: {    // FAST READ
+        quint8 startBlock = command.at(1);
+        quint8 endBlock = command.at(2);
+        int sectorBlocks = qMin(256, memory.length() / 4 - currentSector * 256);
+
+        if (startBlock > endBlock || endBlock >= sectorBlocks)
+            return NACK;
+
+        int absoluteBlock = currentSector * 256 + startBlock;
+        response.append(memory.mid(absoluteBlock * 4, (endBlock - startBlock + 1) * 4));
+
+        break;
+    }
     case 0xa2: {    // WRITE BLOCK
         quint8 block = command.at(1);
         int absoluteBlock = currentSector * 256 + block;
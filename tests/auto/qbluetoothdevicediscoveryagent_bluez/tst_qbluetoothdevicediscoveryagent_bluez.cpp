@@ -0,0 +1,582 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QMutex>
+#include <QtCore/QProcess>
+#include <QtCore/QThread>
+#include <QtDBus/QtDBus>
+
+#include <QBluetoothDeviceDiscoveryAgent>
+#include <QBluetoothDeviceDiscoveryFilter>
+
+QT_USE_NAMESPACE
+
+typedef QMap<QString, QVariantMap> InterfaceList;
+typedef QMap<QDBusObjectPath, InterfaceList> ManagedObjectList;
+
+Q_DECLARE_METATYPE(InterfaceList)
+Q_DECLARE_METATYPE(ManagedObjectList)
+
+static const QString adapterPath = QStringLiteral("/org/bluez/hci0");
+static const QString cachedDevicePath = QStringLiteral("/org/bluez/hci0/dev_AA_BB_CC_00_FF_FF");
+static const QString heartRateUuid = QStringLiteral("0000180d-0000-1000-8000-00805f9b34fb");
+static const QString batteryUuid = QStringLiteral("0000180f-0000-1000-8000-00805f9b34fb");
+static const int deviceCount = 100;
+
+static QString deviceAddress(int index)
+{
+    return QStringLiteral("AA:BB:CC:00:00:%1").arg(index, 2, 16, QLatin1Char('0')).toUpper();
+}
+
+static QString devicePath(int index)
+{
+    return adapterPath + QStringLiteral("/dev_") + deviceAddress(index).replace(QLatin1Char(':'),
+                                                                               QLatin1Char('_'));
+}
+
+// Every tenth device is a heart rate sensor, the signal gets weaker with the index.
+static QVariantMap deviceProperties(int index)
+{
+    QVariantMap properties;
+    properties.insert(QStringLiteral("Address"), deviceAddress(index));
+    properties.insert(QStringLiteral("Name"), (index % 2 ? QStringLiteral("Other-%1")
+                                                         : QStringLiteral("Sensor-%1")).arg(index));
+    properties.insert(QStringLiteral("Alias"), properties.value(QStringLiteral("Name")));
+    properties.insert(QStringLiteral("Adapter"), QVariant::fromValue(QDBusObjectPath(adapterPath)));
+    properties.insert(QStringLiteral("RSSI"), QVariant::fromValue(qint16(-40 - index)));
+    properties.insert(QStringLiteral("TxPower"), QVariant::fromValue(qint16(0)));
+    properties.insert(QStringLiteral("UUIDs"),
+                      QStringList{ index % 10 ? batteryUuid : heartRateUuid });
+    return properties;
+}
+
+/*
+    Stand-in for bluetoothd. Like BlueZ it applies the discovery filter before devices are
+    sent over D-Bus, unless it emulates a BlueZ version which rejects the newer filter keys.
+    It is served from its own thread and its own bus connection, because the agent makes
+    blocking calls on the system bus.
+*/
+class FakeBluez : public QObject
+{
+    Q_OBJECT
+
+public:
+    int signalsSent() const { QMutexLocker locker(&m_mutex); return m_signalsSent; }
+    QVariantMap discoveryFilter() const { QMutexLocker locker(&m_mutex); return m_filter; }
+    bool isDiscovering() const { QMutexLocker locker(&m_mutex); return m_discovering; }
+
+    void setLegacy(bool legacy) { QMutexLocker locker(&m_mutex); m_legacy = legacy; }
+
+    bool setDiscoveryFilter(const QVariantMap &filter)
+    {
+        QMutexLocker locker(&m_mutex);
+        const QStringList knownKeys = { QStringLiteral("Transport"), QStringLiteral("UUIDs"),
+                                        QStringLiteral("RSSI"), QStringLiteral("Pathloss") };
+        if (m_legacy) {
+            for (auto it = filter.cbegin(); it != filter.cend(); ++it) {
+                if (!knownKeys.contains(it.key()))
+                    return false;
+            }
+        }
+        m_filter = filter;
+        return true;
+    }
+
+    void setDiscovering(bool discovering)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_discovering = discovering;
+    }
+
+    ManagedObjectList managedObjects() const
+    {
+        QVariantMap adapter;
+        adapter.insert(QStringLiteral("Address"), QStringLiteral("11:22:33:44:55:66"));
+        adapter.insert(QStringLiteral("Powered"), true);
+        adapter.insert(QStringLiteral("Discovering"), isDiscovering());
+
+        // A device known from an earlier session, it is not in range
+        QVariantMap cached;
+        cached.insert(QStringLiteral("Address"), QStringLiteral("AA:BB:CC:00:FF:FF"));
+        cached.insert(QStringLiteral("Name"), QStringLiteral("Sensor-cached"));
+        cached.insert(QStringLiteral("Adapter"), QVariant::fromValue(QDBusObjectPath(adapterPath)));
+        cached.insert(QStringLiteral("UUIDs"), QStringList{ heartRateUuid });
+
+        return ManagedObjectList{
+            { QDBusObjectPath(adapterPath),
+              InterfaceList{ { QStringLiteral("org.bluez.Adapter1"), adapter } } },
+            { QDBusObjectPath(cachedDevicePath),
+              InterfaceList{ { QStringLiteral("org.bluez.Device1"), cached } } }
+        };
+    }
+
+public Q_SLOTS:
+    bool start(const QString &address);
+    void stop();
+    void advertise(int rounds);
+    void sendUnrelatedChanges(int count);
+
+Q_SIGNALS:
+    void interfacesAdded(const QDBusObjectPath &path, const InterfaceList &interfaces);
+
+private:
+    bool matchesFilter(const QVariantMap &properties) const;
+    void sendPropertiesChanged(const QString &path, const QString &interface,
+                               const QVariantMap &changedProperties);
+    void sendMarker();
+
+    mutable QMutex m_mutex;
+    QVariantMap m_filter;
+    bool m_legacy = false;
+    bool m_discovering = false;
+    int m_signalsSent = 0;
+
+    QDBusConnection m_connection = QDBusConnection(QString());
+    QObject *m_root = nullptr;
+    QObject *m_adapter = nullptr;
+};
+
+class FakeObjectManagerAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.DBus.ObjectManager")
+
+public:
+    FakeObjectManagerAdaptor(FakeBluez *bluez, QObject *parent)
+    :   QDBusAbstractAdaptor(parent), m_bluez(bluez)
+    {
+        connect(bluez, &FakeBluez::interfacesAdded,
+                this, &FakeObjectManagerAdaptor::InterfacesAdded);
+    }
+
+public Q_SLOTS:
+    ManagedObjectList GetManagedObjects() { return m_bluez->managedObjects(); }
+
+Q_SIGNALS:
+    void InterfacesAdded(const QDBusObjectPath &object_path,
+                         const InterfaceList &interfaces_and_properties);
+    void InterfacesRemoved(const QDBusObjectPath &object_path, const QStringList &interfaces);
+
+private:
+    FakeBluez *m_bluez;
+};
+
+class FakeAdapterAdaptor : public QDBusAbstractAdaptor, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.bluez.Adapter1")
+    Q_PROPERTY(QString Address READ address)
+    Q_PROPERTY(bool Powered READ powered)
+    Q_PROPERTY(bool Discovering READ discovering)
+
+public:
+    FakeAdapterAdaptor(FakeBluez *bluez, QObject *parent)
+    :   QDBusAbstractAdaptor(parent), m_bluez(bluez)
+    {
+    }
+
+    QString address() const { return QStringLiteral("11:22:33:44:55:66"); }
+    bool powered() const { return true; }
+    bool discovering() const { return m_bluez->isDiscovering(); }
+
+public Q_SLOTS:
+    void SetDiscoveryFilter(const QVariantMap &filter)
+    {
+        if (!m_bluez->setDiscoveryFilter(filter))
+            sendErrorReply(QStringLiteral("org.bluez.Error.InvalidArguments"),
+                           QStringLiteral("Invalid arguments in method call"));
+    }
+
+    void StartDiscovery() { m_bluez->setDiscovering(true); }
+    void StopDiscovery() { m_bluez->setDiscovering(false); }
+
+private:
+    FakeBluez *m_bluez;
+};
+
+bool FakeBluez::start(const QString &address)
+{
+    qDBusRegisterMetaType<InterfaceList>();
+    qDBusRegisterMetaType<ManagedObjectList>();
+
+    m_connection = QDBusConnection::connectToBus(address, QStringLiteral("fakebluez"));
+    if (!m_connection.isConnected())
+        return false;
+
+    m_root = new QObject(this);
+    new FakeObjectManagerAdaptor(this, m_root);
+    m_adapter = new QObject(this);
+    new FakeAdapterAdaptor(this, m_adapter);
+
+    return m_connection.registerObject(QStringLiteral("/"), m_root,
+                                       QDBusConnection::ExportAdaptors)
+            && m_connection.registerObject(adapterPath, m_adapter,
+                                           QDBusConnection::ExportAdaptors)
+            && m_connection.registerService(QStringLiteral("org.bluez"));
+}
+
+void FakeBluez::stop()
+{
+    m_connection.unregisterService(QStringLiteral("org.bluez"));
+    m_connection.unregisterObject(adapterPath);
+    m_connection.unregisterObject(QStringLiteral("/"));
+    delete m_adapter;
+    delete m_root;
+    m_adapter = m_root = nullptr;
+    QDBusConnection::disconnectFromBus(QStringLiteral("fakebluez"));
+}
+
+bool FakeBluez::matchesFilter(const QVariantMap &properties) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    const QStringList uuids = m_filter.value(QStringLiteral("UUIDs")).toStringList();
+    if (!uuids.isEmpty()) {
+        const QStringList deviceUuids = properties.value(QStringLiteral("UUIDs")).toStringList();
+        if (std::none_of(uuids.cbegin(), uuids.cend(),
+                         [&](const QString &uuid) { return deviceUuids.contains(uuid); })) {
+            return false;
+        }
+    }
+
+    if (m_filter.contains(QStringLiteral("RSSI"))
+            && properties.value(QStringLiteral("RSSI")).toInt()
+                    < m_filter.value(QStringLiteral("RSSI")).toInt()) {
+        return false;
+    }
+
+    const QString pattern = m_filter.value(QStringLiteral("Pattern")).toString();
+    return pattern.isEmpty()
+            || properties.value(QStringLiteral("Name")).toString().startsWith(pattern)
+            || properties.value(QStringLiteral("Address")).toString().startsWith(pattern);
+}
+
+/*
+    Reports every device in range once and repeats its unchanged advertisement data
+    in every further round, unless duplicate data is filtered.
+*/
+void FakeBluez::advertise(int rounds)
+{
+    const bool duplicateData = discoveryFilter().value(QStringLiteral("DuplicateData"),
+                                                       true).toBool();
+    int sent = 0;
+
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < deviceCount; ++i) {
+            const QVariantMap properties = deviceProperties(i);
+            if (!matchesFilter(properties))
+                continue;
+
+            if (round == 0) {
+                Q_EMIT interfacesAdded(QDBusObjectPath(devicePath(i)),
+                                       InterfaceList{ { QStringLiteral("org.bluez.Device1"),
+                                                        properties } });
+                ++sent;
+            } else if (duplicateData) {
+                sendPropertiesChanged(devicePath(i), QStringLiteral("org.bluez.Device1"),
+                                      { { QStringLiteral("RSSI"),
+                                          properties.value(QStringLiteral("RSSI")) } });
+                ++sent;
+            }
+        }
+    }
+
+    sendMarker();
+
+    QMutexLocker locker(&m_mutex);
+    m_signalsSent += sent;
+}
+
+/*
+    Property changes other BlueZ clients cause: GATT notifications, battery levels
+    and devices of another adapter.
+*/
+void FakeBluez::sendUnrelatedChanges(int count)
+{
+    const QString otherAdapterDevice = QStringLiteral("/org/bluez/hci1/dev_AA_BB_CC_11_00_00");
+
+    for (int i = 0; i < count; ++i) {
+        sendPropertiesChanged(devicePath(i % deviceCount) + QStringLiteral("/service0010/char0011"),
+                              QStringLiteral("org.bluez.GattCharacteristic1"),
+                              { { QStringLiteral("Value"), QByteArray(20, char(i)) } });
+        sendPropertiesChanged(devicePath(i % deviceCount), QStringLiteral("org.bluez.Battery1"),
+                              { { QStringLiteral("Percentage"), QVariant::fromValue(uchar(i)) } });
+        sendPropertiesChanged(otherAdapterDevice, QStringLiteral("org.bluez.Device1"),
+                              { { QStringLiteral("RSSI"), QVariant::fromValue(qint16(-50)) } });
+    }
+
+    sendMarker();
+}
+
+void FakeBluez::sendPropertiesChanged(const QString &path, const QString &interface,
+                                      const QVariantMap &changedProperties)
+{
+    QDBusMessage message = QDBusMessage::createSignal(
+                path, QStringLiteral("org.freedesktop.DBus.Properties"),
+                QStringLiteral("PropertiesChanged"));
+    message << interface << changedProperties << QStringList();
+    m_connection.send(message);
+}
+
+// Lets the test know that all of the signals sent before have been delivered
+void FakeBluez::sendMarker()
+{
+    sendPropertiesChanged(adapterPath, QStringLiteral("org.bluez.Adapter1"),
+                          { { QStringLiteral("Class"), 0u } });
+}
+
+class tst_QBluetoothDeviceDiscoveryAgentBluez : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void filter_data();
+    void filter();
+    void propertiesChangedMatchRule();
+
+public slots:
+    void markerReceived() { ++m_markers; }
+
+private:
+    QStringList runDiscovery(const QBluetoothDeviceDiscoveryFilter &filter, int *signalsSent);
+
+    QProcess m_busDaemon;
+    QThread m_bluezThread;
+    FakeBluez *m_bluez = nullptr;
+    int m_markers = 0;
+};
+
+void tst_QBluetoothDeviceDiscoveryAgentBluez::initTestCase()
+{
+    const QString daemon = QStandardPaths::findExecutable(QStringLiteral("dbus-daemon"));
+    if (daemon.isEmpty())
+        QSKIP("This test requires dbus-daemon.");
+
+    m_busDaemon.start(daemon, { QStringLiteral("--session"), QStringLiteral("--nofork"),
+                                QStringLiteral("--print-address") });
+    QVERIFY(m_busDaemon.waitForStarted());
+    QVERIFY(m_busDaemon.waitForReadyRead());
+    const QString address = QString::fromLocal8Bit(m_busDaemon.readLine()).trimmed();
+    QVERIFY(!address.isEmpty());
+
+    // The agent talks to bluetoothd on the system bus
+    qputenv("DBUS_SYSTEM_BUS_ADDRESS", address.toLocal8Bit());
+
+    m_bluez = new FakeBluez;
+    m_bluez->moveToThread(&m_bluezThread);
+    connect(&m_bluezThread, &QThread::finished, m_bluez, &QObject::deleteLater);
+    m_bluezThread.start();
+
+    bool started = false;
+    QMetaObject::invokeMethod(m_bluez, "start", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, started), Q_ARG(QString, address));
+    QVERIFY(started);
+
+    QVERIFY(QDBusConnection::systemBus().connect(
+                QStringLiteral("org.bluez"), adapterPath,
+                QStringLiteral("org.freedesktop.DBus.Properties"),
+                QStringLiteral("PropertiesChanged"), this, SLOT(markerReceived())));
+}
+
+void tst_QBluetoothDeviceDiscoveryAgentBluez::cleanupTestCase()
+{
+    if (m_bluezThread.isRunning()) {
+        QMetaObject::invokeMethod(m_bluez, "stop", Qt::BlockingQueuedConnection);
+        m_bluezThread.quit();
+        m_bluezThread.wait();
+    }
+
+    if (m_busDaemon.state() != QProcess::NotRunning) {
+        m_busDaemon.terminate();
+        m_busDaemon.waitForFinished();
+    }
+}
+
+QStringList tst_QBluetoothDeviceDiscoveryAgentBluez::runDiscovery(
+        const QBluetoothDeviceDiscoveryFilter &filter, int *signalsSent)
+{
+    QBluetoothDeviceDiscoveryAgent agent;
+    agent.setLowEnergyDiscoveryTimeout(0);
+    agent.setDiscoveryFilter(filter);
+
+    const int signalsBefore = m_bluez->signalsSent();
+    const int markers = m_markers;
+
+    agent.start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+    if (!agent.isActive() || !QTest::qWaitFor([&]() { return m_bluez->isDiscovering(); }))
+        return QStringList();
+
+    QMetaObject::invokeMethod(m_bluez, "advertise", Qt::QueuedConnection, Q_ARG(int, 5));
+    if (!QTest::qWaitFor([&]() { return m_markers > markers; }))
+        return QStringList();
+
+    QSignalSpy canceledSpy(&agent, &QBluetoothDeviceDiscoveryAgent::canceled);
+    agent.stop();
+    QTest::qWaitFor([&]() { return !canceledSpy.isEmpty(); });
+
+    *signalsSent = m_bluez->signalsSent() - signalsBefore;
+
+    QStringList addresses;
+    const QList<QBluetoothDeviceInfo> devices = agent.discoveredDevices();
+    for (const QBluetoothDeviceInfo &info : devices)
+        addresses.append(info.address().toString());
+    addresses.sort();
+    return addresses;
+}
+
+void tst_QBluetoothDeviceDiscoveryAgentBluez::filter_data()
+{
+    QTest::addColumn<bool>("legacy");
+
+    QTest::newRow("BlueZ filtering") << false;
+    QTest::newRow("local filtering") << true;
+}
+
+void tst_QBluetoothDeviceDiscoveryAgentBluez::filter()
+{
+    QFETCH(bool, legacy);
+    m_bluez->setLegacy(legacy);
+
+    int unfilteredSignals = 0;
+    const QStringList all = runDiscovery(QBluetoothDeviceDiscoveryFilter(), &unfilteredSignals);
+    QCOMPARE(all.size(), deviceCount + 1);
+    QCOMPARE(m_bluez->discoveryFilter().value(QStringLiteral("Transport")).toString(),
+             QStringLiteral("le"));
+    QVERIFY(!m_bluez->discoveryFilter().contains(QStringLiteral("UUIDs")));
+
+    // Heart rate sensors named "Sensor-" with a signal of at least -90 dBm: 0, 10, ..., 50
+    QBluetoothDeviceDiscoveryFilter filter;
+    filter.setServiceUuids({ QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::HeartRate) });
+    filter.setMinimumRssi(-90);
+    filter.setNamePattern(QStringLiteral("Sensor-"));
+    filter.setDuplicateDataReported(false);
+
+    QStringList expected;
+    for (int i = 0; i <= 50; i += 10)
+        expected.append(deviceAddress(i));
+    expected.sort();
+
+    int filteredSignals = 0;
+    QCOMPARE(runDiscovery(filter, &filteredSignals), expected);
+
+    qDebug() << "D-Bus signals sent by BlueZ, unfiltered:" << unfilteredSignals
+             << "filtered:" << filteredSignals;
+
+    const QVariantMap bluezFilter = m_bluez->discoveryFilter();
+    if (legacy) {
+        // The old BlueZ does not filter, the agent does it before creating the device infos
+        QCOMPARE(bluezFilter.size(), 1);
+        QCOMPARE(filteredSignals, unfilteredSignals);
+    } else {
+        QCOMPARE(bluezFilter.value(QStringLiteral("UUIDs")).toStringList(),
+                 QStringList{ heartRateUuid });
+        QCOMPARE(bluezFilter.value(QStringLiteral("RSSI")).toInt(), -90);
+        QCOMPARE(bluezFilter.value(QStringLiteral("Pattern")).toString(),
+                 QStringLiteral("Sensor-"));
+        QCOMPARE(bluezFilter.value(QStringLiteral("DuplicateData")).toBool(), false);
+        QCOMPARE(filteredSignals, int(expected.size()));
+        QVERIFY(filteredSignals * 50 < unfilteredSignals);
+    }
+
+    // The pathloss also needs the advertised transmit power, the fake only knows the key
+    QBluetoothDeviceDiscoveryFilter pathloss;
+    pathloss.setMaximumPathloss(65);
+    int pathlossSignals = 0;
+    const QStringList inRange = runDiscovery(pathloss, &pathlossSignals);
+    QCOMPARE(inRange.size(), 26); // TxPower 0 dBm, RSSI -40 ... -65 dBm
+    if (!legacy)
+        QCOMPARE(m_bluez->discoveryFilter().value(QStringLiteral("Pathloss")).toInt(), 65);
+}
+
+static QStringList *capturedMessages = nullptr;
+
+static void captureMessages(QtMsgType, const QMessageLogContext &, const QString &message)
+{
+    if (capturedMessages)
+        capturedMessages->append(message);
+}
+
+void tst_QBluetoothDeviceDiscoveryAgentBluez::propertiesChangedMatchRule()
+{
+    m_bluez->setLegacy(false);
+
+    QStringList messages;
+    capturedMessages = &messages;
+    const QtMessageHandler oldHandler = qInstallMessageHandler(captureMessages);
+    QLoggingCategory::setFilterRules(QStringLiteral("qt.bluetooth.bluez.debug=true"));
+
+    QBluetoothDeviceDiscoveryAgent agent;
+    agent.setLowEnergyDiscoveryTimeout(0);
+    agent.start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+    QVERIFY(agent.isActive());
+    QTRY_VERIFY(m_bluez->isDiscovering());
+
+    // 100 devices found, 100 RSSI updates
+    int markers = m_markers;
+    QMetaObject::invokeMethod(m_bluez, "advertise", Qt::QueuedConnection, Q_ARG(int, 2));
+    QTRY_VERIFY(m_markers > markers);
+
+    // 3 x 50 changes nobody in here is interested in
+    markers = m_markers;
+    QMetaObject::invokeMethod(m_bluez, "sendUnrelatedChanges", Qt::QueuedConnection,
+                              Q_ARG(int, 50));
+    QTRY_VERIFY(m_markers > markers);
+
+    QSignalSpy canceledSpy(&agent, &QBluetoothDeviceDiscoveryAgent::canceled);
+    agent.stop();
+    QTRY_VERIFY(!canceledSpy.isEmpty());
+
+    QLoggingCategory::setFilterRules(QString());
+    qInstallMessageHandler(oldHandler);
+    capturedMessages = nullptr;
+
+    QCOMPARE(agent.discoveredDevices().size(), deviceCount + 1);
+
+    // The GATT and battery changes never reach the process. The devices of the other
+    // adapter do, as QtDBus cannot express a path_namespace match.
+    const QRegularExpression counters(
+                QStringLiteral("PropertiesChanged signals delivered: (\\d+) used: (\\d+)"));
+    QRegularExpressionMatch match;
+    for (const QString &message : qAsConst(messages)) {
+        match = counters.match(message);
+        if (match.hasMatch())
+            break;
+    }
+    QVERIFY(match.hasMatch());
+    QCOMPARE(match.captured(1).toInt(), deviceCount + 50);
+    QCOMPARE(match.captured(2).toInt(), deviceCount);
+}
+
+QTEST_MAIN(tst_QBluetoothDeviceDiscoveryAgentBluez)
+
+#include "tst_qbluetoothdevicediscoveryagent_bluez.moc"
@@ -0,0 +1,554 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QSocketNotifier>
+
+#include <QtBluetooth/private/bluez_data_p.h>
+#include <QtBluetooth/private/hcimanager_p.h>
+#include <QtBluetooth/private/qleadvertiser_p.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+/*
+    Emulates the LE controller on the far end of the HCI socket. Every command
+    is recorded and completed, after completionDelay milliseconds if set. The
+    controller accepts up to commandCredits commands at a time.
+ */
+class FakeHciController : public QObject
+{
+    Q_OBJECT
+public:
+    struct Command {
+        QBluezConst::OpCodeCommandField ocf;
+        QByteArray parameters;
+    };
+
+    FakeHciController()
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+            return;
+        controllerSocket = fds[0];
+        hostSocket = fds[1];
+        notifier = new QSocketNotifier(controllerSocket, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &FakeHciController::readCommand);
+    }
+
+    ~FakeHciController()
+    {
+        if (controllerSocket >= 0)
+            ::close(controllerSocket);
+    }
+
+    // the socket end for the HciManager, which takes ownership
+    int takeHostSocket()
+    {
+        const int socket = hostSocket;
+        hostSocket = -1;
+        return socket;
+    }
+
+    QList<QBluezConst::OpCodeCommandField> commandCodes() const
+    {
+        QList<QBluezConst::OpCodeCommandField> result;
+        for (const Command &command : commands)
+            result.append(command.ocf);
+        return result;
+    }
+
+    QList<Command> commands;
+    bool extendedAdvertisingSupported = true;
+    quint16 maxAdvertisingDataLength = 1650;
+    int commandCredits = 1;
+    int completionDelay = 0;
+    int maxOutstandingCommands = 0;
+    bool creditsExceeded = false;
+    bool enableOverlapped = false;
+
+private slots:
+    void readCommand()
+    {
+        char buffer[HCI_MAX_EVENT_SIZE + 4];
+        const int size = ::read(controllerSocket, buffer, sizeof buffer);
+        if (size < 4 || buffer[0] != HCI_COMMAND_PKT)
+            return;
+
+        const quint16 opCode = qFromLittleEndian<quint16>(buffer + 1);
+        const int length = quint8(buffer[3]);
+        if (size != 4 + length) {
+            qWarning() << "Malformed HCI command packet";
+            return;
+        }
+        const auto ocf = QBluezConst::OpCodeCommandField(ocfFromOpCode(opCode));
+        commands.append({ ocf, QByteArray(buffer + 4, length) });
+
+        ++outstandingCommands;
+        maxOutstandingCommands = qMax(maxOutstandingCommands, outstandingCommands);
+        if (outstandingCommands > commandCredits)
+            creditsExceeded = true;
+        const bool enable = (ocf == QBluezConst::OcfLeSetAdvEnable
+                             || ocf == QBluezConst::OcfLeSetExtAdvEnable) && buffer[4] == 1;
+        if (enable && outstandingCommands > 1)
+            enableOverlapped = true;
+
+        QByteArray returnParameters;
+        switch (ocf) {
+        case QBluezConst::OcfLeReadLocalSupportedFeatures:
+            returnParameters = QByteArray(8, '\0');
+            if (extendedAdvertisingSupported)
+                returnParameters[1] = 0x10;
+            break;
+        case QBluezConst::OcfLeReadMaxAdvDataLength:
+            returnParameters.resize(2);
+            qToLittleEndian(maxAdvertisingDataLength, returnParameters.data());
+            break;
+        case QBluezConst::OcfLeReadTxPowerLevel:
+        case QBluezConst::OcfLeSetExtAdvParams:
+            returnParameters = QByteArray(1, char(-4));
+            break;
+        default:
+            break;
+        }
+        if (completionDelay > 0) {
+            QTimer::singleShot(completionDelay, this, [this, opCode, returnParameters]() {
+                completeCommand(opCode, returnParameters);
+            });
+        } else {
+            completeCommand(opCode, returnParameters);
+        }
+    }
+
+private:
+    void completeCommand(quint16 opCode, const QByteArray &returnParameters)
+    {
+        --outstandingCommands;
+        QByteArray event;
+        event.append(char(HCI_EVENT_PKT));
+        event.append(char(HciManager::HciEvent::EVT_CMD_COMPLETE));
+        event.append(char(4 + returnParameters.size()));
+        event.append(char(commandCredits - outstandingCommands)); // number of HCI command packets
+        event.append(char(opCode & 0xff));
+        event.append(char(opCode >> 8));
+        event.append(char(0)); // status
+        event.append(returnParameters);
+        if (::write(controllerSocket, event.constData(), event.size()) != event.size())
+            qWarning() << "Cannot send HCI event";
+    }
+
+    int controllerSocket = -1;
+    int hostSocket = -1;
+    int outstandingCommands = 0;
+    QSocketNotifier *notifier = nullptr;
+};
+
+class tst_QLeAdvertiserBluez : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void legacyAdvertising();
+    void legacyUpdate();
+    void extendedLegacyPdus();
+    void extendedLargePayload();
+    void extendedUpdate();
+    void extendedFragmentedUpdate();
+    void coalescedUpdates();
+    void concurrentSets();
+    void redundantCommandsSkipped_data();
+    void redundantCommandsSkipped();
+    void pipelinedCommands();
+    void sharedHciManager();
+};
+
+static QLowEnergyAdvertisingParameters nonConnectableParameters()
+{
+    QLowEnergyAdvertisingParameters parameters;
+    parameters.setMode(QLowEnergyAdvertisingParameters::AdvNonConnInd);
+    return parameters;
+}
+
+static QLowEnergyAdvertisingData rawAdvertisingData(int size, char fill)
+{
+    // manufacturer specific AD structures of up to 255 bytes each
+    QByteArray raw;
+    while (raw.size() < size) {
+        const int length = qMin(size - raw.size(), 256);
+        raw.append(char(length - 1));
+        raw.append(char(0xff));
+        raw.append(QByteArray(length - 2, fill));
+    }
+
+    QLowEnergyAdvertisingData data;
+    data.setRawData(raw);
+    return data;
+}
+
+// reassembles the payload of a sequence of extended data commands
+static QByteArray extendedPayload(const QList<FakeHciController::Command> &commands,
+                                  QBluezConst::OpCodeCommandField ocf)
+{
+    QByteArray payload;
+    for (const FakeHciController::Command &command : commands) {
+        if (command.ocf != ocf)
+            continue;
+        const int operation = command.parameters.at(1);
+        if (operation == 0x01 || operation == 0x03) // first fragment or complete data
+            payload.clear();
+        payload.append(command.parameters.mid(4, quint8(command.parameters.at(3))));
+    }
+    return payload;
+}
+
+// creates an advertiser on an HciManager of its own, the advertiser owns the manager
+static std::unique_ptr<QLeAdvertiserBluez>
+createAdvertiser(FakeHciController &fake, const QLowEnergyAdvertisingParameters &parameters,
+                 const QLowEnergyAdvertisingData &data)
+{
+    HciManager *manager = new HciManager(fake.takeHostSocket(), 0);
+    auto advertiser = std::make_unique<QLeAdvertiserBluez>(parameters, data,
+                                                           QLowEnergyAdvertisingData(), *manager);
+    manager->setParent(advertiser.get());
+    return advertiser;
+}
+
+void tst_QLeAdvertiserBluez::legacyAdvertising()
+{
+    FakeHciController fake;
+    fake.extendedAdvertisingSupported = false;
+    const auto advertiser = createAdvertiser(fake, nonConnectableParameters(),
+                                             rawAdvertisingData(20, 'a'));
+    QSignalSpy errorSpy(advertiser.get(), &QLeAdvertiser::errorOccurred);
+
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 5);
+    QCOMPARE(fake.commandCodes(), (QList<QBluezConst::OpCodeCommandField>{
+                                       QBluezConst::OcfLeReadLocalSupportedFeatures,
+                                       QBluezConst::OcfLeSetAdvEnable,
+                                       QBluezConst::OcfLeSetAdvParams,
+                                       QBluezConst::OcfLeSetAdvData,
+                                       QBluezConst::OcfLeSetAdvEnable }));
+    QVERIFY(!advertiser->usesExtendedAdvertising());
+
+    // the legacy command carries a zero padded payload
+    const QByteArray data = fake.commands.at(3).parameters;
+    QCOMPARE(data.size(), 32);
+    QCOMPARE(int(data.at(0)), 20);
+    QCOMPARE(data.mid(1, 20), rawAdvertisingData(20, 'a').rawData());
+    QCOMPARE(fake.commands.at(4).parameters, QByteArray(1, 1));
+    QCOMPARE(errorSpy.count(), 0);
+}
+
+void tst_QLeAdvertiserBluez::legacyUpdate()
+{
+    FakeHciController fake;
+    fake.extendedAdvertisingSupported = false;
+    const auto advertiser = createAdvertiser(fake, nonConnectableParameters(),
+                                             rawAdvertisingData(20, 'a'));
+
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 5);
+    fake.commands.clear();
+
+    // the advertiser is not toggled
+    advertiser->updateAdvertisingData(rawAdvertisingData(10, 'b'), QLowEnergyAdvertisingData());
+    QTRY_COMPARE(fake.commands.size(), 1);
+    QCOMPARE(fake.commands.at(0).ocf, QBluezConst::OcfLeSetAdvData);
+    QCOMPARE(fake.commands.at(0).parameters.mid(1, 10), rawAdvertisingData(10, 'b').rawData());
+    QTest::qWait(50);
+    QCOMPARE(fake.commands.size(), 1);
+}
+
+void tst_QLeAdvertiserBluez::extendedLegacyPdus()
+{
+    FakeHciController fake;
+    QLowEnergyAdvertisingParameters parameters;
+    parameters.setMode(QLowEnergyAdvertisingParameters::AdvInd);
+    const auto advertiser = createAdvertiser(fake, parameters, rawAdvertisingData(20, 'a'));
+
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 7);
+    QCOMPARE(fake.commandCodes(), (QList<QBluezConst::OpCodeCommandField>{
+                                       QBluezConst::OcfLeReadLocalSupportedFeatures,
+                                       QBluezConst::OcfLeReadMaxAdvDataLength,
+                                       QBluezConst::OcfLeSetExtAdvEnable,
+                                       QBluezConst::OcfLeSetExtAdvParams,
+                                       QBluezConst::OcfLeSetExtAdvData,
+                                       QBluezConst::OcfLeSetExtScanResponseData,
+                                       QBluezConst::OcfLeSetExtAdvEnable }));
+    QVERIFY(advertiser->usesExtendedAdvertising());
+
+    // small payloads use legacy, connectable and scannable PDUs
+    const QByteArray params = fake.commands.at(3).parameters;
+    QCOMPARE(params.size(), 25);
+    QCOMPARE(int(params.at(0)), advertiser->advertisingHandle());
+    QCOMPARE(qFromLittleEndian<quint16>(params.constData() + 1), quint16(0x13));
+    QCOMPARE(extendedPayload(fake.commands, QBluezConst::OcfLeSetExtAdvData),
+             rawAdvertisingData(20, 'a').rawData());
+
+    const QByteArray enable = fake.commands.at(6).parameters;
+    QCOMPARE(enable.size(), 6);
+    QCOMPARE(int(enable.at(0)), 1);
+    QCOMPARE(int(enable.at(1)), 1);
+    QCOMPARE(int(enable.at(2)), advertiser->advertisingHandle());
+}
+
+void tst_QLeAdvertiserBluez::extendedLargePayload()
+{
+    FakeHciController fake;
+    const QLowEnergyAdvertisingData data = rawAdvertisingData(1650, 'x');
+    const auto advertiser = createAdvertiser(fake, nonConnectableParameters(), data);
+
+    advertiser->startAdvertising();
+    // 1650 bytes need seven fragments of at most 251 bytes
+    QTRY_COMPARE(fake.commands.size(), 4 + 7 + 1);
+    QCOMPARE(fake.commands.last().ocf, QBluezConst::OcfLeSetExtAdvEnable);
+
+    const QByteArray params = fake.commands.at(3).parameters;
+    QCOMPARE(qFromLittleEndian<quint16>(params.constData() + 1), quint16(0));
+
+    QList<int> operations;
+    for (const FakeHciController::Command &command : qAsConst(fake.commands)) {
+        if (command.ocf == QBluezConst::OcfLeSetExtAdvData)
+            operations.append(command.parameters.at(1));
+    }
+    QCOMPARE(operations, (QList<int>{ 1, 0, 0, 0, 0, 0, 2 }));
+    QCOMPARE(extendedPayload(fake.commands, QBluezConst::OcfLeSetExtAdvData), data.rawData());
+}
+
+void tst_QLeAdvertiserBluez::extendedUpdate()
+{
+    FakeHciController fake;
+    const auto advertiser = createAdvertiser(fake, nonConnectableParameters(),
+                                             rawAdvertisingData(200, 'a'));
+
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 6);
+    fake.commands.clear();
+
+    // a payload fitting into a single command replaces the data of the enabled set
+    const QLowEnergyAdvertisingData data = rawAdvertisingData(240, 'b');
+    advertiser->updateAdvertisingData(data, QLowEnergyAdvertisingData());
+    QTRY_COMPARE(fake.commands.size(), 1);
+    QCOMPARE(fake.commands.at(0).ocf, QBluezConst::OcfLeSetExtAdvData);
+    QCOMPARE(int(fake.commands.at(0).parameters.at(1)), 0x03);
+    QCOMPARE(extendedPayload(fake.commands, QBluezConst::OcfLeSetExtAdvData), data.rawData());
+    QTest::qWait(50);
+    QCOMPARE(fake.commands.size(), 1);
+}
+
+void tst_QLeAdvertiserBluez::extendedFragmentedUpdate()
+{
+    FakeHciController fake;
+    const auto advertiser = createAdvertiser(fake, nonConnectableParameters(),
+                                             rawAdvertisingData(200, 'a'));
+
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 6);
+    fake.commands.clear();
+
+    // fragmented data cannot be set while the set is enabled
+    const QLowEnergyAdvertisingData data = rawAdvertisingData(600, 'b');
+    advertiser->updateAdvertisingData(data, QLowEnergyAdvertisingData());
+    QTRY_COMPARE(fake.commands.size(), 5);
+    QCOMPARE(fake.commandCodes(), (QList<QBluezConst::OpCodeCommandField>{
+                                       QBluezConst::OcfLeSetExtAdvEnable,
+                                       QBluezConst::OcfLeSetExtAdvData,
+                                       QBluezConst::OcfLeSetExtAdvData,
+                                       QBluezConst::OcfLeSetExtAdvData,
+                                       QBluezConst::OcfLeSetExtAdvEnable }));
+    QCOMPARE(int(fake.commands.first().parameters.at(0)), 0);
+    QCOMPARE(int(fake.commands.last().parameters.at(0)), 1);
+    QCOMPARE(extendedPayload(fake.commands, QBluezConst::OcfLeSetExtAdvData), data.rawData());
+}
+
+void tst_QLeAdvertiserBluez::coalescedUpdates()
+{
+    FakeHciController fake;
+    const auto advertiser = createAdvertiser(fake, nonConnectableParameters(),
+                                             rawAdvertisingData(20, 'a'));
+
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 6);
+    fake.commands.clear();
+
+    // the first update is in flight while the others are made,
+    // they wait for its completion
+    fake.completionDelay = 100;
+    advertiser->updateAdvertisingData(rawAdvertisingData(20, 'b'), QLowEnergyAdvertisingData());
+    QTRY_COMPARE(fake.commands.size(), 1);
+    for (char fill = 'c'; fill <= 'f'; ++fill)
+        advertiser->updateAdvertisingData(rawAdvertisingData(20, fill), QLowEnergyAdvertisingData());
+    QTRY_COMPARE(fake.commands.size(), 2);
+    QTest::qWait(150);
+    QCOMPARE(fake.commands.size(), 2);
+    QCOMPARE(extendedPayload(fake.commands, QBluezConst::OcfLeSetExtAdvData),
+             rawAdvertisingData(20, 'f').rawData());
+}
+
+void tst_QLeAdvertiserBluez::concurrentSets()
+{
+    FakeHciController fake1;
+    FakeHciController fake2;
+    const auto advertiser1 = createAdvertiser(fake1, nonConnectableParameters(),
+                                              rawAdvertisingData(20, 'a'));
+    const auto advertiser2 = createAdvertiser(fake2, nonConnectableParameters(),
+                                              rawAdvertisingData(20, 'b'));
+
+    advertiser1->startAdvertising();
+    advertiser2->startAdvertising();
+    QTRY_COMPARE(fake1.commands.size(), 6);
+    QTRY_COMPARE(fake2.commands.size(), 6);
+
+    QVERIFY(advertiser1->advertisingHandle() >= 0);
+    QVERIFY(advertiser2->advertisingHandle() >= 0);
+    QVERIFY(advertiser1->advertisingHandle() != advertiser2->advertisingHandle());
+    QCOMPARE(int(fake2.commands.at(3).parameters.at(0)), advertiser2->advertisingHandle());
+}
+
+void tst_QLeAdvertiserBluez::redundantCommandsSkipped_data()
+{
+    QTest::addColumn<bool>("extended");
+    QTest::addColumn<int>("commandCredits");
+    QTest::addColumn<int>("startCommandCount");
+    QTest::addColumn<QBluezConst::OpCodeCommandField>("enableCommand");
+
+    QTest::newRow("legacy") << false << 1 << 5 << QBluezConst::OcfLeSetAdvEnable;
+    QTest::newRow("extended") << true << 1 << 6 << QBluezConst::OcfLeSetExtAdvEnable;
+    // the redundant commands are submitted while disabling is in flight
+    QTest::newRow("legacy, 4 credits") << false << 4 << 5 << QBluezConst::OcfLeSetAdvEnable;
+    QTest::newRow("extended, 4 credits") << true << 4 << 6 << QBluezConst::OcfLeSetExtAdvEnable;
+}
+
+void tst_QLeAdvertiserBluez::redundantCommandsSkipped()
+{
+    QFETCH(bool, extended);
+    QFETCH(int, commandCredits);
+    QFETCH(int, startCommandCount);
+    QFETCH(QBluezConst::OpCodeCommandField, enableCommand);
+
+    FakeHciController fake;
+    fake.extendedAdvertisingSupported = extended;
+    fake.commandCredits = commandCredits;
+    fake.completionDelay = commandCredits > 1 ? 10 : 0;
+    const auto advertiser = createAdvertiser(fake, nonConnectableParameters(),
+                                             rawAdvertisingData(20, 'a'));
+    QSignalSpy errorSpy(advertiser.get(), &QLeAdvertiser::errorOccurred);
+
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), startCommandCount);
+    advertiser->stopAdvertising();
+    QTRY_COMPARE(fake.commands.size(), startCommandCount + 1);
+    fake.commands.clear();
+
+    // parameters and data are still applied, only the set is toggled
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 2);
+    QCOMPARE(fake.commandCodes(), (QList<QBluezConst::OpCodeCommandField>{
+                                       enableCommand, enableCommand }));
+    QCOMPARE(int(fake.commands.last().parameters.at(0)), 1);
+    fake.commands.clear();
+
+    advertiser->updateAdvertisingData(rawAdvertisingData(20, 'a'), QLowEnergyAdvertisingData());
+    QTest::qWait(50);
+    QCOMPARE(fake.commands.size(), 0);
+    QVERIFY(!fake.creditsExceeded);
+    QCOMPARE(errorSpy.count(), 0);
+}
+
+void tst_QLeAdvertiserBluez::pipelinedCommands()
+{
+    FakeHciController fake;
+    fake.extendedAdvertisingSupported = false;
+    fake.commandCredits = 4;
+    fake.completionDelay = 10;
+    const auto advertiser = createAdvertiser(fake, nonConnectableParameters(),
+                                             rawAdvertisingData(20, 'a'));
+    QSignalSpy errorSpy(advertiser.get(), &QLeAdvertiser::errorOccurred);
+
+    advertiser->startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 5);
+    QCOMPARE(fake.commandCodes(), (QList<QBluezConst::OpCodeCommandField>{
+                                       QBluezConst::OcfLeReadLocalSupportedFeatures,
+                                       QBluezConst::OcfLeSetAdvEnable,
+                                       QBluezConst::OcfLeSetAdvParams,
+                                       QBluezConst::OcfLeSetAdvData,
+                                       QBluezConst::OcfLeSetAdvEnable }));
+
+    // disabling, parameters and data are in flight together,
+    // advertising is only enabled once all of them succeeded
+    QCOMPARE(fake.maxOutstandingCommands, 3);
+    QVERIFY(!fake.creditsExceeded);
+    QVERIFY(!fake.enableOverlapped);
+    QCOMPARE(errorSpy.count(), 0);
+}
+
+void tst_QLeAdvertiserBluez::sharedHciManager()
+{
+    FakeHciController fake;
+    fake.completionDelay = 5;
+    HciManager manager(fake.takeHostSocket(), 0);
+    QLeAdvertiserBluez advertiser1(nonConnectableParameters(), rawAdvertisingData(20, 'a'),
+                                   QLowEnergyAdvertisingData(), manager);
+    QLeAdvertiserBluez advertiser2(nonConnectableParameters(), rawAdvertisingData(20, 'b'),
+                                   QLowEnergyAdvertisingData(), manager);
+    QSignalSpy errorSpy1(&advertiser1, &QLeAdvertiser::errorOccurred);
+    QSignalSpy errorSpy2(&advertiser2, &QLeAdvertiser::errorOccurred);
+
+    // both advertisers send the same commands, each gets its own completions
+    advertiser1.startAdvertising();
+    advertiser2.startAdvertising();
+    QTRY_COMPARE(fake.commands.size(), 12);
+    QTest::qWait(50);
+    QCOMPARE(fake.commands.size(), 12);
+    QVERIFY(!fake.creditsExceeded);
+    QCOMPARE(errorSpy1.count(), 0);
+    QCOMPARE(errorSpy2.count(), 0);
+
+    QList<int> enabledSets;
+    for (const FakeHciController::Command &command : qAsConst(fake.commands)) {
+        if (command.ocf == QBluezConst::OcfLeSetExtAdvEnable && command.parameters.at(0) == 1)
+            enabledSets.append(command.parameters.at(2));
+    }
+    std::sort(enabledSets.begin(), enabledSets.end());
+    QList<int> expectedSets{ advertiser1.advertisingHandle(), advertiser2.advertisingHandle() };
+    std::sort(expectedSets.begin(), expectedSets.end());
+    QCOMPARE(enabledSets, expectedSets);
+}
+
+QTEST_MAIN(tst_QLeAdvertiserBluez)
+
+#include "tst_qleadvertiser_bluez.moc"
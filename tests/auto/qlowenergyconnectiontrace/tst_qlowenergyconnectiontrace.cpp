@@ -0,0 +1,175 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtBluetooth/QLowEnergyConnectionTrace>
+#include <QtBluetooth/private/qlowenergyconnectiontrace_p.h>
+
+QT_USE_NAMESPACE
+
+using Trace = QLowEnergyConnectionTrace;
+
+class tst_QLowEnergyConnectionTrace : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyTrace();
+    void sequentialPhases();
+    void overlappingPhases();
+    void trafficAttribution();
+    void abortedPhases();
+    void snapshots();
+};
+
+void tst_QLowEnergyConnectionTrace::emptyTrace()
+{
+    const Trace trace;
+    QVERIFY(trace.isEmpty());
+    QVERIFY(trace.phases().isEmpty());
+    QCOMPARE(trace.startTime(Trace::ConnectPhase), -1);
+    QCOMPARE(trace.duration(Trace::ConnectPhase), -1);
+    QCOMPARE(trace.retryCount(Trace::ConnectPhase), 0);
+    QCOMPARE(trace.roundTrips(Trace::ConnectPhase), 0);
+    QCOMPARE(trace.bytesSent(Trace::ConnectPhase), 0);
+    QCOMPARE(trace.bytesReceived(Trace::ConnectPhase), 0);
+}
+
+void tst_QLowEnergyConnectionTrace::sequentialPhases()
+{
+    Trace trace;
+    auto d = QLowEnergyConnectionTracePrivate::get(trace);
+    d->begin(Trace::ConnectPhase, 0);
+    d->begin(Trace::L2capConnectPhase, 100);
+    QVERIFY(d->end(Trace::L2capConnectPhase, 1100));
+    QVERIFY(d->end(Trace::ConnectPhase, 1200));
+    // ending a phase which is not in progress has no effect
+    QVERIFY(!d->end(Trace::ConnectPhase, 5000));
+    QVERIFY(!d->end(Trace::MtuExchangePhase, 5000));
+
+    QVERIFY(!trace.isEmpty());
+    QCOMPARE(trace.phases(), QList<Trace::Phase>({ Trace::ConnectPhase,
+                                                   Trace::L2capConnectPhase }));
+    QCOMPARE(trace.startTime(Trace::L2capConnectPhase), 100);
+    QCOMPARE(trace.duration(Trace::L2capConnectPhase), 1000);
+    QCOMPARE(trace.duration(Trace::ConnectPhase), 1200);
+    QCOMPARE(trace.duration(Trace::MtuExchangePhase), -1);
+    QCOMPARE(trace.startTime(Trace::SecurityPhase), -1);
+}
+
+void tst_QLowEnergyConnectionTrace::overlappingPhases()
+{
+    Trace trace;
+    auto d = QLowEnergyConnectionTracePrivate::get(trace);
+
+    // detail discovery of two services
+    d->begin(Trace::ServiceDetailsDiscoveryPhase, 10);
+    d->begin(Trace::ServiceDetailsDiscoveryPhase, 20);
+    QVERIFY(!d->end(Trace::ServiceDetailsDiscoveryPhase, 30));
+    QCOMPARE(trace.duration(Trace::ServiceDetailsDiscoveryPhase), -1);
+    QVERIFY(d->end(Trace::ServiceDetailsDiscoveryPhase, 50));
+    QCOMPARE(trace.duration(Trace::ServiceDetailsDiscoveryPhase), 40);
+
+    // a later discovery extends the phase
+    d->begin(Trace::ServiceDetailsDiscoveryPhase, 100);
+    QCOMPARE(trace.duration(Trace::ServiceDetailsDiscoveryPhase), -1);
+    QVERIFY(d->end(Trace::ServiceDetailsDiscoveryPhase, 110));
+    QCOMPARE(trace.startTime(Trace::ServiceDetailsDiscoveryPhase), 10);
+    QCOMPARE(trace.duration(Trace::ServiceDetailsDiscoveryPhase), 100);
+    QCOMPARE(trace.phases().count(), 1);
+}
+
+void tst_QLowEnergyConnectionTrace::trafficAttribution()
+{
+    Trace trace;
+    auto d = QLowEnergyConnectionTracePrivate::get(trace);
+    QCOMPARE(d->activeRecord(), nullptr);
+
+    d->begin(Trace::ConnectPhase, 0);
+    d->begin(Trace::MtuExchangePhase, 10);
+    QCOMPARE(d->activeRecord()->phase, Trace::MtuExchangePhase);
+    d->activeRecord()->bytesSent += 3;
+    d->activeRecord()->bytesReceived += 3;
+    ++d->activeRecord()->roundTrips;
+
+    // the connect phase ends first, the MTU exchange continues
+    d->end(Trace::ConnectPhase, 20);
+    d->begin(Trace::ServiceDiscoveryPhase, 30);
+    d->begin(Trace::SecurityPhase, 40);
+    ++d->activeRecord()->retries;
+    d->end(Trace::SecurityPhase, 50);
+    QCOMPARE(d->activeRecord()->phase, Trace::ServiceDiscoveryPhase);
+    d->activeRecord()->bytesSent += 7;
+    d->end(Trace::ServiceDiscoveryPhase, 60);
+    QCOMPARE(d->activeRecord()->phase, Trace::MtuExchangePhase);
+    d->end(Trace::MtuExchangePhase, 70);
+    QCOMPARE(d->activeRecord(), nullptr);
+
+    QCOMPARE(trace.bytesSent(Trace::MtuExchangePhase), 3);
+    QCOMPARE(trace.bytesReceived(Trace::MtuExchangePhase), 3);
+    QCOMPARE(trace.roundTrips(Trace::MtuExchangePhase), 1);
+    QCOMPARE(trace.bytesSent(Trace::ConnectPhase), 0);
+    QCOMPARE(trace.retryCount(Trace::SecurityPhase), 1);
+    QCOMPARE(trace.bytesSent(Trace::ServiceDiscoveryPhase), 7);
+}
+
+void tst_QLowEnergyConnectionTrace::abortedPhases()
+{
+    Trace trace;
+    auto d = QLowEnergyConnectionTracePrivate::get(trace);
+    d->begin(Trace::ConnectPhase, 0);
+    d->begin(Trace::L2capConnectPhase, 10);
+    d->abort();
+
+    QCOMPARE(d->activeRecord(), nullptr);
+    QVERIFY(!d->end(Trace::L2capConnectPhase, 20));
+    QCOMPARE(trace.startTime(Trace::L2capConnectPhase), 10);
+    QCOMPARE(trace.duration(Trace::L2capConnectPhase), -1);
+    QCOMPARE(trace.duration(Trace::ConnectPhase), -1);
+}
+
+void tst_QLowEnergyConnectionTrace::snapshots()
+{
+    Trace trace;
+    QLowEnergyConnectionTracePrivate::get(trace)->begin(Trace::ConnectPhase, 0);
+    const Trace snapshot = trace;
+
+    QLowEnergyConnectionTracePrivate::get(trace)->end(Trace::ConnectPhase, 10);
+    QCOMPARE(trace.duration(Trace::ConnectPhase), 10);
+    QCOMPARE(snapshot.duration(Trace::ConnectPhase), -1);
+
+    Trace other;
+    other.swap(trace);
+    QVERIFY(trace.isEmpty());
+    QCOMPARE(other.duration(Trace::ConnectPhase), 10);
+}
+
+QTEST_MAIN(tst_QLowEnergyConnectionTrace)
+
+#include "tst_qlowenergyconnectiontrace.moc"
@@ -46,6 +46,12 @@
 #ifdef Q_OS_LINUX
 #include <QtBluetooth/private/lecmaccalculator_p.h>
 #endif
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+#include <QtBluetooth/private/qlowenergycontroller_bluez_p.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include <algorithm>
 #include <cstring>
@@ -66,7 +72,10 @@ private slots:
     void cmacVerifier_data();
     void connectionParameters();
     void controllerType();
+    void preferredMtu();
+    void reliableWrite();
     void serviceData();
+    void localValueStorage();
 
     // Interaction with actual GATT server goes here. Order is relevant.
     void advertisedData();
@@ -331,6 +340,21 @@ void TestQLowEnergyControllerGattServer::serverCommunication()
     QCOMPARE(deviceNameChar.properties(),
              QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Write);
     QCOMPARE(deviceNameChar.value().constData(), "Qt GATT server");
+    {
+        // goes through Prepare and Execute Write Requests on the server
+        QSignalSpy writtenSpy(genericAccessService.data(),
+                              &QLowEnergyService::characteristicWritten);
+        QSignalSpy reliableWriteSpy(genericAccessService.data(),
+                                    &QLowEnergyService::reliableWriteFinished);
+        genericAccessService->beginReliableWrite();
+        genericAccessService->writeCharacteristic(deviceNameChar, "Qt GATT server");
+        QCOMPARE(writtenSpy.count(), 0);
+        genericAccessService->commitReliableWrite();
+        QTRY_COMPARE(reliableWriteSpy.count(), 1);
+        QCOMPARE(reliableWriteSpy.takeFirst().at(0).toBool(), true);
+        QCOMPARE(writtenSpy.count(), 1);
+        QCOMPARE(deviceNameChar.value().constData(), "Qt GATT server");
+    }
     const QLowEnergyCharacteristic appearanceChar
             = genericAccessService->characteristic(QBluetoothUuid::CharacteristicType::Appearance);
     QVERIFY(appearanceChar.isValid());
@@ -466,6 +490,15 @@ void TestQLowEnergyControllerGattServer::serverCommunication()
         QCOMPARE(customService->error(), QLowEnergyService::CharacteristicWriteError);
     }
 
+    // A reliable write fails as a whole if the server rejects one of its values.
+    QSignalSpy reliableWriteSpy(customService.data(), &QLowEnergyService::reliableWriteFinished);
+    customService->beginReliableWrite();
+    customService->writeCharacteristic(customChar5, "reliable");
+    customService->commitReliableWrite();
+    QTRY_COMPARE(reliableWriteSpy.count(), 1);
+    QCOMPARE(reliableWriteSpy.takeFirst().at(0).toBool(), false);
+    QCOMPARE(customService->error(), QLowEnergyService::CharacteristicWriteError);
+
     QByteArray indicateValue(2, 0);
     qToLittleEndian<quint16>(2, reinterpret_cast<uchar *>(indicateValue.data()));
     customService->writeDescriptor(cc3ClientConfig, indicateValue);
@@ -558,6 +591,183 @@ void TestQLowEnergyControllerGattServer::controllerType()
     QCOMPARE(controller->role(), QLowEnergyController::PeripheralRole);
 }
 
+void TestQLowEnergyControllerGattServer::preferredMtu()
+{
+    const QScopedPointer<QLowEnergyController> controller(QLowEnergyController::createPeripheral());
+    QCOMPARE(controller->preferredMtu(), 512);
+
+    controller->setPreferredMtu(517);
+    QCOMPARE(controller->preferredMtu(), 517);
+    controller->setPreferredMtu(23);
+    QCOMPARE(controller->preferredMtu(), 23);
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("MTU 1000 is out of range.*"));
+    controller->setPreferredMtu(1000);
+    QCOMPARE(controller->preferredMtu(), 517);
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("MTU 0 is out of range.*"));
+    controller->setPreferredMtu(0);
+    QCOMPARE(controller->preferredMtu(), 23);
+}
+
+void TestQLowEnergyControllerGattServer::reliableWrite()
+{
+#ifndef Q_OS_LINUX
+    QSKIP("Reliable writes are only implemented for BlueZ");
+#endif
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid(quint16(0x2100)));
+    QLowEnergyCharacteristicData charData;
+    charData.setUuid(QBluetoothUuid(quint16(0x5100)));
+    charData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Write);
+    charData.setValue("first");
+    charData.setValueLength(1, 8);
+    serviceData.addCharacteristic(charData);
+    charData.setUuid(QBluetoothUuid(quint16(0x5101)));
+    charData.setValue("second");
+    serviceData.addCharacteristic(charData);
+
+    const QScopedPointer<QLowEnergyController> controller(QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> service(controller->addService(serviceData));
+    QVERIFY(!service.isNull());
+    const QLowEnergyCharacteristic first = service->characteristic(QBluetoothUuid(quint16(0x5100)));
+    const QLowEnergyCharacteristic second = service->characteristic(QBluetoothUuid(quint16(0x5101)));
+    QVERIFY(first.isValid());
+    QVERIFY(second.isValid());
+    QSignalSpy finishedSpy(service.data(), &QLowEnergyService::reliableWriteFinished);
+
+    // nothing open
+    service->commitReliableWrite();
+    QCOMPARE(service->error(), QLowEnergyService::OperationError);
+    QCOMPARE(finishedSpy.count(), 0);
+
+    // values are only applied on commit
+    service->beginReliableWrite();
+    QVERIFY(service->isReliableWriteOpen());
+    service->writeCharacteristic(first, "one");
+    service->writeCharacteristic(second, "two");
+    QCOMPARE(first.value(), QByteArray("first"));
+    service->commitReliableWrite();
+    QVERIFY(!service->isReliableWriteOpen());
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.takeFirst().at(0).toBool(), true);
+    QCOMPARE(first.value(), QByteArray("one"));
+    QCOMPARE(second.value(), QByteArray("two"));
+
+    // one invalid value rejects all of them
+    service->beginReliableWrite();
+    service->writeCharacteristic(first, "uno");
+    service->writeCharacteristic(second, "far too long");
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("reliable write rejected.*"));
+    service->commitReliableWrite();
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.takeFirst().at(0).toBool(), false);
+    QCOMPARE(service->error(), QLowEnergyService::CharacteristicWriteError);
+    QCOMPARE(first.value(), QByteArray("one"));
+    QCOMPARE(second.value(), QByteArray("two"));
+
+    // aborted values are dropped, a second transaction cannot be opened
+    service->beginReliableWrite();
+    service->beginReliableWrite();
+    QCOMPARE(service->error(), QLowEnergyService::OperationError);
+    service->writeCharacteristic(first, "dropped");
+    service->abortReliableWrite();
+    QVERIFY(!service->isReliableWriteOpen());
+    QCOMPARE(first.value(), QByteArray("one"));
+    QCOMPARE(finishedSpy.count(), 0);
+}
+
+void TestQLowEnergyControllerGattServer::localValueStorage()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    const int valueSize = 64 * 1024;
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid(quint16(0x2200)));
+    QLowEnergyCharacteristicData charData;
+    charData.setUuid(QBluetoothUuid(quint16(0x5200)));
+    charData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Write
+                           | QLowEnergyCharacteristic::Notify);
+    charData.setValue(QByteArray(valueSize, 'v'));
+    charData.setValueLength(1, valueSize);
+    // a client configuration of invalid length is replaced by the default value
+    charData.addDescriptor(QLowEnergyDescriptorData(
+            QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration, QByteArray(1, 1)));
+    serviceData.addCharacteristic(charData);
+
+    const QScopedPointer<QLowEnergyController> controller(QLowEnergyController::createPeripheral());
+    auto d = qobject_cast<QLowEnergyControllerPrivateBluez *>(
+                QLowEnergyControllerPrivate::get(controller.data()));
+    QVERIFY(d);
+    QTest::ignoreMessage(QtWarningMsg,
+                         QRegularExpression("attribute of type .* has invalid length of 1 bytes"));
+    const QScopedPointer<QLowEnergyService> service(controller->addService(serviceData));
+    QVERIFY(!service.isNull());
+    const QLowEnergyCharacteristic characteristic
+            = service->characteristic(QBluetoothUuid(quint16(0x5200)));
+    QVERIFY(characteristic.isValid());
+    const QLowEnergyDescriptor clientConfig = characteristic.clientCharacteristicConfiguration();
+    QVERIFY(clientConfig.isValid());
+    QCOMPARE(clientConfig.value(), QByteArray(2, 0));
+
+    // the attribute table and the service refer to the same values
+    auto memory = d->localAttributeMemory();
+    QCOMPARE(memory.separateBytes, 0);
+    QVERIFY(memory.sharedBytes >= valueSize + 2);
+    QVERIFY(memory.valueBytes < 2 * valueSize);
+
+    service->writeCharacteristic(characteristic, QByteArray(valueSize, 'w'));
+    QCOMPARE(characteristic.value(), QByteArray(valueSize, 'w'));
+    memory = d->localAttributeMemory();
+    QCOMPARE(memory.separateBytes, 0);
+    QVERIFY(memory.valueBytes < 2 * valueSize);
+
+    // a long write from a client is assembled into one value shared by both views
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds), 0);
+    const int peerSocket = fds[0];
+    const auto closePeer = qScopeGuard([peerSocket] { ::close(peerSocket); });
+    ::fcntl(peerSocket, F_SETFL, ::fcntl(peerSocket, F_GETFL) | O_NONBLOCK);
+    QVERIFY(d->attachConnectedChannel(fds[1], QBluetoothAddress("11:22:33:44:55:66")));
+    QCOMPARE(controller->state(), QLowEnergyController::ConnectedState);
+
+    const auto transact = [peerSocket](const QByteArray &request) {
+        QByteArray response;
+        if (::write(peerSocket, request.constData(), request.size()) != request.size())
+            return response;
+        char buffer[64];
+        QTest::qWaitFor([&]() {
+            const ssize_t size = ::read(peerSocket, buffer, sizeof buffer);
+            if (size > 0)
+                response = QByteArray(buffer, size);
+            return !response.isEmpty();
+        });
+        return response;
+    };
+    const QLowEnergyHandle valueHandle = characteristic.handle();
+    const QByteArray part(18, 'p');
+    for (quint16 offset = 0; offset < 3 * part.size(); offset += quint16(part.size())) {
+        QByteArray request(5, Qt::Uninitialized);
+        request[0] = 0x16; // ATT_OP_PREPARE_WRITE_REQUEST
+        qToLittleEndian(valueHandle, request.data() + 1);
+        qToLittleEndian(offset, request.data() + 3);
+        request += part;
+        const QByteArray response = transact(request);
+        QCOMPARE(response.size(), request.size());
+        QCOMPARE(quint8(response.at(0)), quint8(0x17)); // ATT_OP_PREPARE_WRITE_RESPONSE
+        QCOMPARE(response.mid(1), request.mid(1));
+    }
+    QSignalSpy changedSpy(service.data(), &QLowEnergyService::characteristicChanged);
+    const QByteArray response = transact(QByteArray::fromHex("1801"));
+    QCOMPARE(response, QByteArray::fromHex("19")); // ATT_OP_EXECUTE_WRITE_RESPONSE
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(characteristic.value(), part.repeated(3));
+    memory = d->localAttributeMemory();
+    QCOMPARE(memory.separateBytes, 0);
+    QVERIFY(memory.sharedBytes >= 3 * part.size() + 2);
+#else
+    QSKIP("Local value storage is only inspectable for developer builds with BlueZ");
+#endif
+}
+
 void TestQLowEnergyControllerGattServer::serviceData()
 {
     QLowEnergyDescriptorData descData;
@@ -602,6 +812,12 @@ void TestQLowEnergyControllerGattServer::serviceData()
     QCOMPARE(charData.minimumValueLength(), 5);
     QCOMPARE(charData.maximumValueLength(), 5);
 
+    QVERIFY(!charData.isUpdateCoalescingEnabled());
+    QLowEnergyCharacteristicData coalescingCharData = charData;
+    coalescingCharData.setUpdateCoalescingEnabled(true);
+    QVERIFY(coalescingCharData.isUpdateCoalescingEnabled());
+    QVERIFY(coalescingCharData != charData);
+
     const QLowEnergyCharacteristic::PropertyTypes props
             = QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::WriteSigned;
     charData.setProperties(props);
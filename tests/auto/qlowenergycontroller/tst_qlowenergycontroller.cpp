@@ -74,6 +74,8 @@ private slots:
     void tst_readWriteDescriptor();
     void tst_customProgrammableDevice();
     void tst_errorCases();
+    void tst_lazyValueDiscovery();
+    void tst_discoveryPriority();
 private:
     void verifyServiceProperties(const QLowEnergyService *info);
     bool verifyClientCharacteristicValue(const QByteArray& value);
@@ -2759,6 +2761,176 @@ void tst_QLowEnergyController::tst_writeCharacteristicNoResponse()
     QCOMPARE(control->error(), QLowEnergyController::NoError);
 }
 
+void tst_QLowEnergyController::tst_lazyValueDiscovery()
+{
+#if !QT_CONFIG(bluez)
+    QSKIP("Lazy value discovery reads descriptors selectively only on BlueZ");
+#else
+    QList<QBluetoothHostInfo> localAdapters = QBluetoothLocalDevice::allDevices();
+    if (localAdapters.isEmpty())
+        QSKIP("No local Bluetooth device found. Skipping test.");
+
+    if (!remoteDeviceInfo.isValid())
+        QSKIP("No remote BTLE device found. Skipping test.");
+    QScopedPointer<QLowEnergyController> control(
+                QLowEnergyController::createCentral(remoteDeviceInfo));
+
+    QCOMPARE(control->error(), QLowEnergyController::NoError);
+
+    control->connectToDevice();
+    {
+        QTRY_IMPL(control->state() != QLowEnergyController::ConnectingState,
+              30000)
+    }
+
+    if (control->state() == QLowEnergyController::ConnectingState
+            || control->error() != QLowEnergyController::NoError) {
+        // default BTLE backend forever hangs in ConnectingState
+        QSKIP("Cannot connect to remote device");
+    }
+
+    QTRY_VERIFY_WITH_TIMEOUT(control->state() == QLowEnergyController::ConnectedState, 20000);
+    QSignalSpy discoveryFinishedSpy(control.data(), SIGNAL(discoveryFinished()));
+    control->discoverServices();
+    QTRY_VERIFY_WITH_TIMEOUT(discoveryFinishedSpy.count() == 1, 20000);
+
+    // Humidity service
+    const QBluetoothUuid testService(QString("f000aa20-0451-4000-b000-000000000000"));
+    QVERIFY(control->services().contains(testService));
+
+    QLowEnergyService *service = control->createServiceObject(testService, this);
+    QVERIFY(service);
+
+    const QBluetoothUuid dataUuid(QString("f000aa21-0451-4000-b000-000000000000"));
+    const QBluetoothUuid configUuid(QString("f000aa22-0451-4000-b000-000000000000"));
+    QCOMPARE(service->characteristicReadPolicy(dataUuid), QLowEnergyService::ReadOnFirstAccess);
+    service->setCharacteristicReadPolicy(configUuid, QLowEnergyService::ReadOnRequest);
+    QCOMPARE(service->characteristicReadPolicy(configUuid), QLowEnergyService::ReadOnRequest);
+
+    QElapsedTimer timer;
+    timer.start();
+    service->discoverDetails(QLowEnergyService::LazyValueDiscovery);
+    QTRY_VERIFY_WITH_TIMEOUT(
+        service->state() == QLowEnergyService::RemoteServiceDiscovered, 30000);
+    qDebug() << "Lazy value discovery took" << timer.elapsed() << "ms";
+
+    const QLowEnergyCharacteristic dataChar = service->characteristic(dataUuid);
+    const QLowEnergyCharacteristic configChar = service->characteristic(configUuid);
+    QVERIFY(dataChar.isValid());
+    QVERIFY(configChar.isValid());
+
+    // descriptors required for notifications are read during discovery
+    const QLowEnergyDescriptor cccd = dataChar.descriptor(
+                QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
+    QVERIFY(cccd.isValid());
+    QVERIFY(verifyClientCharacteristicValue(cccd.value()));
+    QCOMPARE(dataChar.descriptor(QBluetoothUuid::DescriptorType::CharacteristicUserDescription)
+                     .value(),
+             QByteArray::fromHex("48756d69642e2044617461"));
+
+    // every characteristic value costs exactly one round trip, on first access only
+    QSignalSpy readSpy(service, SIGNAL(characteristicRead(QLowEnergyCharacteristic,QByteArray)));
+    QVERIFY(dataChar.value().isEmpty());
+    QTRY_COMPARE_WITH_TIMEOUT(readSpy.count(), 1, 10000);
+    QCOMPARE(readSpy.at(0).at(0).value<QLowEnergyCharacteristic>(), dataChar);
+    const QByteArray dataValue = readSpy.at(0).at(1).toByteArray();
+    QCOMPARE(dataChar.value(), dataValue);
+    QCOMPARE(service->characteristic(dataUuid).value(), dataValue);
+
+    // ReadOnRequest characteristics are only read explicitly
+    QVERIFY(configChar.value().isEmpty());
+    QTest::qWait(1000);
+    QCOMPARE(readSpy.count(), 1);
+
+    service->readCharacteristic(configChar);
+    QTRY_COMPARE_WITH_TIMEOUT(readSpy.count(), 2, 10000);
+    QVERIFY(configChar.value() == QByteArray::fromHex("00")
+            || configChar.value() == QByteArray::fromHex("81"));
+    QCOMPARE(readSpy.count(), 2);
+    qDebug() << "Value round trips after lazy discovery:" << readSpy.count();
+
+    delete service;
+    control->disconnectFromDevice();
+    QTRY_COMPARE_WITH_TIMEOUT(control->state(), QLowEnergyController::UnconnectedState, 20000);
+#endif
+}
+
+void tst_QLowEnergyController::tst_discoveryPriority()
+{
+#if !QT_CONFIG(bluez)
+    QSKIP("Discovery priorities are only honored on BlueZ");
+#else
+    QList<QBluetoothHostInfo> localAdapters = QBluetoothLocalDevice::allDevices();
+    if (localAdapters.isEmpty())
+        QSKIP("No local Bluetooth device found. Skipping test.");
+
+    if (!remoteDeviceInfo.isValid())
+        QSKIP("No remote BTLE device found. Skipping test.");
+    QScopedPointer<QLowEnergyController> control(
+                QLowEnergyController::createCentral(remoteDeviceInfo));
+
+    control->connectToDevice();
+    {
+        QTRY_IMPL(control->state() != QLowEnergyController::ConnectingState,
+              30000)
+    }
+
+    if (control->state() == QLowEnergyController::ConnectingState
+            || control->error() != QLowEnergyController::NoError) {
+        // default BTLE backend forever hangs in ConnectingState
+        QSKIP("Cannot connect to remote device");
+    }
+
+    QTRY_VERIFY_WITH_TIMEOUT(control->state() == QLowEnergyController::ConnectedState, 20000);
+    QSignalSpy discoveryFinishedSpy(control.data(), SIGNAL(discoveryFinished()));
+    control->discoverServices();
+    QTRY_VERIFY_WITH_TIMEOUT(discoveryFinishedSpy.count() == 1, 20000);
+
+    // Humidity service is requested last but with the highest priority
+    const QBluetoothUuid urgentService(QString("f000aa20-0451-4000-b000-000000000000"));
+    QVERIFY(control->services().contains(urgentService));
+
+    QList<QBluetoothUuid> finished;
+    QList<QLowEnergyService *> services;
+    for (const QBluetoothUuid &uuid : control->services()) {
+        QLowEnergyService *service = control->createServiceObject(uuid, this);
+        QVERIFY(service);
+        connect(service, &QLowEnergyService::stateChanged, this,
+                [&finished, service](QLowEnergyService::ServiceState state) {
+            if (state == QLowEnergyService::RemoteServiceDiscovered)
+                finished.append(service->serviceUuid());
+        });
+        if (uuid == urgentService)
+            services.append(service);
+        else
+            services.prepend(service);
+    }
+
+    QSignalSpy progressSpy(services.last(), SIGNAL(discoveryProgress(int)));
+    for (QLowEnergyService *service : qAsConst(services)) {
+        if (service->serviceUuid() == urgentService)
+            service->discoverDetails(QLowEnergyService::FullDiscovery,
+                                     QLowEnergyService::HighPriority);
+        else
+            service->discoverDetails(QLowEnergyService::FullDiscovery,
+                                     QLowEnergyService::LowPriority);
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), services.count(), 60000);
+    QCOMPARE(finished.first(), urgentService);
+
+    // one signal per round trip, counting up from one
+    QVERIFY(progressSpy.count() > 0);
+    for (int i = 0; i < progressSpy.count(); ++i)
+        QCOMPARE(progressSpy.at(i).at(0).toInt(), i + 1);
+    qDebug() << "Discovery of the urgent service took" << progressSpy.count() << "round trips";
+
+    qDeleteAll(services);
+    control->disconnectFromDevice();
+    QTRY_COMPARE_WITH_TIMEOUT(control->state(), QLowEnergyController::UnconnectedState, 20000);
+#endif
+}
+
 QTEST_MAIN(tst_QLowEnergyController)
 
 #include "tst_qlowenergycontroller.moc"
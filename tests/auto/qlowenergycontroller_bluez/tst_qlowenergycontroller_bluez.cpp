@@ -0,0 +1,639 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QSocketNotifier>
+
+#include <QtBluetooth/QBluetoothDeviceInfo>
+#include <QtBluetooth/QLowEnergyCharacteristicData>
+#include <QtBluetooth/QLowEnergyController>
+#include <QtBluetooth/QLowEnergyServiceData>
+#include <QtBluetooth/private/qlowenergycontroller_bluez_p.h>
+
+#include <algorithm>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+static const QBluetoothAddress localAdapter(QStringLiteral("00:11:22:33:44:55"));
+static const QBluetoothAddress peerAddress(QStringLiteral("66:77:88:99:AA:BB"));
+
+static quint16 le16(const char *data)
+{
+    return quint16(quint8(data[0]) | (quint8(data[1]) << 8));
+}
+
+static void putLe16(char *&dst, quint16 value)
+{
+    *dst++ = char(value & 0xff);
+    *dst++ = char(value >> 8);
+}
+
+static QByteArray uuidBytes(const QBluetoothUuid &uuid)
+{
+    bool ok = false;
+    const quint16 shortUuid = uuid.toUInt16(&ok);
+    Q_ASSERT(ok);
+    QByteArray bytes(2, Qt::Uninitialized);
+    char *data = bytes.data();
+    putLe16(data, shortUuid);
+    return bytes;
+}
+
+/*
+    Scripted ATT server on one end of a socket pair. The other end replaces
+    the L2CAP channel of a central controller. Handles are assigned in the
+    same order as by a peripheral controller. Only 16 bit UUIDs are supported.
+ */
+class ScriptedPeripheral : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ScriptedPeripheral(const QList<QLowEnergyServiceData> &services);
+    ~ScriptedPeripheral() override;
+
+    bool isValid() const { return peerSocket >= 0; }
+
+    // the controller owns the returned socket
+    int takeControllerSocket()
+    {
+        const int socket = controllerSocket;
+        controllerSocket = -1;
+        return socket;
+    }
+
+    QByteArray value(QLowEnergyHandle handle) const;
+
+    // all requests received from the controller
+    QList<QByteArray> requests;
+    // the last byte of the echo of a Prepare Write Request is changed
+    bool corruptPrepareWriteEcho = false;
+    // Read Requests are answered with an error
+    bool rejectReads = false;
+
+private:
+    struct Attribute {
+        QLowEnergyHandle handle;
+        QLowEnergyHandle groupEnd;
+        QByteArray type;
+        QByteArray value;
+    };
+
+    void append(const QBluetoothUuid &type, const QByteArray &value);
+    Attribute *attribute(QLowEnergyHandle handle);
+    void readPdu();
+    QByteArray readByType(const QByteArray &request, bool grouped) const;
+    QByteArray findInformation(const QByteArray &request) const;
+    QByteArray read(const QByteArray &request, quint16 offset);
+    QByteArray executeWrite(const QByteArray &request);
+    QByteArray error(const QByteArray &request, QLowEnergyHandle handle, quint8 code) const;
+
+    QList<Attribute> attributes;
+    QList<QByteArray> preparedWrites;
+    QSocketNotifier *notifier = nullptr;
+    int peerSocket = -1;
+    int controllerSocket = -1;
+    static constexpr int mtu = 23;
+};
+
+ScriptedPeripheral::ScriptedPeripheral(const QList<QLowEnergyServiceData> &services)
+{
+    for (const QLowEnergyServiceData &service : services) {
+        const qsizetype declarationIndex = attributes.size();
+        append(QBluetoothUuid(quint16(0x2800)), uuidBytes(service.uuid()));
+        const QList<QLowEnergyCharacteristicData> characteristics = service.characteristics();
+        for (const QLowEnergyCharacteristicData &characteristic : characteristics) {
+            QByteArray declaration(3, Qt::Uninitialized);
+            char *data = declaration.data();
+            *data++ = char(characteristic.properties());
+            putLe16(data, quint16(attributes.size() + 2));
+            declaration += uuidBytes(characteristic.uuid());
+            append(QBluetoothUuid(quint16(0x2803)), declaration);
+            append(characteristic.uuid(), characteristic.value());
+        }
+        attributes[declarationIndex].groupEnd = quint16(attributes.size());
+    }
+
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+        return;
+    peerSocket = fds[0];
+    controllerSocket = fds[1];
+    notifier = new QSocketNotifier(peerSocket, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &ScriptedPeripheral::readPdu);
+}
+
+ScriptedPeripheral::~ScriptedPeripheral()
+{
+    if (peerSocket >= 0)
+        ::close(peerSocket);
+    if (controllerSocket >= 0)
+        ::close(controllerSocket);
+}
+
+QByteArray ScriptedPeripheral::value(QLowEnergyHandle handle) const
+{
+    return handle > 0 && handle <= attributes.size() ? attributes.at(handle - 1).value
+                                                    : QByteArray();
+}
+
+void ScriptedPeripheral::append(const QBluetoothUuid &type, const QByteArray &value)
+{
+    const QLowEnergyHandle handle = quint16(attributes.size() + 1);
+    attributes.append({ handle, handle, uuidBytes(type), value });
+}
+
+ScriptedPeripheral::Attribute *ScriptedPeripheral::attribute(QLowEnergyHandle handle)
+{
+    return handle > 0 && handle <= attributes.size() ? &attributes[handle - 1] : nullptr;
+}
+
+void ScriptedPeripheral::readPdu()
+{
+    char buffer[mtu];
+    const ssize_t size = ::read(peerSocket, buffer, sizeof buffer);
+    if (size <= 0)
+        return;
+    const QByteArray request(buffer, int(size));
+    requests.append(request);
+
+    QByteArray response;
+    switch (quint8(request.at(0))) {
+    case 0x02: // ATT_OP_EXCHANGE_MTU_REQUEST
+        response = QByteArray::fromHex("031700");
+        break;
+    case 0x04: // ATT_OP_FIND_INFORMATION_REQUEST
+        response = findInformation(request);
+        break;
+    case 0x08: // ATT_OP_READ_BY_TYPE_REQUEST
+        response = readByType(request, false);
+        break;
+    case 0x0a: // ATT_OP_READ_REQUEST
+        if (rejectReads)
+            response = error(request, le16(request.constData() + 1), 0x02); // read not permitted
+        else
+            response = read(request, 0);
+        break;
+    case 0x0c: // ATT_OP_READ_BLOB_REQUEST
+        response = read(request, le16(request.constData() + 3));
+        break;
+    case 0x10: // ATT_OP_READ_BY_GROUP_REQUEST
+        response = readByType(request, true);
+        break;
+    case 0x12: // ATT_OP_WRITE_REQUEST
+        if (Attribute *attr = attribute(le16(request.constData() + 1)))
+            attr->value = request.mid(3);
+        response = QByteArray(1, 0x13);
+        break;
+    case 0x16: // ATT_OP_PREPARE_WRITE_REQUEST
+        preparedWrites.append(request);
+        response = request;
+        response[0] = 0x17;
+        if (corruptPrepareWriteEcho)
+            response[response.size() - 1] = char(~response.at(response.size() - 1));
+        break;
+    case 0x18: // ATT_OP_EXECUTE_WRITE_REQUEST
+        response = executeWrite(request);
+        break;
+    default:
+        response = error(request, 0, 0x06); // request not supported
+        break;
+    }
+    ::write(peerSocket, response.constData(), response.size());
+}
+
+QByteArray ScriptedPeripheral::readByType(const QByteArray &request, bool grouped) const
+{
+    const QLowEnergyHandle start = le16(request.constData() + 1);
+    const QLowEnergyHandle end = le16(request.constData() + 3);
+    const QByteArray type = request.mid(5);
+
+    QByteArray response(2, Qt::Uninitialized);
+    int elementLength = 0;
+    for (const Attribute &attr : attributes) {
+        if (attr.handle < start || attr.handle > end || attr.type != type)
+            continue;
+        const int headerSize = grouped ? 4 : 2;
+        const QByteArray value = attr.value.left(mtu - 2 - headerSize);
+        if (elementLength == 0)
+            elementLength = headerSize + value.size();
+        else if (elementLength != headerSize + value.size()
+                 || response.size() + elementLength > mtu)
+            break;
+
+        QByteArray element(headerSize, Qt::Uninitialized);
+        char *data = element.data();
+        putLe16(data, attr.handle);
+        if (grouped)
+            putLe16(data, attr.groupEnd);
+        response += element + value;
+    }
+    if (elementLength == 0)
+        return error(request, start, 0x0a); // attribute not found
+    response[0] = grouped ? 0x11 : 0x09;
+    response[1] = char(elementLength);
+    return response;
+}
+
+QByteArray ScriptedPeripheral::findInformation(const QByteArray &request) const
+{
+    const QLowEnergyHandle start = le16(request.constData() + 1);
+    const QLowEnergyHandle end = le16(request.constData() + 3);
+
+    QByteArray response = QByteArray::fromHex("0501");
+    for (const Attribute &attr : attributes) {
+        if (attr.handle < start || attr.handle > end)
+            continue;
+        if (response.size() + 4 > mtu)
+            break;
+        QByteArray element(2, Qt::Uninitialized);
+        char *data = element.data();
+        putLe16(data, attr.handle);
+        response += element + attr.type;
+    }
+    if (response.size() == 2)
+        return error(request, start, 0x0a); // attribute not found
+    return response;
+}
+
+QByteArray ScriptedPeripheral::read(const QByteArray &request, quint16 offset)
+{
+    const QLowEnergyHandle handle = le16(request.constData() + 1);
+    const Attribute *attr = attribute(handle);
+    if (!attr)
+        return error(request, handle, 0x01); // invalid handle
+    if (offset > attr->value.size())
+        return error(request, handle, 0x07); // invalid offset
+    const char opcode = request.at(0) == 0x0a ? 0x0b : 0x0d;
+    return QByteArray(1, opcode) + attr->value.mid(offset, mtu - 1);
+}
+
+QByteArray ScriptedPeripheral::executeWrite(const QByteArray &request)
+{
+    if (request.at(1)) {
+        for (const QByteArray &prepared : qAsConst(preparedWrites)) {
+            Attribute *attr = attribute(le16(prepared.constData() + 1));
+            const quint16 offset = le16(prepared.constData() + 3);
+            if (!attr || offset > attr->value.size())
+                return error(request, 0, 0x07); // invalid offset
+            attr->value = attr->value.left(offset) + prepared.mid(5);
+        }
+    }
+    preparedWrites.clear();
+    return QByteArray(1, 0x19);
+}
+
+QByteArray ScriptedPeripheral::error(const QByteArray &request, QLowEnergyHandle handle,
+                                     quint8 code) const
+{
+    QByteArray response(5, Qt::Uninitialized);
+    char *data = response.data();
+    *data++ = 0x01;
+    *data++ = request.at(0);
+    putLe16(data, handle);
+    *data++ = char(code);
+    return response;
+}
+
+class tst_QLowEnergyControllerBluez : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void reliableWrite();
+    void reliableWriteEchoMismatch();
+    void reliableWriteBeforeQueuedWrites();
+    void lazyValueRead();
+    void lazyValueReadError();
+    void discoveryPriority();
+
+private:
+    void connectPeripheral(const QList<QLowEnergyServiceData> &services);
+    QList<QByteArray> writeRequests() const;
+    int readRequests(QLowEnergyHandle handle) const;
+
+    QScopedPointer<ScriptedPeripheral> peripheral;
+    QScopedPointer<QLowEnergyController> controller;
+    QScopedPointer<QLowEnergyService> service;
+    QLowEnergyCharacteristic first;
+    QLowEnergyCharacteristic second;
+};
+
+void tst_QLowEnergyControllerBluez::initTestCase()
+{
+    // Centrals use the kernel ATT interface even if a newer bluetoothd is installed.
+    // The version is detected once, so this must happen before the first controller.
+    qputenv("BLUETOOTH_FORCE_DBUS_LE_VERSION", "5.41");
+}
+
+void tst_QLowEnergyControllerBluez::init()
+{
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid(quint16(0x2100)));
+    QLowEnergyCharacteristicData charData;
+    charData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Write);
+    charData.setUuid(QBluetoothUuid(quint16(0x5100)));
+    charData.setValue("first");
+    serviceData.addCharacteristic(charData);
+    charData.setUuid(QBluetoothUuid(quint16(0x5101)));
+    charData.setValue("second");
+    serviceData.addCharacteristic(charData);
+
+    connectPeripheral({ serviceData });
+    if (QTest::currentTestFailed())
+        return;
+    service.reset(controller->createServiceObject(serviceData.uuid()));
+    QVERIFY(!service.isNull());
+    // the lazy tests start with values which were not read yet
+    const bool lazy = QByteArray(QTest::currentTestFunction()).startsWith("lazy");
+    service->discoverDetails(lazy ? QLowEnergyService::LazyValueDiscovery
+                                  : QLowEnergyService::FullDiscovery);
+    QTRY_COMPARE(service->state(), QLowEnergyService::RemoteServiceDiscovered);
+    first = service->characteristic(QBluetoothUuid(quint16(0x5100)));
+    second = service->characteristic(QBluetoothUuid(quint16(0x5101)));
+    QVERIFY(first.isValid());
+    QVERIFY(second.isValid());
+    if (!lazy)
+        QCOMPARE(first.value(), QByteArray("first"));
+    peripheral->requests.clear();
+}
+
+void tst_QLowEnergyControllerBluez::cleanup()
+{
+    first = QLowEnergyCharacteristic();
+    second = QLowEnergyCharacteristic();
+    service.reset();
+    controller.reset();
+    peripheral.reset();
+}
+
+// connects the controller to a peripheral with the services and discovers them
+void tst_QLowEnergyControllerBluez::connectPeripheral(const QList<QLowEnergyServiceData> &services)
+{
+    first = QLowEnergyCharacteristic();
+    second = QLowEnergyCharacteristic();
+    service.reset();
+    controller.reset();
+
+    peripheral.reset(new ScriptedPeripheral(services));
+    QVERIFY(peripheral->isValid());
+    controller.reset(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(peerAddress, QStringLiteral("Scripted peripheral"), 0),
+            localAdapter));
+    auto d = qobject_cast<QLowEnergyControllerPrivateBluez *>(
+                QLowEnergyControllerPrivate::get(controller.data()));
+    QVERIFY(d);
+    QVERIFY(d->attachConnectedChannel(peripheral->takeControllerSocket(), peerAddress));
+
+    controller->discoverServices();
+    QTRY_COMPARE(controller->state(), QLowEnergyController::DiscoveredState);
+    peripheral->requests.clear();
+}
+
+// the write related requests received by the peripheral
+QList<QByteArray> tst_QLowEnergyControllerBluez::writeRequests() const
+{
+    QList<QByteArray> requests;
+    for (const QByteArray &request : qAsConst(peripheral->requests)) {
+        const quint8 opcode = quint8(request.at(0));
+        if (opcode == 0x12 || opcode == 0x16 || opcode == 0x18)
+            requests.append(request);
+    }
+    return requests;
+}
+
+// the Read Requests for the value at handle received by the peripheral
+int tst_QLowEnergyControllerBluez::readRequests(QLowEnergyHandle handle) const
+{
+    return int(std::count_if(peripheral->requests.cbegin(), peripheral->requests.cend(),
+                             [handle](const QByteArray &request) {
+        return quint8(request.at(0)) == 0x0a && le16(request.constData() + 1) == handle;
+    }));
+}
+
+void tst_QLowEnergyControllerBluez::reliableWrite()
+{
+    QSignalSpy finishedSpy(service.data(), &QLowEnergyService::reliableWriteFinished);
+    QSignalSpy writtenSpy(service.data(), &QLowEnergyService::characteristicWritten);
+    // the second value does not fit into one Prepare Write Request
+    const QByteArray longValue(30, 'l');
+    service->beginReliableWrite();
+    service->writeCharacteristic(first, "one");
+    service->writeCharacteristic(second, longValue);
+    service->commitReliableWrite();
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.takeFirst().at(0).toBool(), true);
+
+    const QList<QByteArray> requests = writeRequests();
+    QCOMPARE(requests.count(), 4);
+    QCOMPARE(requests.at(0), QByteArray::fromHex("16" "0300" "0000") + "one");
+    QCOMPARE(requests.at(1), QByteArray::fromHex("16" "0500" "0000") + longValue.left(18));
+    QCOMPARE(requests.at(2), QByteArray::fromHex("16" "0500" "1200") + longValue.mid(18));
+    QCOMPARE(requests.at(3), QByteArray::fromHex("1801"));
+
+    QCOMPARE(peripheral->value(first.handle()), QByteArray("one"));
+    QCOMPARE(peripheral->value(second.handle()), longValue);
+    QCOMPARE(first.value(), QByteArray("one"));
+    QCOMPARE(second.value(), longValue);
+    QCOMPARE(writtenSpy.count(), 2);
+    QCOMPARE(service->error(), QLowEnergyService::NoError);
+}
+
+void tst_QLowEnergyControllerBluez::reliableWriteEchoMismatch()
+{
+    QSignalSpy finishedSpy(service.data(), &QLowEnergyService::reliableWriteFinished);
+    QSignalSpy writtenSpy(service.data(), &QLowEnergyService::characteristicWritten);
+    peripheral->corruptPrepareWriteEcho = true;
+    service->beginReliableWrite();
+    service->writeCharacteristic(first, "one");
+    service->writeCharacteristic(second, "two");
+    QTest::ignoreMessage(QtWarningMsg,
+                         QRegularExpression("Prepare Write Response does not match request.*"));
+    service->commitReliableWrite();
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.takeFirst().at(0).toBool(), false);
+    QCOMPARE(service->error(), QLowEnergyService::CharacteristicWriteError);
+
+    // the server's queue is cancelled right after the first mismatch
+    const QList<QByteArray> requests = writeRequests();
+    QCOMPARE(requests.count(), 2);
+    QCOMPARE(quint8(requests.at(0).at(0)), quint8(0x16));
+    QCOMPARE(requests.at(1), QByteArray::fromHex("1800"));
+
+    QCOMPARE(peripheral->value(first.handle()), QByteArray("first"));
+    QCOMPARE(peripheral->value(second.handle()), QByteArray("second"));
+    QCOMPARE(first.value(), QByteArray("first"));
+    QCOMPARE(second.value(), QByteArray("second"));
+    QCOMPARE(writtenSpy.count(), 0);
+}
+
+void tst_QLowEnergyControllerBluez::reliableWriteBeforeQueuedWrites()
+{
+    QSignalSpy finishedSpy(service.data(), &QLowEnergyService::reliableWriteFinished);
+    QSignalSpy writtenSpy(service.data(), &QLowEnergyService::characteristicWritten);
+    service->beginReliableWrite();
+    service->writeCharacteristic(first, "one");
+    service->writeCharacteristic(second, "two");
+    service->commitReliableWrite();
+    // queued while the reliable write is in progress
+    service->writeCharacteristic(first, "three");
+    QTRY_COMPARE(writtenSpy.count(), 3);
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.takeFirst().at(0).toBool(), true);
+
+    // the write request neither executes nor cancels the server's queue halfway
+    const QList<QByteArray> requests = writeRequests();
+    QCOMPARE(requests.count(), 4);
+    QCOMPARE(requests.at(0), QByteArray::fromHex("16" "0300" "0000") + "one");
+    QCOMPARE(requests.at(1), QByteArray::fromHex("16" "0500" "0000") + "two");
+    QCOMPARE(requests.at(2), QByteArray::fromHex("1801"));
+    QCOMPARE(requests.at(3), QByteArray::fromHex("12" "0300") + "three");
+    QCOMPARE(peripheral->value(first.handle()), QByteArray("three"));
+    QCOMPARE(peripheral->value(second.handle()), QByteArray("two"));
+}
+
+void tst_QLowEnergyControllerBluez::lazyValueRead()
+{
+    QSignalSpy readSpy(service.data(), &QLowEnergyService::characteristicRead);
+
+    // the first accesses only schedule one read
+    QVERIFY(first.value().isEmpty());
+    QVERIFY(first.value().isEmpty());
+    QCOMPARE(readRequests(first.handle()), 0);
+    QTRY_COMPARE(readSpy.count(), 1);
+    QCOMPARE(readSpy.at(0).at(1).toByteArray(), QByteArray("first"));
+    QCOMPARE(readRequests(first.handle()), 1);
+
+    // later accesses are served from the cache
+    QCOMPARE(first.value(), QByteArray("first"));
+    QTest::qWait(50);
+    QCOMPARE(readRequests(first.handle()), 1);
+    QCOMPARE(readRequests(second.handle()), 0);
+    QCOMPARE(peripheral->requests.count(), 1);
+    QCOMPARE(service->error(), QLowEnergyService::NoError);
+}
+
+void tst_QLowEnergyControllerBluez::lazyValueReadError()
+{
+    QSignalSpy readSpy(service.data(), &QLowEnergyService::characteristicRead);
+    QSignalSpy errorSpy(service.data(), &QLowEnergyService::errorOccurred);
+
+    peripheral->rejectReads = true;
+    QVERIFY(first.value().isEmpty());
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.at(0).at(0).value<QLowEnergyService::ServiceError>(),
+             QLowEnergyService::CharacteristicReadError);
+    QCOMPARE(readRequests(first.handle()), 1);
+
+    // the failed read does not stop the next access from reading again
+    peripheral->rejectReads = false;
+    QVERIFY(first.value().isEmpty());
+    QTRY_COMPARE(readSpy.count(), 1);
+    QCOMPARE(first.value(), QByteArray("first"));
+    QCOMPARE(readRequests(first.handle()), 2);
+    QCOMPARE(readRequests(second.handle()), 0);
+}
+
+void tst_QLowEnergyControllerBluez::discoveryPriority()
+{
+    // four services with two readable characteristics each, five handles per service
+    enum { Low, NormalA, High, NormalB, ServiceCount };
+    QList<QLowEnergyServiceData> services;
+    for (int i = 0; i < ServiceCount; ++i) {
+        QLowEnergyServiceData serviceData;
+        serviceData.setUuid(QBluetoothUuid(quint16(0x2110 + i)));
+        QLowEnergyCharacteristicData charData;
+        charData.setProperties(QLowEnergyCharacteristic::Read);
+        charData.setUuid(QBluetoothUuid(quint16(0x5110 + 2 * i)));
+        charData.setValue("first");
+        serviceData.addCharacteristic(charData);
+        charData.setUuid(QBluetoothUuid(quint16(0x5111 + 2 * i)));
+        charData.setValue("second");
+        serviceData.addCharacteristic(charData);
+        services.append(serviceData);
+    }
+    connectPeripheral(services);
+    if (QTest::currentTestFailed())
+        return;
+
+    // the controller owns the service objects
+    QList<QLowEnergyService *> serviceObjects;
+    for (const QLowEnergyServiceData &serviceData : qAsConst(services)) {
+        serviceObjects.append(controller->createServiceObject(serviceData.uuid(),
+                                                              controller.data()));
+        QVERIFY(serviceObjects.last());
+    }
+
+    // the first request of the low priority service is sent right away
+    serviceObjects[Low]->discoverDetails(QLowEnergyService::FullDiscovery,
+                                         QLowEnergyService::LowPriority);
+    serviceObjects[NormalA]->discoverDetails(QLowEnergyService::FullDiscovery,
+                                             QLowEnergyService::NormalPriority);
+    serviceObjects[NormalB]->discoverDetails(QLowEnergyService::FullDiscovery,
+                                             QLowEnergyService::NormalPriority);
+    serviceObjects[High]->discoverDetails(QLowEnergyService::FullDiscovery,
+                                          QLowEnergyService::HighPriority);
+    for (QLowEnergyService *serviceObject : qAsConst(serviceObjects))
+        QTRY_COMPARE(serviceObject->state(), QLowEnergyService::RemoteServiceDiscovered);
+
+    // the service of each request; ranges are attributed by their end handle
+    QList<int> order;
+    for (const QByteArray &request : qAsConst(peripheral->requests)) {
+        const quint8 opcode = quint8(request.at(0));
+        const bool range = opcode == 0x04 || opcode == 0x08;
+        const QLowEnergyHandle handle = le16(request.constData() + (range ? 3 : 1));
+        order.append((handle - 1) / 5);
+    }
+
+    QVERIFY(order.count() > ServiceCount);
+    QCOMPARE(order.first(), int(Low));
+    const qsizetype highCount = order.count(High);
+    const qsizetype normalCount = order.count(NormalA) + order.count(NormalB);
+    QVERIFY(highCount > 1);
+    // the high priority service overtakes all others
+    for (qsizetype i = 1; i <= highCount; ++i)
+        QCOMPARE(order.at(i), int(High));
+    // the services of the same priority are interleaved before the low priority one
+    for (qsizetype i = highCount + 1; i <= highCount + normalCount; ++i)
+        QVERIFY(order.at(i) == NormalA || order.at(i) == NormalB);
+    QVERIFY(order.indexOf(NormalB) < order.lastIndexOf(NormalA));
+    QVERIFY(order.indexOf(NormalA) < order.lastIndexOf(NormalB));
+    for (qsizetype i = highCount + normalCount + 1; i < order.count(); ++i)
+        QCOMPARE(order.at(i), int(Low));
+}
+
+QTEST_MAIN(tst_QLowEnergyControllerBluez)
+
+#include "tst_qlowenergycontroller_bluez.moc"
@@ -33,6 +33,7 @@
 #include <QNdefNfcTextRecord>
 #include <QNdefNfcUriRecord>
 #include <QNdefMessage>
+#include <private/qndeffiltermatcher_p.h>
 
 QT_USE_NAMESPACE
 
@@ -59,6 +60,10 @@ private slots:
 
     void match();
     void match_data();
+
+    void matcher();
+    void matcher_data();
+    void matcherDispatch();
 };
 
 void tst_QNdefFilter::construct()
@@ -503,6 +508,96 @@ void tst_QNdefFilter::match_data()
     }
 }
 
+void tst_QNdefFilter::matcher()
+{
+    QFETCH(QNdefFilter, filter);
+    QFETCH(QNdefMessage, message);
+    QFETCH(bool, result);
+
+    QNdefFilterMatcher matcher;
+
+    // Unrelated filters share the record class table, but must not affect the result.
+    QNdefFilter unrelated;
+    unrelated.appendRecord(QNdefRecord::Mime, "image/jpeg", 1, 1);
+    unrelated.appendRecord(QNdefRecord::NfcRtd, "U", 0, 1);
+    matcher.addFilter(unrelated);
+
+    const int id = matcher.addFilter(filter);
+    QCOMPARE(matcher.filterCount(), 2);
+    QCOMPARE(matcher.matchingFilters(message).contains(id), result);
+}
+
+void tst_QNdefFilter::matcher_data()
+{
+    match_data();
+}
+
+void tst_QNdefFilter::matcherDispatch()
+{
+    QNdefFilter textFilter;
+    textFilter.appendRecord<QNdefNfcTextRecord>(1, 2);
+
+    QNdefFilter anyMimeFilter;
+    anyMimeFilter.appendRecord(QNdefRecord::Mime, "", 1, 5);
+
+    QNdefFilter orderedFilter;
+    orderedFilter.setOrderMatch(true);
+    orderedFilter.appendRecord<QNdefNfcTextRecord>(1, 1);
+    orderedFilter.appendRecord(QNdefRecord::Mime, "image/png", 0, 1);
+
+    QNdefFilter unorderedFilter;
+    unorderedFilter.appendRecord(QNdefRecord::Mime, "image/png", 0, 1);
+    unorderedFilter.appendRecord<QNdefNfcTextRecord>(1, 1);
+
+    QList<int> called;
+    QNdefFilterMatcher matcher;
+    const int textId = matcher.addFilter(textFilter, [&](const QNdefMessage &) {
+        called.append(0);
+    });
+    const int mimeId = matcher.addFilter(anyMimeFilter, [&](const QNdefMessage &) {
+        called.append(1);
+    });
+    const int orderedId = matcher.addFilter(orderedFilter, [&](const QNdefMessage &) {
+        called.append(2);
+    });
+    const int unorderedId = matcher.addFilter(unorderedFilter, [&](const QNdefMessage &) {
+        called.append(3);
+    });
+
+    QNdefNfcTextRecord textRec;
+    textRec.setText("text");
+
+    QNdefRecord pngRec;
+    pngRec.setTypeNameFormat(QNdefRecord::Mime);
+    pngRec.setType("image/png");
+
+    QNdefRecord jpegRec;
+    jpegRec.setTypeNameFormat(QNdefRecord::Mime);
+    jpegRec.setType("image/jpeg");
+
+    const QNdefMessage textMessage(textRec);
+    QCOMPARE(matcher.matchingFilters(textMessage),
+             QList<int>({ textId, orderedId, unorderedId }));
+    QCOMPARE(matcher.dispatch(textMessage), 3);
+    QCOMPARE(called, QList<int>({ 0, 2, 3 }));
+
+    const QNdefMessage mimeMessage(QList<QNdefRecord>({ pngRec, jpegRec }));
+    QCOMPARE(matcher.matchingFilters(mimeMessage), QList<int>({ mimeId }));
+
+    const QNdefMessage pngFirst(QList<QNdefRecord>({ pngRec, textRec }));
+    QCOMPARE(matcher.matchingFilters(pngFirst), QList<int>({ unorderedId }));
+    QCOMPARE(orderedFilter.match(pngFirst), false);
+    QCOMPARE(unorderedFilter.match(pngFirst), true);
+
+    QVERIFY(matcher.removeFilter(unorderedId));
+    QVERIFY(!matcher.removeFilter(unorderedId));
+    QVERIFY(matcher.matchingFilters(pngFirst).isEmpty());
+
+    called.clear();
+    QCOMPARE(matcher.dispatch(QNdefMessage()), 0);
+    QVERIFY(called.isEmpty());
+}
+
 QTEST_MAIN(tst_QNdefFilter)
 
 #include "tst_qndeffilter.moc"
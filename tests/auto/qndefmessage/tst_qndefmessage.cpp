@@ -32,6 +32,7 @@
 #include <qndefmessage.h>
 #include <qndefnfctextrecord.h>
 #include <qndefnfcurirecord.h>
+#include <private/qndefmessageview_p.h>
 
 QT_USE_NAMESPACE
 
@@ -53,6 +54,9 @@ private slots:
     void parseCorruptedMessage();
     void parseCorruptedMessage_data();
     void parseComplexMessage();
+    void messageView_data();
+    void messageView();
+    void messageWriter();
 };
 
 tst_QNdefMessage::tst_QNdefMessage()
@@ -758,6 +762,98 @@ void tst_QNdefMessage::parseComplexMessage()
 
 }
 
+void tst_QNdefMessage::messageView_data()
+{
+    parseSingleRecordMessage_data();
+}
+
+void tst_QNdefMessage::messageView()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QNdefMessage, message);
+
+    const bool truncated = QByteArray(QTest::currentDataTag()).startsWith("truncated ");
+    if (truncated)
+        QTest::ignoreMessage(QtWarningMsg, "Unexpected end of message");
+
+    const QNdefMessageView view(data);
+    QCOMPARE(view.isValid(), !truncated);
+    if (truncated) {
+        QCOMPARE(view.recordCount(), 0);
+        QVERIFY(view.begin() == view.end());
+        return;
+    }
+
+    QVERIFY(view.toMessage() == message);
+
+    const QNdefMessage parsedMessage = QNdefMessage::fromByteArray(data);
+    QCOMPARE(view.recordCount(), parsedMessage.count());
+
+    int i = 0;
+    for (const QNdefRecordView &recordView : view) {
+        QVERIFY(i < parsedMessage.count());
+        const QNdefRecord &record = parsedMessage.at(i++);
+
+        QCOMPARE(recordView.typeNameFormat(), record.typeNameFormat());
+        QCOMPARE(recordView.type().toByteArray(), record.type());
+        QCOMPARE(recordView.id().toByteArray(), record.id());
+        QCOMPARE(recordView.payloadSize(), record.payload().size());
+        QCOMPARE(recordView.payloadData(), record.payload());
+        if (!recordView.isChunked())
+            QCOMPARE(recordView.payload().toByteArray(), record.payload());
+
+        // Non-chunked records reference the input buffer directly.
+        if (!recordView.isChunked() && !recordView.payload().isEmpty()) {
+            QVERIFY(recordView.payload().data() >= data.constData());
+            QVERIFY(recordView.payload().data() < data.constData() + data.size());
+        }
+
+        QVERIFY(recordView.toRecord() == record);
+    }
+    QCOMPARE(i, parsedMessage.count());
+}
+
+void tst_QNdefMessage::messageWriter()
+{
+    QNdefMessage message;
+
+    QNdefRecord shortRecord;
+    shortRecord.setTypeNameFormat(QNdefRecord::NfcRtd);
+    shortRecord.setType("T");
+    shortRecord.setId("id");
+    shortRecord.setPayload(QByteArray(10, 'a'));
+    message.append(shortRecord);
+
+    QNdefRecord longRecord;
+    longRecord.setTypeNameFormat(QNdefRecord::Mime);
+    longRecord.setType("application/octet-stream");
+    longRecord.setPayload(QByteArray(1000, 'b'));
+    message.append(longRecord);
+
+    message.append(QNdefRecord());
+
+    QByteArray data;
+    QNdefMessageWriter writer(&data);
+    writer.writeMessage(message);
+
+    QCOMPARE(data.size(), QNdefMessageWriter::messageSize(message));
+    QCOMPARE(data, message.toByteArray());
+    QVERIFY(QNdefMessage::fromByteArray(data) == message);
+
+    // an empty message is written as a single empty record
+    QByteArray empty;
+    QNdefMessageWriter(&empty).writeMessage(QNdefMessage());
+    QCOMPARE(empty, QByteArray::fromHex("d00000"));
+    QCOMPARE(empty.size(), QNdefMessageWriter::messageSize(QNdefMessage()));
+
+    // trailing data after the message end is not part of the view
+    data.append("trailing");
+    const QNdefMessageView view(data);
+    QVERIFY(view.isValid());
+    QCOMPARE(view.recordCount(), 3);
+    QCOMPARE(view.size(), data.size() - 8);
+}
+
 QTEST_MAIN(tst_QNdefMessage)
 
 #include "tst_qndefmessage.moc"
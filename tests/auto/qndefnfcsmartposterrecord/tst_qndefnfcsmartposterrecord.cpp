@@ -104,6 +104,8 @@ private slots:
     void tst_typeInfo();
     void tst_construct();
     void tst_downcast();
+    void tst_copyBeforeSerialization();
+    void tst_concurrentSerialization();
 };
 
 tst_QNdefNfcSmartPosterRecord::tst_QNdefNfcSmartPosterRecord()
@@ -567,6 +569,75 @@ void tst_QNdefNfcSmartPosterRecord::tst_downcast()
     QCOMPARE(basePayload, spPayload);
 }
 
+void tst_QNdefNfcSmartPosterRecord::tst_copyBeforeSerialization()
+{
+    // The payload is only serialized on demand, copies taken before must not see later changes.
+    QNdefNfcSmartPosterRecord sprecord;
+    QVERIFY(sprecord.addTitle(getTextRecord("en")));
+    sprecord.setUri(QUrl("http://qt.io"));
+
+    const QNdefNfcSmartPosterRecord copy(sprecord);
+    const QNdefRecord base = sprecord;
+    QNdefMessage message;
+    message.append(sprecord);
+
+    QVERIFY(sprecord.addTitle(getTextRecord("de")));
+    sprecord.setAction(QNdefNfcSmartPosterRecord::DoAction);
+
+    QCOMPARE(copy.titleCount(), 1);
+    QCOMPARE(copy.payload(), base.payload());
+    QCOMPARE(message.first().payload(), base.payload());
+
+    const QNdefNfcSmartPosterRecord parsed(base);
+    QCOMPARE(parsed.titleCount(), 1);
+    QCOMPARE(parsed.uri(), QUrl("http://qt.io"));
+    QVERIFY(!parsed.hasAction());
+
+    // Assignment takes over the payload as well as the structured content
+    QNdefNfcSmartPosterRecord assigned;
+    assigned = sprecord;
+    QCOMPARE(assigned.titleCount(), 2);
+    QCOMPARE(assigned.payload(), sprecord.payload());
+    QVERIFY(assigned.payload() != copy.payload());
+
+    const QNdefNfcSmartPosterRecord reparsed(QNdefMessage::fromByteArray(
+            QNdefMessage(sprecord).toByteArray()).first());
+    QCOMPARE(reparsed.titleCount(), 2);
+    QCOMPARE(reparsed.action(), QNdefNfcSmartPosterRecord::DoAction);
+    QCOMPARE(reparsed.payload(), sprecord.payload());
+    QVERIFY(reparsed == sprecord);
+}
+
+void tst_QNdefNfcSmartPosterRecord::tst_concurrentSerialization()
+{
+    QNdefNfcSmartPosterRecord sprecord;
+    QVERIFY(sprecord.addTitle(getTextRecord("en")));
+    sprecord.setUri(QUrl("http://qt.io"));
+    sprecord.setAction(QNdefNfcSmartPosterRecord::SaveAction);
+
+    // The first const access serializes, whichever thread it happens on
+    const QNdefNfcSmartPosterRecord &shared = sprecord;
+    QList<QByteArray> payloads(8);
+    QList<QThread *> threads;
+    for (int i = 0; i < payloads.size(); ++i) {
+        threads.append(QThread::create([&shared, &payloads, i]() {
+            const QNdefRecord copy = shared;
+            payloads[i] = (i % 2) ? copy.payload() : shared.payload();
+        }));
+    }
+    for (QThread *thread : qAsConst(threads))
+        thread->start();
+    for (QThread *thread : qAsConst(threads)) {
+        QVERIFY(thread->wait());
+        delete thread;
+    }
+
+    const QNdefNfcSmartPosterRecord parsed{ QNdefRecord(sprecord) };
+    QCOMPARE(parsed.action(), QNdefNfcSmartPosterRecord::SaveAction);
+    for (const QByteArray &payload : qAsConst(payloads))
+        QCOMPARE(payload, sprecord.payload());
+}
+
 QTEST_MAIN(tst_QNdefNfcSmartPosterRecord)
 
 #include "tst_qndefnfcsmartposterrecord.moc"
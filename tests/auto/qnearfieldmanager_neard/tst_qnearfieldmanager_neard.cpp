@@ -0,0 +1,652 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QMutex>
+#include <QtCore/QProcess>
+#include <QtCore/QThread>
+#include <QtDBus/QtDBus>
+
+#include <QNdefMessage>
+#include <QNdefNfcUriRecord>
+#include <QNearFieldManager>
+#include <QNearFieldTarget>
+
+QT_USE_NAMESPACE
+
+typedef QMap<QString, QVariantMap> InterfaceList;
+typedef QMap<QDBusObjectPath, InterfaceList> ManagedObjectList;
+
+Q_DECLARE_METATYPE(InterfaceList)
+Q_DECLARE_METATYPE(ManagedObjectList)
+Q_DECLARE_METATYPE(QNearFieldTarget*)
+Q_DECLARE_METATYPE(QNearFieldManager::AdapterState)
+
+static const QString adapterPath = QStringLiteral("/org/neard/nfc0");
+static const QString tagPath = QStringLiteral("/org/neard/nfc0/tag0");
+static const QString recordPath = QStringLiteral("/org/neard/nfc0/tag0/record0");
+
+/*
+    Stand-in for the neard daemon. It is served from its own thread and its
+    own bus connection, because the backend under test makes blocking calls
+    on the system bus.
+*/
+class FakeNeard : public QObject
+{
+    Q_OBJECT
+
+public:
+    bool powered() const { QMutexLocker locker(&m_mutex); return m_powered; }
+    bool polling() const { QMutexLocker locker(&m_mutex); return m_polling; }
+    int pollLoopStarts() const { QMutexLocker locker(&m_mutex); return m_pollLoopStarts; }
+    QByteArray ndef() const { QMutexLocker locker(&m_mutex); return m_ndef; }
+
+    void setPowered(bool powered) { QMutexLocker locker(&m_mutex); m_powered = powered; }
+    void setNdef(const QByteArray &ndef) { QMutexLocker locker(&m_mutex); m_ndef = ndef; }
+
+    void startPollLoop()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_polling = true;
+        ++m_pollLoopStarts;
+    }
+
+    void stopPollLoop() { QMutexLocker locker(&m_mutex); m_polling = false; }
+
+    InterfaceList adapterInterfaces() const
+    {
+        QVariantMap properties;
+        properties.insert(QStringLiteral("Mode"), QStringLiteral("Idle"));
+        properties.insert(QStringLiteral("Powered"), powered());
+        properties.insert(QStringLiteral("Polling"), polling());
+        properties.insert(QStringLiteral("Protocols"),
+                          QStringList{ QStringLiteral("MIFARE"), QStringLiteral("ISO-DEP") });
+        return InterfaceList{ { QStringLiteral("org.neard.Adapter"), properties } };
+    }
+
+    InterfaceList tagInterfaces() const
+    {
+        QVariantMap properties;
+        properties.insert(QStringLiteral("Type"), QStringLiteral("Type 2"));
+        properties.insert(QStringLiteral("Protocol"), QStringLiteral("MIFARE"));
+        properties.insert(QStringLiteral("ReadOnly"), false);
+        properties.insert(QStringLiteral("Adapter"),
+                          QVariant::fromValue(QDBusObjectPath(adapterPath)));
+        return InterfaceList{ { QStringLiteral("org.neard.Tag"), properties } };
+    }
+
+    InterfaceList recordInterfaces() const
+    {
+        QVariantMap properties;
+        properties.insert(QStringLiteral("Type"), QStringLiteral("URI"));
+        return InterfaceList{ { QStringLiteral("org.neard.Record"), properties } };
+    }
+
+    // Only to be called from the thread serving the bus
+    ManagedObjectList managedObjects() const
+    {
+        ManagedObjectList objects;
+        if (m_adapter)
+            objects.insert(QDBusObjectPath(adapterPath), adapterInterfaces());
+        if (m_tag) {
+            objects.insert(QDBusObjectPath(tagPath), tagInterfaces());
+            objects.insert(QDBusObjectPath(recordPath), recordInterfaces());
+        }
+        return objects;
+    }
+
+public Q_SLOTS:
+    bool start(const QString &address);
+    void stop();
+    void addTag();
+    void removeTag();
+    void powerOff();
+    void plugAdapter();
+    void unplugAdapter();
+
+Q_SIGNALS:
+    void interfacesAdded(const QDBusObjectPath &path, const InterfaceList &interfaces);
+    void interfacesRemoved(const QDBusObjectPath &path, const QStringList &interfaces);
+
+private:
+    mutable QMutex m_mutex;
+    bool m_powered = false;
+    bool m_polling = false;
+    int m_pollLoopStarts = 0;
+    QByteArray m_ndef;
+
+    QDBusConnection m_connection = QDBusConnection(QString());
+    QObject *m_root = nullptr;
+    QObject *m_adapter = nullptr;
+    QObject *m_tag = nullptr;
+};
+
+class FakeObjectManagerAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.DBus.ObjectManager")
+
+public:
+    FakeObjectManagerAdaptor(FakeNeard *neard, QObject *parent)
+    :   QDBusAbstractAdaptor(parent), m_neard(neard)
+    {
+        connect(neard, &FakeNeard::interfacesAdded,
+                this, &FakeObjectManagerAdaptor::InterfacesAdded);
+        connect(neard, &FakeNeard::interfacesRemoved,
+                this, &FakeObjectManagerAdaptor::InterfacesRemoved);
+    }
+
+public Q_SLOTS:
+    ManagedObjectList GetManagedObjects()
+    {
+        return m_neard->managedObjects();
+    }
+
+Q_SIGNALS:
+    void InterfacesAdded(const QDBusObjectPath &object_path,
+                         const InterfaceList &interfaces_and_properties);
+    void InterfacesRemoved(const QDBusObjectPath &object_path, const QStringList &interfaces);
+
+private:
+    FakeNeard *m_neard;
+};
+
+class FakeAdapterAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.neard.Adapter")
+    Q_PROPERTY(QString Mode READ mode)
+    Q_PROPERTY(bool Polling READ polling)
+    Q_PROPERTY(bool Powered READ powered WRITE setPowered)
+    Q_PROPERTY(QStringList Protocols READ protocols)
+
+public:
+    FakeAdapterAdaptor(FakeNeard *neard, QObject *parent)
+    :   QDBusAbstractAdaptor(parent), m_neard(neard)
+    {
+    }
+
+    QString mode() const { return QStringLiteral("Idle"); }
+    bool polling() const { return m_neard->polling(); }
+    bool powered() const { return m_neard->powered(); }
+    void setPowered(bool powered) { m_neard->setPowered(powered); }
+    QStringList protocols() const
+    {
+        return QStringList{ QStringLiteral("MIFARE"), QStringLiteral("ISO-DEP") };
+    }
+
+public Q_SLOTS:
+    void StartPollLoop(const QString &) { m_neard->startPollLoop(); }
+    void StopPollLoop() { m_neard->stopPollLoop(); }
+
+private:
+    FakeNeard *m_neard;
+};
+
+class FakeTagAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.neard.Tag")
+    Q_PROPERTY(QString Type READ type)
+    Q_PROPERTY(QString Protocol READ protocol)
+    Q_PROPERTY(bool ReadOnly READ readOnly)
+    Q_PROPERTY(QDBusObjectPath Adapter READ adapter)
+
+public:
+    FakeTagAdaptor(FakeNeard *neard, QObject *parent)
+    :   QDBusAbstractAdaptor(parent), m_neard(neard)
+    {
+    }
+
+    QString type() const { return QStringLiteral("Type 2"); }
+    QString protocol() const { return QStringLiteral("MIFARE"); }
+    bool readOnly() const { return false; }
+    QDBusObjectPath adapter() const { return QDBusObjectPath(adapterPath); }
+
+public Q_SLOTS:
+    QByteArray GetRawNDEF() { return m_neard->ndef(); }
+
+    void Write(const QVariantMap &attributes)
+    {
+        if (attributes.value(QStringLiteral("Type")).toString() == QLatin1String("Raw"))
+            m_neard->setNdef(attributes.value(QStringLiteral("NDEF")).toByteArray());
+    }
+
+private:
+    FakeNeard *m_neard;
+};
+
+bool FakeNeard::start(const QString &address)
+{
+    qDBusRegisterMetaType<InterfaceList>();
+    qDBusRegisterMetaType<ManagedObjectList>();
+
+    m_connection = QDBusConnection::connectToBus(address, QStringLiteral("fakeneard"));
+    if (!m_connection.isConnected())
+        return false;
+
+    m_root = new QObject(this);
+    new FakeObjectManagerAdaptor(this, m_root);
+    m_adapter = new QObject(this);
+    new FakeAdapterAdaptor(this, m_adapter);
+
+    return m_connection.registerObject(QStringLiteral("/"), m_root,
+                                       QDBusConnection::ExportAdaptors)
+            && m_connection.registerObject(adapterPath, m_adapter,
+                                           QDBusConnection::ExportAdaptors)
+            && m_connection.registerService(QStringLiteral("org.neard"));
+}
+
+void FakeNeard::plugAdapter()
+{
+    if (m_adapter)
+        return;
+
+    m_adapter = new QObject(this);
+    new FakeAdapterAdaptor(this, m_adapter);
+    m_connection.registerObject(adapterPath, m_adapter, QDBusConnection::ExportAdaptors);
+
+    Q_EMIT interfacesAdded(QDBusObjectPath(adapterPath), adapterInterfaces());
+}
+
+void FakeNeard::unplugAdapter()
+{
+    if (!m_adapter)
+        return;
+
+    removeTag();
+
+    Q_EMIT interfacesRemoved(QDBusObjectPath(adapterPath),
+                             QStringList{ QStringLiteral("org.neard.Adapter") });
+
+    m_connection.unregisterObject(adapterPath);
+    delete m_adapter;
+    m_adapter = nullptr;
+    stopPollLoop();
+}
+
+void FakeNeard::stop()
+{
+    removeTag();
+    m_connection.unregisterService(QStringLiteral("org.neard"));
+    m_connection.unregisterObject(adapterPath);
+    m_connection.unregisterObject(QStringLiteral("/"));
+    delete m_adapter;
+    delete m_root;
+    m_adapter = m_root = nullptr;
+    QDBusConnection::disconnectFromBus(QStringLiteral("fakeneard"));
+}
+
+void FakeNeard::addTag()
+{
+    if (m_tag)
+        return;
+
+    // neard stops polling once a tag is found
+    stopPollLoop();
+
+    m_tag = new QObject(this);
+    new FakeTagAdaptor(this, m_tag);
+    m_connection.registerObject(tagPath, m_tag, QDBusConnection::ExportAdaptors);
+
+    Q_EMIT interfacesAdded(QDBusObjectPath(tagPath), tagInterfaces());
+    Q_EMIT interfacesAdded(QDBusObjectPath(recordPath), recordInterfaces());
+}
+
+void FakeNeard::removeTag()
+{
+    if (!m_tag)
+        return;
+
+    Q_EMIT interfacesRemoved(QDBusObjectPath(recordPath),
+                             QStringList{ QStringLiteral("org.neard.Record") });
+    Q_EMIT interfacesRemoved(QDBusObjectPath(tagPath),
+                             QStringList{ QStringLiteral("org.neard.Tag") });
+
+    m_connection.unregisterObject(tagPath);
+    delete m_tag;
+    m_tag = nullptr;
+}
+
+void FakeNeard::powerOff()
+{
+    setPowered(false);
+    stopPollLoop();
+
+    QDBusMessage message = QDBusMessage::createSignal(adapterPath,
+                                                      QStringLiteral("org.freedesktop.DBus.Properties"),
+                                                      QStringLiteral("PropertiesChanged"));
+    message << QStringLiteral("org.neard.Adapter")
+            << QVariantMap{ { QStringLiteral("Powered"), false } }
+            << QStringList();
+    m_connection.send(message);
+}
+
+class tst_QNearFieldManagerNeard : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QNearFieldManagerNeard();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void detectReadWrite();
+    void adapterPoweredOff();
+    void tagPresentAtStart();
+    void adapterHotPlug();
+    void tagWhileIdle();
+    void deletedTarget();
+
+private:
+    QProcess m_busDaemon;
+    QThread m_neardThread;
+    FakeNeard *m_neard = nullptr;
+};
+
+tst_QNearFieldManagerNeard::tst_QNearFieldManagerNeard()
+{
+    qRegisterMetaType<QNearFieldTarget *>();
+    qRegisterMetaType<QNearFieldManager::AdapterState>();
+    qRegisterMetaType<QNdefMessage>();
+}
+
+void tst_QNearFieldManagerNeard::initTestCase()
+{
+    const QString daemon = QStandardPaths::findExecutable(QStringLiteral("dbus-daemon"));
+    if (daemon.isEmpty())
+        QSKIP("This test requires dbus-daemon.");
+
+    m_busDaemon.start(daemon, { QStringLiteral("--session"), QStringLiteral("--nofork"),
+                                QStringLiteral("--print-address") });
+    QVERIFY(m_busDaemon.waitForStarted());
+    QVERIFY(m_busDaemon.waitForReadyRead());
+    const QString address = QString::fromLocal8Bit(m_busDaemon.readLine()).trimmed();
+    QVERIFY(!address.isEmpty());
+
+    // The backend talks to neard on the system bus
+    qputenv("DBUS_SYSTEM_BUS_ADDRESS", address.toLocal8Bit());
+
+    m_neard = new FakeNeard;
+    m_neard->moveToThread(&m_neardThread);
+    connect(&m_neardThread, &QThread::finished, m_neard, &QObject::deleteLater);
+    m_neardThread.start();
+
+    bool started = false;
+    QMetaObject::invokeMethod(m_neard, "start", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, started), Q_ARG(QString, address));
+    QVERIFY(started);
+}
+
+void tst_QNearFieldManagerNeard::cleanupTestCase()
+{
+    if (m_neardThread.isRunning()) {
+        QMetaObject::invokeMethod(m_neard, "stop", Qt::BlockingQueuedConnection);
+        m_neardThread.quit();
+        m_neardThread.wait();
+    }
+
+    if (m_busDaemon.state() != QProcess::NotRunning) {
+        m_busDaemon.terminate();
+        m_busDaemon.waitForFinished();
+    }
+}
+
+void tst_QNearFieldManagerNeard::detectReadWrite()
+{
+    QNdefMessage initialMessage;
+    QNdefNfcUriRecord initialRecord;
+    initialRecord.setUri(QUrl(QStringLiteral("https://www.qt.io")));
+    initialMessage.append(initialRecord);
+    m_neard->setNdef(initialMessage.toByteArray());
+
+    QNearFieldManager manager;
+    QVERIFY(manager.isSupported(QNearFieldTarget::NdefAccess));
+    QVERIFY(!manager.isSupported(QNearFieldTarget::TagTypeSpecificAccess));
+    QVERIFY(!manager.isEnabled());
+
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QSignalSpy lostSpy(&manager, &QNearFieldManager::targetLost);
+    QSignalSpy stoppedSpy(&manager, &QNearFieldManager::targetDetectionStopped);
+
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QVERIFY(manager.isEnabled());
+    QVERIFY(m_neard->powered());
+    QTRY_VERIFY(m_neard->polling());
+    QCOMPARE(m_neard->pollLoopStarts(), 1);
+
+    QMetaObject::invokeMethod(m_neard, "addTag", Qt::QueuedConnection);
+    QTRY_COMPARE(detectedSpy.count(), 1);
+
+    QNearFieldTarget *target = detectedSpy.first().at(0).value<QNearFieldTarget *>();
+    QVERIFY(target);
+    QCOMPARE(target->type(), QNearFieldTarget::NfcTagType2);
+    QCOMPARE(target->accessMethods(), QNearFieldTarget::NdefAccess);
+    QTRY_VERIFY(target->hasNdefMessage());
+
+    QSignalSpy ndefMessageReadSpy(target, &QNearFieldTarget::ndefMessageRead);
+    QSignalSpy requestCompletedSpy(target, &QNearFieldTarget::requestCompleted);
+    QSignalSpy errorSpy(target, &QNearFieldTarget::error);
+    QSignalSpy disconnectedSpy(target, &QNearFieldTarget::disconnected);
+
+    const QNearFieldTarget::RequestId readId = target->readNdefMessages();
+    QVERIFY(readId.isValid());
+    QTRY_COMPARE(ndefMessageReadSpy.count(), 1);
+    QCOMPARE(ndefMessageReadSpy.first().at(0).value<QNdefMessage>(), initialMessage);
+    QTRY_COMPARE(requestCompletedSpy.count(), 1);
+    QCOMPARE(requestCompletedSpy.first().at(0).value<QNearFieldTarget::RequestId>(), readId);
+
+    QNdefMessage newMessage;
+    QNdefNfcUriRecord newRecord;
+    newRecord.setUri(QUrl(QStringLiteral("https://doc.qt.io")));
+    newMessage.append(newRecord);
+
+    const QNearFieldTarget::RequestId writeId = target->writeNdefMessages({ newMessage });
+    QVERIFY(writeId.isValid());
+    QTRY_COMPARE(requestCompletedSpy.count(), 2);
+    QCOMPARE(requestCompletedSpy.at(1).at(0).value<QNearFieldTarget::RequestId>(), writeId);
+    QCOMPARE(m_neard->ndef(), newMessage.toByteArray());
+    QCOMPARE(errorSpy.count(), 0);
+
+    // polling is resumed once the tag has gone
+    QMetaObject::invokeMethod(m_neard, "removeTag", Qt::QueuedConnection);
+    QTRY_COMPARE(lostSpy.count(), 1);
+    QCOMPARE(lostSpy.first().at(0).value<QNearFieldTarget *>(), target);
+    QCOMPARE(disconnectedSpy.count(), 1);
+    QVERIFY(!target->hasNdefMessage());
+    QTRY_COMPARE(m_neard->pollLoopStarts(), 2);
+
+    const QNearFieldTarget::RequestId lostReadId = target->readNdefMessages();
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.first().at(0).value<QNearFieldTarget::Error>(),
+             QNearFieldTarget::TargetOutOfRangeError);
+    QCOMPARE(errorSpy.first().at(1).value<QNearFieldTarget::RequestId>(), lostReadId);
+
+    manager.stopTargetDetection();
+    QCOMPARE(stoppedSpy.count(), 1);
+    QTRY_VERIFY(!m_neard->polling());
+}
+
+void tst_QNearFieldManagerNeard::adapterPoweredOff()
+{
+    m_neard->setPowered(true);
+
+    QNearFieldManager manager;
+    QVERIFY(manager.isEnabled());
+
+    QSignalSpy stateSpy(&manager, &QNearFieldManager::adapterStateChanged);
+    QSignalSpy stoppedSpy(&manager, &QNearFieldManager::targetDetectionStopped);
+
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QTRY_VERIFY(m_neard->polling());
+
+    QMetaObject::invokeMethod(m_neard, "powerOff", Qt::QueuedConnection);
+    QTRY_COMPARE(stateSpy.count(), 1);
+    QCOMPARE(stateSpy.first().at(0).value<QNearFieldManager::AdapterState>(),
+             QNearFieldManager::AdapterState::Offline);
+    QCOMPARE(stoppedSpy.count(), 1);
+    QVERIFY(!manager.isEnabled());
+}
+
+void tst_QNearFieldManagerNeard::tagPresentAtStart()
+{
+    m_neard->setPowered(true);
+    QMetaObject::invokeMethod(m_neard, "addTag", Qt::BlockingQueuedConnection);
+
+    QNearFieldManager manager;
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QSignalSpy lostSpy(&manager, &QNearFieldManager::targetLost);
+
+    const int pollLoopStarts = m_neard->pollLoopStarts();
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QCOMPARE(detectedSpy.count(), 1);
+
+    QNearFieldTarget *target = detectedSpy.first().at(0).value<QNearFieldTarget *>();
+    QVERIFY(target);
+    QCOMPARE(target->type(), QNearFieldTarget::NfcTagType2);
+    QVERIFY(target->hasNdefMessage());
+
+    // no polling while the tag is connected
+    QCOMPARE(m_neard->pollLoopStarts(), pollLoopStarts);
+
+    QMetaObject::invokeMethod(m_neard, "removeTag", Qt::QueuedConnection);
+    QTRY_COMPARE(lostSpy.count(), 1);
+    QTRY_COMPARE(m_neard->pollLoopStarts(), pollLoopStarts + 1);
+
+    manager.stopTargetDetection();
+    QTRY_VERIFY(!m_neard->polling());
+}
+
+void tst_QNearFieldManagerNeard::adapterHotPlug()
+{
+    m_neard->setPowered(true);
+    QMetaObject::invokeMethod(m_neard, "unplugAdapter", Qt::BlockingQueuedConnection);
+
+    QNearFieldManager manager;
+    QVERIFY(!manager.isSupported(QNearFieldTarget::NdefAccess));
+    QVERIFY(!manager.isEnabled());
+    QVERIFY(!manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+
+    QSignalSpy stateSpy(&manager, &QNearFieldManager::adapterStateChanged);
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QSignalSpy lostSpy(&manager, &QNearFieldManager::targetLost);
+    QSignalSpy stoppedSpy(&manager, &QNearFieldManager::targetDetectionStopped);
+
+    QMetaObject::invokeMethod(m_neard, "plugAdapter", Qt::QueuedConnection);
+    QTRY_COMPARE(stateSpy.count(), 1);
+    QCOMPARE(stateSpy.at(0).at(0).value<QNearFieldManager::AdapterState>(),
+             QNearFieldManager::AdapterState::Online);
+    QVERIFY(manager.isSupported(QNearFieldTarget::NdefAccess));
+    QVERIFY(manager.isEnabled());
+
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QTRY_VERIFY(m_neard->polling());
+
+    QMetaObject::invokeMethod(m_neard, "addTag", Qt::QueuedConnection);
+    QTRY_COMPARE(detectedSpy.count(), 1);
+
+    QMetaObject::invokeMethod(m_neard, "unplugAdapter", Qt::QueuedConnection);
+    QTRY_COMPARE(stateSpy.count(), 2);
+    QCOMPARE(stateSpy.at(1).at(0).value<QNearFieldManager::AdapterState>(),
+             QNearFieldManager::AdapterState::Offline);
+    QCOMPARE(lostSpy.count(), 1);
+    QCOMPARE(stoppedSpy.count(), 1);
+    QVERIFY(!manager.isSupported(QNearFieldTarget::NdefAccess));
+    QVERIFY(!manager.isEnabled());
+
+    QMetaObject::invokeMethod(m_neard, "plugAdapter", Qt::BlockingQueuedConnection);
+}
+
+void tst_QNearFieldManagerNeard::tagWhileIdle()
+{
+    m_neard->setPowered(true);
+
+    QNearFieldManager manager;
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QSignalSpy lostSpy(&manager, &QNearFieldManager::targetLost);
+
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QTRY_VERIFY(m_neard->polling());
+    manager.stopTargetDetection();
+    QTRY_VERIFY(!m_neard->polling());
+
+    // tags are not reported while detection is stopped
+    QMetaObject::invokeMethod(m_neard, "addTag", Qt::QueuedConnection);
+    QTest::qWait(100);
+    QCOMPARE(detectedSpy.count(), 0);
+
+    // but once it is started again
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QCOMPARE(detectedSpy.count(), 1);
+
+    QMetaObject::invokeMethod(m_neard, "removeTag", Qt::QueuedConnection);
+    QTRY_COMPARE(lostSpy.count(), 1);
+    manager.stopTargetDetection();
+    QTRY_VERIFY(!m_neard->polling());
+}
+
+void tst_QNearFieldManagerNeard::deletedTarget()
+{
+    m_neard->setPowered(true);
+
+    QNearFieldManager manager;
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QSignalSpy lostSpy(&manager, &QNearFieldManager::targetLost);
+
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QTRY_VERIFY(m_neard->polling());
+    const int pollLoopStarts = m_neard->pollLoopStarts();
+
+    QMetaObject::invokeMethod(m_neard, "addTag", Qt::QueuedConnection);
+    QTRY_COMPARE(detectedSpy.count(), 1);
+    delete detectedSpy.first().at(0).value<QNearFieldTarget *>();
+
+    // the tag leaving is not reported, polling is resumed nevertheless
+    QMetaObject::invokeMethod(m_neard, "removeTag", Qt::QueuedConnection);
+    QTRY_COMPARE(m_neard->pollLoopStarts(), pollLoopStarts + 1);
+    QCOMPARE(lostSpy.count(), 0);
+
+    // a target deleted while it is lost
+    connect(&manager, &QNearFieldManager::targetLost, this,
+            [](QNearFieldTarget *target) { delete target; });
+    QMetaObject::invokeMethod(m_neard, "addTag", Qt::QueuedConnection);
+    QTRY_COMPARE(detectedSpy.count(), 2);
+    QMetaObject::invokeMethod(m_neard, "removeTag", Qt::QueuedConnection);
+    QTRY_COMPARE(lostSpy.count(), 1);
+
+    manager.stopTargetDetection();
+    QTRY_VERIFY(!m_neard->polling());
+}
+
+QTEST_MAIN(tst_QNearFieldManagerNeard)
+
+#include "tst_qnearfieldmanager_neard.moc"
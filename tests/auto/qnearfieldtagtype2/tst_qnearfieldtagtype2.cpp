@@ -32,6 +32,7 @@
 #include <qnearfieldtagtype2_p.h>
 #include <QtNfc/qndefmessage.h>
 #include <QtNfc/qndefnfctextrecord.h>
+#include <QtNfc/qndefnfcurirecord.h>
 
 QT_USE_NAMESPACE
 
@@ -54,6 +55,7 @@ private slots:
     void dynamicMemoryModel();
 
     void ndefMessages();
+    void cachedNdefAccess();
 
 private:
     void waitForMatchingTarget();
@@ -344,6 +346,84 @@ void tst_QNearFieldTagType2::ndefMessages()
     }
 }
 
+void tst_QNearFieldTagType2::cachedNdefAccess()
+{
+    // "NDEF Tag.nfc" stores a URI record in a 144 byte data area
+    const QByteArray ndefTagUid = QByteArray::fromHex("44444444444444");
+
+    QList<QByteArray> seenIds;
+    forever {
+        waitForMatchingTarget();
+        if (QTest::currentTestFailed())
+            return;
+
+        QNearFieldTarget::RequestId id = target->readBlock(0);
+        QVERIFY(target->waitForRequestCompleted(id));
+
+        const QByteArray data = target->requestResponse(id).toByteArray();
+        const QByteArray uid = data.left(3) + data.mid(4, 4);
+        if (uid == ndefTagUid)
+            break;
+
+        QVERIFY2(!seenIds.contains(uid), "NDEF Tag.nfc was not activated");
+        seenIds.append(uid);
+    }
+
+    QNearFieldTagType2Memory *memory = target->memory();
+    QVERIFY(!memory->isCached());
+
+    // one READ for the capability container, one FAST_READ for the data area
+    QVERIFY(target->hasNdefMessage());
+    QVERIFY(memory->isCached());
+    QCOMPARE(memory->statistics().readCommands, 2);
+
+    // the target also reports the completion of every tag command
+    QSignalSpy ndefMessageReadSpy(target, SIGNAL(ndefMessageRead(QNdefMessage)));
+    QSignalSpy requestCompleteSpy(memory, &QNearFieldTagType2Memory::requestCompleted);
+    QSignalSpy errorSpy(memory, &QNearFieldTagType2Memory::error);
+
+    // served from the cache
+    id = target->readNdefMessages();
+    QTRY_COMPARE(requestCompleteSpy.count(), 1);
+    QCOMPARE(requestCompleteSpy.takeFirst().first().value<QNearFieldTarget::RequestId>(), id);
+    QCOMPARE(memory->statistics().lastNdefReadCommands, 0);
+    QCOMPARE(ndefMessageReadSpy.count(), 1);
+
+    const QNdefMessage storedMessage = ndefMessageReadSpy.takeFirst().first().value<QNdefMessage>();
+    QCOMPARE(storedMessage.count(), 1);
+    QVERIFY(storedMessage.first().isRecordType<QNdefNfcUriRecord>());
+    QCOMPARE(QNdefNfcUriRecord(storedMessage.first()).uri(), QUrl(QStringLiteral("https://qt.io")));
+
+    QNdefNfcUriRecord uriRecord;
+    uriRecord.setUri(QUrl(QStringLiteral("https://qt.io/nfc")));
+    QNdefMessage message;
+    message.append(uriRecord);
+
+    // the TLV grows by four bytes, only the pages it touches are written
+    id = target->writeNdefMessages({ message });
+    QTRY_COMPARE(requestCompleteSpy.count(), 1);
+    QCOMPARE(requestCompleteSpy.takeFirst().first().value<QNearFieldTarget::RequestId>(), id);
+    const int writeCommands = memory->statistics().lastNdefWriteCommands;
+    QVERIFY(writeCommands > 0);
+    QVERIFY(writeCommands <= (2 + message.toByteArray().size() + 1 + 3) / 4);
+
+    // writing the same message again does not send any command
+    id = target->writeNdefMessages({ message });
+    QTRY_COMPARE(requestCompleteSpy.count(), 1);
+    QCOMPARE(requestCompleteSpy.takeFirst().first().value<QNearFieldTarget::RequestId>(), id);
+    QCOMPARE(memory->statistics().lastNdefWriteCommands, 0);
+
+    // read back from the tag instead of the cache
+    memory->invalidate();
+    id = target->readNdefMessages();
+    QTRY_COMPARE(requestCompleteSpy.count(), 1);
+    QCOMPARE(requestCompleteSpy.takeFirst().first().value<QNearFieldTarget::RequestId>(), id);
+    QCOMPARE(memory->statistics().lastNdefReadCommands, 2);
+    QCOMPARE(ndefMessageReadSpy.count(), 1);
+    QCOMPARE(ndefMessageReadSpy.takeFirst().first().value<QNdefMessage>(), message);
+    QCOMPARE(errorSpy.count(), 0);
+}
+
 QTEST_MAIN(tst_QNearFieldTagType2)
 
 // Unset the moc namespace which is not required for the following include.
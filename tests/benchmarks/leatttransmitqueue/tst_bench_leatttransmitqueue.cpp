@@ -0,0 +1,289 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QTimer>
+
+#include <QtBluetooth/private/leatttransmitqueue_p.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+// ATT_MTU 247 minus the Write Command header
+static const int payloadSize = 244;
+static const int packetCount = 2000;
+
+/*
+    Remote end of the ATT channel which takes packets off the link at a limited
+    rate: packetsPerTick packets every millisecond, or as fast as they arrive if
+    packetsPerTick is 0. Each packet carries its sequence number, so losses and
+    reordering are detected.
+ */
+class SlowPeer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SlowPeer(int packetsPerTick) : packetsPerTick(packetsPerTick)
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+            return;
+        peerSocket = fds[0];
+        localSocket = fds[1];
+
+        // a small send buffer, like the few ACL buffers of an LE controller
+        const int bufferSize = 4096;
+        ::setsockopt(localSocket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+        if (packetsPerTick > 0) {
+            connect(&timer, &QTimer::timeout, this, &SlowPeer::readPackets);
+            timer.start(1);
+        } else {
+            notifier = new QSocketNotifier(peerSocket, QSocketNotifier::Read, this);
+            connect(notifier, &QSocketNotifier::activated, this, &SlowPeer::readPackets);
+        }
+    }
+
+    ~SlowPeer()
+    {
+        if (peerSocket >= 0)
+            ::close(peerSocket);
+        if (localSocket >= 0)
+            ::close(localSocket);
+    }
+
+    int localSocket = -1;
+    int receivedPackets = 0;
+    int outOfOrderPackets = 0;
+    quint32 nextSequence = 0;
+    // notifications of a value may skip sequence numbers, but never go back
+    bool allowGaps = false;
+
+signals:
+    void allReceived();
+
+private:
+    void readPackets()
+    {
+        char buffer[512];
+        for (int i = 0; packetsPerTick == 0 || i < packetsPerTick; ++i) {
+            const ssize_t size = ::read(peerSocket, buffer, sizeof(buffer));
+            if (size <= 0)
+                return;
+
+            quint32 sequence;
+            memcpy(&sequence, buffer + 3, sizeof(sequence));
+            if (sequence < nextSequence || (sequence > nextSequence && !allowGaps))
+                ++outOfOrderPackets;
+            nextSequence = sequence + 1;
+
+            if (++receivedPackets == packetCount)
+                emit allReceived();
+        }
+    }
+
+    int packetsPerTick;
+    int peerSocket = -1;
+    QSocketNotifier *notifier = nullptr;
+    QTimer timer;
+};
+
+static QByteArray attPacket(quint8 opCode, quint32 sequence)
+{
+    QByteArray packet(3 + payloadSize, 0);
+    packet[0] = opCode;
+    packet[1] = 0x2a;
+    memcpy(packet.data() + 3, &sequence, sizeof(sequence));
+    return packet;
+}
+
+static QByteArray writeCommand(quint32 sequence)
+{
+    return attPacket(0x52, sequence); // ATT_OP_WRITE_COMMAND
+}
+
+static QByteArray notification(quint32 sequence)
+{
+    return attPacket(0x1b, sequence); // ATT_OP_HANDLE_VAL_NOTIFICATION
+}
+
+class tst_LeAttTransmitQueueBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void throughput_data();
+    void throughput();
+    void lossWithoutQueue_data();
+    void lossWithoutQueue();
+    void notificationBurst_data();
+    void notificationBurst();
+};
+
+void tst_LeAttTransmitQueueBench::throughput_data()
+{
+    QTest::addColumn<int>("packetsPerTick");
+    QTest::addColumn<int>("writeCommandLimit");
+
+    QTest::newRow("fast peer, limit 16") << 0 << 16;
+    QTest::newRow("fast peer, limit 128") << 0 << 128;
+    QTest::newRow("slow peer, limit 16") << 20 << 16;
+    QTest::newRow("slow peer, limit 128") << 20 << 128;
+}
+
+// time to stream packetCount write commands to the peer, without losing any
+void tst_LeAttTransmitQueueBench::throughput()
+{
+    QFETCH(int, packetsPerTick);
+    QFETCH(int, writeCommandLimit);
+
+    SlowPeer peer(packetsPerTick);
+    QVERIFY(peer.localSocket >= 0);
+
+    QObject owner;
+    LeAttTransmitQueue queue;
+    queue.setSocketDescriptor(peer.localSocket);
+    queue.setWriteCommandLimit(writeCommandLimit);
+
+    quint32 sequence = 0;
+    // the producer fills the queue and continues once it is drained
+    const auto produce = [&]() {
+        while (sequence < packetCount) {
+            if (!queue.sendWriteCommand(writeCommand(sequence), &owner))
+                return;
+            ++sequence;
+        }
+    };
+    connect(&queue, &LeAttTransmitQueue::writeCommandsDrained, &queue, produce);
+
+    QSignalSpy receivedSpy(&peer, &SlowPeer::allReceived);
+    QElapsedTimer timer;
+    timer.start();
+    produce();
+    QVERIFY(receivedSpy.wait(60000));
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    QCOMPARE(peer.receivedPackets, packetCount);
+    QCOMPARE(peer.outOfOrderPackets, 0);
+    QCOMPARE(queue.pendingWriteCommands(&owner), 0);
+
+    QTest::setBenchmarkResult(qreal(elapsed), QTest::WalltimeNanoseconds);
+}
+
+void tst_LeAttTransmitQueueBench::lossWithoutQueue_data()
+{
+    QTest::addColumn<int>("packetsPerTick");
+
+    QTest::newRow("fast peer") << 0;
+    QTest::newRow("slow peer") << 20;
+}
+
+// the previous behavior: a write which would block is dropped
+void tst_LeAttTransmitQueueBench::lossWithoutQueue()
+{
+    QFETCH(int, packetsPerTick);
+
+    SlowPeer peer(packetsPerTick);
+    QVERIFY(peer.localSocket >= 0);
+
+    int lostPackets = 0;
+    for (quint32 sequence = 0; sequence < packetCount; ++sequence) {
+        const QByteArray packet = writeCommand(sequence);
+        if (::write(peer.localSocket, packet.constData(), packet.size()) < 0) {
+            QVERIFY(errno == EAGAIN || errno == EWOULDBLOCK);
+            ++lostPackets;
+        }
+        // give the peer the same chance to read as with the queue
+        if (sequence % 16 == 0)
+            QCoreApplication::processEvents();
+    }
+    QTRY_COMPARE(peer.receivedPackets, packetCount - lostPackets);
+
+    QTest::setBenchmarkResult(lostPackets, QTest::Events);
+}
+
+void tst_LeAttTransmitQueueBench::notificationBurst_data()
+{
+    QTest::addColumn<bool>("coalesce");
+
+    QTest::newRow("every update") << false;
+    QTest::newRow("latest value wins") << true;
+}
+
+// notifications the peer receives when a value is updated much faster than the link drains
+void tst_LeAttTransmitQueueBench::notificationBurst()
+{
+    QFETCH(bool, coalesce);
+
+    SlowPeer peer(20);
+    QVERIFY(peer.localSocket >= 0);
+    peer.allowGaps = true;
+
+    LeAttTransmitQueue queue;
+    queue.setSocketDescriptor(peer.localSocket);
+
+    int coalesced = 0;
+    int dropped = 0;
+    for (quint32 sequence = 0; sequence < packetCount; ++sequence) {
+        switch (queue.sendNotification(notification(sequence), 0x2a, coalesce)) {
+        case LeAttTransmitQueue::NotificationAccepted:
+            break;
+        case LeAttTransmitQueue::NotificationCoalesced:
+            ++coalesced;
+            break;
+        case LeAttTransmitQueue::NotificationDropped:
+            ++dropped;
+            break;
+        }
+        // the value changes faster than the peer takes notifications off the link
+        if (sequence % 50 == 0)
+            QCoreApplication::processEvents();
+    }
+
+    QTRY_COMPARE(queue.queuedPacketCount(), 0);
+    QTRY_COMPARE(peer.receivedPackets, packetCount - coalesced - dropped);
+    QCOMPARE(peer.outOfOrderPackets, 0);
+    if (coalesce) {
+        // the client ends up with the latest value
+        QCOMPARE(dropped, 0);
+        QCOMPARE(peer.nextSequence, quint32(packetCount));
+    }
+    qDebug() << "coalesced:" << coalesced << "dropped:" << dropped;
+
+    QTest::setBenchmarkResult(peer.receivedPackets, QTest::Events);
+}
+
+QTEST_MAIN(tst_LeAttTransmitQueueBench)
+
+#include "tst_bench_leatttransmitqueue.moc"
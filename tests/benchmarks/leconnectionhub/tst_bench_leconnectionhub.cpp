@@ -0,0 +1,226 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtBluetooth/private/bluez_data_p.h>
+#include <QtBluetooth/private/hcimanager_p.h>
+#include <QtBluetooth/private/leconnectionhub_p.h>
+
+#include <algorithm>
+
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+/*
+    Stand-in for the LE controller behind the HCI sockets of a process.
+    Like the kernel, it delivers each event to every open HCI socket.
+ */
+class FakeHciController
+{
+public:
+    ~FakeHciController()
+    {
+        for (int socket : qAsConst(controllerSockets))
+            ::close(socket);
+    }
+
+    // the socket end for an HciManager, which takes ownership
+    int openHostSocket()
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+            return -1;
+        controllerSockets.append(fds[0]);
+        return fds[1];
+    }
+
+    void sendConnectionComplete(quint16 handle, const QBluetoothAddress &peer)
+    {
+        // Spec v5.2, Vol 4, Part E, 7.7.65.1
+        QByteArray parameters(18, Qt::Uninitialized);
+        parameters[0] = 0; // status
+        qToLittleEndian<quint16>(handle, parameters.data() + 1);
+        parameters[3] = 0; // central
+        parameters[4] = 0; // public peer address
+        quint64 address = peer.toUInt64();
+        for (int i = 0; i < 6; ++i, address >>= 8)
+            parameters[5 + i] = char(address & 0xff);
+        qToLittleEndian<quint16>(0x0018, parameters.data() + 11); // interval
+        qToLittleEndian<quint16>(0, parameters.data() + 13); // latency
+        qToLittleEndian<quint16>(0x01f4, parameters.data() + 15); // supervision timeout
+        parameters[17] = 0; // clock accuracy
+        sendLeMetaEvent(0x01, parameters);
+    }
+
+    void sendDataLengthChange(quint16 handle)
+    {
+        // Spec v5.2, Vol 4, Part E, 7.7.65.7
+        QByteArray parameters(10, Qt::Uninitialized);
+        qToLittleEndian<quint16>(handle, parameters.data());
+        qToLittleEndian<quint16>(251, parameters.data() + 2);
+        qToLittleEndian<quint16>(2120, parameters.data() + 4);
+        qToLittleEndian<quint16>(251, parameters.data() + 6);
+        qToLittleEndian<quint16>(2120, parameters.data() + 8);
+        sendLeMetaEvent(0x07, parameters);
+    }
+
+private:
+    void sendLeMetaEvent(quint8 subEvent, const QByteArray &parameters)
+    {
+        QByteArray event;
+        event.append(char(HCI_EVENT_PKT));
+        event.append(char(HciManager::HciEvent::EVT_LE_META_EVENT));
+        event.append(char(1 + parameters.size()));
+        event.append(char(subEvent));
+        event.append(parameters);
+        for (int socket : qAsConst(controllerSockets)) {
+            if (::write(socket, event.constData(), event.size()) != event.size())
+                qWarning() << "Cannot send HCI event";
+        }
+    }
+
+    QList<int> controllerSockets;
+};
+
+class tst_LeConnectionHubBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cpuPerConnection_data();
+    void cpuPerConnection();
+};
+
+static qint64 processCpuTime()
+{
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return qint64(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+static QBluetoothAddress peerAddress(int index)
+{
+    return QBluetoothAddress(Q_UINT64_C(0xaabbcc000000) + index);
+}
+
+static quint16 connectionHandle(int index)
+{
+    return quint16(0x40 + index);
+}
+
+void tst_LeConnectionHubBench::cpuPerConnection_data()
+{
+    QTest::addColumn<int>("connections");
+    QTest::addColumn<bool>("shared");
+
+    for (int connections : { 1, 8, 32, 64 }) {
+        QTest::addRow("%d links, manager per link", connections) << connections << false;
+        QTest::addRow("%d links, shared hub", connections) << connections << true;
+    }
+}
+
+/*
+    Every connection gets one event per round, as the link layer reports
+    e.g. data length changes or connection updates. The result is the CPU
+    time of the process, in nanoseconds per connection and event, spent on
+    sending, reading and dispatching the events. With one HciManager per
+    link, as controllers used to open them, each event is read and parsed
+    once per link.
+ */
+void tst_LeConnectionHubBench::cpuPerConnection()
+{
+    QFETCH(int, connections);
+    QFETCH(bool, shared);
+    const int rounds = 200;
+
+    FakeHciController controller;
+    int delivered = 0;
+    int parsed = 0;
+
+    QList<HciManager *> managers;
+    QSharedPointer<LeConnectionHub> hub;
+    QList<LeHciLink *> links;
+    if (shared) {
+        auto manager = new HciManager(controller.openHostSocket(), 0);
+        managers.append(manager);
+        connect(manager, &HciManager::dataLengthChange, this, [&parsed]() { ++parsed; });
+        hub.reset(new LeConnectionHub(manager));
+        for (int i = 0; i < connections; ++i) {
+            auto link = new LeHciLink(hub);
+            link->setRemoteDevice(peerAddress(i));
+            connect(link, &LeHciLink::dataLengthChange, this, [&delivered]() { ++delivered; });
+            links.append(link);
+            controller.sendConnectionComplete(connectionHandle(i), peerAddress(i));
+        }
+        QTRY_VERIFY(std::all_of(links.cbegin(), links.cend(),
+                                [](LeHciLink *link) { return link->connectionHandle() != 0; }));
+    } else {
+        for (int i = 0; i < connections; ++i) {
+            auto manager = new HciManager(controller.openHostSocket(), 0);
+            managers.append(manager);
+            const quint16 handle = connectionHandle(i);
+            connect(manager, &HciManager::dataLengthChange, this,
+                    [&delivered, &parsed, handle](quint16 eventHandle) {
+                ++parsed;
+                if (eventHandle == handle)
+                    ++delivered;
+            });
+        }
+    }
+
+    const int parsesPerEvent = shared ? 1 : connections;
+    const qint64 start = processCpuTime();
+    for (int round = 1; round <= rounds; ++round) {
+        for (int i = 0; i < connections; ++i)
+            controller.sendDataLengthChange(connectionHandle(i));
+        while (delivered < round * connections
+               || parsed < round * connections * parsesPerEvent) {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+    }
+    const qint64 cpuTime = processCpuTime() - start;
+
+    QCOMPARE(delivered, rounds * connections);
+    QCOMPARE(parsed, rounds * connections * parsesPerEvent);
+    qDebug() << "HCI events parsed:" << parsed;
+
+    qDeleteAll(links);
+    hub.reset();
+    qDeleteAll(managers);
+
+    QTest::setBenchmarkResult(qreal(cpuTime) / (rounds * connections),
+                              QTest::WalltimeNanoseconds);
+}
+
+QTEST_MAIN(tst_LeConnectionHubBench)
+
+#include "tst_bench_leconnectionhub.moc"
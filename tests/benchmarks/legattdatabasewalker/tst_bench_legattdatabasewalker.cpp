@@ -0,0 +1,485 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include <QtBluetooth/qlowenergycharacteristic.h>
+#include <QtBluetooth/private/legattdatabasewalker_p.h>
+
+QT_USE_NAMESPACE
+
+/*
+    Scripted ATT server which answers the requests of LeGattDatabaseWalker
+    from an in-memory attribute table. Responses are filled up to the MTU in
+    the same way as a conformant peripheral would do.
+ */
+class FakePeripheral
+{
+public:
+    struct Attribute {
+        QLowEnergyHandle handle;
+        QBluetoothUuid type;
+        QByteArray value;
+    };
+
+    QList<Attribute> attributes;
+    quint16 mtu = 23;
+    bool readMultipleVariableSupported = true;
+
+    QByteArray respond(const QByteArray &request) const;
+
+private:
+    QByteArray readByType(const QByteArray &request) const;
+    QByteArray findInformation(const QByteArray &request) const;
+    QByteArray read(const QByteArray &request) const;
+    QByteArray readBlob(const QByteArray &request) const;
+    QByteArray readMultipleVariable(const QByteArray &request) const;
+    const Attribute *attribute(QLowEnergyHandle handle) const;
+};
+
+static quint16 le16(const QByteArray &data, int offset)
+{
+    return quint16(quint8(data.at(offset)) | (quint8(data.at(offset + 1)) << 8));
+}
+
+static void appendLe16(QByteArray &data, quint16 value)
+{
+    data.append(char(value & 0xff));
+    data.append(char(value >> 8));
+}
+
+static QByteArray uuidBytes(const QBluetoothUuid &uuid)
+{
+    QByteArray bytes;
+    bool ok = false;
+    const quint16 shortUuid = uuid.toUInt16(&ok);
+    if (ok) {
+        appendLe16(bytes, shortUuid);
+    } else {
+        const QByteArray bigEndian = uuid.toRfc4122();
+        for (int i = bigEndian.size() - 1; i >= 0; --i)
+            bytes.append(bigEndian.at(i));
+    }
+    return bytes;
+}
+
+static QByteArray errorResponse(const QByteArray &request, QLowEnergyHandle handle, quint8 code)
+{
+    QByteArray response;
+    response.append(char(0x01));
+    response.append(request.at(0));
+    appendLe16(response, handle);
+    response.append(char(code));
+    return response;
+}
+
+QByteArray FakePeripheral::respond(const QByteArray &request) const
+{
+    switch (quint8(request.at(0))) {
+    case 0x04:
+        return findInformation(request);
+    case 0x08:
+        return readByType(request);
+    case 0x0A:
+        return read(request);
+    case 0x0C:
+        return readBlob(request);
+    case 0x20:
+        return readMultipleVariable(request);
+    default:
+        return errorResponse(request, 0, 0x06); // request not supported
+    }
+}
+
+QByteArray FakePeripheral::readByType(const QByteArray &request) const
+{
+    const QLowEnergyHandle start = le16(request, 1);
+    const QLowEnergyHandle end = le16(request, 3);
+    const QBluetoothUuid type(le16(request, 5));
+
+    QByteArray response;
+    int elementLength = 0;
+    for (const Attribute &attr : attributes) {
+        if (attr.handle < start || attr.handle > end || attr.type != type)
+            continue;
+
+        const QByteArray value = attr.value.left(qMin(mtu - 4, 253));
+        if (elementLength == 0) {
+            elementLength = 2 + value.size();
+            response.append(char(0x09));
+            response.append(char(elementLength));
+        } else if (elementLength != 2 + value.size()
+                   || response.size() + elementLength > mtu) {
+            break;
+        }
+        appendLe16(response, attr.handle);
+        response.append(value);
+    }
+
+    if (response.isEmpty())
+        return errorResponse(request, start, 0x0A); // attribute not found
+    return response;
+}
+
+QByteArray FakePeripheral::findInformation(const QByteArray &request) const
+{
+    const QLowEnergyHandle start = le16(request, 1);
+    const QLowEnergyHandle end = le16(request, 3);
+
+    QByteArray response;
+    int uuidSize = 0;
+    for (const Attribute &attr : attributes) {
+        if (attr.handle < start || attr.handle > end)
+            continue;
+
+        const QByteArray uuid = uuidBytes(attr.type);
+        if (uuidSize == 0) {
+            uuidSize = uuid.size();
+            response.append(char(0x05));
+            response.append(char(uuidSize == 2 ? 0x01 : 0x02));
+        } else if (uuidSize != uuid.size() || response.size() + 2 + uuidSize > mtu) {
+            break;
+        }
+        appendLe16(response, attr.handle);
+        response.append(uuid);
+    }
+
+    if (response.isEmpty())
+        return errorResponse(request, start, 0x0A); // attribute not found
+    return response;
+}
+
+QByteArray FakePeripheral::read(const QByteArray &request) const
+{
+    const QLowEnergyHandle handle = le16(request, 1);
+    const Attribute *attr = attribute(handle);
+    if (!attr)
+        return errorResponse(request, handle, 0x01); // invalid handle
+
+    return char(0x0B) + attr->value.left(mtu - 1);
+}
+
+QByteArray FakePeripheral::readBlob(const QByteArray &request) const
+{
+    const QLowEnergyHandle handle = le16(request, 1);
+    const quint16 offset = le16(request, 3);
+    const Attribute *attr = attribute(handle);
+    if (!attr)
+        return errorResponse(request, handle, 0x01); // invalid handle
+    if (offset > attr->value.size())
+        return errorResponse(request, handle, 0x07); // invalid offset
+
+    return char(0x0D) + attr->value.mid(offset, mtu - 1);
+}
+
+QByteArray FakePeripheral::readMultipleVariable(const QByteArray &request) const
+{
+    if (!readMultipleVariableSupported)
+        return errorResponse(request, 0, 0x06); // request not supported
+
+    QByteArray response(1, char(0x21));
+    for (int i = 1; i + 1 < request.size(); i += 2) {
+        const Attribute *attr = attribute(le16(request, i));
+        if (!attr)
+            return errorResponse(request, le16(request, i), 0x01); // invalid handle
+        appendLe16(response, quint16(attr->value.size()));
+        response.append(attr->value);
+    }
+
+    // the tuple list is cut off at the MTU, possibly within a length field
+    return response.left(mtu);
+}
+
+const FakePeripheral::Attribute *FakePeripheral::attribute(QLowEnergyHandle handle) const
+{
+    for (const Attribute &attr : attributes) {
+        if (attr.handle == handle)
+            return &attr;
+    }
+    return nullptr;
+}
+
+/*
+    Creates a device with \a serviceCount services, each of them with four
+    characteristics. The characteristics mix 16 and 128 bit uuids, some have
+    descriptors and every fifth service has a value longer than any MTU.
+    The last service includes the first one.
+
+    The expected discovery result is returned via \a expected.
+ */
+static FakePeripheral createPeripheral(int serviceCount,
+                                       QList<LeGattDatabaseWalker::Service> *expected)
+{
+    FakePeripheral peripheral;
+    QLowEnergyHandle handle = 0;
+
+    for (int s = 0; s < serviceCount; ++s) {
+        LeGattDatabaseWalker::Service service;
+        service.startHandle = ++handle;
+        service.uuid = (s % 2)
+                ? QBluetoothUuid(QStringLiteral("{6e400001-b5a3-f393-e0a9-e50e24dc%1}")
+                                 .arg(s, 4, 16, QLatin1Char('0')))
+                : QBluetoothUuid(quint16(0x1800 + s));
+        peripheral.attributes.append({ service.startHandle,
+                                       QBluetoothUuid(quint16(0x2800)), uuidBytes(service.uuid) });
+
+        if (s > 0 && s == serviceCount - 1) {
+            const LeGattDatabaseWalker::Service &included = expected->constFirst();
+            QByteArray declaration;
+            appendLe16(declaration, included.startHandle);
+            appendLe16(declaration, included.endHandle);
+            declaration.append(uuidBytes(included.uuid));
+            peripheral.attributes.append({ ++handle, QBluetoothUuid(quint16(0x2802)),
+                                           declaration });
+            service.includedServices.append(included.uuid);
+        }
+
+        for (int c = 0; c < 4; ++c) {
+            const QLowEnergyHandle charHandle = ++handle;
+            QLowEnergyServicePrivate::CharData charData;
+            charData.valueHandle = ++handle;
+            charData.uuid = ((s + c) % 3 == 0)
+                    ? QBluetoothUuid(QStringLiteral("{6e40%1-b5a3-f393-e0a9-e50e24dcca9e}")
+                                     .arg(s * 4 + c, 4, 16, QLatin1Char('0')))
+                    : QBluetoothUuid(quint16(0x2a00 + c));
+            charData.properties = (c == 3) ? QLowEnergyCharacteristic::Write
+                                           : QLowEnergyCharacteristic::Read;
+            if (c == 1)
+                charData.properties |= QLowEnergyCharacteristic::Notify;
+
+            const QByteArray value = (c == 2 && s % 5 == 0)
+                    ? QByteArray(600, char('a' + s % 26))
+                    : QByteArray(4 + 3 * c, char(s * 4 + c));
+
+            QByteArray declaration;
+            declaration.append(char(charData.properties));
+            appendLe16(declaration, charData.valueHandle);
+            declaration.append(uuidBytes(charData.uuid));
+            peripheral.attributes.append({ charHandle, QBluetoothUuid(quint16(0x2803)),
+                                           declaration });
+            peripheral.attributes.append({ charData.valueHandle, charData.uuid, value });
+            if (charData.properties & QLowEnergyCharacteristic::Read)
+                charData.value = value;
+
+            QList<QPair<QBluetoothUuid, QByteArray>> descriptors;
+            if (c == 1)
+                descriptors.append({ QBluetoothUuid(quint16(0x2902)), QByteArray(2, '\0') });
+            if (c == 2) {
+                descriptors.append({ QBluetoothUuid(quint16(0x2901)),
+                                     QByteArray("Characteristic ") + QByteArray::number(c) });
+            }
+            for (const auto &descriptor : qAsConst(descriptors)) {
+                QLowEnergyServicePrivate::DescData descData;
+                descData.uuid = descriptor.first;
+                descData.value = descriptor.second;
+                peripheral.attributes.append({ ++handle, descriptor.first, descriptor.second });
+                charData.descriptorList.insert(handle, descData);
+            }
+
+            service.characteristics.insert(charHandle, charData);
+        }
+
+        service.endHandle = handle;
+        expected->append(service);
+    }
+
+    return peripheral;
+}
+
+static QList<LeGattDatabaseWalker::Service> serviceRanges(
+        const QList<LeGattDatabaseWalker::Service> &services)
+{
+    QList<LeGattDatabaseWalker::Service> ranges;
+    for (const LeGattDatabaseWalker::Service &service : services) {
+        LeGattDatabaseWalker::Service range;
+        range.startHandle = service.startHandle;
+        range.endHandle = service.endHandle;
+        range.uuid = service.uuid;
+        ranges.append(range);
+    }
+    return ranges;
+}
+
+static int walk(LeGattDatabaseWalker &walker, const FakePeripheral &peripheral)
+{
+    int roundTrips = 0;
+    for (QByteArray request = walker.nextRequest(); !request.isEmpty();
+         request = walker.nextRequest()) {
+        walker.processResponse(peripheral.respond(request));
+        ++roundTrips;
+    }
+    return roundTrips;
+}
+
+class tst_LeGattDatabaseWalkerBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void discover_data();
+    void discover();
+    void roundTrips_data();
+    void roundTrips();
+    void walkTime_data();
+    void walkTime();
+};
+
+static void addDeviceRows()
+{
+    QTest::addColumn<int>("serviceCount");
+    QTest::addColumn<int>("mtu");
+    QTest::addColumn<bool>("readMultiple");
+    QTest::addColumn<QLowEnergyService::DiscoveryMode>("mode");
+
+    const auto full = QLowEnergyService::FullDiscovery;
+    QTest::newRow("20 services, mtu 23") << 20 << 23 << true << full;
+    QTest::newRow("20 services, mtu 23, single reads") << 20 << 23 << false << full;
+    QTest::newRow("20 services, mtu 247") << 20 << 247 << true << full;
+    QTest::newRow("20 services, mtu 517") << 20 << 517 << true << full;
+    QTest::newRow("20 services, mtu 23, lazy values")
+            << 20 << 23 << true << QLowEnergyService::LazyValueDiscovery;
+    QTest::newRow("20 services, mtu 517, lazy values")
+            << 20 << 517 << true << QLowEnergyService::LazyValueDiscovery;
+    QTest::newRow("20 services, mtu 517, skip values")
+            << 20 << 517 << true << QLowEnergyService::SkipValueDiscovery;
+}
+
+void tst_LeGattDatabaseWalkerBench::discover_data()
+{
+    addDeviceRows();
+}
+
+void tst_LeGattDatabaseWalkerBench::discover()
+{
+    QFETCH(int, serviceCount);
+    QFETCH(int, mtu);
+    QFETCH(bool, readMultiple);
+    QFETCH(QLowEnergyService::DiscoveryMode, mode);
+
+    QList<LeGattDatabaseWalker::Service> expected;
+    FakePeripheral peripheral = createPeripheral(serviceCount, &expected);
+    peripheral.mtu = mtu;
+    peripheral.readMultipleVariableSupported = readMultiple;
+
+    LeGattDatabaseWalker walker(serviceRanges(expected), mtu, mode);
+    walk(walker, peripheral);
+    QVERIFY(walker.isFinished());
+
+    const QBluetoothUuid cccdUuid(
+                QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
+    const QBluetoothUuid userDescriptionUuid(
+                QBluetoothUuid::DescriptorType::CharacteristicUserDescription);
+
+    const QList<LeGattDatabaseWalker::Service> &services = walker.services();
+    QCOMPARE(services.size(), expected.size());
+    for (int i = 0; i < services.size(); ++i) {
+        const LeGattDatabaseWalker::Service &service = services.at(i);
+        const LeGattDatabaseWalker::Service &expectedService = expected.at(i);
+        QCOMPARE(service.uuid, expectedService.uuid);
+        QCOMPARE(service.includedServices, expectedService.includedServices);
+        QCOMPARE(service.characteristics.size(), expectedService.characteristics.size());
+
+        for (auto it = expectedService.characteristics.cbegin();
+             it != expectedService.characteristics.cend(); ++it) {
+            QVERIFY(service.characteristics.contains(it.key()));
+            const QLowEnergyServicePrivate::CharData &charData = service.characteristics[it.key()];
+            QCOMPARE(charData.uuid, it->uuid);
+            QCOMPARE(charData.valueHandle, it->valueHandle);
+            QCOMPARE(int(charData.properties), int(it->properties));
+            // lazy discovery defers all values without a read policy
+            const bool valueRead = (mode == QLowEnergyService::FullDiscovery);
+            QCOMPARE(charData.value, valueRead ? it->value : QByteArray());
+            QCOMPARE(charData.descriptorList.size(), it->descriptorList.size());
+
+            for (auto descIt = it->descriptorList.cbegin();
+                 descIt != it->descriptorList.cend(); ++descIt) {
+                QVERIFY(charData.descriptorList.contains(descIt.key()));
+                const QLowEnergyServicePrivate::DescData &descData =
+                        charData.descriptorList[descIt.key()];
+                QCOMPARE(descData.uuid, descIt->uuid);
+                const bool descriptorRead = (mode == QLowEnergyService::FullDiscovery)
+                        || (mode == QLowEnergyService::LazyValueDiscovery
+                            && (descIt->uuid == cccdUuid || descIt->uuid == userDescriptionUuid));
+                QCOMPARE(descData.value, descriptorRead ? descIt->value : QByteArray());
+            }
+        }
+    }
+}
+
+void tst_LeGattDatabaseWalkerBench::roundTrips_data()
+{
+    addDeviceRows();
+}
+
+void tst_LeGattDatabaseWalkerBench::roundTrips()
+{
+    QFETCH(int, serviceCount);
+    QFETCH(int, mtu);
+    QFETCH(bool, readMultiple);
+    QFETCH(QLowEnergyService::DiscoveryMode, mode);
+
+    QList<LeGattDatabaseWalker::Service> expected;
+    FakePeripheral peripheral = createPeripheral(serviceCount, &expected);
+    peripheral.mtu = mtu;
+    peripheral.readMultipleVariableSupported = readMultiple;
+
+    LeGattDatabaseWalker walker(serviceRanges(expected), mtu, mode);
+    const int count = walk(walker, peripheral);
+    QCOMPARE(count, walker.requestCount());
+
+    QTest::setBenchmarkResult(count, QTest::Events);
+}
+
+void tst_LeGattDatabaseWalkerBench::walkTime_data()
+{
+    addDeviceRows();
+}
+
+void tst_LeGattDatabaseWalkerBench::walkTime()
+{
+    QFETCH(int, serviceCount);
+    QFETCH(int, mtu);
+    QFETCH(bool, readMultiple);
+    QFETCH(QLowEnergyService::DiscoveryMode, mode);
+
+    QList<LeGattDatabaseWalker::Service> expected;
+    FakePeripheral peripheral = createPeripheral(serviceCount, &expected);
+    peripheral.mtu = mtu;
+    peripheral.readMultipleVariableSupported = readMultiple;
+    const QList<LeGattDatabaseWalker::Service> ranges = serviceRanges(expected);
+
+    QBENCHMARK {
+        LeGattDatabaseWalker walker(ranges, mtu, mode);
+        walk(walker, peripheral);
+    }
+}
+
+QTEST_MAIN(tst_LeGattDatabaseWalkerBench)
+
+#include "tst_bench_legattdatabasewalker.moc"
@@ -0,0 +1,230 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QTimer>
+
+#include <QtBluetooth/private/lepreparedwrite_p.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+/*
+    Scripted ATT server on the far end of a socket pair. It queues Prepare
+    Write Requests and echoes them, after responseDelay milliseconds if set,
+    and applies the queue on an Execute Write Request.
+ */
+class FakeServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FakeServer(int responseDelay) : responseDelay(responseDelay)
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+            return;
+        serverSocket = fds[0];
+        clientSocket = fds[1];
+        notifier = new QSocketNotifier(serverSocket, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &FakeServer::readRequest);
+    }
+
+    ~FakeServer()
+    {
+        if (serverSocket >= 0)
+            ::close(serverSocket);
+        if (clientSocket >= 0)
+            ::close(clientSocket);
+    }
+
+    int clientSocket = -1;
+    QByteArray value;
+    int requests = 0;
+
+private:
+    void readRequest()
+    {
+        char buffer[600];
+        const ssize_t size = ::read(serverSocket, buffer, sizeof(buffer));
+        if (size <= 0)
+            return;
+        ++requests;
+        const QByteArray request(buffer, size);
+        QByteArray response;
+        if (request.at(0) == 0x16) { // ATT_OP_PREPARE_WRITE_REQUEST
+            prepared.append(request.mid(LePreparedWrite::PrepareWriteHeaderSize));
+            response = request;
+            response[0] = 0x17;
+        } else if (request.at(0) == 0x18) { // ATT_OP_EXECUTE_WRITE_REQUEST
+            if (request.at(1))
+                value = prepared;
+            prepared.clear();
+            response = QByteArray(1, 0x19);
+        }
+        if (responseDelay > 0)
+            QTimer::singleShot(responseDelay, this, [this, response]() { respond(response); });
+        else
+            respond(response);
+    }
+
+    void respond(const QByteArray &response)
+    {
+        QVERIFY(::write(serverSocket, response.constData(), response.size()) == response.size());
+    }
+
+    QByteArray prepared;
+    QSocketNotifier *notifier = nullptr;
+    int serverSocket = -1;
+    int responseDelay;
+};
+
+class tst_LeLongWriteBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void slicing_data();
+    void slicing();
+    void latency_data();
+    void latency();
+};
+
+static void addRows()
+{
+    QTest::addColumn<int>("valueSize");
+    QTest::addColumn<int>("mtu");
+
+    QTest::newRow("512 bytes, MTU 23") << 512 << 23;
+    QTest::newRow("512 bytes, MTU 247") << 512 << 247;
+    QTest::newRow("4 KB, MTU 23") << 4096 << 23;
+    QTest::newRow("4 KB, MTU 247") << 4096 << 247;
+}
+
+void tst_LeLongWriteBench::slicing_data()
+{
+    addRows();
+}
+
+// cost of preparing all requests of a long write
+void tst_LeLongWriteBench::slicing()
+{
+    QFETCH(int, valueSize);
+    QFETCH(int, mtu);
+
+    const QByteArray value(valueSize, 'x');
+    QBENCHMARK {
+        LePreparedWrite write(mtu);
+        write.addValue(0x10, 0x11, value);
+        while (!write.atEnd())
+            write.nextPacket();
+    }
+}
+
+void tst_LeLongWriteBench::latency_data()
+{
+    QTest::addColumn<int>("valueSize");
+    QTest::addColumn<int>("mtu");
+    QTest::addColumn<int>("responseDelay");
+
+    QTest::newRow("512 bytes, MTU 23") << 512 << 23 << 0;
+    QTest::newRow("4 KB, MTU 23") << 4096 << 23 << 0;
+    QTest::newRow("4 KB, MTU 247") << 4096 << 247 << 0;
+
+    QTest::newRow("512 bytes, MTU 23, 1 ms") << 512 << 23 << 1;
+    QTest::newRow("4 KB, MTU 23, 1 ms") << 4096 << 23 << 1;
+    QTest::newRow("4 KB, MTU 247, 1 ms") << 4096 << 247 << 1;
+}
+
+// time from the first Prepare Write Request to the Execute Write Response
+void tst_LeLongWriteBench::latency()
+{
+    QFETCH(int, valueSize);
+    QFETCH(int, mtu);
+    QFETCH(int, responseDelay);
+
+    FakeServer server(responseDelay);
+    QVERIFY(server.clientSocket >= 0);
+
+    QByteArray value(valueSize, Qt::Uninitialized);
+    for (int i = 0; i < valueSize; ++i)
+        value[i] = char(i);
+
+    LePreparedWrite write(mtu);
+    write.addValue(0x10, 0x11, value);
+    QByteArray request;
+    QEventLoop loop;
+    bool done = false;
+    bool mismatch = false;
+    const auto send = [&](const QByteArray &packet) {
+        request = packet;
+        QCOMPARE(::write(server.clientSocket, packet.constData(), packet.size()),
+                 ssize_t(packet.size()));
+    };
+    QSocketNotifier notifier(server.clientSocket, QSocketNotifier::Read);
+    connect(&notifier, &QSocketNotifier::activated, &notifier, [&]() {
+        char buffer[600];
+        const ssize_t size = ::read(server.clientSocket, buffer, sizeof(buffer));
+        if (size <= 0)
+            return;
+        const QByteArray response(buffer, size);
+        if (response.at(0) == 0x19) {
+            done = true;
+            loop.quit();
+        } else if (!LePreparedWrite::isEcho(request, response)) {
+            mismatch = true;
+            send(LePreparedWrite::executePacket(false));
+        } else if (!write.atEnd()) {
+            send(write.nextPacket());
+        } else {
+            send(LePreparedWrite::executePacket(true));
+        }
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    send(write.nextPacket());
+    QTimer::singleShot(60000, &loop, &QEventLoop::quit);
+    loop.exec();
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    QVERIFY(done);
+    QVERIFY(!mismatch);
+    QCOMPARE(server.value, value);
+    QCOMPARE(server.requests, write.packetCount() + 1);
+    qDebug() << "round trips:" << server.requests;
+
+    QTest::setBenchmarkResult(qreal(elapsed), QTest::WalltimeNanoseconds);
+}
+
+QTEST_MAIN(tst_LeLongWriteBench)
+
+#include "tst_bench_lelongwrite.moc"
@@ -0,0 +1,274 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QSocketNotifier>
+
+#include <QtBluetooth/private/bluez_data_p.h>
+#include <QtBluetooth/private/hcimanager_p.h>
+#include <QtBluetooth/private/qleadvertiser_p.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+/*
+    Stand-in for an LE controller behind the HCI socket. It answers each
+    command with the recorded return parameters of a controller, one
+    transport round trip after the command arrived. Up to commandCredits
+    commands are accepted at a time, as announced in Num_HCI_Command_Packets.
+ */
+class RecordedHciController : public QObject
+{
+    Q_OBJECT
+public:
+    RecordedHciController(bool extendedAdvertising, int commandCredits)
+        : extendedAdvertising(extendedAdvertising), commandCredits(commandCredits)
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+            return;
+        controllerSocket = fds[0];
+        hostSocket = fds[1];
+        notifier = new QSocketNotifier(controllerSocket, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &RecordedHciController::readCommand);
+    }
+
+    ~RecordedHciController()
+    {
+        if (controllerSocket >= 0)
+            ::close(controllerSocket);
+    }
+
+    // the socket end for the HciManager, which takes ownership
+    int takeHostSocket()
+    {
+        const int socket = hostSocket;
+        hostSocket = -1;
+        return socket;
+    }
+
+    int commandCount = 0;
+
+signals:
+    void advertisingEnabled();
+    void advertisingDisabled();
+
+private slots:
+    void readCommand()
+    {
+        char buffer[HCI_MAX_EVENT_SIZE + 4];
+        const int size = ::read(controllerSocket, buffer, sizeof buffer);
+        if (size < 4 || buffer[0] != HCI_COMMAND_PKT)
+            return;
+
+        ++commandCount;
+        ++outstandingCommands;
+        if (outstandingCommands > commandCredits)
+            qWarning() << "The host exceeded the command credits";
+
+        const quint16 opCode = qFromLittleEndian<quint16>(buffer + 1);
+        const auto ocf = QBluezConst::OpCodeCommandField(ocfFromOpCode(opCode));
+        const bool enableCommand = ocf == QBluezConst::OcfLeSetAdvEnable
+                || ocf == QBluezConst::OcfLeSetExtAdvEnable;
+        const bool enable = enableCommand && size > 4 && buffer[4] == 1;
+        const QByteArray returnParameters = recordedReturnParameters(ocf);
+
+        QTimer::singleShot(roundTripTime, Qt::PreciseTimer, this,
+                           [this, opCode, returnParameters, enableCommand, enable]() {
+            completeCommand(opCode, returnParameters);
+            if (enable)
+                emit advertisingEnabled();
+            else if (enableCommand)
+                emit advertisingDisabled();
+        });
+    }
+
+private:
+    QByteArray recordedReturnParameters(QBluezConst::OpCodeCommandField ocf) const
+    {
+        switch (ocf) {
+        case QBluezConst::OcfLeReadLocalSupportedFeatures:
+            return QByteArray::fromHex(extendedAdvertising ? "ff59000000000000"
+                                                           : "3f00000000000000");
+        case QBluezConst::OcfLeReadMaxAdvDataLength:
+            return QByteArray::fromHex("7206");
+        case QBluezConst::OcfLeReadTxPowerLevel:
+            return QByteArray::fromHex("f4");
+        case QBluezConst::OcfLeSetExtAdvParams:
+            return QByteArray::fromHex("07");
+        default:
+            return QByteArray();
+        }
+    }
+
+    void completeCommand(quint16 opCode, const QByteArray &returnParameters)
+    {
+        --outstandingCommands;
+        QByteArray event;
+        event.append(char(HCI_EVENT_PKT));
+        event.append(char(HciManager::HciEvent::EVT_CMD_COMPLETE));
+        event.append(char(4 + returnParameters.size()));
+        event.append(char(commandCredits - outstandingCommands)); // number of HCI command packets
+        event.append(char(opCode & 0xff));
+        event.append(char(opCode >> 8));
+        event.append(char(0)); // status
+        event.append(returnParameters);
+        if (::write(controllerSocket, event.constData(), event.size()) != event.size())
+            qWarning() << "Cannot send HCI event";
+    }
+
+    // milliseconds between receiving a command and its completion arriving at the host
+    static const int roundTripTime = 2;
+
+    bool extendedAdvertising = false;
+    int commandCredits = 1;
+    int outstandingCommands = 0;
+    int controllerSocket = -1;
+    int hostSocket = -1;
+    QSocketNotifier *notifier = nullptr;
+};
+
+class tst_QLeAdvertiserBluezBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void commandCount_data();
+    void commandCount();
+    void startLatency_data();
+    void startLatency();
+
+private:
+    void addStartRows();
+};
+
+static QLowEnergyAdvertisingParameters advertisingParameters()
+{
+    QLowEnergyAdvertisingParameters parameters;
+    parameters.setMode(QLowEnergyAdvertisingParameters::AdvNonConnInd);
+    return parameters;
+}
+
+static QLowEnergyAdvertisingData advertisingData()
+{
+    QLowEnergyAdvertisingData data;
+    data.setDiscoverability(QLowEnergyAdvertisingData::DiscoverabilityGeneral);
+    data.setLocalName(QStringLiteral("Benchmark"));
+    data.setServices({ QBluetoothUuid::ServiceClassUuid::HeartRate });
+    return data;
+}
+
+void tst_QLeAdvertiserBluezBench::addStartRows()
+{
+    QTest::addColumn<bool>("extended");
+    QTest::addColumn<int>("commandCredits");
+    QTest::addColumn<bool>("restart");
+    QTest::addColumn<int>("expectedCommands");
+
+    QTest::newRow("legacy, 1 credit") << false << 1 << false << 5;
+    QTest::newRow("legacy, 4 credits") << false << 4 << false << 5;
+    QTest::newRow("legacy, restart") << false << 1 << true << 2;
+    QTest::newRow("extended, 1 credit") << true << 1 << false << 6;
+    QTest::newRow("extended, 4 credits") << true << 4 << false << 6;
+    QTest::newRow("extended, restart") << true << 1 << true << 2;
+}
+
+#define START_ADVERTISER(controller, manager, advertiser, enabledSpy, restart) \
+    HciManager manager(controller.takeHostSocket(), 0); \
+    QLeAdvertiserBluez advertiser(advertisingParameters(), advertisingData(), \
+                                  QLowEnergyAdvertisingData(), manager); \
+    QSignalSpy enabledSpy(&controller, &RecordedHciController::advertisingEnabled); \
+    if (restart) { \
+        QSignalSpy disabledSpy(&controller, &RecordedHciController::advertisingDisabled); \
+        advertiser.startAdvertising(); \
+        QVERIFY(enabledSpy.wait()); \
+        disabledSpy.clear(); \
+        advertiser.stopAdvertising(); \
+        QVERIFY(disabledSpy.wait()); \
+        controller.commandCount = 0; \
+        enabledSpy.clear(); \
+    }
+
+void tst_QLeAdvertiserBluezBench::commandCount_data()
+{
+    addStartRows();
+}
+
+void tst_QLeAdvertiserBluezBench::commandCount()
+{
+    QFETCH(bool, extended);
+    QFETCH(int, commandCredits);
+    QFETCH(bool, restart);
+    QFETCH(int, expectedCommands);
+
+    RecordedHciController controller(extended, commandCredits);
+    START_ADVERTISER(controller, manager, advertiser, enabledSpy, restart);
+
+    advertiser.startAdvertising();
+    QVERIFY(enabledSpy.wait());
+    QCOMPARE(controller.commandCount, expectedCommands);
+
+    QTest::setBenchmarkResult(controller.commandCount, QTest::Events);
+}
+
+void tst_QLeAdvertiserBluezBench::startLatency_data()
+{
+    addStartRows();
+}
+
+// time from startAdvertising() until the controller enabled advertising
+void tst_QLeAdvertiserBluezBench::startLatency()
+{
+    QFETCH(bool, extended);
+    QFETCH(int, commandCredits);
+    QFETCH(bool, restart);
+
+    const int iterations = 20;
+    qint64 totalTime = 0;
+    for (int i = 0; i < iterations; ++i) {
+        RecordedHciController controller(extended, commandCredits);
+        START_ADVERTISER(controller, manager, advertiser, enabledSpy, restart);
+
+        QElapsedTimer timer;
+        timer.start();
+        advertiser.startAdvertising();
+        QVERIFY(enabledSpy.wait());
+        totalTime += timer.nsecsElapsed();
+    }
+
+    QTest::setBenchmarkResult(qreal(totalTime) / iterations, QTest::WalltimeNanoseconds);
+}
+
+QTEST_MAIN(tst_QLeAdvertiserBluezBench)
+
+#include "tst_bench_qleadvertiser_bluez.moc"
@@ -0,0 +1,992 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QSocketNotifier>
+
+#include <QtBluetooth/QBluetoothDeviceInfo>
+#include <QtBluetooth/QLowEnergyCharacteristicData>
+#include <QtBluetooth/QLowEnergyController>
+#include <QtBluetooth/QLowEnergyDescriptorData>
+#include <QtBluetooth/QLowEnergyServiceData>
+#include <QtBluetooth/private/qlowenergycontroller_bluez_p.h>
+
+#include <algorithm>
+#include <functional>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+#if defined(__GLIBC__)
+/*
+    Counts the heap allocations of the process. The definitions interpose the
+    ones of the C library, so they also see operator new and the allocations
+    of the Qt containers.
+ */
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+
+static QBasicAtomicInteger<qint64> allocations = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+extern "C" void *malloc(size_t size) noexcept
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) noexcept
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_realloc(pointer, size);
+}
+
+static qint64 allocationCount()
+{
+    return allocations.loadRelaxed();
+}
+#else
+static qint64 allocationCount()
+{
+    return -1;
+}
+#endif
+
+static const QBluetoothAddress localAdapter(QStringLiteral("00:11:22:33:44:55"));
+static const QBluetoothAddress peerAddress(QStringLiteral("66:77:88:99:AA:BB"));
+
+static quint16 le16(const char *data)
+{
+    return quint16(quint8(data[0]) | (quint8(data[1]) << 8));
+}
+
+static void putLe16(char *&dst, quint16 value)
+{
+    *dst++ = char(value & 0xff);
+    *dst++ = char(value >> 8);
+}
+
+static QByteArray uuidBytes(const QBluetoothUuid &uuid)
+{
+    QByteArray bytes;
+    bool ok = false;
+    const quint16 shortUuid = uuid.toUInt16(&ok);
+    if (ok) {
+        bytes.resize(2);
+        char *data = bytes.data();
+        putLe16(data, shortUuid);
+    } else {
+        const QByteArray bigEndian = uuid.toRfc4122();
+        for (int i = bigEndian.size() - 1; i >= 0; --i)
+            bytes.append(bigEndian.at(i));
+    }
+    return bytes;
+}
+
+/*
+    Runs the event loop until \a done returns true. Unlike QTest::qWait(), it
+    never sleeps, so the measured time is spent handling PDUs.
+ */
+static bool spin(const std::function<bool()> &done)
+{
+    QElapsedTimer timeout;
+    timeout.start();
+    while (!done()) {
+        if (timeout.hasExpired(60000))
+            return false;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+/*
+    One end of a socket pair which replaces the L2CAP channel of a controller.
+    The peer does not allocate while it handles PDUs, so the allocations during
+    a measurement are those of the controller and the event loop.
+ */
+class AttPeer : public QObject
+{
+    Q_OBJECT
+public:
+    AttPeer()
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+            return;
+        peerSocket = fds[0];
+        controllerSocket = fds[1];
+        notifier = new QSocketNotifier(peerSocket, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &AttPeer::readPdu);
+    }
+
+    ~AttPeer() override
+    {
+        if (peerSocket >= 0)
+            ::close(peerSocket);
+        if (controllerSocket >= 0)
+            ::close(controllerSocket);
+    }
+
+    bool isValid() const { return peerSocket >= 0; }
+
+    // the controller owns the returned socket
+    int takeControllerSocket()
+    {
+        const int socket = controllerSocket;
+        controllerSocket = -1;
+        return socket;
+    }
+
+    bool send(const char *pdu, int size)
+    {
+        if (::write(peerSocket, pdu, size) != size)
+            return false;
+        ++sentPdus;
+        return true;
+    }
+
+    int pduCount() const { return sentPdus + receivedPdus; }
+
+    int roundTrips = 0;
+
+protected:
+    virtual void handlePdu(const char *pdu, int size) = 0;
+
+    int sentPdus = 0;
+    int receivedPdus = 0;
+
+private:
+    void readPdu()
+    {
+        const ssize_t size = ::read(peerSocket, buffer, sizeof buffer);
+        if (size <= 0)
+            return;
+        ++receivedPdus;
+        handlePdu(buffer, int(size));
+    }
+
+    char buffer[1024];
+    QSocketNotifier *notifier = nullptr;
+    int peerSocket = -1;
+    int controllerSocket = -1;
+};
+
+/*
+    Scripted ATT server which answers the requests of a central controller
+    from the attribute table of the given services. The handles are assigned
+    in the same order as by a peripheral controller. Responses are filled up to
+    the MTU like a conformant peripheral would do.
+ */
+class FakePeripheral : public AttPeer
+{
+    Q_OBJECT
+public:
+    FakePeripheral(const QList<QLowEnergyServiceData> &services, quint16 serverMtu);
+
+    quint16 mtu = 23;
+    int writes = 0;
+    int executedWrites = 0;
+
+protected:
+    void handlePdu(const char *pdu, int size) override;
+
+private:
+    struct Attribute {
+        QLowEnergyHandle handle;
+        QLowEnergyHandle groupEnd;
+        QByteArray type;
+        QByteArray value;
+    };
+
+    void append(const QBluetoothUuid &type, const QByteArray &value);
+    const Attribute *attribute(QLowEnergyHandle handle) const;
+    int readByType(const char *request, int size, bool grouped);
+    int findInformation(const char *request);
+    int read(const char *request, quint16 offset);
+    int readMultipleVariable(const char *request, int size);
+    int error(quint8 request, QLowEnergyHandle handle, quint8 code);
+
+    QList<Attribute> attributes;
+    quint16 serverMtu;
+    char response[1024];
+};
+
+FakePeripheral::FakePeripheral(const QList<QLowEnergyServiceData> &services, quint16 serverMtu)
+    : serverMtu(serverMtu)
+{
+    for (const QLowEnergyServiceData &service : services) {
+        const int serviceIndex = attributes.size();
+        append(QBluetoothUuid(quint16(0x2800)), uuidBytes(service.uuid()));
+
+        const QList<QLowEnergyCharacteristicData> characteristics = service.characteristics();
+        for (const QLowEnergyCharacteristicData &characteristic : characteristics) {
+            QByteArray declaration(3, Qt::Uninitialized);
+            char *data = declaration.data();
+            *data++ = char(characteristic.properties());
+            putLe16(data, quint16(attributes.size() + 2));
+            declaration += uuidBytes(characteristic.uuid());
+            append(QBluetoothUuid(quint16(0x2803)), declaration);
+            append(characteristic.uuid(), characteristic.value());
+
+            const QList<QLowEnergyDescriptorData> descriptors = characteristic.descriptors();
+            for (const QLowEnergyDescriptorData &descriptor : descriptors)
+                append(descriptor.uuid(), descriptor.value());
+        }
+        attributes[serviceIndex].groupEnd = quint16(attributes.size());
+    }
+}
+
+void FakePeripheral::append(const QBluetoothUuid &type, const QByteArray &value)
+{
+    const QLowEnergyHandle handle = quint16(attributes.size() + 1);
+    attributes.append({ handle, handle, uuidBytes(type), value });
+}
+
+const FakePeripheral::Attribute *FakePeripheral::attribute(QLowEnergyHandle handle) const
+{
+    return handle > 0 && handle <= attributes.size() ? &attributes.at(handle - 1) : nullptr;
+}
+
+void FakePeripheral::handlePdu(const char *pdu, int size)
+{
+    int responseSize = 0;
+    switch (quint8(pdu[0])) {
+    case 0x02: // ATT_OP_EXCHANGE_MTU_REQUEST
+        mtu = qBound<quint16>(23, le16(pdu + 1), serverMtu);
+        response[0] = 0x03;
+        response[1] = char(serverMtu & 0xff);
+        response[2] = char(serverMtu >> 8);
+        responseSize = 3;
+        break;
+    case 0x04: // ATT_OP_FIND_INFORMATION_REQUEST
+        responseSize = findInformation(pdu);
+        break;
+    case 0x08: // ATT_OP_READ_BY_TYPE_REQUEST
+        responseSize = readByType(pdu, size, false);
+        break;
+    case 0x0a: // ATT_OP_READ_REQUEST
+        responseSize = read(pdu, 0);
+        break;
+    case 0x0c: // ATT_OP_READ_BLOB_REQUEST
+        responseSize = read(pdu, le16(pdu + 3));
+        break;
+    case 0x10: // ATT_OP_READ_BY_GROUP_REQUEST
+        responseSize = readByType(pdu, size, true);
+        break;
+    case 0x12: // ATT_OP_WRITE_REQUEST
+        ++writes;
+        response[0] = 0x13;
+        responseSize = 1;
+        break;
+    case 0x16: // ATT_OP_PREPARE_WRITE_REQUEST
+        memcpy(response, pdu, size);
+        response[0] = 0x17;
+        responseSize = size;
+        break;
+    case 0x18: // ATT_OP_EXECUTE_WRITE_REQUEST
+        if (pdu[1])
+            ++executedWrites;
+        response[0] = 0x19;
+        responseSize = 1;
+        break;
+    case 0x20: // ATT_OP_READ_MULTIPLE_VARIABLE_REQUEST
+        responseSize = readMultipleVariable(pdu, size);
+        break;
+    case 0x1e: // ATT_OP_HANDLE_VAL_CONFIRMATION
+    case 0x52: // ATT_OP_WRITE_COMMAND
+        return;
+    default:
+        responseSize = error(quint8(pdu[0]), 0, 0x06); // request not supported
+        break;
+    }
+
+    ++roundTrips;
+    send(response, responseSize);
+}
+
+int FakePeripheral::readByType(const char *request, int size, bool grouped)
+{
+    const QLowEnergyHandle start = le16(request + 1);
+    const QLowEnergyHandle end = le16(request + 3);
+    const char *type = request + 5;
+    const int typeSize = size - 5;
+
+    char *data = response + 2;
+    int elementLength = 0;
+    for (const Attribute &attr : qAsConst(attributes)) {
+        if (attr.handle < start || attr.handle > end || attr.type.size() != typeSize
+                || memcmp(attr.type.constData(), type, typeSize) != 0) {
+            continue;
+        }
+
+        const int headerSize = grouped ? 4 : 2;
+        const int valueSize = qMin(attr.value.size(), qMin(mtu - 2 - headerSize, 253));
+        if (elementLength == 0)
+            elementLength = headerSize + valueSize;
+        else if (elementLength != headerSize + valueSize || data - response + elementLength > mtu)
+            break;
+
+        putLe16(data, attr.handle);
+        if (grouped)
+            putLe16(data, attr.groupEnd);
+        memcpy(data, attr.value.constData(), valueSize);
+        data += valueSize;
+    }
+
+    if (elementLength == 0)
+        return error(quint8(request[0]), start, 0x0a); // attribute not found
+    response[0] = grouped ? 0x11 : 0x09;
+    response[1] = char(elementLength);
+    return int(data - response);
+}
+
+int FakePeripheral::findInformation(const char *request)
+{
+    const QLowEnergyHandle start = le16(request + 1);
+    const QLowEnergyHandle end = le16(request + 3);
+
+    char *data = response + 2;
+    int uuidSize = 0;
+    for (const Attribute &attr : qAsConst(attributes)) {
+        if (attr.handle < start || attr.handle > end)
+            continue;
+        if (uuidSize == 0)
+            uuidSize = attr.type.size();
+        else if (uuidSize != attr.type.size() || data - response + 2 + uuidSize > mtu)
+            break;
+
+        putLe16(data, attr.handle);
+        memcpy(data, attr.type.constData(), uuidSize);
+        data += uuidSize;
+    }
+
+    if (uuidSize == 0)
+        return error(quint8(request[0]), start, 0x0a); // attribute not found
+    response[0] = 0x05;
+    response[1] = uuidSize == 2 ? 0x01 : 0x02;
+    return int(data - response);
+}
+
+int FakePeripheral::read(const char *request, quint16 offset)
+{
+    const QLowEnergyHandle handle = le16(request + 1);
+    const Attribute *attr = attribute(handle);
+    if (!attr)
+        return error(quint8(request[0]), handle, 0x01); // invalid handle
+    if (offset > attr->value.size())
+        return error(quint8(request[0]), handle, 0x07); // invalid offset
+
+    const int valueSize = qMin(attr->value.size() - offset, mtu - 1);
+    response[0] = request[0] == 0x0a ? 0x0b : 0x0d;
+    memcpy(response + 1, attr->value.constData() + offset, valueSize);
+    return 1 + valueSize;
+}
+
+int FakePeripheral::readMultipleVariable(const char *request, int size)
+{
+    char *data = response + 1;
+    for (int i = 1; i + 1 < size; i += 2) {
+        const QLowEnergyHandle handle = le16(request + i);
+        const Attribute *attr = attribute(handle);
+        if (!attr)
+            return error(quint8(request[0]), handle, 0x01); // invalid handle
+        putLe16(data, quint16(attr->value.size()));
+        memcpy(data, attr->value.constData(), attr->value.size());
+        data += attr->value.size();
+        if (data - response >= mtu)
+            break;
+    }
+
+    // the tuple list is cut off at the MTU, possibly within a length field
+    response[0] = 0x21;
+    return qMin(int(data - response), int(mtu));
+}
+
+int FakePeripheral::error(quint8 request, QLowEnergyHandle handle, quint8 code)
+{
+    char *data = response;
+    *data++ = 0x01;
+    *data++ = char(request);
+    putLe16(data, handle);
+    *data++ = char(code);
+    return int(data - response);
+}
+
+/*
+    Scripted ATT client of a peripheral controller. The benchmark sends the
+    requests; the central counts the responses and notifications and
+    confirms indications.
+ */
+class FakeCentral : public AttPeer
+{
+    Q_OBJECT
+public:
+    int responses = 0;
+    int errors = 0;
+    int notifications = 0;
+
+protected:
+    void handlePdu(const char *pdu, int size) override
+    {
+        Q_UNUSED(size);
+        switch (quint8(pdu[0])) {
+        case 0x1b: // ATT_OP_HANDLE_VAL_NOTIFICATION
+            ++notifications;
+            break;
+        case 0x1d: { // ATT_OP_HANDLE_VAL_INDICATION
+            ++notifications;
+            const char confirmation = 0x1e;
+            send(&confirmation, 1);
+        } break;
+        case 0x01: // ATT_OP_ERROR_RESPONSE
+            ++errors;
+            Q_FALLTHROUGH();
+        default:
+            ++responses;
+            ++roundTrips;
+            break;
+        }
+    }
+};
+
+/*
+    Wall time, heap allocations and round trips of the PDUs which pass
+    between a controller and \a peer from construction until report().
+ */
+class Measurement
+{
+public:
+    explicit Measurement(const AttPeer &peer)
+        : peer(peer), pdus(peer.pduCount()), roundTrips(peer.roundTrips),
+          allocations(allocationCount())
+    {
+        timer.start();
+    }
+
+    void report()
+    {
+        const qint64 elapsed = timer.nsecsElapsed();
+        const qint64 allocated = allocationCount() - allocations;
+        const int pduCount = qMax(1, peer.pduCount() - pdus);
+        if (allocations < 0) {
+            qDebug("%d PDUs, %d round trips, allocations not counted",
+                   pduCount, peer.roundTrips - roundTrips);
+        } else {
+            qDebug("%d PDUs, %d round trips, %.2f allocations/PDU",
+                   pduCount, peer.roundTrips - roundTrips, qreal(allocated) / pduCount);
+        }
+        QTest::setBenchmarkResult(qreal(elapsed) / pduCount, QTest::WalltimeNanoseconds);
+    }
+
+private:
+    QElapsedTimer timer;
+    const AttPeer &peer;
+    const int pdus;
+    const int roundTrips;
+    const qint64 allocations;
+};
+
+enum {
+    LongValueSize = 100,
+    OperationCount = 200,
+    UpdateCount = 10000,
+    // below LeAttTransmitQueue::DefaultNotificationLimit
+    UpdateBurst = 32
+};
+
+static QBluetoothUuid characteristicUuid(int service, int characteristic)
+{
+    return ((service + characteristic) % 3 == 0)
+            ? QBluetoothUuid(QStringLiteral("{6e40%1-b5a3-f393-e0a9-e50e24dcca9e}")
+                             .arg(characteristic, 4, 16, QLatin1Char('0')))
+            : QBluetoothUuid(quint16(0x2b00 + characteristic));
+}
+
+/*
+    Creates \a serviceCount services with four characteristics each. The
+    characteristics mix 16 and 128 bit uuids. The second one notifies, the
+    third one has a value which needs several reads at the default MTU, and
+    the fourth one is writable.
+ */
+static QList<QLowEnergyServiceData> createServices(int serviceCount)
+{
+    QList<QLowEnergyServiceData> services;
+    for (int s = 0; s < serviceCount; ++s) {
+        QLowEnergyServiceData service;
+        service.setType(QLowEnergyServiceData::ServiceTypePrimary);
+        service.setUuid((s % 2)
+                ? QBluetoothUuid(QStringLiteral("{6e400001-b5a3-f393-e0a9-e50e24dc%1}")
+                                 .arg(s, 4, 16, QLatin1Char('0')))
+                : QBluetoothUuid(quint16(0x1820 + s)));
+
+        for (int c = 0; c < 4; ++c) {
+            QLowEnergyCharacteristicData characteristic;
+            characteristic.setUuid(characteristicUuid(s, c));
+            switch (c) {
+            case 0:
+                characteristic.setProperties(QLowEnergyCharacteristic::Read);
+                characteristic.setValue(QByteArray(4, char(s)));
+                break;
+            case 1:
+                characteristic.setProperties(QLowEnergyCharacteristic::Read
+                                             | QLowEnergyCharacteristic::Notify);
+                characteristic.setValue(QByteArray(4, char(s)));
+                characteristic.addDescriptor(QLowEnergyDescriptorData(
+                        QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration,
+                        QByteArray(2, 0)));
+                break;
+            case 2:
+                characteristic.setProperties(QLowEnergyCharacteristic::Read);
+                characteristic.setValue(QByteArray(LongValueSize, char('a' + s % 26)));
+                characteristic.addDescriptor(QLowEnergyDescriptorData(
+                        QBluetoothUuid::DescriptorType::CharacteristicUserDescription,
+                        QByteArray("long value")));
+                break;
+            case 3:
+                characteristic.setProperties(QLowEnergyCharacteristic::Read
+                                             | QLowEnergyCharacteristic::Write
+                                             | QLowEnergyCharacteristic::WriteNoResponse);
+                characteristic.setValue(QByteArray(20, char(s)));
+                break;
+            }
+            service.addCharacteristic(characteristic);
+        }
+        services.append(service);
+    }
+    return services;
+}
+
+static QLowEnergyControllerPrivateBluez *bluezPrivate(QLowEnergyController *controller)
+{
+    return qobject_cast<QLowEnergyControllerPrivateBluez *>(
+                QLowEnergyControllerPrivate::get(controller));
+}
+
+/*
+    Connects the central \a controller to \a peripheral and discovers the
+    details of all \a services, either in one pass or service by service.
+ */
+static bool connectAndDiscover(QLowEnergyController *controller, FakePeripheral &peripheral,
+                               const QList<QLowEnergyServiceData> &services, bool singlePass,
+                               QList<QLowEnergyService *> *serviceObjects)
+{
+    if (!bluezPrivate(controller)->attachConnectedChannel(peripheral.takeControllerSocket(),
+                                                         peerAddress)) {
+        return false;
+    }
+
+    controller->discoverServices();
+    if (!spin([controller]() {
+            return controller->state() == QLowEnergyController::DiscoveredState;
+        })) {
+        return false;
+    }
+
+    for (const QLowEnergyServiceData &service : services) {
+        QLowEnergyService *object = controller->createServiceObject(service.uuid(), controller);
+        if (!object)
+            return false;
+        serviceObjects->append(object);
+    }
+
+    if (singlePass) {
+        controller->discoverAllServiceDetails();
+    } else {
+        for (QLowEnergyService *object : qAsConst(*serviceObjects))
+            object->discoverDetails();
+    }
+    return spin([serviceObjects]() {
+        return std::all_of(serviceObjects->cbegin(), serviceObjects->cend(),
+                           [](const QLowEnergyService *object) {
+                               return object->state()
+                                       == QLowEnergyService::RemoteServiceDiscovered;
+                           });
+    });
+}
+
+static QLowEnergyController *createCentral(int mtu)
+{
+    QLowEnergyController *controller = QLowEnergyController::createCentral(
+                QBluetoothDeviceInfo(peerAddress, QStringLiteral("Scripted peripheral"), 0),
+                localAdapter);
+    controller->setPreferredMtu(mtu);
+    return controller;
+}
+
+static QLowEnergyController *createPeripheral(const QList<QLowEnergyServiceData> &services,
+                                             int mtu, QList<QLowEnergyService *> *serviceObjects)
+{
+    QLowEnergyController *controller = QLowEnergyController::createPeripheral(localAdapter);
+    controller->setPreferredMtu(mtu);
+    for (const QLowEnergyServiceData &service : services)
+        serviceObjects->append(controller->addService(service, controller));
+    return controller;
+}
+
+static bool exchangeMtu(FakeCentral &central, int mtu)
+{
+    if (mtu <= 23)
+        return true;
+
+    char request[3];
+    char *data = request;
+    *data++ = 0x02; // ATT_OP_EXCHANGE_MTU_REQUEST
+    putLe16(data, quint16(mtu));
+    const int responses = central.responses + 1;
+    return central.send(request, sizeof request)
+            && spin([&central, responses]() { return central.responses == responses; });
+}
+
+class tst_QLowEnergyControllerBluezBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    // central role against a scripted peripheral
+    void discovery_data();
+    void discovery();
+    void reads_data();
+    void reads();
+    void longWrites_data();
+    void longWrites();
+    void receivedNotifications_data();
+    void receivedNotifications();
+
+    // peripheral role against a scripted central
+    void readByTypeFlood_data();
+    void readByTypeFlood();
+    void sentNotifications_data();
+    void sentNotifications();
+};
+
+void tst_QLowEnergyControllerBluezBench::initTestCase()
+{
+    // Centrals use the kernel ATT interface even if a newer bluetoothd is installed.
+    // The version is detected once, so this must happen before the first controller.
+    qputenv("BLUETOOTH_FORCE_DBUS_LE_VERSION", "5.41");
+}
+
+void tst_QLowEnergyControllerBluezBench::discovery_data()
+{
+    QTest::addColumn<int>("serviceCount");
+    QTest::addColumn<int>("mtu");
+    QTest::addColumn<bool>("singlePass");
+
+    QTest::newRow("10 services, MTU 23") << 10 << 23 << false;
+    QTest::newRow("10 services, MTU 23, single pass") << 10 << 23 << true;
+    QTest::newRow("40 services, MTU 23") << 40 << 23 << false;
+    QTest::newRow("40 services, MTU 23, single pass") << 40 << 23 << true;
+    QTest::newRow("40 services, MTU 247") << 40 << 247 << false;
+    QTest::newRow("40 services, MTU 247, single pass") << 40 << 247 << true;
+}
+
+// from the connection to the discovery of all service details
+void tst_QLowEnergyControllerBluezBench::discovery()
+{
+    QFETCH(int, serviceCount);
+    QFETCH(int, mtu);
+    QFETCH(bool, singlePass);
+
+    const QList<QLowEnergyServiceData> services = createServices(serviceCount);
+    FakePeripheral peripheral(services, quint16(mtu));
+    QVERIFY(peripheral.isValid());
+    QScopedPointer<QLowEnergyController> controller(createCentral(mtu));
+    QVERIFY(bluezPrivate(controller.data()));
+
+    QList<QLowEnergyService *> serviceObjects;
+    Measurement measurement(peripheral);
+    QVERIFY(connectAndDiscover(controller.data(), peripheral, services, singlePass,
+                               &serviceObjects));
+    measurement.report();
+
+    QCOMPARE(controller->mtu(), mtu);
+    QCOMPARE(controller->services().size(), serviceCount);
+    for (int i = 0; i < serviceCount; ++i) {
+        const QList<QLowEnergyCharacteristic> characteristics =
+                serviceObjects.at(i)->characteristics();
+        QCOMPARE(characteristics.size(), 4);
+        QCOMPARE(characteristics.at(2).value(),
+                 services.at(i).characteristics().at(2).value());
+    }
+}
+
+void tst_QLowEnergyControllerBluezBench::reads_data()
+{
+    QTest::addColumn<int>("mtu");
+    QTest::addColumn<bool>("longValue");
+
+    QTest::newRow("short value, MTU 23") << 23 << false;
+    QTest::newRow("long value, MTU 23") << 23 << true;
+    QTest::newRow("long value, MTU 247") << 247 << true;
+}
+
+// queued reads of one characteristic
+void tst_QLowEnergyControllerBluezBench::reads()
+{
+    QFETCH(int, mtu);
+    QFETCH(bool, longValue);
+
+    const QList<QLowEnergyServiceData> services = createServices(1);
+    FakePeripheral peripheral(services, quint16(mtu));
+    QVERIFY(peripheral.isValid());
+    QScopedPointer<QLowEnergyController> controller(createCentral(mtu));
+    QVERIFY(bluezPrivate(controller.data()));
+    QList<QLowEnergyService *> serviceObjects;
+    QVERIFY(connectAndDiscover(controller.data(), peripheral, services, true, &serviceObjects));
+
+    QLowEnergyService *service = serviceObjects.constFirst();
+    const QLowEnergyCharacteristic characteristic =
+            service->characteristics().at(longValue ? 2 : 0);
+    int reads = 0;
+    connect(service, &QLowEnergyService::characteristicRead, service, [&reads]() { ++reads; });
+
+    Measurement measurement(peripheral);
+    for (int i = 0; i < OperationCount; ++i)
+        service->readCharacteristic(characteristic);
+    QVERIFY(spin([&reads]() { return reads == OperationCount; }));
+    measurement.report();
+
+    QCOMPARE(service->error(), QLowEnergyService::NoError);
+}
+
+void tst_QLowEnergyControllerBluezBench::longWrites_data()
+{
+    QTest::addColumn<int>("mtu");
+    QTest::addColumn<int>("valueSize");
+
+    QTest::newRow("100 bytes, MTU 23") << 23 << 100;
+    QTest::newRow("512 bytes, MTU 23") << 23 << 512;
+    QTest::newRow("512 bytes, MTU 247") << 247 << 512;
+}
+
+// queued writes which need Prepare and Execute Write Requests
+void tst_QLowEnergyControllerBluezBench::longWrites()
+{
+    QFETCH(int, mtu);
+    QFETCH(int, valueSize);
+
+    const QList<QLowEnergyServiceData> services = createServices(1);
+    FakePeripheral peripheral(services, quint16(mtu));
+    QVERIFY(peripheral.isValid());
+    QScopedPointer<QLowEnergyController> controller(createCentral(mtu));
+    QVERIFY(bluezPrivate(controller.data()));
+    QList<QLowEnergyService *> serviceObjects;
+    QVERIFY(connectAndDiscover(controller.data(), peripheral, services, true, &serviceObjects));
+
+    QLowEnergyService *service = serviceObjects.constFirst();
+    const QLowEnergyCharacteristic characteristic = service->characteristics().at(3);
+    const QByteArray value(valueSize, 'w');
+    int writes = 0;
+    connect(service, &QLowEnergyService::characteristicWritten, service,
+            [&writes]() { ++writes; });
+
+    Measurement measurement(peripheral);
+    for (int i = 0; i < OperationCount; ++i)
+        service->writeCharacteristic(characteristic, value);
+    QVERIFY(spin([&writes]() { return writes == OperationCount; }));
+    measurement.report();
+
+    QCOMPARE(service->error(), QLowEnergyService::NoError);
+    QCOMPARE(peripheral.executedWrites, int(OperationCount));
+}
+
+static void addNotificationRows()
+{
+    QTest::addColumn<int>("mtu");
+    QTest::addColumn<int>("valueSize");
+
+    QTest::newRow("20 bytes, MTU 23") << 23 << 20;
+    QTest::newRow("20 bytes, MTU 247") << 247 << 20;
+    QTest::newRow("244 bytes, MTU 247") << 247 << 244;
+}
+
+void tst_QLowEnergyControllerBluezBench::receivedNotifications_data()
+{
+    addNotificationRows();
+}
+
+// notifications from the peripheral, in bursts
+void tst_QLowEnergyControllerBluezBench::receivedNotifications()
+{
+    QFETCH(int, mtu);
+    QFETCH(int, valueSize);
+
+    const QList<QLowEnergyServiceData> services = createServices(1);
+    FakePeripheral peripheral(services, quint16(mtu));
+    QVERIFY(peripheral.isValid());
+    QScopedPointer<QLowEnergyController> controller(createCentral(mtu));
+    QVERIFY(bluezPrivate(controller.data()));
+    QList<QLowEnergyService *> serviceObjects;
+    QVERIFY(connectAndDiscover(controller.data(), peripheral, services, true, &serviceObjects));
+
+    QLowEnergyService *service = serviceObjects.constFirst();
+    const QLowEnergyCharacteristic characteristic = service->characteristics().at(1);
+    QByteArray notification(3 + valueSize, 'n');
+    char *data = notification.data();
+    *data++ = 0x1b; // ATT_OP_HANDLE_VAL_NOTIFICATION
+    putLe16(data, characteristic.handle());
+    int changes = 0;
+    connect(service, &QLowEnergyService::characteristicChanged, service,
+            [&changes]() { ++changes; });
+
+    Measurement measurement(peripheral);
+    for (int sent = 0; sent < UpdateCount;) {
+        const int burst = qMin(int(UpdateBurst), UpdateCount - sent);
+        for (int i = 0; i < burst; ++i)
+            QVERIFY(peripheral.send(notification.constData(), notification.size()));
+        sent += burst;
+        QVERIFY(spin([&changes, sent]() { return changes == sent; }));
+    }
+    measurement.report();
+
+    QCOMPARE(characteristic.value(), notification.mid(3));
+}
+
+void tst_QLowEnergyControllerBluezBench::readByTypeFlood_data()
+{
+    QTest::addColumn<int>("serviceCount");
+    QTest::addColumn<int>("mtu");
+    QTest::addColumn<bool>("declarations");
+
+    QTest::newRow("10 services, MTU 23, declarations") << 10 << 23 << true;
+    QTest::newRow("40 services, MTU 23, declarations") << 40 << 23 << true;
+    QTest::newRow("40 services, MTU 247, declarations") << 40 << 247 << true;
+    QTest::newRow("40 services, MTU 23, values") << 40 << 23 << false;
+    QTest::newRow("40 services, MTU 247, values") << 40 << 247 << false;
+}
+
+// Read By Type Requests over the whole database, sent without waiting for the responses
+void tst_QLowEnergyControllerBluezBench::readByTypeFlood()
+{
+    QFETCH(int, serviceCount);
+    QFETCH(int, mtu);
+    QFETCH(bool, declarations);
+
+    FakeCentral central;
+    QVERIFY(central.isValid());
+    QList<QLowEnergyService *> serviceObjects;
+    QScopedPointer<QLowEnergyController> controller(
+            createPeripheral(createServices(serviceCount), mtu, &serviceObjects));
+    QVERIFY(!serviceObjects.contains(nullptr));
+    auto d = bluezPrivate(controller.data());
+    QVERIFY(d);
+    QVERIFY(d->attachConnectedChannel(central.takeControllerSocket(), peerAddress));
+    QVERIFY(exchangeMtu(central, mtu));
+
+    char request[7];
+    char *data = request;
+    *data++ = 0x08; // ATT_OP_READ_BY_TYPE_REQUEST
+    putLe16(data, 0x0001);
+    putLe16(data, 0xffff);
+    // the value of the first characteristic has a 16 bit uuid in the second service
+    putLe16(data, declarations ? 0x2803 : characteristicUuid(1, 0).toUInt16());
+
+    const int responses = central.responses;
+    Measurement measurement(central);
+    for (int sent = 0; sent < OperationCount * 10;) {
+        const int burst = qMin(int(UpdateBurst), OperationCount * 10 - sent);
+        for (int i = 0; i < burst; ++i)
+            QVERIFY(central.send(request, sizeof request));
+        sent += burst;
+        QVERIFY(spin([&central, responses, sent]() {
+            return central.responses - responses == sent;
+        }));
+    }
+    measurement.report();
+
+    QCOMPARE(central.errors, 0);
+}
+
+void tst_QLowEnergyControllerBluezBench::sentNotifications_data()
+{
+    addNotificationRows();
+}
+
+// value updates of a local characteristic which the central subscribed to
+void tst_QLowEnergyControllerBluezBench::sentNotifications()
+{
+    QFETCH(int, mtu);
+    QFETCH(int, valueSize);
+
+    FakeCentral central;
+    QVERIFY(central.isValid());
+    QList<QLowEnergyService *> serviceObjects;
+    QScopedPointer<QLowEnergyController> controller(
+            createPeripheral(createServices(1), mtu, &serviceObjects));
+    QVERIFY(!serviceObjects.contains(nullptr));
+    auto d = bluezPrivate(controller.data());
+    QVERIFY(d);
+    QVERIFY(d->attachConnectedChannel(central.takeControllerSocket(), peerAddress));
+    QVERIFY(exchangeMtu(central, mtu));
+
+    QLowEnergyService *service = serviceObjects.constFirst();
+    const QLowEnergyCharacteristic characteristic = service->characteristics().at(1);
+    const QLowEnergyDescriptor clientConfig = characteristic.descriptor(
+            QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
+    QVERIFY(clientConfig.isValid());
+
+    char request[5];
+    char *data = request;
+    *data++ = 0x12; // ATT_OP_WRITE_REQUEST
+    putLe16(data, clientConfig.handle());
+    putLe16(data, 0x0001); // notifications enabled
+    const int responses = central.responses + 1;
+    QVERIFY(central.send(request, sizeof request));
+    QVERIFY(spin([&central, responses]() { return central.responses == responses; }));
+    QCOMPARE(central.errors, 0);
+
+    const QByteArray value(valueSize, 'n');
+    Measurement measurement(central);
+    for (int sent = 0; sent < UpdateCount;) {
+        const int burst = qMin(int(UpdateBurst), UpdateCount - sent);
+        for (int i = 0; i < burst; ++i)
+            service->writeCharacteristic(characteristic, value);
+        sent += burst;
+        QVERIFY(spin([&central, sent]() { return central.notifications == sent; }));
+    }
+    measurement.report();
+
+    QCOMPARE(service->droppedUpdates(), 0);
+}
+
+QTEST_MAIN(tst_QLowEnergyControllerBluezBench)
+
+#include "tst_bench_qlowenergycontroller_bluez.moc"
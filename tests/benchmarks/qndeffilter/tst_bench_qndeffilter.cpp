@@ -0,0 +1,159 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include <QtNfc/qndeffilter.h>
+#include <QtNfc/qndefmessage.h>
+#include <QtNfc/qndefnfctextrecord.h>
+#include <QtNfc/qndefnfcurirecord.h>
+#include <QtNfc/private/qndeffiltermatcher_p.h>
+
+QT_USE_NAMESPACE
+
+class tst_QNdefFilterBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void match_data();
+    void match();
+    void matchAllFilters_data();
+    void matchAllFilters();
+    void matcherDispatch_data();
+    void matcherDispatch();
+
+private:
+    QList<QNdefFilter> m_filters;
+    QNdefMessage m_message;
+};
+
+static QNdefRecord mimeRecord(const QByteArray &type)
+{
+    QNdefRecord record;
+    record.setTypeNameFormat(QNdefRecord::Mime);
+    record.setType(type);
+    record.setPayload("payload");
+    return record;
+}
+
+void tst_QNdefFilterBench::initTestCase()
+{
+    // A tag sorting setup: many filters, each expecting a text record and a
+    // filter specific MIME record, some of them in the given order.
+    for (int i = 0; i < 50; ++i) {
+        QNdefFilter filter;
+        filter.setOrderMatch(i % 2);
+        filter.appendRecord<QNdefNfcTextRecord>(1, 1);
+        filter.appendRecord(QNdefRecord::Mime, "application/vnd.sorter." + QByteArray::number(i),
+                            1, 1);
+        filter.appendRecord<QNdefNfcUriRecord>(0, 1);
+        filter.appendRecord(QNdefRecord::Empty, "", 0, 10);
+        m_filters.append(filter);
+    }
+
+    QNdefNfcTextRecord text;
+    text.setText(QStringLiteral("sorting"));
+    m_message.append(text);
+    m_message.append(mimeRecord("application/vnd.sorter.42"));
+    QNdefNfcUriRecord uri;
+    uri.setUri(QUrl(QStringLiteral("https://qt.io")));
+    m_message.append(uri);
+    for (int i = 0; i < 4; ++i)
+        m_message.append(QNdefRecord());
+}
+
+void tst_QNdefFilterBench::match_data()
+{
+    QTest::addColumn<bool>("orderMatch");
+
+    QTest::newRow("unordered") << false;
+    QTest::newRow("ordered") << true;
+}
+
+void tst_QNdefFilterBench::match()
+{
+    QFETCH(bool, orderMatch);
+
+    QNdefFilter filter = m_filters.at(42);
+    filter.setOrderMatch(orderMatch);
+    QVERIFY(filter.match(m_message));
+
+    QBENCHMARK {
+        filter.match(m_message);
+    }
+}
+
+void tst_QNdefFilterBench::matchAllFilters_data()
+{
+    QTest::addColumn<int>("filterCount");
+
+    QTest::newRow("10 filters") << 10;
+    QTest::newRow("50 filters") << 50;
+}
+
+void tst_QNdefFilterBench::matchAllFilters()
+{
+    QFETCH(int, filterCount);
+
+    const QList<QNdefFilter> filters = m_filters.mid(0, filterCount);
+    QBENCHMARK {
+        int matched = 0;
+        for (const QNdefFilter &filter : filters)
+            matched += filter.match(m_message) ? 1 : 0;
+        Q_UNUSED(matched);
+    }
+}
+
+void tst_QNdefFilterBench::matcherDispatch_data()
+{
+    matchAllFilters_data();
+}
+
+void tst_QNdefFilterBench::matcherDispatch()
+{
+    QFETCH(int, filterCount);
+
+    int handled = 0;
+    QNdefFilterMatcher matcher;
+    for (int i = 0; i < filterCount; ++i)
+        matcher.addFilter(m_filters.at(i), [&handled](const QNdefMessage &) { ++handled; });
+
+    QCOMPARE(matcher.dispatch(m_message), filterCount > 42 ? 1 : 0);
+
+    QBENCHMARK {
+        matcher.dispatch(m_message);
+    }
+}
+
+QTEST_MAIN(tst_QNdefFilterBench)
+
+#include "tst_bench_qndeffilter.moc"
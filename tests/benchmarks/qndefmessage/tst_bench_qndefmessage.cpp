@@ -0,0 +1,162 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include <QtNfc/qndefmessage.h>
+#include <QtNfc/qndefrecord.h>
+#include <QtNfc/private/qndefmessageview_p.h>
+
+QT_USE_NAMESPACE
+
+class tst_QNdefMessageBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fromByteArray_data();
+    void fromByteArray();
+    void messageView_data();
+    void messageView();
+    void toByteArray_data();
+    void toByteArray();
+};
+
+static QNdefMessage createMessage(int recordCount, int payloadSize)
+{
+    QNdefMessage message;
+    for (int i = 0; i < recordCount; ++i) {
+        QNdefRecord record;
+        record.setTypeNameFormat(QNdefRecord::Mime);
+        record.setType("application/octet-stream");
+        record.setId(QByteArray::number(i));
+        record.setPayload(QByteArray(payloadSize, char(i)));
+        message.append(record);
+    }
+    return message;
+}
+
+// A single record with its payload split into chunks of chunkSize bytes.
+static QByteArray createChunkedMessage(int chunkCount, int chunkSize)
+{
+    QByteArray data;
+    const QByteArray chunk(chunkSize, 'c');
+    for (int i = 0; i < chunkCount; ++i) {
+        const bool first = i == 0;
+        const bool last = i == chunkCount - 1;
+
+        quint8 flags = first ? QNdefRecord::Mime : 0x06;
+        if (first)
+            flags |= 0x80; // MB
+        if (last)
+            flags |= 0x40; // ME
+        else
+            flags |= 0x20; // CF
+
+        data.append(char(flags));
+        data.append(char(first ? 3 : 0)); // TYPE LENGTH
+        data.append(char(quint32(chunkSize) >> 24));
+        data.append(char(quint32(chunkSize) >> 16));
+        data.append(char(quint32(chunkSize) >> 8));
+        data.append(char(quint32(chunkSize)));
+        if (first)
+            data.append("a/b");
+        data.append(chunk);
+    }
+    return data;
+}
+
+static void addParseRows()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("1 x 16 bytes") << createMessage(1, 16).toByteArray();
+    QTest::newRow("100 x 16 bytes") << createMessage(100, 16).toByteArray();
+    QTest::newRow("100 x 1 KiB") << createMessage(100, 1024).toByteArray();
+    QTest::newRow("4 x 64 KiB") << createMessage(4, 64 * 1024).toByteArray();
+    QTest::newRow("chunked 256 x 256 bytes") << createChunkedMessage(256, 256);
+}
+
+void tst_QNdefMessageBench::fromByteArray_data()
+{
+    addParseRows();
+}
+
+void tst_QNdefMessageBench::fromByteArray()
+{
+    QFETCH(QByteArray, data);
+
+    QBENCHMARK {
+        const QNdefMessage message = QNdefMessage::fromByteArray(data);
+        QVERIFY(!message.isEmpty());
+    }
+}
+
+void tst_QNdefMessageBench::messageView_data()
+{
+    addParseRows();
+}
+
+void tst_QNdefMessageBench::messageView()
+{
+    QFETCH(QByteArray, data);
+
+    qsizetype total = 0;
+    QBENCHMARK {
+        const QNdefMessageView view(data);
+        QVERIFY(view.isValid());
+        for (const QNdefRecordView &record : view)
+            total += record.payloadSize();
+    }
+    QVERIFY(total > 0);
+}
+
+void tst_QNdefMessageBench::toByteArray_data()
+{
+    QTest::addColumn<QNdefMessage>("message");
+
+    QTest::newRow("1 x 16 bytes") << createMessage(1, 16);
+    QTest::newRow("100 x 16 bytes") << createMessage(100, 16);
+    QTest::newRow("100 x 1 KiB") << createMessage(100, 1024);
+    QTest::newRow("4 x 64 KiB") << createMessage(4, 64 * 1024);
+}
+
+void tst_QNdefMessageBench::toByteArray()
+{
+    QFETCH(QNdefMessage, message);
+
+    QBENCHMARK {
+        const QByteArray data = message.toByteArray();
+        QVERIFY(!data.isEmpty());
+    }
+}
+
+QTEST_MAIN(tst_QNdefMessageBench)
+
+#include "tst_bench_qndefmessage.moc"
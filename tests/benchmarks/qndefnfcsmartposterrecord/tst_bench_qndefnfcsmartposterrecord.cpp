@@ -0,0 +1,137 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include <QtNfc/qndefmessage.h>
+#include <QtNfc/qndefnfcsmartposterrecord.h>
+
+QT_USE_NAMESPACE
+
+class tst_QNdefNfcSmartPosterRecordBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void create_data();
+    void create();
+    void parse_data();
+    void parse();
+    void modify_data();
+    void modify();
+};
+
+static QNdefNfcSmartPosterRecord createPoster(int titleCount, int iconCount)
+{
+    QNdefNfcSmartPosterRecord poster;
+    poster.setUri(QUrl(QStringLiteral("https://www.qt.io/product")));
+    poster.setAction(QNdefNfcSmartPosterRecord::DoAction);
+
+    for (int i = 0; i < titleCount; ++i) {
+        poster.addTitle(QStringLiteral("Poster title %1").arg(i),
+                        QStringLiteral("l%1").arg(i), QNdefNfcTextRecord::Utf8);
+    }
+
+    for (int i = 0; i < iconCount; ++i)
+        poster.addIcon("image/x-icon-" + QByteArray::number(i), QByteArray(4096, char(i)));
+
+    poster.setSize(1024);
+    poster.setTypeInfo(QStringLiteral("text/html"));
+    return poster;
+}
+
+static void addPosterRows()
+{
+    QTest::addColumn<int>("titleCount");
+    QTest::addColumn<int>("iconCount");
+
+    QTest::newRow("1 title") << 1 << 0;
+    QTest::newRow("50 titles") << 50 << 0;
+    QTest::newRow("50 titles, 5 icons") << 50 << 5;
+}
+
+void tst_QNdefNfcSmartPosterRecordBench::create_data()
+{
+    addPosterRows();
+}
+
+void tst_QNdefNfcSmartPosterRecordBench::create()
+{
+    QFETCH(int, titleCount);
+    QFETCH(int, iconCount);
+
+    QBENCHMARK {
+        const QNdefNfcSmartPosterRecord poster = createPoster(titleCount, iconCount);
+        QVERIFY(!poster.payload().isEmpty());
+    }
+}
+
+void tst_QNdefNfcSmartPosterRecordBench::parse_data()
+{
+    addPosterRows();
+}
+
+void tst_QNdefNfcSmartPosterRecordBench::parse()
+{
+    QFETCH(int, titleCount);
+    QFETCH(int, iconCount);
+
+    const QNdefRecord record = createPoster(titleCount, iconCount);
+
+    QBENCHMARK {
+        const QNdefNfcSmartPosterRecord poster(record);
+        QCOMPARE(poster.titleCount(), titleCount);
+    }
+}
+
+void tst_QNdefNfcSmartPosterRecordBench::modify_data()
+{
+    addPosterRows();
+}
+
+void tst_QNdefNfcSmartPosterRecordBench::modify()
+{
+    QFETCH(int, titleCount);
+    QFETCH(int, iconCount);
+
+    const QNdefNfcSmartPosterRecord poster = createPoster(titleCount, iconCount);
+
+    // Replacing a single title of an existing poster and writing it out again.
+    QBENCHMARK {
+        QNdefNfcSmartPosterRecord copy(poster);
+        QVERIFY(copy.removeTitle(QStringLiteral("l0")));
+        QVERIFY(copy.addTitle(QStringLiteral("Replaced title"), QStringLiteral("l0"),
+                              QNdefNfcTextRecord::Utf16));
+        QVERIFY(!QNdefMessage(copy).toByteArray().isEmpty());
+    }
+}
+
+QTEST_MAIN(tst_QNdefNfcSmartPosterRecordBench)
+
+#include "tst_bench_qndefnfcsmartposterrecord.moc"
@@ -0,0 +1,61 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtNfc/qndefmessage.h>
+#include <QtNfc/private/qndefmessageview_p.h>
+
+static void silence(QtMsgType, const QMessageLogContext &, const QString &) { }
+
+extern "C" int LLVMFuzzerTestOneInput(const char *Data, size_t Size)
+{
+    // Corrupted input is expected, don't spend the time on printing warnings.
+    static const QtMessageHandler handler = qInstallMessageHandler(silence);
+    Q_UNUSED(handler);
+
+    const QByteArrayView data(Data, qsizetype(Size));
+    const QNdefMessageView view(data);
+
+    for (const QNdefRecordView &record : view) {
+        if (record.payloadData().size() != record.payloadSize())
+            qFatal("Assembled payload size does not match the chunk headers");
+    }
+
+    if (!view.isValid())
+        return 0;
+
+    // Writing and reading back the parsed message must be lossless.
+    const QNdefMessage message = view.toMessage();
+    const QByteArray encoded = message.toByteArray();
+    if (!(QNdefMessage::fromByteArray(encoded) == message))
+        qFatal("NDEF message does not survive a round trip");
+    if (encoded.size() != QNdefMessageWriter::messageSize(message))
+        qFatal("Encoded message size does not match the precomputed size");
+
+    return 0;
+}